@@ -6,23 +6,32 @@
 // Globals
 //-----------------------------------------------------------------
 
-cbuffer basicCBuffer : register(b0) {
+cbuffer perFrameCBuffer : register(b0) {
 
-	float4x4			viewProjMatrix;
-	float4x4			worldITMatrix;				// Not used
-	float4x4			worldMatrix;				// Not used
-	float4x4			cameraViewMatrices[6];
-	float4				eyePos;
-	float4				lightVec;					// Not used
-	float4				lightAmbient;				// Not used
-	float4				lightDiffuse;				// Not used
-	float4				lightSpecular;				// Not used
+	float4x4			cubeFaceViewProjMatrices[6]; // Only used by the layered (single pass) cube map geometry shaders
+	float4				lightVec; // w=1: Vec represents position, w=0: Vec  represents direction.
+	float4				lightAmbient;
+	float4				lightDiffuse;
+	float4				lightSpecular;
 	float4				light2Vec; // w=1: Vec represents position, w=0: Vec  represents direction.
 	float4				light2Ambient;
 	float4				light2Diffuse;
 	float4				light2Specular;
-	float4				windDir;					// Not used
+	float4				windDir;
 	float				Timer;
+	float				grassHeight;
+};
+
+cbuffer perViewCBuffer : register(b1) {
+
+	float4x4			viewProjMatrix;
+	float4				eyePos;
+};
+
+cbuffer perObjectCBuffer : register(b2) {
+
+	float4x4			worldMatrix;
+	float4x4			worldITMatrix; // Correctly transform normals to world space
 };
 
 //-----------------------------------------------------------------
@@ -57,10 +66,11 @@ void main(point VertexInputPacket inputVertex[1],
 	float gPartLife = 0.7;//seconds
 	float gPartScale = 0.5;
 	float gPartSpeed = 2;
+	float gTimeScale = 3; // speed up particles
 
 	VertexOutputPacket		outputVertex;
 	float age = inputVertex[0].data.x;
-	float ptime = fmod(Timer + (age*gPartLife), gPartLife);
+	float ptime = fmod((Timer * gTimeScale) + (age*gPartLife), gPartLife);
 	float size = (gPartScale*ptime) + (gPartScale * 2);
 
 	// Compute world matrix so that billboard faces the camera.
@@ -85,7 +95,7 @@ void main(point VertexInputPacket inputVertex[1],
 			pos += ptime*inputVertex[0].vel*gPartSpeed;
 
 		// Transform to homogeneous clip space.
-		outputVertex.posH = mul(float4(pos, 1.0f), viewProjMatrix);
+		outputVertex.posH = mul(mul(float4(pos, 1.0f), worldMatrix), viewProjMatrix);
 		outputVertex.Z = outputVertex.posH;
 		outputVertex.texCoord = float2((posL[i].x + 1)*0.5, (posL[i].y + 1)*0.5);
 		outputTriangleStream.Append(outputVertex);
@@ -10,21 +10,36 @@
 // Globals
 //-----------------------------------------------------------------
 
-cbuffer basicCBuffer : register(b0) {
+cbuffer perFrameCBuffer : register(b0) {
 
-	float4x4			worldViewProjMatrix;
-	float4x4			worldITMatrix;				// Correctly transform normals to world space
-	float4x4			worldMatrix;
-	float4				eyePos;
-	float4				lightVec;					// w=1: Vec represents position, w=0: Vec  represents direction.
+	float4x4			cubeFaceViewProjMatrices[6]; // Only used by the layered (single pass) cube map geometry shaders
+	float4				lightVec; // w=1: Vec represents position, w=0: Vec  represents direction.
 	float4				lightAmbient;
 	float4				lightDiffuse;
 	float4				lightSpecular;
+	float4				light2Vec; // w=1: Vec represents position, w=0: Vec  represents direction.
+	float4				light2Ambient;
+	float4				light2Diffuse;
+	float4				light2Specular;
 	float4				windDir;
 	float				Timer;
 	float				grassHeight;
 };
 
+cbuffer perViewCBuffer : register(b1) {
+
+	float4x4			viewProjMatrix;
+	float4				eyePos;
+};
+
+cbuffer perObjectCBuffer : register(b2) {
+
+	float4x4			worldMatrix;
+	float4x4			worldITMatrix; // Correctly transform normals to world space
+	float4				matDiffuse; // a represents alpha.
+	float4				matSpecular; // a represents specular power.
+};
+
 
 
 
@@ -34,9 +49,7 @@ cbuffer basicCBuffer : register(b0) {
 struct vertexInputPacket {
 
 	float3				pos			: POSITION;
-	float3				normal		: NORMAL;
-	float4				matDiffuse	: DIFFUSE; // a represents alpha.
-	float4				matSpecular	: SPECULAR;  // a represents specular power. 
+	float4				normal		: NORMAL; // 10:10:10:2 UNORM - xyz = normal * 0.5 + 0.5 (see DXVertexCompact)
 	float2				texCoord	: TEXCOORD;
 };
 
@@ -70,12 +83,12 @@ vertexOutputPacket main(vertexInputPacket inputVertex) {
 	outputVertex.posW = mul(float4(pos, 1.0f), worldMatrix).xyz;
 	
 	// Transform normals to world space with gWorldIT.
-	outputVertex.normalW = mul(float4(inputVertex.normal, 1.0f), worldITMatrix).xyz;
+	outputVertex.normalW = mul(float4(inputVertex.normal.xyz * 2.0f - 1.0f, 1.0f), worldITMatrix).xyz;
 	//outputVertex.normalW = (normalTexture.Load(int3(inputVertex.texCoord.x * 1024, inputVertex.texCoord.y * 1024, 0)).xyz*2-1);
 	
 	// Pass through material properties
-	outputVertex.matDiffuse = inputVertex.matDiffuse;
-	outputVertex.matSpecular = inputVertex.matSpecular;
+	outputVertex.matDiffuse = matDiffuse;
+	outputVertex.matSpecular = matSpecular;
 	// .. and texture coordinates.
 	outputVertex.texCoord = inputVertex.texCoord;
 	
@@ -85,7 +98,7 @@ vertexOutputPacket main(vertexInputPacket inputVertex) {
 	float k = pow(grassHeight*200, 3);
 	float3 gWindDir = float3(sin(Timer)*0.05, 0, 0);
 	pos = pos + gWindDir*k;
-	outputVertex.posH = mul(float4(pos, 1.0), worldViewProjMatrix);
+	outputVertex.posH = mul(mul(float4(pos, 1.0), worldMatrix), viewProjMatrix);
 
 	return outputVertex;
 }
@@ -28,23 +28,6 @@ SamplerState gNormalLinearSam : register(s0);
 // Tri-linear sampler bound to sampler s1
 SamplerState gTriLinearSam : register(s1);
 
-// Globals
-
-cbuffer basicCBuffer : register(b0) {
-
-	float4x4			worldViewProjMatrix;
-	float4x4			worldITMatrix; // Correctly transform normals to world space
-	float4x4			worldMatrix;
-	float4				eyePos;
-	float4				lightVec; // w=1: Vec represents position, w=0: Vec  represents direction.
-	float4				lightAmbient;
-	float4				lightDiffuse;
-	float4				lightSpecular;
-	float4				windDir;
-	float				Timer;
-	float				grassHeight;
-};
-
 //-----------------------------------------------------------------
 // Input / Output structures
 //-----------------------------------------------------------------
@@ -16,31 +16,43 @@ Based partly on "Effective Water Simulation From Physical Models", GPU Gems
 //-----------------------------------------------------------------
 #define NWAVES 2
 
-cbuffer basicCBuffer : register(b0) {
+cbuffer perFrameCBuffer : register(b0) {
 
-	float4x4			worldViewProjMatrix;
-	float4x4			worldITMatrix;				// Correctly transform normals to world space
-	float4x4			worldMatrix;
-	float4				eyePos;
-
-	float4				lightVec;					// w=1: Vec represents position, w=0: Vec  represents direction.
+	float4x4			cubeFaceViewProjMatrices[6]; // Only used by the layered (single pass) cube map geometry shaders
+	float4				lightVec; // w=1: Vec represents position, w=0: Vec  represents direction.
 	float4				lightAmbient;
 	float4				lightDiffuse;
 	float4				lightSpecular;
+	float4				light2Vec; // w=1: Vec represents position, w=0: Vec  represents direction.
+	float4				light2Ambient;
+	float4				light2Diffuse;
+	float4				light2Specular;
 	float4				windDir;
 	float				Timer;
 	float				grassHeight;
 };
 
+cbuffer perViewCBuffer : register(b1) {
+
+	float4x4			viewProjMatrix;
+	float4				eyePos;
+};
+
+cbuffer perObjectCBuffer : register(b2) {
+
+	float4x4			worldMatrix;
+	float4x4			worldITMatrix; // Correctly transform normals to world space
+	float4				matDiffuse; // a represents alpha.
+	float4				matSpecular; // a represents specular power.
+};
+
 //-----------------------------------------------------------------
 // Input / Output structures
 //-----------------------------------------------------------------
 struct vertexInputPacket {
 
 	float3				pos			: POSITION;
-	float3				normal		: NORMAL;
-	float4				matDiffuse	: DIFFUSE;		// a represents alpha.
-	float4				matSpecular	: SPECULAR;		// a represents specular power. 
+	float4				normal		: NORMAL; // 10:10:10:2 UNORM - xyz = normal * 0.5 + 0.5 (see DXVertexCompact)
 	float2				texCoord	: TEXCOORD;
 };
 
@@ -122,7 +134,7 @@ vertexOutputPacket main(vertexInputPacket IN) {
 	float3 T = float3(0, ddy, 1);
 	float3 N = float3(-ddx, 1, -ddy);
 
-	OUT.posH = mul(Po, worldViewProjMatrix);
+	OUT.posH = mul(mul(Po, worldMatrix), viewProjMatrix);
 
 	// pass texture coordinates for fetching the normal map
 	float cycle = fmod(Timer, 100.0);
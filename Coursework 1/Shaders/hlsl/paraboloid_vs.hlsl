@@ -0,0 +1,84 @@
+
+// Ensure matrices are row-major
+#pragma pack_matrix(row_major)
+
+// Dual paraboloid vertex shader - per_pixel_lighting_vs with the paraboloid projection in place of the perspective projection.  The per-view matrix of a paraboloid view is its view matrix alone.  Each vertex is projected onto the paraboloid facing the view direction (the unit direction d from the centre maps to d.xy / (1 + d.z)) with depth the distance from the centre, and the hemisphere behind the view is clipped.  The projection is not linear so triangles are rasterized with straight edges between their projected corners - large triangles near the edge of the hemisphere bend less than they should.
+
+//-----------------------------------------------------------------
+// Globals
+//-----------------------------------------------------------------
+
+cbuffer perViewCBuffer : register(b1) {
+
+	float4x4			viewProjMatrix;
+	float4				eyePos;
+};
+
+cbuffer perObjectCBuffer : register(b2) {
+
+	float4x4			worldMatrix;
+	float4x4			worldITMatrix; // Correctly transform normals to world space
+	float4				matDiffuse; // a represents alpha.
+	float4				matSpecular; // a represents specular power.
+};
+
+// Far clip distance of the paraboloid views (Scene::FAR_DEPTH)
+static const float farDepth = 1000.0;
+
+// The clip plane is slightly behind the centre (as the z of a unit direction) so the paraboloid image covers the corners of the render target and texels at the edge of the hemisphere are not left cleared
+static const float hemisphereOverlap = 0.1;
+
+
+
+//-----------------------------------------------------------------
+// Input / Output structures
+//-----------------------------------------------------------------
+struct vertexInputPacket {
+
+	float3				pos			: POSITION;
+	float4				normal		: NORMAL; // 10:10:10:2 UNORM - xyz = normal * 0.5 + 0.5 (see DXVertexCompact)
+	float2				texCoord	: TEXCOORD;
+};
+
+
+struct vertexOutputPacket {
+
+
+	// Vertex in world coords
+	float3				posW			: POSITION;
+	// Normal in world coords
+	float3				normalW			: NORMAL;
+	float4				matDiffuse		: DIFFUSE;
+	float4				matSpecular		: SPECULAR;
+	float2				texCoord		: TEXCOORD;
+	float4				posH			: SV_POSITION;
+	float				clipDistance	: SV_ClipDistance0;
+};
+
+
+//-----------------------------------------------------------------
+// Vertex Shader
+//-----------------------------------------------------------------
+vertexOutputPacket main(vertexInputPacket inputVertex) {
+
+	vertexOutputPacket outputVertex;
+
+	// Lighting is calculated in world space.
+	outputVertex.posW = mul(float4(inputVertex.pos, 1.0f), worldMatrix).xyz;
+	// Transform normals to world space with gWorldIT.
+	outputVertex.normalW = mul(float4(inputVertex.normal.xyz * 2.0f - 1.0f, 1.0f), worldITMatrix).xyz;
+	// Pass through material properties
+	outputVertex.matDiffuse = matDiffuse;
+	outputVertex.matSpecular = matSpecular;
+	// .. and texture coordinates.
+	outputVertex.texCoord = inputVertex.texCoord;
+	// Finally project the view space direction of the vertex onto the paraboloid.  w is 1 so attributes are interpolated linearly across the paraboloid image.
+	float3 posV = mul(float4(outputVertex.posW, 1.0), viewProjMatrix).xyz;
+	float viewDistance = length(posV);
+	float3 d = posV / max(viewDistance, 1e-6);
+
+	outputVertex.posH = float4(d.xy / (1.0 + max(d.z, hemisphereOverlap - 1.0)), viewDistance / farDepth, 1.0);
+	outputVertex.clipDistance = d.z + hemisphereOverlap;
+
+	return outputVertex;
+}
@@ -15,13 +15,9 @@
 // Globals
 //-----------------------------------------------------------------
 
-cbuffer basicCBuffer : register(b0) {
+cbuffer perFrameCBuffer : register(b0) {
 
-	float4x4			worldViewProjMatrix;
-	float4x4			worldITMatrix; // Correctly transform normals to world space
-	float4x4			worldMatrix;
-	float4x4			cameraViewMatrices[6];
-	float4				eyePos;
+	float4x4			cubeFaceViewProjMatrices[6]; // Only used by the layered (single pass) cube map geometry shaders
 	float4				lightVec; // w=1: Vec represents position, w=0: Vec  represents direction.
 	float4				lightAmbient;
 	float4				lightDiffuse;
@@ -30,12 +26,15 @@ cbuffer basicCBuffer : register(b0) {
 	float4				light2Ambient;
 	float4				light2Diffuse;
 	float4				light2Specular;
-	
 	float4				windDir;
 	float				Timer;
 	float				grassHeight;
+};
 
+cbuffer perViewCBuffer : register(b1) {
 
+	float4x4			viewProjMatrix;
+	float4				eyePos;
 };
 
 
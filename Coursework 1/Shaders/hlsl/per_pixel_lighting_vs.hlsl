@@ -7,25 +7,18 @@
 // Globals
 //-----------------------------------------------------------------
 
-cbuffer basicCBuffer : register(b0) {
+cbuffer perViewCBuffer : register(b1) {
 
-	float4x4			worldViewProjMatrix;
-	float4x4			worldITMatrix; // Correctly transform normals to world space
-	float4x4			worldMatrix;
-	float4x4			cameraViewMatrices[6];
+	float4x4			viewProjMatrix;
 	float4				eyePos;
-	float4				lightVec; // w=1: Vec represents position, w=0: Vec  represents direction.
-	float4				lightAmbient;
-	float4				lightDiffuse;
-	float4				lightSpecular;
-	float4				windDir;
-	float				Timer;
-	float				grassHeight;
-
-	float4				light2Vec; // w=1: Vec represents position, w=0: Vec  represents direction.
-	float4				light2Ambient;
-	float4				light2Diffuse;
-	float4				light2Specular;
+};
+
+cbuffer perObjectCBuffer : register(b2) {
+
+	float4x4			worldMatrix;
+	float4x4			worldITMatrix; // Correctly transform normals to world space
+	float4				matDiffuse; // a represents alpha.
+	float4				matSpecular; // a represents specular power.
 };
 
 
@@ -36,9 +29,7 @@ cbuffer basicCBuffer : register(b0) {
 struct vertexInputPacket {
 
 	float3				pos			: POSITION;
-	float3				normal		: NORMAL;
-	float4				matDiffuse	: DIFFUSE; // a represents alpha.
-	float4				matSpecular	: SPECULAR;  // a represents specular power. 
+	float4				normal		: NORMAL; // 10:10:10:2 UNORM - xyz = normal * 0.5 + 0.5 (see DXVertexCompact)
 	float2				texCoord	: TEXCOORD;
 };
 
@@ -67,14 +58,14 @@ vertexOutputPacket main(vertexInputPacket inputVertex) {
 	// Lighting is calculated in world space.
 	outputVertex.posW = mul(float4(inputVertex.pos, 1.0f), worldMatrix).xyz;
 	// Transform normals to world space with gWorldIT.
-	outputVertex.normalW = mul(float4(inputVertex.normal, 1.0f), worldITMatrix).xyz;
+	outputVertex.normalW = mul(float4(inputVertex.normal.xyz * 2.0f - 1.0f, 1.0f), worldITMatrix).xyz;
 	// Pass through material properties
-	outputVertex.matDiffuse = inputVertex.matDiffuse;
-	outputVertex.matSpecular = inputVertex.matSpecular;
+	outputVertex.matDiffuse = matDiffuse;
+	outputVertex.matSpecular = matSpecular;
 	// .. and texture coordinates.
 	outputVertex.texCoord = inputVertex.texCoord;
-	// Finally transform/project pos to screen/clip space posH
-	outputVertex.posH = mul(float4(inputVertex.pos, 1.0), worldViewProjMatrix);
+	// Finally transform/project world space pos to screen/clip space posH
+	outputVertex.posH = mul(float4(outputVertex.posW, 1.0), viewProjMatrix);
 
 	return outputVertex;
 }
@@ -0,0 +1,100 @@
+
+//
+// Simplified lighting for the cube map (reflection) passes - ambient and the directional diffuse term of per_pixel_lighting_ps without the view dependent specular term.  Surfaces seen in the low resolution reflection lose little from it.
+//
+
+// Ensure matrices are row-major
+#pragma pack_matrix(row_major)
+
+
+//-----------------------------------------------------------------
+// Structures and resources
+//-----------------------------------------------------------------
+
+//-----------------------------------------------------------------
+// Globals
+//-----------------------------------------------------------------
+
+cbuffer perFrameCBuffer : register(b0) {
+
+	float4x4			cubeFaceViewProjMatrices[6]; // Only used by the layered (single pass) cube map geometry shaders
+	float4				lightVec; // w=1: Vec represents position, w=0: Vec  represents direction.
+	float4				lightAmbient;
+	float4				lightDiffuse;
+	float4				lightSpecular;
+	float4				light2Vec; // w=1: Vec represents position, w=0: Vec  represents direction.
+	float4				light2Ambient;
+	float4				light2Diffuse;
+	float4				light2Specular;
+	float4				windDir;
+	float				Timer;
+	float				grassHeight;
+};
+
+cbuffer perViewCBuffer : register(b1) {
+
+	float4x4			viewProjMatrix;
+	float4				eyePos;
+};
+
+
+//
+// Textures
+//
+
+// Assumes texture bound to texture t0 and sampler bound to sampler s0
+Texture2D myTexture : register(t0);
+SamplerState linearSampler : register(s0);
+
+
+
+
+//-----------------------------------------------------------------
+// Input / Output structures
+//-----------------------------------------------------------------
+
+// Input fragment - this is the per-fragment packet interpolated by the rasteriser stage
+struct FragmentInputPacket {
+
+	// Vertex in world coords
+	float3				posW			: POSITION;
+	// Normal in world coords
+	float3				normalW			: NORMAL;
+	float4				matDiffuse		: DIFFUSE; // a represents alpha.
+	float4				matSpecular		: SPECULAR; // a represents specular power. 
+	float2				texCoord		: TEXCOORD;
+	float4				posH			: SV_POSITION;
+};
+
+
+struct FragmentOutputPacket {
+
+	float4				fragmentColour : SV_TARGET;
+};
+
+
+//-----------------------------------------------------------------
+// Pixel Shader - Lighting 
+//-----------------------------------------------------------------
+
+FragmentOutputPacket main(FragmentInputPacket v) { 
+
+	FragmentOutputPacket outputFragment;
+
+	float3 N = normalize(v.normalW);
+
+	float4 baseColour = v.matDiffuse * myTexture.Sample(linearSampler, v.texCoord);
+
+	//Initialise returned colour to ambient component
+	float3 colour = baseColour.xyz * (lightAmbient.xyz + light2Ambient.xyz);
+
+	float3 lightDir = -lightVec.xyz; // Directional light
+	if (lightVec.w == 1.0)
+		lightDir = lightVec.xyz - v.posW; // Positional light
+	lightDir = normalize(lightDir);
+
+	colour += max(dot(lightDir, N), 0.0f) * baseColour.xyz * lightDiffuse.xyz;
+
+	outputFragment.fragmentColour = float4(colour, baseColour.a);
+	return outputFragment;
+}
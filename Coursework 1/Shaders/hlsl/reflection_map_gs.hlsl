@@ -2,12 +2,11 @@
 // Ensure matrices are row-major
 #pragma pack_matrix(row_major)
 
-cbuffer basicCBuffer : register(b0) {
-	float4x4			worldViewProjMatrix;
-	float4x4			worldITMatrix; // Correctly transform normals to world space
-	float4x4			worldMatrix;
-	float4x4			cameraViewMatrices[6];
-	float4				eyePos;
+// Layered (single pass) cube map geometry shader.  Each input triangle is transformed by the view-projection matrix of every cube map face and emitted to the faces whose frustum it may overlap, selected with SV_RenderTargetArrayIndex.  Only the world space position output by the vertex shader is used - the clip space position it computes for the bound view is replaced.
+
+cbuffer perFrameCBuffer : register(b0) {
+
+	float4x4			cubeFaceViewProjMatrices[6]; // Only used by the layered (single pass) cube map geometry shaders
 	float4				lightVec; // w=1: Vec represents position, w=0: Vec  represents direction.
 	float4				lightAmbient;
 	float4				lightDiffuse;
@@ -19,9 +18,9 @@ cbuffer basicCBuffer : register(b0) {
 	float4				windDir;
 	float				Timer;
 	float				grassHeight;
-}
+};
 
-//input to cube map geometry shader
+//input to cube map geometry shader - the output of the per-pixel lighting vertex shaders
 struct GS_CUBEMAP_IN
 {
 	// Vertex in world coords
@@ -37,45 +36,60 @@ struct GS_CUBEMAP_IN
 //output from cube map geometry shader
 struct PS_CUBEMAP_IN
 {
-	float3				posW			: POSITION; //set
+	float3				posW			: POSITION;
 	// Normal in world coords
-	float3				normalW			: NORMAL; //set
-	float4				matDiffuse		: DIFFUSE; // a represents alpha. //set
-	float4				matSpecular		: SPECULAR; // a represents specular power.  //set
-	float2				Tex				: TEXCOORD; //Texture coord //set
-	float4				Pos				: SV_POSITION; //Projection coord //set
+	float3				normalW			: NORMAL;
+	float4				matDiffuse		: DIFFUSE; // a represents alpha.
+	float4				matSpecular		: SPECULAR; // a represents specular power.
+	float2				texCoord		: TEXCOORD;
+	float4				posH			: SV_POSITION; //Projection coord
 
-	uint				RTIndex			: SV_RenderTargetArrayIndex; //set
+	uint				RTIndex			: SV_RenderTargetArrayIndex;
 };
 
+// Return true if all three clip space vertices are outside the same plane of the face frustum
+bool outsideFrustum(float4 p0, float4 p1, float4 p2)
+{
+	return (p0.x < -p0.w && p1.x < -p1.w && p2.x < -p2.w) ||
+		(p0.x > p0.w && p1.x > p1.w && p2.x > p2.w) ||
+		(p0.y < -p0.w && p1.y < -p1.w && p2.y < -p2.w) ||
+		(p0.y > p0.w && p1.y > p1.w && p2.y > p2.w) ||
+		(p0.z < 0 && p1.z < 0 && p2.z < 0) ||
+		(p0.z > p0.w && p1.z > p1.w && p2.z > p2.w);
+}
+
 [maxvertexcount(18)]
 void main(triangle GS_CUBEMAP_IN input[3],
 	inout TriangleStream<PS_CUBEMAP_IN> CubeMapStream)
 {
-	// For each triangle
-	for (int f = 0; f < 6; ++f)
+	for (uint f = 0; f < 6; ++f)
 	{
-		// Compute screen coordinates
+		float4 p[3];
+
+		// Transform the world space positions to the clip space of the face
+		for (int v = 0; v < 3; ++v)
+			p[v] = mul(float4(input[v].posW, 1.0f), cubeFaceViewProjMatrices[f]);
+
+		// Reject triangles that cannot be seen by the face
+		if (outsideFrustum(p[0], p[1], p[2]))
+			continue;
+
 		PS_CUBEMAP_IN output;
-		// Assign the ith triangle to the ith render target.
+
 		output.RTIndex = f;
-		// For each vertex in the triangle
-		for (int v = 0; v < 3; v++)
+
+		for (int v = 0; v < 3; ++v)
 		{
-			// Transform to the view space of the ith cube face.
-			output.Pos = mul(float4(input[v].posW, 1), cameraViewMatrices[f]);
-			// Transform to homogeneous clip space.
-			output.Pos = mul(output.Pos, worldViewProjMatrix);
-			output.Tex = input[v].texCoord;
-			
+			output.posW = input[v].posW;
+			output.normalW = input[v].normalW;
 			output.matDiffuse = input[v].matDiffuse;
 			output.matSpecular = input[v].matSpecular;
-			output.posW = mul(float4(input[v].posW, 1.0f), worldMatrix).xyz;
-			// Transform normals to world space with gWorldIT.
-			output.normalW = mul(float4(input[v].normalW, 1.0f), worldITMatrix).xyz;
+			output.texCoord = input[v].texCoord;
+			output.posH = p[v];
 
 			CubeMapStream.Append(output);
 		}
+
 		CubeMapStream.RestartStrip();
 	}
 }
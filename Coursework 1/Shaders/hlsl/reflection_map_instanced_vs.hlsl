@@ -0,0 +1,77 @@
+
+
+// Ensure matrices are row-major
+#pragma pack_matrix(row_major)
+
+//-----------------------------------------------------------------
+// Globals
+//-----------------------------------------------------------------
+
+cbuffer perViewCBuffer : register(b1) {
+
+	float4x4			viewProjMatrix;
+	float4				eyePos;
+};
+
+// Only the material colours are read - the transforms come from the instance stream
+cbuffer perObjectCBuffer : register(b2) {
+
+	float4x4			worldMatrix;
+	float4x4			worldITMatrix;
+	float4				matDiffuse; // a represents alpha.
+	float4				matSpecular; // a represents specular power.
+};
+
+
+
+//-----------------------------------------------------------------
+// Input / Output structures
+//-----------------------------------------------------------------
+struct vertexInputPacket {
+
+	float3				pos			: POSITION;
+	float4				normal		: NORMAL; // 10:10:10:2 UNORM - xyz = normal * 0.5 + 0.5 (see DXVertexCompact)
+	float2				texCoord	: TEXCOORD;
+
+	// Per-instance data (input slot 1) - replaces the transforms of the per-object cbuffer of reflection_map_vs
+	float4x4			worldMatrix		: WORLD;
+	float4x4			worldITMatrix	: WORLDIT; // Correctly transform normals to world space
+	float4				tint			: TINT;
+};
+
+
+struct vertexOutputPacket {
+
+
+	// Vertex in world coords
+	float3				posW			: POSITION;
+	// Normal in world coords
+	float3				normalW			: NORMAL;
+	float4				matDiffuse		: DIFFUSE;
+	float4				matSpecular		: SPECULAR;
+	float2				texCoord		: TEXCOORD;
+	float4				posH			: SV_POSITION;
+};
+
+
+//-----------------------------------------------------------------
+// Vertex Shader
+//-----------------------------------------------------------------
+vertexOutputPacket main(vertexInputPacket inputVertex) {
+
+	vertexOutputPacket outputVertex;
+
+	// Lighting is calculated in world space.
+	outputVertex.posW = mul(float4(inputVertex.pos, 1.0f), inputVertex.worldMatrix).xyz;
+	// Transform normals to world space with gWorldIT.
+	outputVertex.normalW = mul(float4(inputVertex.normal.xyz * 2.0f - 1.0f, 1.0f), inputVertex.worldITMatrix).xyz;
+	// Pass through material properties - the diffuse colour is tinted per instance
+	outputVertex.matDiffuse = matDiffuse * inputVertex.tint;
+	outputVertex.matSpecular = matSpecular;
+	// .. and texture coordinates.
+	outputVertex.texCoord = inputVertex.texCoord;
+	// Finally transform/project world space pos to screen/clip space posH
+	outputVertex.posH = mul(float4(outputVertex.posW, 1.0), viewProjMatrix);
+
+	return outputVertex;
+}
@@ -0,0 +1,59 @@
+
+// Ensure matrices are row-major
+#pragma pack_matrix(row_major)
+
+// Layered (single pass) cube map geometry shader for the sky box.  As reflection_map_gs but the projected depth is set to the far plane (z = w) as in sky_box_vs.
+
+cbuffer perFrameCBuffer : register(b0) {
+
+	float4x4			cubeFaceViewProjMatrices[6]; // Only used by the layered (single pass) cube map geometry shaders
+};
+
+struct GS_SKYBOX_IN
+{
+	float3				texCoord		: TEXCOORD;
+	float4				posH			: SV_POSITION; // World space position (see sky_box_layered_vs)
+};
+
+struct PS_SKYBOX_IN
+{
+	float3				texCoord		: TEXCOORD;
+	float4				posH			: SV_POSITION;
+
+	uint				RTIndex			: SV_RenderTargetArrayIndex;
+};
+
+[maxvertexcount(18)]
+void main(triangle GS_SKYBOX_IN input[3],
+	inout TriangleStream<PS_SKYBOX_IN> CubeMapStream)
+{
+	for (uint f = 0; f < 6; ++f)
+	{
+		float4 p[3];
+
+		for (int v = 0; v < 3; ++v)
+			p[v] = mul(float4(input[v].posH.xyz, 1.0f), cubeFaceViewProjMatrices[f]).xyww;
+
+		// Reject triangles outside the same side plane of the face (depth is always at the far plane)
+		if ((p[0].x < -p[0].w && p[1].x < -p[1].w && p[2].x < -p[2].w) ||
+			(p[0].x > p[0].w && p[1].x > p[1].w && p[2].x > p[2].w) ||
+			(p[0].y < -p[0].w && p[1].y < -p[1].w && p[2].y < -p[2].w) ||
+			(p[0].y > p[0].w && p[1].y > p[1].w && p[2].y > p[2].w) ||
+			(p[0].w <= 0 && p[1].w <= 0 && p[2].w <= 0))
+			continue;
+
+		PS_SKYBOX_IN output;
+
+		output.RTIndex = f;
+
+		for (int v = 0; v < 3; ++v)
+		{
+			output.texCoord = input[v].texCoord;
+			output.posH = p[v];
+
+			CubeMapStream.Append(output);
+		}
+
+		CubeMapStream.RestartStrip();
+	}
+}
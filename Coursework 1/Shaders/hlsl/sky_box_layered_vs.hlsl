@@ -0,0 +1,50 @@
+
+// Ensure matrices are row-major
+#pragma pack_matrix(row_major)
+
+// Sky box vertex shader for the layered cube map pass.  Outputs the world space position - the projection (with z set to the far plane) is applied per face by sky_box_gs.
+
+//-----------------------------------------------------------------
+// Globals
+//-----------------------------------------------------------------
+
+cbuffer perObjectCBuffer : register(b2) {
+
+	float4x4			worldMatrix;
+	float4x4			worldITMatrix; // Correctly transform normals to world space
+	float4				matDiffuse; // a represents alpha.
+	float4				matSpecular; // a represents specular power.
+};
+
+
+
+//-----------------------------------------------------------------
+// Input / Output structures
+//-----------------------------------------------------------------
+struct vertexInputPacket {
+
+	float3				pos			: POSITION;
+	float4				normal		: NORMAL; // 10:10:10:2 UNORM - xyz = normal * 0.5 + 0.5 (see DXVertexCompact)
+	float2				texCoord	: TEXCOORD;
+};
+
+
+struct vertexOutputPacket {
+
+	float3				texCoord		: TEXCOORD;
+	float4				posH			: SV_POSITION; // World space position
+};
+
+
+//-----------------------------------------------------------------
+// Vertex Shader
+//-----------------------------------------------------------------
+vertexOutputPacket main(vertexInputPacket inputVertex) {
+
+	vertexOutputPacket outputVertex;
+
+	outputVertex.texCoord = inputVertex.pos;
+	outputVertex.posH = mul(float4(inputVertex.pos, 1.0), worldMatrix);
+
+	return outputVertex;
+}
@@ -7,10 +7,18 @@
 // Globals
 //-----------------------------------------------------------------
 
-cbuffer basicCBuffer : register(b0) {
+cbuffer perViewCBuffer : register(b1) {
 
-	float4x4			worldViewProjMatrix;
+	float4x4			viewProjMatrix;
+	float4				eyePos;
+};
+
+cbuffer perObjectCBuffer : register(b2) {
 
+	float4x4			worldMatrix;
+	float4x4			worldITMatrix; // Correctly transform normals to world space
+	float4				matDiffuse; // a represents alpha.
+	float4				matSpecular; // a represents specular power.
 };
 
 
@@ -21,9 +29,7 @@ cbuffer basicCBuffer : register(b0) {
 struct vertexInputPacket {
 
 	float3				pos			: POSITION;
-	float3				normal		: NORMAL;
-	float4				matDiffuse	: DIFFUSE; // a represents alpha.
-	float4				matSpecular	: SPECULAR;  // a represents specular power. 
+	float4				normal		: NORMAL; // 10:10:10:2 UNORM - xyz = normal * 0.5 + 0.5 (see DXVertexCompact)
 	float2				texCoord	: TEXCOORD;
 };
 
@@ -47,7 +53,7 @@ vertexOutputPacket main(vertexInputPacket inputVertex) {
 	outputVertex.texCoord = inputVertex.pos;
 	
 	// Transform/project pos to screen/clip space posH ensuring that pos.z=1(far clipping plane)
-	outputVertex.posH = mul(float4(inputVertex.pos, 1.0), worldViewProjMatrix).xyww;
+	outputVertex.posH = mul(mul(float4(inputVertex.pos, 1.0), worldMatrix), viewProjMatrix).xyww;
 	//outputVertex.posH.z=200.0;
 
 	return outputVertex;
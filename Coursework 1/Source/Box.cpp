@@ -2,6 +2,8 @@
 #include <stdafx.h>
 #include <Box.h>
 #include <DXVertexExt.h>
+#include <DXVertexCompact.h>
+#include <vector>
 #include <iostream>
 #include <exception>
 #include <Effect.h>
@@ -57,7 +59,7 @@ static const DXVertexExt vertices[] = {
 };
 
 // Create the indices
-UINT indices[] = {
+uint16_t indices[] = {
 
 		// front face OK
 		0, 1, 2,
@@ -112,10 +114,15 @@ Box::Box(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *tex_vi
 		ZeroMemory(&vertexDesc, sizeof(D3D11_BUFFER_DESC));
 		ZeroMemory(&vertexData, sizeof(D3D11_SUBRESOURCE_DATA));
 
+		// The vertices are packed for upload (see DXVertexCompact) - their colours match the default per-object colours (see DXBaseModel::getMaterialColours)
+		vector<DXVertexCompact> packedVertices;
+
+		DXVertexCompact::packVertices(vertices, 24, &packedVertices);
+
 		vertexDesc.Usage = D3D11_USAGE_IMMUTABLE;
-		vertexDesc.ByteWidth = sizeof(DXVertexExt) * 24;
+		vertexDesc.ByteWidth = sizeof(DXVertexCompact) * 24;
 		vertexDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		vertexData.pSysMem = vertices;
+		vertexData.pSysMem = packedVertices.data();
 
 		HRESULT hr = device->CreateBuffer(&vertexDesc, &vertexData, &vertexBuffer);
 
@@ -124,7 +131,7 @@ Box::Box(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *tex_vi
 
 		D3D11_BUFFER_DESC indexDesc;
 		indexDesc.Usage = D3D11_USAGE_IMMUTABLE;
-		indexDesc.ByteWidth = sizeof(UINT) * 36;
+		indexDesc.ByteWidth = sizeof(uint16_t) * 36;
 		indexDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
 		indexDesc.CPUAccessFlags = 0;
 		indexDesc.MiscFlags = 0;
@@ -133,6 +140,7 @@ Box::Box(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *tex_vi
 		indexData.pSysMem = indices;
 		
 		hr = device->CreateBuffer(&indexDesc, &indexData, &indexBuffer);
+		indexFormat = DXGI_FORMAT_R16_UINT;
 		
 		if (!SUCCEEDED(hr))
 			throw exception("Vertex buffer cannot be created");
@@ -182,10 +190,6 @@ Box::Box(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *tex_vi
 
 Box::~Box() {
 
-	if (vertexBuffer)
-		vertexBuffer->Release();
-	if (indexBuffer)
-		indexBuffer->Release();
 	//if (effect)
 	//	effect->Release();
 
@@ -198,37 +202,36 @@ Box::~Box() {
 }
 
 
-void Box::render(ID3D11DeviceContext *context) {
+UINT Box::getTextures(ID3D11ShaderResourceView **views, ID3D11SamplerState **_sampler) {
+
+	if (!textureResourceView || !sampler)
+		return 0;
+
+	views[0] = textureResourceView;
+	*_sampler = sampler;
 
-	// set shader reflection map shaders for shark
-	context->VSSetShader(effect->getVertexShader(), 0, 0);
-	context->PSSetShader(effect->getPixelShader(), 0, 0);
-	
-	// Validate object before rendering (see notes in constructor)
-	if (!context || !vertexBuffer || !effect)
-		return;
+	return 1;
+}
+
+void Box::bindGeometry(DXContext *context) {
 
 	// Set vertex layout
 	context->IASetInputLayout(effect->getVSInputLayout());
 
 	// Set vertex and index buffers for IA
 	ID3D11Buffer* vertexBuffers[] = { vertexBuffer };
-	UINT vertexStrides[] = { sizeof(DXVertexExt) };
+	UINT vertexStrides[] = { sizeof(DXVertexCompact) };
 	UINT vertexOffsets[] = { 0 };
 
 	context->IASetVertexBuffers(0, 1, vertexBuffers, vertexStrides, vertexOffsets);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	context->IASetIndexBuffer(indexBuffer, indexFormat, 0);
 
 	// Set primitive topology for IA
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
 
-	// Bind texture resource views and texture sampler objects to the PS stage of the pipeline
-	if (textureResourceView && sampler) {
+void Box::draw(DXContext *context) {
 
-		context->PSSetShaderResources(0, 1, &textureResourceView);
-		context->PSSetSamplers(0, 1, &sampler);
-	}
-	effect->bindPipeline(context);
 	// Draw box object using index buffer
 	// 36 indices for the box.
 	context->DrawIndexed(36, 0, 0);
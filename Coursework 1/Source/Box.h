@@ -1,14 +1,12 @@
 #pragma once
 
-#include <GUObject.h>
+#include <DXBaseModel.h>
 class Effect;
+class DXContext;
 
 
-class Box : public GUObject {
+class Box : public DXBaseModel {
 
-	ID3D11Buffer					*vertexBuffer = nullptr;
-	ID3D11Buffer					*indexBuffer = nullptr;
-	Effect							*effect = nullptr;
 
 	// Augment box with texture view
 	ID3D11ShaderResourceView			*textureResourceView = nullptr;
@@ -18,5 +16,7 @@ public:
 	Box(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *tex_view);
 	~Box();
 	void setTexture(ID3D11ShaderResourceView *tex_view);
-	void render(ID3D11DeviceContext *context);
+	UINT getTextures(ID3D11ShaderResourceView **views, ID3D11SamplerState **_sampler);
+	void bindGeometry(DXContext *context);
+	void draw(DXContext *context);
 };
\ No newline at end of file
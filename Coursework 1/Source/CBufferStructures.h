@@ -1,14 +1,21 @@
 #pragma once
 using namespace DirectX;
 using namespace DirectX::PackedVector;
-// CBuffer struct
+// CBuffer structs
+// Constant data is split by update frequency so values shared by every object (lights, time) are uploaded once per frame, the camera once per view and only the transforms once per object
 // Use 16byte aligned so can use optimised XMMathFunctions instead of setting _XM_NO_INNTRINSICS_ define when compiling for x86
-__declspec(align(16)) struct CBufferExt  {
-	DirectX::XMMATRIX						WVPMatrix;
-	DirectX::XMMATRIX						worldITMatrix; // Correctly transform normals to world space
-	DirectX::XMMATRIX						worldMatrix;
-	DirectX::XMMATRIX						cameraViewMatrices[6];
-	DirectX::XMFLOAT4						eyePos;
+
+// Register slots of the constant buffers below (must match the register(bN) declarations in the HLSL)
+enum CBufferSlot {
+
+	CBufferSlotPerFrame = 0,
+	CBufferSlotPerView = 1,
+	CBufferSlotPerObject = 2
+};
+
+// Per-frame constants - register(b0)
+__declspec(align(16)) struct CBufferPerFrame {
+	DirectX::XMMATRIX						cubeFaceViewProjMatrices[6]; // Only used by the layered (single pass, geometry shader) cube map path
 	DirectX::XMFLOAT4						lightVec; // w=1: Vec represents position, w=0: Vec  represents direction.
 	DirectX::XMFLOAT4						lightAmbient;
 	DirectX::XMFLOAT4						lightDiffuse;
@@ -20,15 +27,25 @@ __declspec(align(16)) struct CBufferExt  {
 
 	// from terrain tutorial
 	DirectX::XMFLOAT4						windDir;
-	// Simple single light source properties
 	FLOAT									Timer;
 	// from terrain tutorial
 	FLOAT									grassHeight;
-	//// from terrain tutorial
-	//FLOAT									reflectionPass;
-	// from particle system tutorial
-	//FLOAT									fireHeight;
+	FLOAT									padding[2]; // HLSL starts each float4 on a 16 byte boundary
+	DirectX::XMFLOAT4						probeBlend; // x = weight of the second reflection probe (see reflection_probe_ps)
+};
 
+// Per-view constants - register(b1)
+__declspec(align(16)) struct CBufferPerView {
+	DirectX::XMMATRIX						viewProjMatrix;
+	DirectX::XMFLOAT4						eyePos;
+};
+
+// Per-object constants - register(b2)
+__declspec(align(16)) struct CBufferPerObject {
+	DirectX::XMMATRIX						worldMatrix;
+	DirectX::XMMATRIX						worldITMatrix; // Correctly transform normals to world space
+	DirectX::XMFLOAT4						matDiffuse; // Material colours (see DXBaseModel::getMaterialColours) - a represents alpha
+	DirectX::XMFLOAT4						matSpecular; // a represents specular power
 };
 
 __declspec(align(16)) struct camStruct {
@@ -0,0 +1,170 @@
+
+//
+// CookedMesh.cpp
+//
+
+#include <stdafx.h>
+#include <CookedMesh.h>
+
+using namespace std;
+
+
+const wchar_t *CookedMesh::Extension = L".cmesh";
+
+// Sections start on 16 byte boundaries
+static uint64_t alignSection(const uint64_t offset) {
+
+	return (offset + 15) & ~(uint64_t)15;
+}
+
+
+CookedMesh::CookedMesh() {
+}
+
+// Map the given cooked mesh file.  Returns nullptr if the file does not exist or is not a complete cooked mesh of the current version and vertex layout, including a sub-mesh table that draws outside the stored indices or vertices.
+CookedMesh* CookedMesh::CreateCookedMesh(const wstring &filename) {
+
+	HANDLE file = CreateFileW(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+
+	if (file == INVALID_HANDLE_VALUE)
+		return nullptr;
+
+	LARGE_INTEGER fileSize;
+
+	if (!GetFileSizeEx(file, &fileSize) || (uint64_t)fileSize.QuadPart < sizeof(Header)) {
+
+		CloseHandle(file);
+		return nullptr;
+	}
+
+	CookedMesh *cookedMesh = new CookedMesh();
+
+	cookedMesh->file = file;
+	cookedMesh->mapping = CreateFileMappingW(file, NULL, PAGE_READONLY, 0, 0, NULL);
+
+	if (cookedMesh->mapping)
+		cookedMesh->view = static_cast<const uint8_t*>(MapViewOfFile(cookedMesh->mapping, FILE_MAP_READ, 0, 0, 0));
+
+	if (!cookedMesh->view) {
+
+		cookedMesh->release();
+		return nullptr;
+	}
+
+	const Header *header = reinterpret_cast<const Header*>(cookedMesh->view);
+
+	// Every section must lie within the file
+	uint64_t size = (uint64_t)fileSize.QuadPart;
+	bool valid = header->magic == Magic && header->version == Version && header->vertexStride == sizeof(DXVertexCompact) && header->fileSize == size && header->numMeshes > 0
+		&& (header->indexStride == sizeof(uint16_t) || header->indexStride == sizeof(uint32_t))
+		&& header->meshTableOffset + (uint64_t)header->numMeshes * sizeof(SubMesh) <= size
+		&& header->vertexOffset + (uint64_t)header->numVertices * sizeof(DXVertexCompact) <= size
+		&& header->indexOffset + (uint64_t)header->numIndices * header->indexStride <= size;
+
+	// Every sub-mesh must draw indices and vertices within the file (its indices start where the previous sub-mesh's end)
+	if (valid) {
+
+		const SubMesh *meshes = reinterpret_cast<const SubMesh*>(cookedMesh->view + header->meshTableOffset);
+		uint64_t startIndex = 0;
+
+		for (uint32_t i = 0; i < header->numMeshes && valid; ++i) {
+
+			valid = startIndex + meshes[i].indexCount <= header->numIndices && meshes[i].baseVertex < header->numVertices;
+			startIndex += meshes[i].indexCount;
+		}
+	}
+
+	if (!valid) {
+
+		cookedMesh->release();
+		return nullptr;
+	}
+
+	cookedMesh->header = header;
+
+	return cookedMesh;
+}
+
+CookedMesh::~CookedMesh() {
+
+	if (view)
+		UnmapViewOfFile(view);
+
+	if (mapping)
+		CloseHandle(mapping);
+
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+}
+
+// Write a cooked mesh file.  The counts, index stride, source stamp and bounds are taken from header - the magic, version, vertex stride and offsets are filled in.  indices holds header.indexStride bytes per index.
+bool CookedMesh::write(const wstring &filename, const Header &header, const SubMesh *meshes, const DXVertexCompact *vertices, const void *indices) {
+
+	Header fileHeader = header;
+
+	fileHeader.magic = Magic;
+	fileHeader.version = Version;
+	fileHeader.vertexStride = sizeof(DXVertexCompact);
+	fileHeader.meshTableOffset = alignSection(sizeof(Header));
+	fileHeader.vertexOffset = alignSection(fileHeader.meshTableOffset + (uint64_t)header.numMeshes * sizeof(SubMesh));
+	fileHeader.indexOffset = alignSection(fileHeader.vertexOffset + (uint64_t)header.numVertices * sizeof(DXVertexCompact));
+	fileHeader.fileSize = fileHeader.indexOffset + (uint64_t)header.numIndices * header.indexStride;
+
+	ofstream out(filename.c_str(), ios::binary);
+
+	if (!out)
+		return false;
+
+	static const char padding[16] = {};
+
+	out.write(reinterpret_cast<const char*>(&fileHeader), sizeof(Header));
+	out.write(padding, (streamsize)(fileHeader.meshTableOffset - sizeof(Header)));
+	out.write(reinterpret_cast<const char*>(meshes), (streamsize)header.numMeshes * sizeof(SubMesh));
+	out.write(padding, (streamsize)(fileHeader.vertexOffset - (fileHeader.meshTableOffset + (uint64_t)header.numMeshes * sizeof(SubMesh))));
+	out.write(reinterpret_cast<const char*>(vertices), (streamsize)header.numVertices * sizeof(DXVertexCompact));
+	out.write(padding, (streamsize)(fileHeader.indexOffset - (fileHeader.vertexOffset + (uint64_t)header.numVertices * sizeof(DXVertexCompact))));
+	out.write(reinterpret_cast<const char*>(indices), (streamsize)header.numIndices * header.indexStride);
+
+	return out.good();
+}
+
+// Return the size and last write time of a file.  Returns false if the file does not exist.
+bool CookedMesh::getFileStamp(const wstring &filename, uint64_t *size, uint64_t *writeTime) {
+
+	WIN32_FILE_ATTRIBUTE_DATA attributes;
+
+	if (!GetFileAttributesExW(filename.c_str(), GetFileExInfoStandard, &attributes))
+		return false;
+
+	*size = ((uint64_t)attributes.nFileSizeHigh << 32) | attributes.nFileSizeLow;
+	*writeTime = ((uint64_t)attributes.ftLastWriteTime.dwHighDateTime << 32) | attributes.ftLastWriteTime.dwLowDateTime;
+
+	return true;
+}
+
+
+// Accessor methods
+const CookedMesh::Header* CookedMesh::getHeader() const {
+
+	return header;
+}
+
+const CookedMesh::SubMesh* CookedMesh::getMeshes() const {
+
+	return reinterpret_cast<const SubMesh*>(view + header->meshTableOffset);
+}
+
+const DXVertexCompact* CookedMesh::getVertices() const {
+
+	return reinterpret_cast<const DXVertexCompact*>(view + header->vertexOffset);
+}
+
+const void* CookedMesh::getIndices() const {
+
+	return view + header->indexOffset;
+}
+
+DXGI_FORMAT CookedMesh::getIndexFormat() const {
+
+	return (header->indexStride == sizeof(uint16_t)) ? DXGI_FORMAT_R16_UINT : DXGI_FORMAT_R32_UINT;
+}
@@ -0,0 +1,83 @@
+//
+// CookedMesh.h
+//
+
+// Cooked model meshes.  A cooked mesh file holds the result of Model's import of a source model (obj, 3ds or gsf) - the DXVertexCompact vertices and left-handed indices of every sub-mesh ready for upload (already reordered by MeshOptimizer, and 16 bit when every index fits), the sub-mesh table and the bounding sphere - behind a versioned header.  The file is mapped into memory and Model creates its buffers straight from the mapped view, so loading a cooked mesh costs the file read with no parsing or copying.
+//
+// Cooked files are written next to their source with Extension appended when models are loaded with Model::setCookModels(true).  Each file records the size and last write time of its source - a file that no longer matches is ignored and the source is imported instead.  Material colours are not stored, so a cooked mesh stays valid when its material changes.
+
+#pragma once
+
+#include <GUObject.h>
+#include <DXVertexCompact.h>
+#include <cstdint>
+#include <string>
+
+
+class CookedMesh : public GUObject {
+
+public:
+
+	// File header.  The sub-mesh table, vertices and indices follow at the given offsets from the start of the file (each 16 byte aligned).
+	struct Header {
+
+		uint32_t						magic;
+		uint32_t						version;
+		uint32_t						vertexStride; // sizeof(DXVertexCompact) when the file was cooked
+		uint32_t						indexStride; // 2 or 4 bytes
+		uint32_t						numMeshes;
+		uint32_t						numVertices;
+		uint32_t						numIndices;
+		uint32_t						reserved;
+		uint64_t						sourceSize; // size and last write time of the source model
+		uint64_t						sourceWriteTime;
+		float							boundsCentre[3]; // model space bounding sphere
+		float							boundsRadius;
+		uint64_t						meshTableOffset;
+		uint64_t						vertexOffset;
+		uint64_t						indexOffset;
+		uint64_t						fileSize;
+	};
+
+	// Sub-mesh table entry.  Indices are relative to the base vertex of their sub-mesh and the sub-meshes' indices are stored in order.
+	struct SubMesh {
+
+		uint32_t						baseVertex;
+		uint32_t						indexCount;
+	};
+
+	static const uint32_t				Magic = 0x48534D43; // "CMSH"
+	static const uint32_t				Version = 3; // 2 - triangles and vertices reordered by MeshOptimizer, 3 - DXVertexCompact vertices, 16 bit indices and no material colours
+
+	// Appended to the source model filename to name its cooked mesh
+	static const wchar_t				*Extension;
+
+private:
+
+	HANDLE								file = INVALID_HANDLE_VALUE;
+	HANDLE								mapping = NULL;
+	const uint8_t						*view = nullptr;
+	const Header						*header = nullptr;
+
+	CookedMesh();
+
+public:
+
+	// Map the given cooked mesh file.  Returns nullptr if the file does not exist or is not a complete cooked mesh of the current version and vertex layout, including a sub-mesh table that draws outside the stored indices or vertices.
+	static CookedMesh* CreateCookedMesh(const std::wstring &filename);
+
+	~CookedMesh();
+
+	// Write a cooked mesh file.  The counts, index stride, source stamp and bounds are taken from header - the magic, version, vertex stride and offsets are filled in.  indices holds header.indexStride bytes per index.
+	static bool write(const std::wstring &filename, const Header &header, const SubMesh *meshes, const DXVertexCompact *vertices, const void *indices);
+
+	// Return the size and last write time of a file.  Returns false if the file does not exist.
+	static bool getFileStamp(const std::wstring &filename, uint64_t *size, uint64_t *writeTime);
+
+	// Accessor methods - the pointers are into the mapped file and valid while the CookedMesh exists
+	const Header* getHeader() const;
+	const SubMesh* getMeshes() const;
+	const DXVertexCompact* getVertices() const;
+	const void* getIndices() const;
+	DXGI_FORMAT getIndexFormat() const;
+};
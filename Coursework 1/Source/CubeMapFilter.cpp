@@ -0,0 +1,441 @@
+
+//
+// CubeMapFilter.cpp
+//
+
+#include <stdafx.h>
+#include <CubeMapFilter.h>
+#include <WorkerPool.h>
+#include <cmath>
+#include <cstring>
+#include <fstream>
+#include <emmintrin.h>
+
+using namespace std;
+
+
+// DDS header fields read by readCubeDDS (see the DDS_HEADER and DDS_HEADER_DXT10 documentation)
+static const uint32_t DDSMagic = 0x20534444; // "DDS "
+static const uint32_t DDSFourCC_DX10 = 0x30315844; // "DX10"
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static const uint32_t DDPF_ALPHAPIXELS = 0x1;
+static const uint32_t DDPF_RGB = 0x40;
+static const uint32_t DDSCAPS2_CUBEMAP_ALLFACES = 0xFE00;
+static const uint32_t DXGIFormatR8G8B8A8 = 28;
+static const uint32_t DXGIFormatR8G8B8A8SRGB = 29;
+static const uint32_t DXGIFormatB8G8R8A8 = 87;
+static const uint32_t DXGIFormatB8G8R8A8SRGB = 91;
+static const uint32_t D3D10MiscTextureCube = 0x4;
+
+static const float Pi = 3.14159265f;
+
+
+// One level of the box filtered source chain - 6 faces of size x size texels of 4 floats
+struct SourceLevel {
+
+	int					size;
+	vector<float>		texels;
+};
+
+
+// Return the direction through (u, v) in [-1, 1] of the given cube map face (Direct3D face orientation, v down)
+static void faceDirection(const int face, const float u, const float v, float *dir) {
+
+	switch (face) {
+
+	case 0: dir[0] = 1.0f; dir[1] = -v; dir[2] = -u; break;
+	case 1: dir[0] = -1.0f; dir[1] = -v; dir[2] = u; break;
+	case 2: dir[0] = u; dir[1] = 1.0f; dir[2] = v; break;
+	case 3: dir[0] = u; dir[1] = -1.0f; dir[2] = -v; break;
+	case 4: dir[0] = u; dir[1] = -v; dir[2] = 1.0f; break;
+	default: dir[0] = -u; dir[1] = -v; dir[2] = -1.0f; break;
+	}
+}
+
+// Return a where mask is set and b elsewhere
+static inline __m128 select(const __m128 mask, const __m128 a, const __m128 b) {
+
+	return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b));
+}
+
+// Add the bilinear samples in four directions to colour (R, G, B, A), each scaled by its lane of weights.  Lane i reads the source level of sizes[i] x sizes[i] texels at levelTexels[i].  The face each direction passes through, the texel coordinates and the bilinear weights are found for the four lanes together - only the texel reads are made lane by lane.  Lanes with no weight are skipped and samples are clamped to the edges of the face.
+static void addSamples(const __m128 dirX, const __m128 dirY, const __m128 dirZ, const float *weights, const float *sizes, const float * const *levelTexels, __m128 *colour) {
+
+	const __m128 zero = _mm_setzero_ps();
+	const __m128 one = _mm_set1_ps(1.0f);
+	const __m128 half = _mm_set1_ps(0.5f);
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+
+	__m128 ax = _mm_andnot_ps(signBit, dirX);
+	__m128 ay = _mm_andnot_ps(signBit, dirY);
+	__m128 az = _mm_andnot_ps(signBit, dirZ);
+
+	// The major axis picks the face - x wins ties with y and z, y wins ties with z
+	__m128 xMajor = _mm_and_ps(_mm_cmpge_ps(ax, ay), _mm_cmpge_ps(ax, az));
+	__m128 yMajor = _mm_andnot_ps(xMajor, _mm_cmpge_ps(ay, az));
+
+	__m128 xPositive = _mm_cmpgt_ps(dirX, zero);
+	__m128 yPositive = _mm_cmpgt_ps(dirY, zero);
+	__m128 zPositive = _mm_cmpgt_ps(dirZ, zero);
+
+	__m128 negX = _mm_xor_ps(dirX, signBit);
+	__m128 negY = _mm_xor_ps(dirY, signBit);
+	__m128 negZ = _mm_xor_ps(dirZ, signBit);
+
+	__m128 inv = _mm_div_ps(one, select(xMajor, ax, select(yMajor, ay, az)));
+
+	// (u, v) in [-1, 1] on the face (Direct3D face orientation, v down - see faceDirection)
+	__m128 u = _mm_mul_ps(select(xMajor, select(xPositive, negZ, dirZ), select(yMajor, dirX, select(zPositive, dirX, negX))), inv);
+	__m128 v = _mm_mul_ps(select(yMajor, select(yPositive, dirZ, negZ), negY), inv);
+
+	__m128 face = select(xMajor, select(xPositive, _mm_set1_ps(0.0f), _mm_set1_ps(1.0f)), select(yMajor, select(yPositive, _mm_set1_ps(2.0f), _mm_set1_ps(3.0f)), select(zPositive, _mm_set1_ps(4.0f), _mm_set1_ps(5.0f))));
+
+	// Texel coordinates of the top left tap and the bilinear weights of the four taps
+	__m128 size = _mm_loadu_ps(sizes);
+	__m128 maxCoord = _mm_sub_ps(size, one);
+
+	__m128 x = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(_mm_add_ps(u, one), half), size), half), zero), maxCoord);
+	__m128 y = _mm_min_ps(_mm_max_ps(_mm_sub_ps(_mm_mul_ps(_mm_mul_ps(_mm_add_ps(v, one), half), size), half), zero), maxCoord);
+
+	__m128 x0 = _mm_cvtepi32_ps(_mm_cvttps_epi32(x));
+	__m128 y0 = _mm_cvtepi32_ps(_mm_cvttps_epi32(y));
+	__m128 x1 = _mm_min_ps(_mm_add_ps(x0, one), maxCoord);
+	__m128 y1 = _mm_min_ps(_mm_add_ps(y0, one), maxCoord);
+
+	__m128 fx = _mm_sub_ps(x, x0);
+	__m128 fy = _mm_sub_ps(y, y0);
+	__m128 gx = _mm_sub_ps(one, fx);
+	__m128 gy = _mm_sub_ps(one, fy);
+	__m128 weight = _mm_loadu_ps(weights);
+
+	float w00[4], w10[4], w01[4], w11[4];
+
+	_mm_storeu_ps(w00, _mm_mul_ps(_mm_mul_ps(gx, gy), weight));
+	_mm_storeu_ps(w10, _mm_mul_ps(_mm_mul_ps(fx, gy), weight));
+	_mm_storeu_ps(w01, _mm_mul_ps(_mm_mul_ps(gx, fy), weight));
+	_mm_storeu_ps(w11, _mm_mul_ps(_mm_mul_ps(fx, fy), weight));
+
+	// Texel offsets of the taps - row r of face f starts at texel (f * size + r) * size
+	int faces[4], columns0[4], columns1[4], rows0[4], rows1[4];
+
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(faces), _mm_cvttps_epi32(face));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(columns0), _mm_cvttps_epi32(x0));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(columns1), _mm_cvttps_epi32(x1));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(rows0), _mm_cvttps_epi32(y0));
+	_mm_storeu_si128(reinterpret_cast<__m128i*>(rows1), _mm_cvttps_epi32(y1));
+
+	__m128 sum = *colour;
+
+	for (int lane = 0; lane < 4; lane++) {
+
+		if (weights[lane] <= 0.0f)
+			continue;
+
+		size_t laneSize = (size_t)sizes[lane];
+		const float *texels = levelTexels[lane] + (size_t)faces[lane] * laneSize * laneSize * 4;
+		const float *row0 = texels + rows0[lane] * laneSize * 4;
+		const float *row1 = texels + rows1[lane] * laneSize * 4;
+
+		__m128 taps = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(row0 + columns0[lane] * 4), _mm_set1_ps(w00[lane])), _mm_mul_ps(_mm_loadu_ps(row0 + columns1[lane] * 4), _mm_set1_ps(w10[lane])));
+
+		taps = _mm_add_ps(taps, _mm_mul_ps(_mm_loadu_ps(row1 + columns0[lane] * 4), _mm_set1_ps(w01[lane])));
+		taps = _mm_add_ps(taps, _mm_mul_ps(_mm_loadu_ps(row1 + columns1[lane] * 4), _mm_set1_ps(w11[lane])));
+
+		sum = _mm_add_ps(sum, taps);
+	}
+
+	*colour = sum;
+}
+
+// Van der Corput radical inverse of i (the second coordinate of the Hammersley point set)
+static float radicalInverse(uint32_t i) {
+
+	i = (i << 16) | (i >> 16);
+	i = ((i & 0x55555555u) << 1) | ((i & 0xAAAAAAAAu) >> 1);
+	i = ((i & 0x33333333u) << 2) | ((i & 0xCCCCCCCCu) >> 2);
+	i = ((i & 0x0F0F0F0Fu) << 4) | ((i & 0xF0F0F0F0u) >> 4);
+	i = ((i & 0x00FF00FFu) << 8) | ((i & 0xFF00FF00u) >> 8);
+
+	return (float)i * 2.3283064365386963e-10f;
+}
+
+
+// Prefilter the size x size cube map texels (the 6 faces of a single level) into mipLevels levels with sampleCount samples per texel.  filtered receives every level of face +X, then every level of face -X and so on (DDS order, see ReflectionProbeSet::writeCubeDDS).  Rows are filtered in parallel if a pool is given.
+void CubeMapFilter::prefilterGGX(const uint8_t *texels, const int size, const int mipLevels, const int sampleCount, WorkerPool *pool, vector<uint8_t> *filtered) {
+
+	int levels = min(max(mipLevels, 1), getMipLevelCount(size));
+
+	// Box filtered source chain
+	vector<SourceLevel> source(getMipLevelCount(size));
+
+	source[0].size = size;
+	source[0].texels.resize((size_t)6 * size * size * 4);
+
+	for (size_t i = 0; i < source[0].texels.size(); i++)
+		source[0].texels[i] = texels[i] * (1.0f / 255.0f);
+
+	for (size_t l = 1; l < source.size(); l++) {
+
+		const SourceLevel &parent = source[l - 1];
+		int levelSize = max(parent.size >> 1, 1);
+
+		source[l].size = levelSize;
+		source[l].texels.resize((size_t)6 * levelSize * levelSize * 4);
+
+		for (int face = 0; face < 6; face++) {
+
+			for (int y = 0; y < levelSize; y++) {
+
+				for (int x = 0; x < levelSize; x++) {
+
+					for (int c = 0; c < 4; c++) {
+
+						const float *p = &parent.texels[(size_t)face * parent.size * parent.size * 4];
+						int px = x * 2, py = y * 2;
+						int px1 = min(px + 1, parent.size - 1), py1 = min(py + 1, parent.size - 1);
+
+						source[l].texels[(((size_t)face * levelSize + y) * levelSize + x) * 4 + c] = 0.25f * (p[(py * parent.size + px) * 4 + c] + p[(py * parent.size + px1) * 4 + c] + p[(py1 * parent.size + px) * 4 + c] + p[(py1 * parent.size + px1) * 4 + c]);
+					}
+				}
+			}
+		}
+	}
+
+	// Offset of each level within a face of the output
+	vector<size_t> levelOffset(levels);
+	size_t faceBytes = 0;
+
+	for (int l = 0; l < levels; l++) {
+
+		size_t levelSize = (size_t)max(size >> l, 1);
+
+		levelOffset[l] = faceBytes;
+		faceBytes += levelSize * levelSize * 4;
+	}
+
+	filtered->resize(faceBytes * 6);
+
+	// The most detailed level is the mirror reflection (roughness 0)
+	for (int face = 0; face < 6; face++)
+		memcpy(&(*filtered)[face * faceBytes], texels + (size_t)face * size * size * 4, (size_t)size * size * 4);
+
+	const int count = max(sampleCount, 1);
+	const int paddedCount = (count + 3) & ~3;
+	const float texelSolidAngle = 4.0f * Pi / (6.0f * size * size);
+
+	for (int l = 1; l < levels; l++) {
+
+		// Tangent space sample directions (the normal is +z) of the GGX lobe, their weight (N.L) and the source level they are read from.  Padding samples have no weight.
+		float roughness = (float)l / (float)(levels - 1);
+		float alpha2 = roughness * roughness * roughness * roughness;
+
+		vector<float> sampleX(paddedCount, 0.0f), sampleY(paddedCount, 0.0f), sampleZ(paddedCount, 1.0f), sampleWeight(paddedCount, 0.0f);
+		vector<float> sampleSize(paddedCount, (float)size);
+		vector<const float*> sampleTexels(paddedCount, source[0].texels.data());
+		float totalWeight = 0.0f;
+
+		for (int i = 0; i < count; i++) {
+
+			float phi = 2.0f * Pi * ((float)i + 0.5f) / (float)count;
+			float xi = radicalInverse((uint32_t)i);
+			float cosTheta = sqrtf((1.0f - xi) / (1.0f + (alpha2 - 1.0f) * xi));
+			float sinTheta = sqrtf(max(1.0f - cosTheta * cosTheta, 0.0f));
+
+			// Reflect the view direction (the normal) about the half vector
+			float hx = sinTheta * cosf(phi), hy = sinTheta * sinf(phi), hz = cosTheta;
+			float lz = 2.0f * hz * hz - 1.0f;
+
+			if (lz <= 0.0f)
+				continue;
+
+			// pdf of the reflected direction is D(h) / 4 when the view direction is the normal
+			float d = (hz * hz * (alpha2 - 1.0f) + 1.0f);
+			float pdf = alpha2 / (Pi * d * d) * 0.25f;
+			float sampleSolidAngle = 1.0f / ((float)count * pdf + 1e-6f);
+
+			sampleX[i] = 2.0f * hz * hx;
+			sampleY[i] = 2.0f * hz * hy;
+			sampleZ[i] = lz;
+			sampleWeight[i] = lz;
+			totalWeight += lz;
+
+			int sampleLevel = min(max((int)(0.5f * log2f(sampleSolidAngle / texelSolidAngle) + 1.0f), 0), (int)source.size() - 1);
+
+			sampleSize[i] = (float)source[sampleLevel].size;
+			sampleTexels[i] = source[sampleLevel].texels.data();
+		}
+
+		const float invWeight = (totalWeight > 0.0f) ? 1.0f / totalWeight : 0.0f;
+		const int levelSize = max(size >> l, 1);
+
+		auto filterRow = [&](int row) {
+
+			int face = row / levelSize;
+			int y = row % levelSize;
+			uint8_t *out = &(*filtered)[face * faceBytes + levelOffset[l] + (size_t)y * levelSize * 4];
+
+			for (int x = 0; x < levelSize; x++) {
+
+				float n[3];
+
+				faceDirection(face, (x + 0.5f) * 2.0f / levelSize - 1.0f, (y + 0.5f) * 2.0f / levelSize - 1.0f, n);
+
+				float invLength = 1.0f / sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+				n[0] *= invLength;
+				n[1] *= invLength;
+				n[2] *= invLength;
+
+				// Tangent frame of the texel direction
+				float up[3] = { 0.0f, 0.0f, 0.0f };
+
+				up[(fabsf(n[2]) < 0.999f) ? 2 : 0] = 1.0f;
+
+				float t[3] = { up[1] * n[2] - up[2] * n[1], up[2] * n[0] - up[0] * n[2], up[0] * n[1] - up[1] * n[0] };
+				float invTLength = 1.0f / sqrtf(t[0] * t[0] + t[1] * t[1] + t[2] * t[2]);
+
+				t[0] *= invTLength;
+				t[1] *= invTLength;
+				t[2] *= invTLength;
+
+				float b[3] = { n[1] * t[2] - n[2] * t[1], n[2] * t[0] - n[0] * t[2], n[0] * t[1] - n[1] * t[0] };
+
+				__m128 tx = _mm_set1_ps(t[0]), ty = _mm_set1_ps(t[1]), tz = _mm_set1_ps(t[2]);
+				__m128 bx = _mm_set1_ps(b[0]), by = _mm_set1_ps(b[1]), bz = _mm_set1_ps(b[2]);
+				__m128 nx = _mm_set1_ps(n[0]), ny = _mm_set1_ps(n[1]), nz = _mm_set1_ps(n[2]);
+
+				__m128 sum = _mm_setzero_ps();
+
+				// Rotate four samples at a time to the texel's frame and sample the source in those directions
+				for (int i = 0; i < paddedCount; i += 4) {
+
+					__m128 sx = _mm_loadu_ps(&sampleX[i]);
+					__m128 sy = _mm_loadu_ps(&sampleY[i]);
+					__m128 sz = _mm_loadu_ps(&sampleZ[i]);
+
+					__m128 wx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, tx), _mm_mul_ps(sy, bx)), _mm_mul_ps(sz, nx));
+					__m128 wy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, ty), _mm_mul_ps(sy, by)), _mm_mul_ps(sz, ny));
+					__m128 wz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(sx, tz), _mm_mul_ps(sy, bz)), _mm_mul_ps(sz, nz));
+
+					addSamples(wx, wy, wz, &sampleWeight[i], &sampleSize[i], &sampleTexels[i], &sum);
+				}
+
+				float colour[4];
+
+				_mm_storeu_ps(colour, sum);
+
+				for (int c = 0; c < 4; c++)
+					out[x * 4 + c] = (uint8_t)min(max(colour[c] * invWeight * 255.0f + 0.5f, 0.0f), 255.0f);
+			}
+		};
+
+		if (pool)
+			pool->parallelFor(6 * levelSize, filterRow);
+		else {
+
+			for (int row = 0; row < 6 * levelSize; row++)
+				filterRow(row);
+		}
+	}
+}
+
+// Read the most detailed level of an uncompressed 32 bit RGBA or BGRA DDS cube map into texels (converted to RGBA).  Returns false if the file is missing or not in a supported format.
+bool CubeMapFilter::readCubeDDS(const string &filename, int *size, vector<uint8_t> *texels) {
+
+	ifstream file(filename.c_str(), ios::binary);
+
+	if (!file)
+		return false;
+
+	uint32_t magic = 0;
+	uint32_t header[31];
+
+	file.read(reinterpret_cast<char*>(&magic), sizeof(magic));
+	file.read(reinterpret_cast<char*>(header), sizeof(header));
+
+	if (!file || magic != DDSMagic || header[0] != sizeof(header) || header[2] != header[3] || header[2] == 0)
+		return false;
+
+	bool bgra;
+
+	if (header[20] == DDSFourCC_DX10) {
+
+		uint32_t dx10Header[5];
+
+		file.read(reinterpret_cast<char*>(dx10Header), sizeof(dx10Header));
+
+		if (!file || !(dx10Header[2] & D3D10MiscTextureCube) || dx10Header[3] != 1)
+			return false;
+
+		if (dx10Header[0] == DXGIFormatR8G8B8A8 || dx10Header[0] == DXGIFormatR8G8B8A8SRGB)
+			bgra = false;
+		else if (dx10Header[0] == DXGIFormatB8G8R8A8 || dx10Header[0] == DXGIFormatB8G8R8A8SRGB)
+			bgra = true;
+		else
+			return false;
+	}
+	else {
+
+		if ((header[27] & DDSCAPS2_CUBEMAP_ALLFACES) != DDSCAPS2_CUBEMAP_ALLFACES || !(header[19] & DDPF_RGB) || header[21] != 32)
+			return false;
+
+		if (header[22] == 0x000000FF && header[23] == 0x0000FF00 && header[24] == 0x00FF0000)
+			bgra = false;
+		else if (header[22] == 0x00FF0000 && header[23] == 0x0000FF00 && header[24] == 0x000000FF)
+			bgra = true;
+		else
+			return false;
+	}
+
+	// Formats without alpha are read as opaque
+	bool opaque = (header[20] != DDSFourCC_DX10) && !((header[19] & DDPF_ALPHAPIXELS) && header[25]);
+
+	int faceSize = (int)header[2];
+	int mipCount = ((header[1] & DDSD_MIPMAPCOUNT) && header[6] > 0) ? (int)header[6] : 1;
+	size_t levelBytes = (size_t)faceSize * faceSize * 4;
+	size_t faceBytes = 0;
+
+	for (int l = 0; l < mipCount; l++) {
+
+		size_t mipSize = (size_t)max(faceSize >> l, 1);
+
+		faceBytes += mipSize * mipSize * 4;
+	}
+
+	vector<uint8_t> data(faceBytes * 6);
+
+	file.read(reinterpret_cast<char*>(data.data()), data.size());
+
+	if (!file)
+		return false;
+
+	*size = faceSize;
+	texels->resize(levelBytes * 6);
+
+	for (int face = 0; face < 6; face++) {
+
+		const uint8_t *src = &data[face * faceBytes];
+		uint8_t *dst = &(*texels)[face * levelBytes];
+
+		for (size_t i = 0; i < levelBytes; i += 4) {
+
+			dst[i] = src[i + ((bgra) ? 2 : 0)];
+			dst[i + 1] = src[i + 1];
+			dst[i + 2] = src[i + ((bgra) ? 0 : 2)];
+			dst[i + 3] = (opaque) ? 255 : src[i + 3];
+		}
+	}
+
+	return true;
+}
+
+// Return the number of levels of a full mip chain of a size x size cube map
+int CubeMapFilter::getMipLevelCount(const int size) {
+
+	int levels = 1;
+
+	while ((size >> levels) > 0)
+		levels++;
+
+	return levels;
+}
@@ -0,0 +1,32 @@
+//
+// CubeMapFilter.h
+//
+
+// Load-time prefiltering of environment cube maps for glossy reflection.  Level l of the prefiltered mip chain holds the environment convolved with the GGX distribution of roughness l / (mipLevels - 1), so a shader picks the level from the roughness of the surface (see reflection_probe_ps) and rough surfaces sample small levels rather than the full face.
+//
+// Each texel of a level importance samples the GGX lobe around its direction (assuming the view and reflection directions are the normal, as in the split sum approximation).  The sample directions of a level only depend on the roughness so they are generated once in tangent space.  They are processed four at a time with SSE - rotated to each texel's frame, mapped to a face and its bilinear weights, and the R, G, B and A of each tap accumulated as one vector.  Samples are read from a box filtered chain of the source chosen by the solid angle of each sample (filtered importance sampling) so few samples are needed without aliasing.  The rows of each level are filtered in parallel on a WorkerPool.
+//
+// The class does not depend on Direct3D - cube maps are 4 bytes (R, G, B, A) per texel with the faces in Direct3D order (+X, -X, +Y, -Y, +Z, -Z).
+
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class WorkerPool;
+
+
+class CubeMapFilter {
+
+public:
+
+	// Prefilter the size x size cube map texels (the 6 faces of a single level) into mipLevels levels with sampleCount samples per texel.  filtered receives every level of face +X, then every level of face -X and so on (DDS order, see ReflectionProbeSet::writeCubeDDS).  Rows are filtered in parallel if a pool is given.
+	static void prefilterGGX(const uint8_t *texels, const int size, const int mipLevels, const int sampleCount, WorkerPool *pool, std::vector<uint8_t> *filtered);
+
+	// Read the most detailed level of an uncompressed 32 bit RGBA or BGRA DDS cube map into texels (converted to RGBA).  Returns false if the file is missing or not in a supported format.
+	static bool readCubeDDS(const std::string &filename, int *size, std::vector<uint8_t> *texels);
+
+	// Return the number of levels of a full mip chain of a size x size cube map
+	static int getMipLevelCount(const int size);
+};
@@ -1,6 +1,7 @@
 
 #include "stdafx.h"
 #include <DXBaseModel.h>
+#include <Effect.h>
 
 
 DXBaseModel::~DXBaseModel() {
@@ -14,3 +15,64 @@ DXBaseModel::~DXBaseModel() {
 	if (inputLayout)
 		inputLayout->Release();
 }
+
+
+// Render the model in isolation - binds the effect, textures and geometry then issues the draw calls
+void DXBaseModel::render(DXContext *context) {
+
+	// Validate model before rendering
+	if (!context || !vertexBuffer || !effect)
+		return;
+
+	effect->bindPipeline(context);
+	bindTextures(context);
+	bindGeometry(context);
+	draw(context);
+}
+
+// Bind the textures returned by getTextures to the pixel shader
+void DXBaseModel::bindTextures(DXContext *context) {
+
+	ID3D11ShaderResourceView *views[MaxTextures];
+	ID3D11SamplerState *sampler = nullptr;
+
+	UINT numViews = getTextures(views, &sampler);
+
+	if (numViews > 0) {
+
+		context->PSSetShaderResources(0, numViews, views);
+		context->PSSetSamplers(0, 1, &sampler);
+	}
+}
+
+
+// Return the model space bounding sphere of the model.  Returns false if the model has no bounds (it is never culled).
+bool DXBaseModel::getBoundingSphere(DirectX::XMFLOAT3 *centre, float *radius) {
+
+	return false;
+}
+
+// Return the material colours the vertex shaders read from the per-object constants (see CBufferPerObject).  The default is opaque white without specular.
+void DXBaseModel::getMaterialColours(DirectX::XMFLOAT4 *diffuse, DirectX::XMFLOAT4 *specular) {
+
+	*diffuse = DirectX::XMFLOAT4(1.0f, 1.0f, 1.0f, 1.0f);
+	*specular = DirectX::XMFLOAT4(0.0f, 0.0f, 0.0f, 0.0f);
+}
+
+
+// Accessor methods
+
+Effect* DXBaseModel::getEffect() {
+
+	return effect;
+}
+
+ID3D11Buffer* DXBaseModel::getVertexBuffer() {
+
+	return vertexBuffer;
+}
+
+ID3D11Buffer* DXBaseModel::getIndexBuffer() {
+
+	return indexBuffer;
+}
@@ -3,9 +3,13 @@
 
 #include <d3d11_2.h>
 #include <GUObject.h>
+#include <DirectXMath.h>
 
+class DXContext;
+class Effect;
 
-// Abstract base class to model mesh objects for rendering in DirectX
+
+// Abstract base class to model mesh objects for rendering in DirectX.  Rendering is split into effect, texture and geometry state followed by the draw calls so a render queue can skip state already bound by the previous draw (see DXRenderQueue).
 class DXBaseModel : public GUObject {
 
 protected:
@@ -14,9 +18,40 @@ protected:
 	ID3D11Buffer				*indexBuffer = nullptr;
 	ID3D11InputLayout			*inputLayout = nullptr;
 
+	// DXGI_FORMAT_R16_UINT when every index fits in 16 bits (see DXVertexCompact::packIndices)
+	DXGI_FORMAT					indexFormat = DXGI_FORMAT_R32_UINT;
+	Effect						*effect = nullptr;
+
 public:
 
+	// Maximum number of pixel shader resource views bound by a model
+	static const UINT			MaxTextures = 8;
+
 	~DXBaseModel();
 
-	virtual void render(ID3D11DeviceContext *context) = 0;
+	// Render the model in isolation - binds the effect, textures and geometry then issues the draw calls
+	virtual void render(DXContext *context);
+
+	// Return the pixel shader resource views (at most MaxTextures) and sampler bound by bindTextures.  Returns 0 if the model binds no textures.
+	virtual UINT getTextures(ID3D11ShaderResourceView **views, ID3D11SamplerState **sampler) = 0;
+
+	// Bind the textures returned by getTextures to the pixel shader
+	void bindTextures(DXContext *context);
+
+	// Bind the input layout, vertex and index buffers and primitive topology
+	virtual void bindGeometry(DXContext *context) = 0;
+
+	// Issue the draw calls.  Assumes the effect, textures and geometry of the model are bound.
+	virtual void draw(DXContext *context) = 0;
+
+	// Return the model space bounding sphere of the model.  Returns false if the model has no bounds (it is never culled).
+	virtual bool getBoundingSphere(DirectX::XMFLOAT3 *centre, float *radius);
+
+	// Return the material colours the vertex shaders read from the per-object constants (see CBufferPerObject).  The default is opaque white without specular.
+	virtual void getMaterialColours(DirectX::XMFLOAT4 *diffuse, DirectX::XMFLOAT4 *specular);
+
+	// Accessor methods
+	Effect* getEffect();
+	ID3D11Buffer* getVertexBuffer();
+	ID3D11Buffer* getIndexBuffer();
 };
@@ -0,0 +1,389 @@
+
+//
+// DXConstantRing.cpp
+//
+
+#include <stdafx.h>
+#include <DXConstantRing.h>
+#include <DXContext.h>
+#include <thread>
+
+using namespace std;
+
+
+DXConstantRing::DXConstantRing(ID3D11Device *_device, UINT sizeInBytes, bool _bindByOffset) {
+
+	device = _device;
+	bindByOffset = _bindByOffset;
+
+	if (!device)
+		throw exception("DXConstantRing: Invalid device");
+
+	device->AddRef();
+
+	capacity = (sizeInBytes + Alignment - 1) & ~(Alignment - 1);
+
+	D3D11_BUFFER_DESC bufferDesc;
+
+	ZeroMemory(&bufferDesc, sizeof(D3D11_BUFFER_DESC));
+
+	bufferDesc.ByteWidth = capacity;
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	if (bindByOffset) {
+
+		HRESULT hr = device->CreateBuffer(&bufferDesc, nullptr, &buffer);
+
+		if (!SUCCEEDED(hr))
+			throw exception("DXConstantRing: Cannot create ring buffer");
+	}
+	else {
+
+		// The GPU never reads cpuData so it needs no fences - each frame only has to fit in the ring
+		cpuData.resize(capacity);
+
+		bufferDesc.ByteWidth = FallbackBufferSize;
+
+		slotBuffers.resize(FallbackSlots, nullptr);
+
+		for (UINT i = 0; i < FallbackSlots; ++i) {
+
+			HRESULT hr = device->CreateBuffer(&bufferDesc, nullptr, &slotBuffers[i]);
+
+			if (!SUCCEEDED(hr))
+				throw exception("DXConstantRing: Cannot create constant buffer");
+		}
+	}
+}
+
+DXConstantRing::~DXConstantRing() {
+
+	for (size_t i = 0; i < fences.size(); ++i)
+		fences[i].query->Release();
+
+	for (size_t i = 0; i < freeQueries.size(); ++i)
+		freeQueries[i]->Release();
+
+	if (buffer)
+		buffer->Release();
+
+	if (staticBuffer)
+		staticBuffer->Release();
+
+	for (size_t i = 0; i < slotBuffers.size(); ++i)
+		if (slotBuffers[i])
+			slotBuffers[i]->Release();
+
+	if (device)
+		device->Release();
+}
+
+
+// Block until the oldest frame fence has been signalled and release its bytes.  GetData returns S_FALSE until the query is signalled - any other result is an error (such as device removal) that would never clear.
+void DXConstantRing::waitForOldestFence(DXContext *context) {
+
+	Fence fence = fences.front();
+	fences.pop_front();
+
+	BOOL done = FALSE;
+	HRESULT hr = context->GetData(fence.query, &done, sizeof(BOOL), 0);
+
+	if (hr == S_FALSE || (hr == S_OK && !done)) {
+
+		stallCount++;
+
+		do {
+
+			this_thread::yield();
+			hr = context->GetData(fence.query, &done, sizeof(BOOL), 0);
+
+		} while (hr == S_FALSE || (hr == S_OK && !done));
+	}
+
+	if (FAILED(hr)) {
+
+		fence.query->Release();
+		throw exception("DXConstantRing: Fence query failed");
+	}
+
+	bytesInFlight -= fence.bytes;
+	freeQueries.push_back(fence.query);
+}
+
+
+// Allocate size bytes of constant data for the current frame.  The ring is mapped on the first allocation after an unmap.  Returns a pointer to write the data to and the range to bind it with.
+void* DXConstantRing::allocate(DXContext *context, UINT size, DXConstantRange *range) {
+
+	UINT alignedSize = (size + Alignment - 1) & ~(Alignment - 1);
+
+	if (alignedSize == 0 || alignedSize > capacity || (!bindByOffset && alignedSize > FallbackBufferSize))
+		throw exception("DXConstantRing: Invalid allocation size");
+
+	// An allocation never straddles the end of the buffer - skip the remaining bytes and wrap to the start
+	UINT skipped = (head + alignedSize > capacity) ? capacity - head : 0;
+
+	// Wait for the GPU to release old frames until the allocation fits behind the oldest in-flight data
+	while (bytesInFlight + skipped + alignedSize > capacity) {
+
+		if (fences.empty())
+			throw exception("DXConstantRing: Constant data for a single frame exceeds the ring size");
+
+		waitForOldestFence(context);
+	}
+
+	if (!bindByOffset) {
+
+		mappedData = cpuData.data();
+	}
+	else if (!mappedData) {
+
+		D3D11_MAPPED_SUBRESOURCE res;
+		HRESULT hr = context->Map(buffer, 0, (firstMap) ? D3D11_MAP_WRITE_DISCARD : D3D11_MAP_WRITE_NO_OVERWRITE, 0, &res);
+
+		if (!SUCCEEDED(hr))
+			throw exception("DXConstantRing: Cannot map ring buffer");
+
+		mappedData = static_cast<uint8_t*>(res.pData);
+		firstMap = false;
+		mapCount++;
+	}
+
+	if (skipped)
+		head = 0;
+
+	UINT offset = head;
+
+	head += alignedSize;
+	frameBytes += skipped + alignedSize;
+	bytesInFlight += skipped + alignedSize;
+
+	range->firstConstant = offset / 16;
+	range->numConstants = alignedSize / 16;
+	range->staticBlock = false;
+
+	return mappedData + offset;
+}
+
+// Allocate and copy the given constant data
+DXConstantRange DXConstantRing::upload(DXContext *context, const void *data, UINT size) {
+
+	DXConstantRange range;
+
+	memcpy(allocate(context, size, &range), data, size);
+
+	return range;
+}
+
+// Unmap the ring - must be called after the last allocation and before any draw call that reads from the ring
+void DXConstantRing::unmap(DXContext *context) {
+
+	if (mappedData) {
+
+		if (bindByOffset)
+			context->Unmap(buffer, 0);
+
+		mappedData = nullptr;
+	}
+}
+
+// Mark the end of the frame.  Issues the fence protecting every allocation made since the previous endFrame.
+void DXConstantRing::endFrame(DXContext *context) {
+
+	unmap(context);
+
+	if (frameBytes == 0)
+		return;
+
+	if (!bindByOffset) {
+
+		bytesInFlight -= frameBytes;
+		frameBytes = 0;
+		return;
+	}
+
+	Fence fence;
+
+	fence.bytes = frameBytes;
+
+	if (!freeQueries.empty()) {
+
+		fence.query = freeQueries.back();
+		freeQueries.pop_back();
+	}
+	else {
+
+		D3D11_QUERY_DESC queryDesc;
+
+		queryDesc.Query = D3D11_QUERY_EVENT;
+		queryDesc.MiscFlags = 0;
+
+		if (!SUCCEEDED(device->CreateQuery(&queryDesc, &fence.query)))
+			throw exception("DXConstantRing: Cannot create fence query");
+	}
+
+	context->End(fence.query);
+	fences.push_back(fence);
+
+	frameBytes = 0;
+}
+
+// Reserve a static block of size bytes.  Static blocks are never freed.
+DXConstantRange DXConstantRing::allocateStatic(UINT size) {
+
+	UINT alignedSize = (size + Alignment - 1) & ~(Alignment - 1);
+
+	if (alignedSize == 0 || (!bindByOffset && alignedSize > FallbackBufferSize))
+		throw exception("DXConstantRing: Invalid allocation size");
+
+	DXConstantRange range;
+
+	range.firstConstant = (UINT)staticData.size() / 16;
+	range.numConstants = alignedSize / 16;
+	range.staticBlock = true;
+
+	staticData.resize(staticData.size() + alignedSize, 0);
+	staticDirty = true;
+
+	return range;
+}
+
+// Return a pointer to rewrite the contents of the given static block.  The block must not be bound again until flushStatic has been called.
+void* DXConstantRing::writeStatic(const DXConstantRange &range) {
+
+	staticDirty = true;
+
+	return staticData.data() + range.firstConstant * 16;
+}
+
+// Upload the static blocks if any were written since the last flush.  The immutable buffer is recreated - command lists that still reference the old buffer keep it alive until they are released.
+void DXConstantRing::flushStatic() {
+
+	if (!staticDirty)
+		return;
+
+	staticDirty = false;
+
+	// Without offsetting each bind copies from staticData so there is nothing to upload
+	if (!bindByOffset || staticData.empty())
+		return;
+
+	D3D11_BUFFER_DESC bufferDesc;
+
+	ZeroMemory(&bufferDesc, sizeof(D3D11_BUFFER_DESC));
+
+	bufferDesc.ByteWidth = (UINT)staticData.size();
+	bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	bufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
+
+	D3D11_SUBRESOURCE_DATA initData;
+
+	ZeroMemory(&initData, sizeof(D3D11_SUBRESOURCE_DATA));
+	initData.pSysMem = staticData.data();
+
+	ID3D11Buffer *newBuffer = nullptr;
+
+	if (!SUCCEEDED(device->CreateBuffer(&bufferDesc, &initData, &newBuffer)))
+		throw exception("DXConstantRing: Cannot create static constant buffer");
+
+	if (staticBuffer)
+		staticBuffer->Release();
+
+	staticBuffer = newBuffer;
+	staticUploadCount++;
+}
+
+// Bind numRanges allocations to consecutive slots from startSlot of each of the given stages (DXConstantStage flags).  Safe to call concurrently on different contexts.
+void DXConstantRing::bind(DXContext *context, uint32_t stages, UINT startSlot, UINT numRanges, const DXConstantRange *ranges) {
+
+	ID3D11Buffer *buffers[FallbackSlots];
+	UINT firstConstant[FallbackSlots];
+	UINT numConstants[FallbackSlots];
+
+	if (numRanges > FallbackSlots)
+		throw exception("DXConstantRing: Too many ranges");
+
+	if (bindByOffset) {
+
+		for (UINT i = 0; i < numRanges; ++i) {
+
+			buffers[i] = (ranges[i].staticBlock) ? staticBuffer : buffer;
+			firstConstant[i] = ranges[i].firstConstant;
+			numConstants[i] = ranges[i].numConstants;
+		}
+
+		if (stages & ConstantStageVS)
+			context->VSSetConstantBuffers1(startSlot, numRanges, buffers, firstConstant, numConstants);
+
+		if (stages & ConstantStageGS)
+			context->GSSetConstantBuffers1(startSlot, numRanges, buffers, firstConstant, numConstants);
+
+		if (stages & ConstantStagePS)
+			context->PSSetConstantBuffers1(startSlot, numRanges, buffers, firstConstant, numConstants);
+
+		return;
+	}
+
+	if (startSlot + numRanges > FallbackSlots)
+		throw exception("DXConstantRing: Constant buffer slot out of range");
+
+	// Copy each range into the buffer of its slot.  Every bind discards the previous contents so the stages still bound to an earlier range of the slot see the new one.
+	for (UINT i = 0; i < numRanges; ++i) {
+
+		buffers[i] = slotBuffers[startSlot + i];
+
+		D3D11_MAPPED_SUBRESOURCE res;
+		HRESULT hr = context->Map(buffers[i], 0, D3D11_MAP_WRITE_DISCARD, 0, &res);
+
+		if (!SUCCEEDED(hr))
+			throw exception("DXConstantRing: Cannot map constant buffer");
+
+		const uint8_t *data = (ranges[i].staticBlock) ? staticData.data() : cpuData.data();
+
+		memcpy(res.pData, data + ranges[i].firstConstant * 16, ranges[i].numConstants * 16);
+		context->Unmap(buffers[i], 0);
+	}
+
+	if (stages & ConstantStageVS)
+		context->VSSetConstantBuffers(startSlot, numRanges, buffers);
+
+	if (stages & ConstantStageGS)
+		context->GSSetConstantBuffers(startSlot, numRanges, buffers);
+
+	if (stages & ConstantStagePS)
+		context->PSSetConstantBuffers(startSlot, numRanges, buffers);
+}
+
+
+// Accessor methods
+
+ID3D11Buffer* DXConstantRing::getBuffer() {
+
+	return buffer;
+}
+
+UINT DXConstantRing::getCapacity() {
+
+	return capacity;
+}
+
+bool DXConstantRing::bindsByOffset() {
+
+	return bindByOffset;
+}
+
+uint64_t DXConstantRing::getMapCount() {
+
+	return mapCount;
+}
+
+uint64_t DXConstantRing::getStallCount() {
+
+	return stallCount;
+}
+
+uint64_t DXConstantRing::getStaticUploadCount() {
+
+	return staticUploadCount;
+}
@@ -0,0 +1,128 @@
+
+//
+// DXConstantRing.h
+//
+
+// Upload ring for dynamic shader constants.  A single large D3D11_USAGE_DYNAMIC constant buffer is sub-allocated in 256 byte aligned blocks and mapped with D3D11_MAP_WRITE_NO_OVERWRITE, so the driver never has to rename the buffer.  Each allocation is bound by range with VSSetConstantBuffers1 (and the PS / GS equivalents).  An event query is issued at the end of every frame and the ring blocks on the oldest outstanding query before reusing memory the GPU may still be reading.
+//
+// Direct3D 11.0 devices cannot bind by range.  The ring then writes into a CPU copy instead and bind() copies each range into a small per-slot buffer mapped with D3D11_MAP_WRITE_DISCARD, so the driver renames the buffer on every bind.
+//
+// Constants that stay the same for many frames (such as the transforms of nodes at rest) can be kept out of the ring in static blocks.  Static blocks live in a D3D11_USAGE_IMMUTABLE buffer that is only recreated when a block has been rewritten.
+
+#pragma once
+
+#include <d3d11_2.h>
+#include <GUObject.h>
+#include <cstdint>
+#include <deque>
+#include <vector>
+
+class DXContext;
+
+
+// Range of the ring buffer holding one allocation, in the units expected by the *SetConstantBuffers1 methods (16 byte constants)
+struct DXConstantRange {
+
+	UINT								firstConstant;
+	UINT								numConstants;
+	bool								staticBlock; // Allocated by allocateStatic rather than from the ring
+};
+
+// Shader stages a range is bound to by DXConstantRing::bind
+enum DXConstantStage : uint32_t {
+
+	ConstantStageVS = 0x01,
+	ConstantStageGS = 0x02,
+	ConstantStagePS = 0x04
+};
+
+
+class DXConstantRing : public GUObject {
+
+	// Frame fence - the query is signalled once the GPU has finished with the bytes allocated during the frame
+	struct Fence {
+
+		ID3D11Query						*query;
+		UINT							bytes;
+	};
+
+	ID3D11Device						*device = nullptr;
+	ID3D11Buffer						*buffer = nullptr;
+	UINT								capacity = 0;
+
+	// False when the device cannot bind constant buffers by range.  Allocations are then made from cpuData and bind() uploads them to slotBuffers.
+	bool								bindByOffset = true;
+	std::vector<uint8_t>				cpuData;
+	std::vector<ID3D11Buffer*>			slotBuffers;
+
+	// Static blocks and the buffer they were last uploaded to (nullptr before the first upload and when the device cannot bind by range)
+	std::vector<uint8_t>				staticData;
+	ID3D11Buffer						*staticBuffer = nullptr;
+	bool								staticDirty = false;
+
+	// Offset of the next allocation and the mapped base address of the buffer (nullptr when unmapped)
+	UINT								head = 0;
+	uint8_t								*mappedData = nullptr;
+
+	// The first map after creation must discard, all later maps use NO_OVERWRITE
+	bool								firstMap = true;
+
+	// Bytes allocated in the current frame and in all frames (including the current one) the GPU may still be reading
+	UINT								frameBytes = 0;
+	UINT								bytesInFlight = 0;
+
+	std::deque<Fence>					fences;
+	std::vector<ID3D11Query*>			freeQueries;
+
+	// Statistics
+	uint64_t							mapCount = 0;
+	uint64_t							stallCount = 0;
+	uint64_t							staticUploadCount = 0;
+
+	// Block until the oldest frame fence has been signalled and release its bytes
+	void waitForOldestFence(DXContext *context);
+
+public:
+
+	// Offsets passed to *SetConstantBuffers1 must be multiples of 16 constants (256 bytes)
+	static const UINT					Alignment = 256;
+
+	// Constant buffer slots and largest allocation supported when the device cannot bind by range
+	static const UINT					FallbackSlots = 4;
+	static const UINT					FallbackBufferSize = 1024;
+
+	// Create a ring of the given size in bytes (rounded up to the allocation alignment).  bindByOffset is false when the device does not support constant buffer offsetting (see DXSystem::supportsConstantBufferOffsetting).
+	DXConstantRing(ID3D11Device *_device, UINT sizeInBytes, bool _bindByOffset = true);
+	~DXConstantRing();
+
+	// Allocate size bytes of constant data for the current frame.  The ring is mapped on the first allocation after an unmap.  Returns a pointer to write the data to and the range to bind it with.
+	void* allocate(DXContext *context, UINT size, DXConstantRange *range);
+
+	// Allocate and copy the given constant data
+	DXConstantRange upload(DXContext *context, const void *data, UINT size);
+
+	// Unmap the ring - must be called after the last allocation and before any draw call that reads from the ring
+	void unmap(DXContext *context);
+
+	// Mark the end of the frame.  Issues the fence protecting every allocation made since the previous endFrame.
+	void endFrame(DXContext *context);
+
+	// Reserve a static block of size bytes.  Static blocks are never freed.
+	DXConstantRange allocateStatic(UINT size);
+
+	// Return a pointer to rewrite the contents of the given static block.  The block must not be bound again until flushStatic has been called.
+	void* writeStatic(const DXConstantRange &range);
+
+	// Upload the static blocks if any were written since the last flush
+	void flushStatic();
+
+	// Bind numRanges allocations to consecutive slots from startSlot of each of the given stages (DXConstantStage flags).  Safe to call concurrently on different contexts.
+	void bind(DXContext *context, uint32_t stages, UINT startSlot, UINT numRanges, const DXConstantRange *ranges);
+
+	ID3D11Buffer* getBuffer();
+	UINT getCapacity();
+	bool bindsByOffset();
+	uint64_t getMapCount();
+	uint64_t getStallCount();
+	uint64_t getStaticUploadCount();
+};
@@ -0,0 +1,52 @@
+//
+// DXContext.cpp
+//
+
+#include <stdafx.h>
+#include <DXContext.h>
+
+
+// Return a printable name for the given command type
+const char* DXCommandName(const DXCommandType type) {
+
+	static const char *names[] = {
+
+		"RSSetState",
+		"RSSetViewports",
+		"OMSetDepthStencilState",
+		"OMSetBlendState",
+		"OMSetRenderTargets",
+		"VSSetShader",
+		"PSSetShader",
+		"GSSetShader",
+		"IASetInputLayout",
+		"IASetVertexBuffers",
+		"IASetIndexBuffer",
+		"IASetPrimitiveTopology",
+		"VSSetConstantBuffers",
+		"PSSetConstantBuffers",
+		"GSSetConstantBuffers",
+		"VSSetConstantBuffers1",
+		"PSSetConstantBuffers1",
+		"GSSetConstantBuffers1",
+		"PSSetShaderResources",
+		"PSSetSamplers",
+		"ClearRenderTargetView",
+		"ClearDepthStencilView",
+		"Map",
+		"Unmap",
+		"Draw",
+		"DrawIndexed",
+		"DrawIndexedInstanced",
+		"CopyResource",
+		"End",
+		"GetData",
+		"FinishCommandList",
+		"ExecuteCommandList",
+		"Present"
+	};
+
+	static_assert(ARRAYSIZE(names) == (size_t)DXCommandType::Count, "DXCommandName table does not match DXCommandType");
+
+	return (type < DXCommandType::Count) ? names[(size_t)type] : "Unknown";
+}
@@ -0,0 +1,130 @@
+//
+// DXContext.h
+//
+
+// Abstract rendering context used by the Scene and all renderable objects in place of ID3D11DeviceContext.  The interface mirrors the subset of ID3D11DeviceContext methods used by the application (with the same method names and parameters) so a concrete backend can either forward each call to Direct3D (DXImmediateContext) or record it into an inspectable command stream without a GPU (DXRecordingContext).
+
+#pragma once
+
+#include <d3d11_2.h>
+#include <cstdint>
+#include <GUObject.h>
+
+
+// Each call type issued through DXContext.  Used to tag recorded commands and to index per-call counters.
+enum class DXCommandType : uint8_t {
+
+	RSSetState = 0,
+	RSSetViewports,
+	OMSetDepthStencilState,
+	OMSetBlendState,
+	OMSetRenderTargets,
+	VSSetShader,
+	PSSetShader,
+	GSSetShader,
+	IASetInputLayout,
+	IASetVertexBuffers,
+	IASetIndexBuffer,
+	IASetPrimitiveTopology,
+	VSSetConstantBuffers,
+	PSSetConstantBuffers,
+	GSSetConstantBuffers,
+	VSSetConstantBuffers1,
+	PSSetConstantBuffers1,
+	GSSetConstantBuffers1,
+	PSSetShaderResources,
+	PSSetSamplers,
+	ClearRenderTargetView,
+	ClearDepthStencilView,
+	Map,
+	Unmap,
+	Draw,
+	DrawIndexed,
+	DrawIndexedInstanced,
+	CopyResource,
+	End,
+	GetData,
+	FinishCommandList,
+	ExecuteCommandList,
+	Present,
+
+	Count
+};
+
+// Return a printable name for the given command type
+const char* DXCommandName(const DXCommandType type);
+
+
+// Commands recorded on a deferred context by FinishCommandList, ready to be executed on the immediate context.  Each backend provides its own command list type.
+class DXCommandList : public GUObject {
+
+public:
+
+	virtual ~DXCommandList() {}
+
+	// Return the Direct3D command list if the backend has one, otherwise nullptr
+	virtual ID3D11CommandList* getD3DCommandList() = 0;
+};
+
+
+class DXContext : public GUObject {
+
+public:
+
+	virtual ~DXContext() {}
+
+	// Rasteriser stage
+	virtual void RSSetState(ID3D11RasterizerState *rasterizerState) = 0;
+	virtual void RSSetViewports(UINT numViewports, const D3D11_VIEWPORT *viewports) = 0;
+
+	// Output merger stage
+	virtual void OMSetDepthStencilState(ID3D11DepthStencilState *depthStencilState, UINT stencilRef) = 0;
+	virtual void OMSetBlendState(ID3D11BlendState *blendState, const FLOAT blendFactor[4], UINT sampleMask) = 0;
+	virtual void OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *renderTargetViews, ID3D11DepthStencilView *depthStencilView) = 0;
+	virtual void OMGetRenderTargets(UINT numViews, ID3D11RenderTargetView **renderTargetViews, ID3D11DepthStencilView **depthStencilView) = 0;
+
+	// Shader stages
+	virtual void VSSetShader(ID3D11VertexShader *vertexShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) = 0;
+	virtual void PSSetShader(ID3D11PixelShader *pixelShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) = 0;
+	virtual void GSSetShader(ID3D11GeometryShader *geometryShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) = 0;
+	virtual void VSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers) = 0;
+	virtual void PSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers) = 0;
+	virtual void GSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers) = 0;
+
+	// Bind a range of each constant buffer (Direct3D 11.1).  firstConstant and numConstants are in units of 16-byte constants and must be multiples of 16.
+	virtual void VSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants) = 0;
+	virtual void PSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants) = 0;
+	virtual void GSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants) = 0;
+
+	virtual void PSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *shaderResourceViews) = 0;
+	virtual void PSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers) = 0;
+
+	// Input assembler stage
+	virtual void IASetInputLayout(ID3D11InputLayout *inputLayout) = 0;
+	virtual void IASetVertexBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *vertexBuffers, const UINT *strides, const UINT *offsets) = 0;
+	virtual void IASetIndexBuffer(ID3D11Buffer *indexBuffer, DXGI_FORMAT format, UINT offset) = 0;
+	virtual void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) = 0;
+
+	// Resource access
+	virtual void ClearRenderTargetView(ID3D11RenderTargetView *renderTargetView, const FLOAT colour[4]) = 0;
+	virtual void ClearDepthStencilView(ID3D11DepthStencilView *depthStencilView, UINT clearFlags, FLOAT depth, UINT8 stencil) = 0;
+	virtual HRESULT Map(ID3D11Resource *resource, UINT subresource, D3D11_MAP mapType, UINT mapFlags, D3D11_MAPPED_SUBRESOURCE *mappedResource) = 0;
+	virtual void Unmap(ID3D11Resource *resource, UINT subresource) = 0;
+	virtual void CopyResource(ID3D11Resource *dstResource, ID3D11Resource *srcResource) = 0;
+
+	// Queries (used to fence CPU writes against GPU progress)
+	virtual void End(ID3D11Asynchronous *async) = 0;
+	virtual HRESULT GetData(ID3D11Asynchronous *async, void *data, UINT dataSize, UINT getDataFlags) = 0;
+
+	// Draw calls
+	virtual void Draw(UINT vertexCount, UINT startVertexLocation) = 0;
+	virtual void DrawIndexed(UINT indexCount, UINT startIndexLocation, INT baseVertexLocation) = 0;
+	virtual void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation) = 0;
+
+	// Command lists.  FinishCommandList is only valid on a deferred context and ExecuteCommandList on the immediate context (see DXSystem::createDeferredContext).  The caller owns the returned command list.
+	virtual HRESULT FinishCommandList(BOOL restoreDeferredContextState, DXCommandList **commandList) = 0;
+	virtual void ExecuteCommandList(DXCommandList *commandList, BOOL restoreContextState) = 0;
+
+	// Return the underlying Direct3D context if the backend has one, otherwise nullptr
+	virtual ID3D11DeviceContext* getD3DContext() = 0;
+};
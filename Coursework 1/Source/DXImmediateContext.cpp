@@ -0,0 +1,255 @@
+//
+// DXImmediateContext.cpp
+//
+
+#include <stdafx.h>
+#include <DXImmediateContext.h>
+
+
+DXD3DCommandList::DXD3DCommandList(ID3D11CommandList *_commandList) {
+
+	commandList = _commandList;
+}
+
+DXD3DCommandList::~DXD3DCommandList() {
+
+	if (commandList)
+		commandList->Release();
+}
+
+ID3D11CommandList* DXD3DCommandList::getD3DCommandList() {
+
+	return commandList;
+}
+
+
+DXImmediateContext::DXImmediateContext(ID3D11DeviceContext *_context) {
+
+	context = _context;
+
+	if (context) {
+
+		context->AddRef();
+		context->QueryInterface(__uuidof(ID3D11DeviceContext1), reinterpret_cast<void**>(&context1));
+	}
+}
+
+DXImmediateContext::~DXImmediateContext() {
+
+	if (context1)
+		context1->Release();
+
+	if (context)
+		context->Release();
+}
+
+
+// Rasteriser stage
+
+void DXImmediateContext::RSSetState(ID3D11RasterizerState *rasterizerState) {
+
+	context->RSSetState(rasterizerState);
+}
+
+void DXImmediateContext::RSSetViewports(UINT numViewports, const D3D11_VIEWPORT *viewports) {
+
+	context->RSSetViewports(numViewports, viewports);
+}
+
+
+// Output merger stage
+
+void DXImmediateContext::OMSetDepthStencilState(ID3D11DepthStencilState *depthStencilState, UINT stencilRef) {
+
+	context->OMSetDepthStencilState(depthStencilState, stencilRef);
+}
+
+void DXImmediateContext::OMSetBlendState(ID3D11BlendState *blendState, const FLOAT blendFactor[4], UINT sampleMask) {
+
+	context->OMSetBlendState(blendState, blendFactor, sampleMask);
+}
+
+void DXImmediateContext::OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *renderTargetViews, ID3D11DepthStencilView *depthStencilView) {
+
+	context->OMSetRenderTargets(numViews, renderTargetViews, depthStencilView);
+}
+
+void DXImmediateContext::OMGetRenderTargets(UINT numViews, ID3D11RenderTargetView **renderTargetViews, ID3D11DepthStencilView **depthStencilView) {
+
+	context->OMGetRenderTargets(numViews, renderTargetViews, depthStencilView);
+}
+
+
+// Shader stages
+
+void DXImmediateContext::VSSetShader(ID3D11VertexShader *vertexShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) {
+
+	context->VSSetShader(vertexShader, classInstances, numClassInstances);
+}
+
+void DXImmediateContext::PSSetShader(ID3D11PixelShader *pixelShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) {
+
+	context->PSSetShader(pixelShader, classInstances, numClassInstances);
+}
+
+void DXImmediateContext::GSSetShader(ID3D11GeometryShader *geometryShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) {
+
+	context->GSSetShader(geometryShader, classInstances, numClassInstances);
+}
+
+void DXImmediateContext::VSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers) {
+
+	context->VSSetConstantBuffers(startSlot, numBuffers, constantBuffers);
+}
+
+void DXImmediateContext::PSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers) {
+
+	context->PSSetConstantBuffers(startSlot, numBuffers, constantBuffers);
+}
+
+void DXImmediateContext::GSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers) {
+
+	context->GSSetConstantBuffers(startSlot, numBuffers, constantBuffers);
+}
+
+// Without a Direct3D 11.1 context the constant buffer ranges cannot be honoured so the whole buffer is bound.  Callers check DXSystem::supportsConstantBufferOffsetting before relying on ranges.
+void DXImmediateContext::VSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants) {
+
+	if (context1)
+		context1->VSSetConstantBuffers1(startSlot, numBuffers, constantBuffers, firstConstant, numConstants);
+	else
+		context->VSSetConstantBuffers(startSlot, numBuffers, constantBuffers);
+}
+
+void DXImmediateContext::PSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants) {
+
+	if (context1)
+		context1->PSSetConstantBuffers1(startSlot, numBuffers, constantBuffers, firstConstant, numConstants);
+	else
+		context->PSSetConstantBuffers(startSlot, numBuffers, constantBuffers);
+}
+
+void DXImmediateContext::GSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants) {
+
+	if (context1)
+		context1->GSSetConstantBuffers1(startSlot, numBuffers, constantBuffers, firstConstant, numConstants);
+	else
+		context->GSSetConstantBuffers(startSlot, numBuffers, constantBuffers);
+}
+
+void DXImmediateContext::PSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *shaderResourceViews) {
+
+	context->PSSetShaderResources(startSlot, numViews, shaderResourceViews);
+}
+
+void DXImmediateContext::PSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers) {
+
+	context->PSSetSamplers(startSlot, numSamplers, samplers);
+}
+
+
+// Input assembler stage
+
+void DXImmediateContext::IASetInputLayout(ID3D11InputLayout *inputLayout) {
+
+	context->IASetInputLayout(inputLayout);
+}
+
+void DXImmediateContext::IASetVertexBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *vertexBuffers, const UINT *strides, const UINT *offsets) {
+
+	context->IASetVertexBuffers(startSlot, numBuffers, vertexBuffers, strides, offsets);
+}
+
+void DXImmediateContext::IASetIndexBuffer(ID3D11Buffer *indexBuffer, DXGI_FORMAT format, UINT offset) {
+
+	context->IASetIndexBuffer(indexBuffer, format, offset);
+}
+
+void DXImmediateContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) {
+
+	context->IASetPrimitiveTopology(topology);
+}
+
+
+// Resource access
+
+void DXImmediateContext::ClearRenderTargetView(ID3D11RenderTargetView *renderTargetView, const FLOAT colour[4]) {
+
+	context->ClearRenderTargetView(renderTargetView, colour);
+}
+
+void DXImmediateContext::ClearDepthStencilView(ID3D11DepthStencilView *depthStencilView, UINT clearFlags, FLOAT depth, UINT8 stencil) {
+
+	context->ClearDepthStencilView(depthStencilView, clearFlags, depth, stencil);
+}
+
+HRESULT DXImmediateContext::Map(ID3D11Resource *resource, UINT subresource, D3D11_MAP mapType, UINT mapFlags, D3D11_MAPPED_SUBRESOURCE *mappedResource) {
+
+	return context->Map(resource, subresource, mapType, mapFlags, mappedResource);
+}
+
+void DXImmediateContext::Unmap(ID3D11Resource *resource, UINT subresource) {
+
+	context->Unmap(resource, subresource);
+}
+
+void DXImmediateContext::CopyResource(ID3D11Resource *dstResource, ID3D11Resource *srcResource) {
+
+	context->CopyResource(dstResource, srcResource);
+}
+
+
+// Queries
+
+void DXImmediateContext::End(ID3D11Asynchronous *async) {
+
+	context->End(async);
+}
+
+HRESULT DXImmediateContext::GetData(ID3D11Asynchronous *async, void *data, UINT dataSize, UINT getDataFlags) {
+
+	return context->GetData(async, data, dataSize, getDataFlags);
+}
+
+
+// Draw calls
+
+void DXImmediateContext::Draw(UINT vertexCount, UINT startVertexLocation) {
+
+	context->Draw(vertexCount, startVertexLocation);
+}
+
+void DXImmediateContext::DrawIndexed(UINT indexCount, UINT startIndexLocation, INT baseVertexLocation) {
+
+	context->DrawIndexed(indexCount, startIndexLocation, baseVertexLocation);
+}
+
+void DXImmediateContext::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation) {
+
+	context->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+}
+
+
+// Command lists
+
+HRESULT DXImmediateContext::FinishCommandList(BOOL restoreDeferredContextState, DXCommandList **commandList) {
+
+	ID3D11CommandList *d3dCommandList = nullptr;
+
+	HRESULT hr = context->FinishCommandList(restoreDeferredContextState, &d3dCommandList);
+
+	*commandList = (SUCCEEDED(hr)) ? new DXD3DCommandList(d3dCommandList) : nullptr;
+
+	return hr;
+}
+
+void DXImmediateContext::ExecuteCommandList(DXCommandList *commandList, BOOL restoreContextState) {
+
+	context->ExecuteCommandList(commandList->getD3DCommandList(), restoreContextState);
+}
+
+
+ID3D11DeviceContext* DXImmediateContext::getD3DContext() {
+
+	return context;
+}
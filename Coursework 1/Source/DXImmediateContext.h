@@ -0,0 +1,81 @@
+//
+// DXImmediateContext.h
+//
+
+// Direct3D 11 backend for DXContext.  Each call is forwarded unchanged to the encapsulated ID3D11DeviceContext, which is either the immediate context or a deferred context created by DXSystem::createDeferredContext.
+
+#pragma once
+
+#include <DXContext.h>
+
+
+// Command list finished on a deferred Direct3D context
+class DXD3DCommandList : public DXCommandList {
+
+	ID3D11CommandList						*commandList = nullptr;
+
+public:
+
+	// The DXD3DCommandList takes ownership of the given reference
+	DXD3DCommandList(ID3D11CommandList *_commandList);
+	~DXD3DCommandList();
+
+	ID3D11CommandList* getD3DCommandList();
+};
+
+
+class DXImmediateContext : public DXContext {
+
+	ID3D11DeviceContext						*context = nullptr;
+
+	// Direct3D 11.1 interface of the same context (nullptr if the runtime does not provide it)
+	ID3D11DeviceContext1					*context1 = nullptr;
+
+public:
+
+	// The DXImmediateContext retains a reference to the given Direct3D context
+	DXImmediateContext(ID3D11DeviceContext *_context);
+	~DXImmediateContext();
+
+	void RSSetState(ID3D11RasterizerState *rasterizerState);
+	void RSSetViewports(UINT numViewports, const D3D11_VIEWPORT *viewports);
+
+	void OMSetDepthStencilState(ID3D11DepthStencilState *depthStencilState, UINT stencilRef);
+	void OMSetBlendState(ID3D11BlendState *blendState, const FLOAT blendFactor[4], UINT sampleMask);
+	void OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *renderTargetViews, ID3D11DepthStencilView *depthStencilView);
+	void OMGetRenderTargets(UINT numViews, ID3D11RenderTargetView **renderTargetViews, ID3D11DepthStencilView **depthStencilView);
+
+	void VSSetShader(ID3D11VertexShader *vertexShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances);
+	void PSSetShader(ID3D11PixelShader *pixelShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances);
+	void GSSetShader(ID3D11GeometryShader *geometryShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances);
+	void VSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers);
+	void PSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers);
+	void GSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers);
+	void VSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants);
+	void PSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants);
+	void GSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants);
+	void PSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *shaderResourceViews);
+	void PSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers);
+
+	void IASetInputLayout(ID3D11InputLayout *inputLayout);
+	void IASetVertexBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *vertexBuffers, const UINT *strides, const UINT *offsets);
+	void IASetIndexBuffer(ID3D11Buffer *indexBuffer, DXGI_FORMAT format, UINT offset);
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+
+	void ClearRenderTargetView(ID3D11RenderTargetView *renderTargetView, const FLOAT colour[4]);
+	void ClearDepthStencilView(ID3D11DepthStencilView *depthStencilView, UINT clearFlags, FLOAT depth, UINT8 stencil);
+	HRESULT Map(ID3D11Resource *resource, UINT subresource, D3D11_MAP mapType, UINT mapFlags, D3D11_MAPPED_SUBRESOURCE *mappedResource);
+	void Unmap(ID3D11Resource *resource, UINT subresource);
+	void CopyResource(ID3D11Resource *dstResource, ID3D11Resource *srcResource);
+	void End(ID3D11Asynchronous *async);
+	HRESULT GetData(ID3D11Asynchronous *async, void *data, UINT dataSize, UINT getDataFlags);
+
+	void Draw(UINT vertexCount, UINT startVertexLocation);
+	void DrawIndexed(UINT indexCount, UINT startIndexLocation, INT baseVertexLocation);
+	void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation);
+
+	HRESULT FinishCommandList(BOOL restoreDeferredContextState, DXCommandList **commandList);
+	void ExecuteCommandList(DXCommandList *commandList, BOOL restoreContextState);
+
+	ID3D11DeviceContext* getD3DContext();
+};
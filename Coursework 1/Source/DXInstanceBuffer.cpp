@@ -0,0 +1,97 @@
+
+//
+// DXInstanceBuffer.cpp
+//
+
+#include <stdafx.h>
+#include <DXInstanceBuffer.h>
+#include <DXContext.h>
+
+using namespace std;
+
+
+// Create a buffer holding at most maxInstances instances per frame
+DXInstanceBuffer::DXInstanceBuffer(ID3D11Device *device, UINT maxInstances) {
+
+	if (!device || maxInstances == 0)
+		throw exception("DXInstanceBuffer: Invalid parameters");
+
+	capacity = maxInstances;
+
+	D3D11_BUFFER_DESC bufferDesc;
+
+	ZeroMemory(&bufferDesc, sizeof(D3D11_BUFFER_DESC));
+
+	bufferDesc.ByteWidth = capacity * sizeof(DXInstanceData);
+	bufferDesc.Usage = D3D11_USAGE_DYNAMIC;
+	bufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
+	bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+
+	HRESULT hr = device->CreateBuffer(&bufferDesc, nullptr, &buffer);
+
+	if (!SUCCEEDED(hr))
+		throw exception("DXInstanceBuffer: Cannot create instance buffer");
+}
+
+DXInstanceBuffer::~DXInstanceBuffer() {
+
+	if (buffer)
+		buffer->Release();
+}
+
+
+// Discard the previous frame's instances and map the buffer for writing
+void DXInstanceBuffer::begin(DXContext *context) {
+
+	D3D11_MAPPED_SUBRESOURCE mapped;
+
+	HRESULT hr = context->Map(buffer, 0, D3D11_MAP_WRITE_DISCARD, 0, &mapped);
+
+	if (!SUCCEEDED(hr))
+		throw exception("DXInstanceBuffer: Cannot map instance buffer");
+
+	mappedData = static_cast<DXInstanceData*>(mapped.pData);
+	count = 0;
+}
+
+// Allocate numInstances instances.  Returns a pointer to write the instance data to and the range to draw them with.  The allocation is truncated to the remaining capacity so the returned range may hold fewer instances than requested.
+DXInstanceData* DXInstanceBuffer::allocate(UINT numInstances, DXInstanceRange *range) {
+
+	if (!mappedData)
+		throw exception("DXInstanceBuffer: Buffer not mapped");
+
+	range->firstInstance = count;
+	range->numInstances = min(numInstances, capacity - count);
+
+	count += range->numInstances;
+
+	return mappedData + range->firstInstance;
+}
+
+// Unmap the buffer - must be called after the last allocation and before any draw call that reads from the buffer
+void DXInstanceBuffer::end(DXContext *context) {
+
+	if (!mappedData)
+		return;
+
+	context->Unmap(buffer, 0);
+	mappedData = nullptr;
+}
+
+
+// Accessor methods
+
+ID3D11Buffer* DXInstanceBuffer::getBuffer() {
+
+	return buffer;
+}
+
+UINT DXInstanceBuffer::getCapacity() {
+
+	return capacity;
+}
+
+UINT DXInstanceBuffer::getInstanceCount() {
+
+	return count;
+}
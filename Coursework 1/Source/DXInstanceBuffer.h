@@ -0,0 +1,60 @@
+//
+// DXInstanceBuffer.h
+//
+
+// Per-instance vertex stream for hardware instancing.  A D3D11_USAGE_DYNAMIC vertex buffer is refilled once per frame (mapped with D3D11_MAP_WRITE_DISCARD) with the instances that survived culling, and each group of instances is drawn from its range of the buffer with DrawIndexedInstanced (see Model::renderInstanced).
+
+#pragma once
+
+#include <d3d11_2.h>
+#include <DirectXMath.h>
+#include <GUObject.h>
+
+class DXContext;
+
+
+// Per-instance data read by the instanced vertex shaders (input slot 1, see instancedCompactVertexDesc)
+struct DXInstanceData {
+
+	DirectX::XMFLOAT4X4					worldMatrix;
+	DirectX::XMFLOAT4X4					worldITMatrix; // Correctly transform normals to world space
+	DirectX::XMFLOAT4					tint; // Multiplied with the material diffuse colour
+};
+
+
+// Range of the instance buffer holding one group of instances, in the units expected by DrawIndexedInstanced
+struct DXInstanceRange {
+
+	UINT								firstInstance;
+	UINT								numInstances;
+};
+
+
+class DXInstanceBuffer : public GUObject {
+
+	ID3D11Buffer						*buffer = nullptr;
+	UINT								capacity = 0;
+
+	// Instances written since the last begin and the mapped base address of the buffer (nullptr when unmapped)
+	UINT								count = 0;
+	DXInstanceData						*mappedData = nullptr;
+
+public:
+
+	// Create a buffer holding at most maxInstances instances per frame
+	DXInstanceBuffer(ID3D11Device *device, UINT maxInstances);
+	~DXInstanceBuffer();
+
+	// Discard the previous frame's instances and map the buffer for writing
+	void begin(DXContext *context);
+
+	// Allocate numInstances instances.  Returns a pointer to write the instance data to and the range to draw them with.  The allocation is truncated to the remaining capacity so the returned range may hold fewer instances than requested.
+	DXInstanceData* allocate(UINT numInstances, DXInstanceRange *range);
+
+	// Unmap the buffer - must be called after the last allocation and before any draw call that reads from the buffer
+	void end(DXContext *context);
+
+	ID3D11Buffer* getBuffer();
+	UINT getCapacity();
+	UINT getInstanceCount();
+};
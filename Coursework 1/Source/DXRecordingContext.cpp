@@ -0,0 +1,459 @@
+//
+// DXRecordingContext.cpp
+//
+
+#include <stdafx.h>
+#include <DXRecordingContext.h>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+ID3D11CommandList* DXRecordedCommandList::getD3DCommandList() {
+
+	return nullptr;
+}
+
+
+DXRecordingContext::DXRecordingContext() {
+
+	for (int i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+		boundRTV[i] = nullptr;
+
+	for (size_t i = 0; i < (size_t)DXCommandType::Count; ++i)
+		pendingCallCount[i] = 0;
+
+	resetCounters();
+}
+
+DXRecordingContext::~DXRecordingContext() {
+}
+
+
+void DXRecordingContext::record(DXCommandType type, UINT slot, UINT count, INT offset, const void *object, UINT instanceCount, UINT startInstance) {
+
+	callCount[(size_t)type]++;
+	pendingCallCount[(size_t)type]++;
+
+	if (!recordCommands)
+		return;
+
+	if (clearOnNextCommand) {
+
+		commands.clear();
+		clearOnNextCommand = false;
+	}
+
+	DXCommand cmd;
+
+	cmd.type = type;
+	cmd.slot = slot;
+	cmd.count = count;
+	cmd.offset = offset;
+	cmd.instanceCount = instanceCount;
+	cmd.startInstance = startInstance;
+	cmd.object = object;
+
+	commands.push_back(cmd);
+}
+
+// Return the size in bytes of the CPU shadow copy required to map the given resource
+size_t DXRecordingContext::shadowSize(ID3D11Resource *resource, UINT *rowPitch) {
+
+	D3D11_RESOURCE_DIMENSION dim;
+	resource->GetType(&dim);
+
+	if (dim == D3D11_RESOURCE_DIMENSION_BUFFER) {
+
+		D3D11_BUFFER_DESC desc;
+		static_cast<ID3D11Buffer*>(resource)->GetDesc(&desc);
+
+		*rowPitch = desc.ByteWidth;
+		return desc.ByteWidth;
+	}
+	else if (dim == D3D11_RESOURCE_DIMENSION_TEXTURE2D) {
+
+		D3D11_TEXTURE2D_DESC desc;
+		static_cast<ID3D11Texture2D*>(resource)->GetDesc(&desc);
+
+		// Assume the widest (4 x 32 bit) texel format so any 2D texture can be mapped
+		*rowPitch = desc.Width * 16;
+		return (size_t)(*rowPitch) * desc.Height;
+	}
+
+	// Other resource types are never mapped by the application - provide a nominal block
+	*rowPitch = 65536;
+	return 65536;
+}
+
+
+// Rasteriser stage
+
+void DXRecordingContext::RSSetState(ID3D11RasterizerState *rasterizerState) {
+
+	record(DXCommandType::RSSetState, 0, 1, 0, rasterizerState);
+}
+
+void DXRecordingContext::RSSetViewports(UINT numViewports, const D3D11_VIEWPORT *viewports) {
+
+	record(DXCommandType::RSSetViewports, 0, numViewports, 0, viewports);
+}
+
+
+// Output merger stage
+
+void DXRecordingContext::OMSetDepthStencilState(ID3D11DepthStencilState *depthStencilState, UINT stencilRef) {
+
+	record(DXCommandType::OMSetDepthStencilState, stencilRef, 1, 0, depthStencilState);
+}
+
+void DXRecordingContext::OMSetBlendState(ID3D11BlendState *blendState, const FLOAT blendFactor[4], UINT sampleMask) {
+
+	record(DXCommandType::OMSetBlendState, sampleMask, 1, 0, blendState);
+}
+
+void DXRecordingContext::OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *renderTargetViews, ID3D11DepthStencilView *depthStencilView) {
+
+	for (UINT i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+		boundRTV[i] = (renderTargetViews && i < numViews) ? renderTargetViews[i] : nullptr;
+
+	boundDSV = depthStencilView;
+
+	record(DXCommandType::OMSetRenderTargets, 0, numViews, 0, boundRTV[0]);
+}
+
+// Return the bound views.  As with ID3D11DeviceContext::OMGetRenderTargets a reference is added to each returned interface.
+void DXRecordingContext::OMGetRenderTargets(UINT numViews, ID3D11RenderTargetView **renderTargetViews, ID3D11DepthStencilView **depthStencilView) {
+
+	if (renderTargetViews) {
+
+		for (UINT i = 0; i < numViews && i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i) {
+
+			renderTargetViews[i] = boundRTV[i];
+
+			if (renderTargetViews[i])
+				renderTargetViews[i]->AddRef();
+		}
+	}
+
+	if (depthStencilView) {
+
+		*depthStencilView = boundDSV;
+
+		if (boundDSV)
+			boundDSV->AddRef();
+	}
+}
+
+
+// Shader stages
+
+void DXRecordingContext::VSSetShader(ID3D11VertexShader *vertexShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) {
+
+	record(DXCommandType::VSSetShader, 0, 1, 0, vertexShader);
+}
+
+void DXRecordingContext::PSSetShader(ID3D11PixelShader *pixelShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) {
+
+	record(DXCommandType::PSSetShader, 0, 1, 0, pixelShader);
+}
+
+void DXRecordingContext::GSSetShader(ID3D11GeometryShader *geometryShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) {
+
+	record(DXCommandType::GSSetShader, 0, 1, 0, geometryShader);
+}
+
+void DXRecordingContext::VSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers) {
+
+	record(DXCommandType::VSSetConstantBuffers, startSlot, numBuffers, 0, (constantBuffers) ? constantBuffers[0] : nullptr);
+}
+
+void DXRecordingContext::PSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers) {
+
+	record(DXCommandType::PSSetConstantBuffers, startSlot, numBuffers, 0, (constantBuffers) ? constantBuffers[0] : nullptr);
+}
+
+void DXRecordingContext::GSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers) {
+
+	record(DXCommandType::GSSetConstantBuffers, startSlot, numBuffers, 0, (constantBuffers) ? constantBuffers[0] : nullptr);
+}
+
+void DXRecordingContext::VSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants) {
+
+	record(DXCommandType::VSSetConstantBuffers1, startSlot, numBuffers, (firstConstant) ? (INT)firstConstant[0] : 0, (constantBuffers) ? constantBuffers[0] : nullptr);
+}
+
+void DXRecordingContext::PSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants) {
+
+	record(DXCommandType::PSSetConstantBuffers1, startSlot, numBuffers, (firstConstant) ? (INT)firstConstant[0] : 0, (constantBuffers) ? constantBuffers[0] : nullptr);
+}
+
+void DXRecordingContext::GSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants) {
+
+	record(DXCommandType::GSSetConstantBuffers1, startSlot, numBuffers, (firstConstant) ? (INT)firstConstant[0] : 0, (constantBuffers) ? constantBuffers[0] : nullptr);
+}
+
+void DXRecordingContext::PSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *shaderResourceViews) {
+
+	record(DXCommandType::PSSetShaderResources, startSlot, numViews, 0, (shaderResourceViews) ? shaderResourceViews[0] : nullptr);
+}
+
+void DXRecordingContext::PSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers) {
+
+	record(DXCommandType::PSSetSamplers, startSlot, numSamplers, 0, (samplers) ? samplers[0] : nullptr);
+}
+
+
+// Input assembler stage
+
+void DXRecordingContext::IASetInputLayout(ID3D11InputLayout *inputLayout) {
+
+	record(DXCommandType::IASetInputLayout, 0, 1, 0, inputLayout);
+}
+
+void DXRecordingContext::IASetVertexBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *vertexBuffers, const UINT *strides, const UINT *offsets) {
+
+	record(DXCommandType::IASetVertexBuffers, startSlot, numBuffers, (offsets) ? (INT)offsets[0] : 0, (vertexBuffers) ? vertexBuffers[0] : nullptr);
+}
+
+void DXRecordingContext::IASetIndexBuffer(ID3D11Buffer *indexBuffer, DXGI_FORMAT format, UINT offset) {
+
+	record(DXCommandType::IASetIndexBuffer, (UINT)format, 1, (INT)offset, indexBuffer);
+}
+
+void DXRecordingContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology) {
+
+	record(DXCommandType::IASetPrimitiveTopology, (UINT)topology, 1, 0, nullptr);
+}
+
+
+// Resource access
+
+void DXRecordingContext::ClearRenderTargetView(ID3D11RenderTargetView *renderTargetView, const FLOAT colour[4]) {
+
+	record(DXCommandType::ClearRenderTargetView, 0, 1, 0, renderTargetView);
+}
+
+void DXRecordingContext::ClearDepthStencilView(ID3D11DepthStencilView *depthStencilView, UINT clearFlags, FLOAT depth, UINT8 stencil) {
+
+	record(DXCommandType::ClearDepthStencilView, clearFlags, 1, 0, depthStencilView);
+}
+
+HRESULT DXRecordingContext::Map(ID3D11Resource *resource, UINT subresource, D3D11_MAP mapType, UINT mapFlags, D3D11_MAPPED_SUBRESOURCE *mappedResource) {
+
+	if (!resource || !mappedResource)
+		return E_INVALIDARG;
+
+	UINT rowPitch = 0;
+	size_t size = shadowSize(resource, &rowPitch);
+
+	// Shadow memory persists between maps so WRITE_NO_OVERWRITE / READ_WRITE semantics hold
+	vector<uint8_t>& shadow = shadowMemory[resource];
+
+	if (shadow.size() < size)
+		shadow.resize(size);
+
+	mappedResource->pData = shadow.data();
+	mappedResource->RowPitch = rowPitch;
+	mappedResource->DepthPitch = (UINT)size;
+
+	bytesMapped += size;
+	pendingBytesMapped += size;
+
+	record(DXCommandType::Map, (UINT)mapType, subresource, (INT)size, resource);
+
+	return S_OK;
+}
+
+void DXRecordingContext::Unmap(ID3D11Resource *resource, UINT subresource) {
+
+	record(DXCommandType::Unmap, 0, subresource, 0, resource);
+}
+
+void DXRecordingContext::CopyResource(ID3D11Resource *dstResource, ID3D11Resource *srcResource) {
+
+	record(DXCommandType::CopyResource, 0, 1, 0, dstResource);
+}
+
+
+// Queries
+
+void DXRecordingContext::End(ID3D11Asynchronous *async) {
+
+	record(DXCommandType::End, 0, 1, 0, async);
+}
+
+// There is no GPU so every query has completed by the time it is read.  Event queries (the only type used) return TRUE.
+HRESULT DXRecordingContext::GetData(ID3D11Asynchronous *async, void *data, UINT dataSize, UINT getDataFlags) {
+
+	record(DXCommandType::GetData, getDataFlags, 1, 0, async);
+
+	if (data && dataSize >= sizeof(BOOL))
+		*static_cast<BOOL*>(data) = TRUE;
+
+	return S_OK;
+}
+
+
+// Draw calls
+
+void DXRecordingContext::Draw(UINT vertexCount, UINT startVertexLocation) {
+
+	record(DXCommandType::Draw, startVertexLocation, vertexCount, 0, nullptr);
+}
+
+void DXRecordingContext::DrawIndexed(UINT indexCount, UINT startIndexLocation, INT baseVertexLocation) {
+
+	record(DXCommandType::DrawIndexed, startIndexLocation, indexCount, baseVertexLocation, nullptr);
+}
+
+void DXRecordingContext::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation) {
+
+	record(DXCommandType::DrawIndexedInstanced, startIndexLocation, indexCountPerInstance, baseVertexLocation, nullptr, instanceCount, startInstanceLocation);
+}
+
+
+// Command lists
+
+HRESULT DXRecordingContext::FinishCommandList(BOOL restoreDeferredContextState, DXCommandList **commandList) {
+
+	record(DXCommandType::FinishCommandList, restoreDeferredContextState, 0, 0, nullptr);
+
+	DXRecordedCommandList *recordedList = new DXRecordedCommandList();
+
+	recordedList->commands.swap(commands);
+
+	for (size_t i = 0; i < (size_t)DXCommandType::Count; ++i) {
+
+		recordedList->callCount[i] = pendingCallCount[i];
+		pendingCallCount[i] = 0;
+	}
+
+	recordedList->bytesMapped = pendingBytesMapped;
+	pendingBytesMapped = 0;
+
+	// As with Direct3D the deferred context returns to the default state unless its state is restored
+	if (!restoreDeferredContextState) {
+
+		for (int i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+			boundRTV[i] = nullptr;
+
+		boundDSV = nullptr;
+	}
+
+	*commandList = recordedList;
+
+	return S_OK;
+}
+
+void DXRecordingContext::ExecuteCommandList(DXCommandList *commandList, BOOL restoreContextState) {
+
+	DXRecordedCommandList *recordedList = static_cast<DXRecordedCommandList*>(commandList);
+
+	record(DXCommandType::ExecuteCommandList, restoreContextState, (UINT)recordedList->commands.size(), 0, commandList);
+
+	for (size_t i = 0; i < (size_t)DXCommandType::Count; ++i)
+		callCount[i] += recordedList->callCount[i];
+
+	bytesMapped += recordedList->bytesMapped;
+
+	if (recordCommands)
+		commands.insert(commands.end(), recordedList->commands.begin(), recordedList->commands.end());
+
+	if (!restoreContextState) {
+
+		for (int i = 0; i < D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT; ++i)
+			boundRTV[i] = nullptr;
+
+		boundDSV = nullptr;
+	}
+}
+
+
+ID3D11DeviceContext* DXRecordingContext::getD3DContext() {
+
+	return nullptr;
+}
+
+
+//
+// Recording interface
+//
+
+// Mark the end of a frame (called in place of IDXGISwapChain::Present).  The command stream of the completed frame remains available until the next call is recorded.
+void DXRecordingContext::endFrame() {
+
+	record(DXCommandType::Present, 0, 0, 0, nullptr);
+
+	framesRecorded++;
+	clearOnNextCommand = true;
+}
+
+void DXRecordingContext::setRecordCommands(const bool enabled) {
+
+	recordCommands = enabled;
+
+	if (!recordCommands)
+		commands.clear();
+}
+
+// Reset all call counters, the mapped byte count and the frame count
+void DXRecordingContext::resetCounters() {
+
+	for (size_t i = 0; i < (size_t)DXCommandType::Count; ++i)
+		callCount[i] = 0;
+
+	bytesMapped = 0;
+	framesRecorded = 0;
+}
+
+const std::vector<DXCommand>& DXRecordingContext::getCommands() const {
+
+	return commands;
+}
+
+uint64_t DXRecordingContext::getCallCount(const DXCommandType type) const {
+
+	return (type < DXCommandType::Count) ? callCount[(size_t)type] : 0;
+}
+
+uint64_t DXRecordingContext::getTotalCallCount() const {
+
+	uint64_t total = 0;
+
+	for (size_t i = 0; i < (size_t)DXCommandType::Count; ++i)
+		total += callCount[i];
+
+	return total;
+}
+
+uint64_t DXRecordingContext::getBytesMapped() const {
+
+	return bytesMapped;
+}
+
+uint64_t DXRecordingContext::getFramesRecorded() const {
+
+	return framesRecorded;
+}
+
+// Print the per-call counters (totals and per-frame averages) to stdout
+void DXRecordingContext::reportCallCounts() const {
+
+	double frames = (framesRecorded > 0) ? (double)framesRecorded : 1.0;
+
+	cout << "API calls recorded over " << framesRecorded << " frames" << endl;
+	cout << left << setw(26) << "call" << right << setw(14) << "total" << setw(14) << "per frame" << endl;
+
+	for (size_t i = 0; i < (size_t)DXCommandType::Count; ++i) {
+
+		if (callCount[i] == 0)
+			continue;
+
+		cout << left << setw(26) << DXCommandName((DXCommandType)i) << right << setw(14) << callCount[i] << setw(14) << fixed << setprecision(1) << (double)callCount[i] / frames << endl;
+	}
+
+	cout << left << setw(26) << "all calls" << right << setw(14) << getTotalCallCount() << setw(14) << fixed << setprecision(1) << (double)getTotalCallCount() / frames << endl;
+	cout << left << setw(26) << "bytes mapped" << right << setw(14) << bytesMapped << setw(14) << fixed << setprecision(1) << (double)bytesMapped / frames << endl << endl;
+}
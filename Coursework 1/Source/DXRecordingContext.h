@@ -0,0 +1,146 @@
+//
+// DXRecordingContext.h
+//
+
+// Headless backend for DXContext.  No call reaches a GPU - every state change, Map / Unmap and draw call is appended to an inspectable command stream and counted per call type so the Scene frame loop can be run and profiled without rendering on a GPU.  Resource handles passed to the context are real objects created on the NULL Direct3D device of the HEADLESS backend (see DXBackendType) - the context only reads their descriptions to size its Map shadow memory.  Map returns CPU-side shadow memory sized to the mapped resource so existing upload code runs unchanged.
+
+#pragma once
+
+#include <DXContext.h>
+#include <vector>
+#include <unordered_map>
+
+
+// A single recorded call.  The meaning of slot, count and offset depends on the command type (start slot / number of bound objects for state setters, map type / subresource for Map, vertex or index counts and start locations for draws).  Instanced draws also store the instance count and start instance.
+struct DXCommand {
+
+	DXCommandType						type;
+	UINT								slot;
+	UINT								count;
+	INT									offset;
+
+	// Number of instances and first instance drawn (1 and 0 for every other command)
+	UINT								instanceCount;
+	UINT								startInstance;
+
+	// First object bound by the call, or the resource / view operated on
+	const void							*object;
+};
+
+
+// Command list finished on a deferred recording context.  Holds the commands and per-call counts recorded since the previous FinishCommandList.
+class DXRecordedCommandList : public DXCommandList {
+
+public:
+
+	std::vector<DXCommand>				commands;
+	uint64_t							callCount[(size_t)DXCommandType::Count];
+	uint64_t							bytesMapped = 0;
+
+	// No Direct3D command list exists for the headless backend
+	ID3D11CommandList* getD3DCommandList();
+};
+
+
+class DXRecordingContext : public DXContext {
+
+	// Command stream for the current (or last completed) frame
+	std::vector<DXCommand>				commands;
+
+	// When false only the per-call counters are updated (avoids growing the stream when only call counts are needed)
+	bool								recordCommands = true;
+
+	// Clear the command stream on the next recorded call - set when a frame ends so the last complete frame stays inspectable
+	bool								clearOnNextCommand = false;
+
+	uint64_t							callCount[(size_t)DXCommandType::Count];
+	uint64_t							bytesMapped = 0;
+	uint64_t							framesRecorded = 0;
+
+	// Calls and mapped bytes since the last FinishCommandList - moved into the command list when the context is used as a deferred context
+	uint64_t							pendingCallCount[(size_t)DXCommandType::Count];
+	uint64_t							pendingBytesMapped = 0;
+
+	// Bound output merger state so OMGetRenderTargets can be answered without a device
+	ID3D11RenderTargetView				*boundRTV[D3D11_SIMULTANEOUS_RENDER_TARGET_COUNT];
+	ID3D11DepthStencilView				*boundDSV = nullptr;
+
+	// CPU-side memory returned from Map, keyed on the mapped resource
+	std::unordered_map<ID3D11Resource*, std::vector<uint8_t> >	shadowMemory;
+
+	void record(DXCommandType type, UINT slot, UINT count, INT offset, const void *object, UINT instanceCount = 1, UINT startInstance = 0);
+
+	// Return the size in bytes of the CPU shadow copy required to map the given resource
+	static size_t shadowSize(ID3D11Resource *resource, UINT *rowPitch);
+
+public:
+
+	DXRecordingContext();
+	~DXRecordingContext();
+
+	void RSSetState(ID3D11RasterizerState *rasterizerState);
+	void RSSetViewports(UINT numViewports, const D3D11_VIEWPORT *viewports);
+
+	void OMSetDepthStencilState(ID3D11DepthStencilState *depthStencilState, UINT stencilRef);
+	void OMSetBlendState(ID3D11BlendState *blendState, const FLOAT blendFactor[4], UINT sampleMask);
+	void OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *renderTargetViews, ID3D11DepthStencilView *depthStencilView);
+	void OMGetRenderTargets(UINT numViews, ID3D11RenderTargetView **renderTargetViews, ID3D11DepthStencilView **depthStencilView);
+
+	void VSSetShader(ID3D11VertexShader *vertexShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances);
+	void PSSetShader(ID3D11PixelShader *pixelShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances);
+	void GSSetShader(ID3D11GeometryShader *geometryShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances);
+	void VSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers);
+	void PSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers);
+	void GSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers);
+	void VSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants);
+	void PSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants);
+	void GSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants);
+	void PSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *shaderResourceViews);
+	void PSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers);
+
+	void IASetInputLayout(ID3D11InputLayout *inputLayout);
+	void IASetVertexBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *vertexBuffers, const UINT *strides, const UINT *offsets);
+	void IASetIndexBuffer(ID3D11Buffer *indexBuffer, DXGI_FORMAT format, UINT offset);
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+
+	void ClearRenderTargetView(ID3D11RenderTargetView *renderTargetView, const FLOAT colour[4]);
+	void ClearDepthStencilView(ID3D11DepthStencilView *depthStencilView, UINT clearFlags, FLOAT depth, UINT8 stencil);
+	HRESULT Map(ID3D11Resource *resource, UINT subresource, D3D11_MAP mapType, UINT mapFlags, D3D11_MAPPED_SUBRESOURCE *mappedResource);
+	void Unmap(ID3D11Resource *resource, UINT subresource);
+	void CopyResource(ID3D11Resource *dstResource, ID3D11Resource *srcResource);
+	void End(ID3D11Asynchronous *async);
+	HRESULT GetData(ID3D11Asynchronous *async, void *data, UINT dataSize, UINT getDataFlags);
+
+	void Draw(UINT vertexCount, UINT startVertexLocation);
+	void DrawIndexed(UINT indexCount, UINT startIndexLocation, INT baseVertexLocation);
+	void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation);
+
+	// FinishCommandList moves the commands recorded since the last call into a DXRecordedCommandList.  ExecuteCommandList appends the commands of the list to this context's stream and adds its counts to this context's counters.
+	HRESULT FinishCommandList(BOOL restoreDeferredContextState, DXCommandList **commandList);
+	void ExecuteCommandList(DXCommandList *commandList, BOOL restoreContextState);
+
+	// No Direct3D context exists for the headless backend
+	ID3D11DeviceContext* getD3DContext();
+
+
+	//
+	// Recording interface
+	//
+
+	// Mark the end of a frame (called in place of IDXGISwapChain::Present).  The command stream of the completed frame remains available until the next call is recorded.
+	void endFrame();
+
+	void setRecordCommands(const bool enabled);
+
+	// Reset all call counters, the mapped byte count and the frame count
+	void resetCounters();
+
+	const std::vector<DXCommand>& getCommands() const;
+	uint64_t getCallCount(const DXCommandType type) const;
+	uint64_t getTotalCallCount() const;
+	uint64_t getBytesMapped() const;
+	uint64_t getFramesRecorded() const;
+
+	// Print the per-call counters (totals and per-frame averages) to stdout
+	void reportCallCounts() const;
+};
@@ -0,0 +1,297 @@
+
+//
+// DXRenderQueue.cpp
+//
+
+#include <stdafx.h>
+#include <DXRenderQueue.h>
+#include <DXBaseModel.h>
+#include <Effect.h>
+
+using namespace std;
+
+
+bool DXRenderQueue::TextureSet::operator<(const TextureSet &rhs) const {
+
+	if (numViews != rhs.numViews)
+		return numViews < rhs.numViews;
+
+	if (sampler != rhs.sampler)
+		return sampler < rhs.sampler;
+
+	for (UINT i = 0; i < numViews; ++i) {
+
+		if (views[i] != rhs.views[i])
+			return views[i] < rhs.views[i];
+	}
+
+	return false;
+}
+
+
+DXRenderQueue::DXRenderQueue() {
+}
+
+
+uint16_t DXRenderQueue::registerEffect(Effect *effect) {
+
+	map<Effect*, uint16_t>::iterator i = effectIDs.find(effect);
+
+	if (i != effectIDs.end())
+		return i->second;
+
+	if (effects.size() >= (1 << StateIDBits))
+		throw exception("DXRenderQueue: Too many unique effects");
+
+	uint16_t id = (uint16_t)effects.size();
+
+	effectIDs[effect] = id;
+	effects.push_back(effect);
+	effectBlended.push_back(effect->isBlended());
+
+	return id;
+}
+
+uint16_t DXRenderQueue::registerTextureSet(DXBaseModel *model) {
+
+	TextureSet textureSet;
+
+	ZeroMemory(&textureSet, sizeof(TextureSet));
+	textureSet.numViews = model->getTextures(textureSet.views, &textureSet.sampler);
+
+	if (textureSet.numViews == 0)
+		textureSet.sampler = nullptr;
+
+	map<TextureSet, uint16_t>::iterator i = textureSetIDs.find(textureSet);
+
+	if (i != textureSetIDs.end())
+		return i->second;
+
+	if (textureSetIDs.size() >= (1 << StateIDBits))
+		throw exception("DXRenderQueue: Too many unique texture sets");
+
+	uint16_t id = (uint16_t)textureSetIDs.size();
+
+	textureSetIDs[textureSet] = id;
+
+	return id;
+}
+
+uint16_t DXRenderQueue::registerMesh(DXBaseModel *model) {
+
+	pair<ID3D11Buffer*, ID3D11Buffer*> mesh(model->getVertexBuffer(), model->getIndexBuffer());
+
+	map<pair<ID3D11Buffer*, ID3D11Buffer*>, uint16_t>::iterator i = meshIDs.find(mesh);
+
+	if (i != meshIDs.end())
+		return i->second;
+
+	if (meshIDs.size() >= (1 << StateIDBits))
+		throw exception("DXRenderQueue: Too many unique meshes");
+
+	uint16_t id = (uint16_t)meshIDs.size();
+
+	meshIDs[mesh] = id;
+
+	return id;
+}
+
+
+// Remove all items and set the depth mapped to the largest depth key
+void DXRenderQueue::begin(const float _farDepth) {
+
+	items.clear();
+	sortEntries.clear();
+	farDepth = _farDepth;
+}
+
+// Add an item.  viewDepth is the view space depth of the item used to order items within the same state (opaque) or across all states (blended).
+void DXRenderQueue::submit(const DXDrawItem &item, const float viewDepth) {
+
+	Effect *drawEffect = (item.effect) ? item.effect : ((item.model) ? item.model->getEffect() : nullptr);
+
+	if (!item.model || !drawEffect || !item.model->getVertexBuffer())
+		return;
+
+	QueuedItem queued;
+
+	queued.draw = item;
+	queued.effectID = registerEffect(drawEffect);
+	queued.textureID = registerTextureSet(item.model);
+	queued.meshID = registerMesh(item.model);
+
+	// Quantise the depth to DepthBits
+	const uint64_t maxDepth = (1 << DepthBits) - 1;
+
+	float normalisedDepth = (farDepth > 0.0f) ? viewDepth / farDepth : 0.0f;
+
+	normalisedDepth = min(max(normalisedDepth, 0.0f), 1.0f);
+
+	uint64_t depth = (uint64_t)(normalisedDepth * (float)maxDepth);
+
+	uint64_t effect = queued.effectID;
+	uint64_t texture = queued.textureID;
+	uint64_t mesh = queued.meshID;
+
+	SortEntry entry;
+
+	if (effectBlended[queued.effectID]) {
+
+		// Blended items are drawn back-to-front across all states
+		entry.key = ((uint64_t)BlendedPass << 62) | ((maxDepth - depth) << 38) | (effect << 26) | (texture << 14) | (mesh << 2);
+	}
+	else {
+
+		// Opaque items are grouped by state and drawn front-to-back within each state
+		entry.key = ((uint64_t)OpaquePass << 62) | (effect << 50) | (texture << 38) | (mesh << 26) | (depth << 2);
+	}
+
+	entry.item = (uint32_t)items.size();
+
+	items.push_back(queued);
+	sortEntries.push_back(entry);
+}
+
+// LSD radix sort of sortEntries by key, 8 bits per pass.  Passes where every key has the same digit are skipped.
+void DXRenderQueue::radixSort() {
+
+	const size_t numEntries = sortEntries.size();
+
+	if (numEntries < 2)
+		return;
+
+	// Build the histogram of every digit in a single pass over the keys
+	uint32_t histogram[8][256];
+
+	ZeroMemory(histogram, sizeof(histogram));
+
+	for (size_t i = 0; i < numEntries; ++i) {
+
+		uint64_t key = sortEntries[i].key;
+
+		for (int digit = 0; digit < 8; ++digit)
+			histogram[digit][(key >> (digit * 8)) & 0xFF]++;
+	}
+
+	sortScratch.resize(numEntries);
+
+	SortEntry *src = &sortEntries[0];
+	SortEntry *dst = &sortScratch[0];
+
+	for (int digit = 0; digit < 8; ++digit) {
+
+		uint32_t *counts = histogram[digit];
+
+		// Skip the pass if all keys share this digit
+		if (counts[(src[0].key >> (digit * 8)) & 0xFF] == numEntries)
+			continue;
+
+		uint32_t offsets[256];
+		uint32_t sum = 0;
+
+		for (int bucket = 0; bucket < 256; ++bucket) {
+
+			offsets[bucket] = sum;
+			sum += counts[bucket];
+		}
+
+		for (size_t i = 0; i < numEntries; ++i)
+			dst[offsets[(src[i].key >> (digit * 8)) & 0xFF]++] = src[i];
+
+		swap(src, dst);
+	}
+
+	// Odd number of passes - sorted data is in the scratch buffer
+	if (src != &sortEntries[0])
+		sortEntries.swap(sortScratch);
+}
+
+// Sort the submitted items by key
+void DXRenderQueue::sort() {
+
+	radixSort();
+}
+
+// Draw the sorted items, binding state only when it changes.  Per-object constants are bound from constantRing to objectSlot.
+void DXRenderQueue::execute(DXContext *context, DXConstantRing *constantRing, const UINT objectSlot) {
+
+	int boundEffect = -1;
+	int boundTextureSet = -1;
+	int boundMesh = -1;
+
+	for (size_t i = 0; i < sortEntries.size(); ++i) {
+
+		QueuedItem &queued = items[sortEntries[i].item];
+		DXBaseModel *model = queued.draw.model;
+
+		if (queued.effectID != boundEffect) {
+
+			effects[queued.effectID]->bindPipeline(context);
+			boundEffect = queued.effectID;
+			effectBinds++;
+
+			// The input layout is bound with the geometry and depends on the effect
+			boundMesh = -1;
+		}
+
+		if (queued.textureID != boundTextureSet) {
+
+			model->bindTextures(context);
+			boundTextureSet = queued.textureID;
+			textureBinds++;
+		}
+
+		if (queued.meshID != boundMesh) {
+
+			model->bindGeometry(context);
+			boundMesh = queued.meshID;
+			geometryBinds++;
+		}
+
+		constantRing->bind(context, (queued.draw.geometryShaderConstants) ? ConstantStageGS : ConstantStageVS, objectSlot, 1, &queued.draw.objectConstants);
+
+		model->draw(context);
+		itemsDrawn++;
+	}
+}
+
+void DXRenderQueue::resetStats() {
+
+	itemsDrawn = 0;
+	effectBinds = 0;
+	textureBinds = 0;
+	geometryBinds = 0;
+}
+
+
+// Accessor methods
+
+int DXRenderQueue::getItemCount() {
+
+	return (int)items.size();
+}
+
+uint64_t DXRenderQueue::getItemsDrawn() {
+
+	return itemsDrawn;
+}
+
+uint64_t DXRenderQueue::getStateBinds() {
+
+	return effectBinds + textureBinds + geometryBinds;
+}
+
+uint64_t DXRenderQueue::getEffectBinds() {
+
+	return effectBinds;
+}
+
+uint64_t DXRenderQueue::getTextureBinds() {
+
+	return textureBinds;
+}
+
+uint64_t DXRenderQueue::getGeometryBinds() {
+
+	return geometryBinds;
+}
@@ -0,0 +1,131 @@
+
+//
+// DXRenderQueue.h
+//
+
+// Per-view queue of draw items.  Each item is given a 64-bit sort key built from its pass (opaque / blended), effect, texture set, mesh and view depth.  The keys are radix sorted and the queue is executed in key order, binding the effect, texture set and geometry of an item only when they differ from the previous item.  The number of state changes therefore scales with the number of unique states rather than the number of objects.
+//
+// Sort key layout (most significant bit first):
+//
+//	opaque items	[63:62] pass = 0	[61:50] effect		[49:38] texture set		[37:26] mesh		[25:2] depth (front-to-back)
+//	blended items	[63:62] pass = 1	[61:38] depth (back-to-front)		[37:26] effect		[25:14] texture set		[13:2] mesh
+
+#pragma once
+
+#include <d3d11_2.h>
+#include <GUObject.h>
+#include <DXConstantRing.h>
+#include <DXBaseModel.h>
+#include <map>
+#include <utility>
+#include <vector>
+
+class DXContext;
+class Effect;
+
+
+// Draw submitted to the queue
+struct DXDrawItem {
+
+	DXBaseModel							*model;
+
+	// Effect used to draw the item in place of the model's effect (nullptr to use the model's effect).  It must use the same vertex input layout as the model's effect.
+	Effect								*effect;
+
+	// Range of the constant ring holding the per-object constants of the item
+	DXConstantRange						objectConstants;
+
+	// Bind the per-object constants to the geometry shader rather than the vertex shader
+	bool								geometryShaderConstants;
+};
+
+
+class DXRenderQueue : public GUObject {
+
+	// Texture set bound by DXBaseModel::bindTextures.  Ordered so sets can be used as map keys.
+	struct TextureSet {
+
+		ID3D11ShaderResourceView		*views[DXBaseModel::MaxTextures];
+		UINT							numViews;
+		ID3D11SamplerState				*sampler;
+
+		bool operator<(const TextureSet &rhs) const;
+	};
+
+	struct QueuedItem {
+
+		DXDrawItem						draw;
+		uint16_t						effectID;
+		uint16_t						textureID;
+		uint16_t						meshID;
+	};
+
+	struct SortEntry {
+
+		uint64_t						key;
+		uint32_t						item;
+	};
+
+	// State registries - each unique effect, texture set and mesh (vertex / index buffer pair) is given a small integer ID on first use
+	std::map<Effect*, uint16_t>			effectIDs;
+	std::vector<Effect*>				effects;
+	std::vector<bool>					effectBlended;
+	std::map<TextureSet, uint16_t>		textureSetIDs;
+	std::map<std::pair<ID3D11Buffer*, ID3D11Buffer*>, uint16_t> meshIDs;
+
+	std::vector<QueuedItem>				items;
+	std::vector<SortEntry>				sortEntries;
+	std::vector<SortEntry>				sortScratch;
+
+	// Depth mapped to the largest depth key (depths are clamped to [0, farDepth])
+	float								farDepth = 1000.0f;
+
+	// Statistics accumulated over all calls to execute since the last resetStats
+	uint64_t							itemsDrawn = 0;
+	uint64_t							effectBinds = 0;
+	uint64_t							textureBinds = 0;
+	uint64_t							geometryBinds = 0;
+
+	uint16_t registerEffect(Effect *effect);
+	uint16_t registerTextureSet(DXBaseModel *model);
+	uint16_t registerMesh(DXBaseModel *model);
+
+	// LSD radix sort of sortEntries by key, 8 bits per pass.  Passes where every key has the same digit are skipped.
+	void radixSort();
+
+public:
+
+	// Number of bits used for each state ID and for the quantised depth
+	static const int					StateIDBits = 12;
+	static const int					DepthBits = 24;
+
+	enum DXRenderPass : uint32_t {
+
+		OpaquePass = 0,
+		BlendedPass = 1
+	};
+
+	DXRenderQueue();
+
+	// Remove all items and set the depth mapped to the largest depth key
+	void begin(const float _farDepth);
+
+	// Add an item.  viewDepth is the view space depth of the item used to order items within the same state (opaque) or across all states (blended).
+	void submit(const DXDrawItem &item, const float viewDepth);
+
+	// Sort the submitted items by key
+	void sort();
+
+	// Draw the sorted items, binding state only when it changes.  Per-object constants are bound from constantRing to objectSlot.
+	void execute(DXContext *context, DXConstantRing *constantRing, const UINT objectSlot);
+
+	void resetStats();
+
+	// Accessor methods
+	int getItemCount();
+	uint64_t getItemsDrawn();
+	uint64_t getStateBinds();
+	uint64_t getEffectBinds();
+	uint64_t getTextureBinds();
+	uint64_t getGeometryBinds();
+};
@@ -0,0 +1,592 @@
+//
+// DXStateFilterContext.cpp
+//
+
+#include <stdafx.h>
+#include <DXStateFilterContext.h>
+#include <iostream>
+#include <iomanip>
+
+using namespace std;
+
+
+DXStateFilterContext::DXStateFilterContext(DXContext *_target) {
+
+	target = _target;
+
+	if (!target)
+		throw exception("DXStateFilterContext: Invalid target context");
+
+	target->retain();
+
+	resetCounters();
+	invalidate();
+}
+
+DXStateFilterContext::~DXStateFilterContext() {
+
+	if (target)
+		target->release();
+}
+
+
+// Count the call and return true if it should be forwarded.  unchanged is true if the call would not change the shadowed state.
+bool DXStateFilterContext::issue(DXCommandType type, bool unchanged) {
+
+	if (filtering && unchanged) {
+
+		filteredCount[(size_t)type]++;
+		return false;
+	}
+
+	issuedCount[(size_t)type]++;
+	return true;
+}
+
+
+// Rasteriser stage
+
+void DXStateFilterContext::RSSetState(ID3D11RasterizerState *_rasterizerState) {
+
+	if (!issue(DXCommandType::RSSetState, rasterizerStateKnown && rasterizerState == _rasterizerState))
+		return;
+
+	target->RSSetState(_rasterizerState);
+
+	rasterizerState = _rasterizerState;
+	rasterizerStateKnown = true;
+}
+
+void DXStateFilterContext::RSSetViewports(UINT _numViewports, const D3D11_VIEWPORT *_viewports) {
+
+	bool unchanged = viewportsKnown && numViewports == _numViewports && (_numViewports == 0 || memcmp(viewports, _viewports, sizeof(D3D11_VIEWPORT) * _numViewports) == 0);
+
+	if (!issue(DXCommandType::RSSetViewports, unchanged))
+		return;
+
+	target->RSSetViewports(_numViewports, _viewports);
+
+	numViewports = min(_numViewports, (UINT)D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE);
+
+	if (numViewports > 0)
+		memcpy(viewports, _viewports, sizeof(D3D11_VIEWPORT) * numViewports);
+
+	viewportsKnown = (numViewports == _numViewports);
+}
+
+
+// Output merger stage
+
+void DXStateFilterContext::OMSetDepthStencilState(ID3D11DepthStencilState *_depthStencilState, UINT _stencilRef) {
+
+	if (!issue(DXCommandType::OMSetDepthStencilState, depthStencilStateKnown && depthStencilState == _depthStencilState && stencilRef == _stencilRef))
+		return;
+
+	target->OMSetDepthStencilState(_depthStencilState, _stencilRef);
+
+	depthStencilState = _depthStencilState;
+	stencilRef = _stencilRef;
+	depthStencilStateKnown = true;
+}
+
+void DXStateFilterContext::OMSetBlendState(ID3D11BlendState *_blendState, const FLOAT _blendFactor[4], UINT _sampleMask) {
+
+	// A null blend factor is equivalent to { 1, 1, 1, 1 }
+	static const FLOAT defaultBlendFactor[4] = { 1.0f, 1.0f, 1.0f, 1.0f };
+	const FLOAT *factor = (_blendFactor) ? _blendFactor : defaultBlendFactor;
+
+	bool unchanged = blendStateKnown && blendState == _blendState && sampleMask == _sampleMask && memcmp(blendFactor, factor, sizeof(blendFactor)) == 0;
+
+	if (!issue(DXCommandType::OMSetBlendState, unchanged))
+		return;
+
+	target->OMSetBlendState(_blendState, _blendFactor, _sampleMask);
+
+	blendState = _blendState;
+	memcpy(blendFactor, factor, sizeof(blendFactor));
+	sampleMask = _sampleMask;
+	blendStateKnown = true;
+}
+
+// Render targets are not filtered.  Binding a render target unbinds any shader resource view of the same resource so the shadowed views are forgotten.
+void DXStateFilterContext::OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *renderTargetViews, ID3D11DepthStencilView *depthStencilView) {
+
+	issue(DXCommandType::OMSetRenderTargets, false);
+
+	target->OMSetRenderTargets(numViews, renderTargetViews, depthStencilView);
+
+	for (int i = 0; i < D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT; ++i)
+		shaderResourceKnown[i] = false;
+}
+
+void DXStateFilterContext::OMGetRenderTargets(UINT numViews, ID3D11RenderTargetView **renderTargetViews, ID3D11DepthStencilView **depthStencilView) {
+
+	target->OMGetRenderTargets(numViews, renderTargetViews, depthStencilView);
+}
+
+
+// Shader stages.  Calls that bind class instances are always forwarded.
+
+void DXStateFilterContext::VSSetShader(ID3D11VertexShader *_vertexShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) {
+
+	if (!issue(DXCommandType::VSSetShader, numClassInstances == 0 && vertexShaderKnown && vertexShader == _vertexShader))
+		return;
+
+	target->VSSetShader(_vertexShader, classInstances, numClassInstances);
+
+	vertexShader = _vertexShader;
+	vertexShaderKnown = (numClassInstances == 0);
+}
+
+void DXStateFilterContext::PSSetShader(ID3D11PixelShader *_pixelShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) {
+
+	if (!issue(DXCommandType::PSSetShader, numClassInstances == 0 && pixelShaderKnown && pixelShader == _pixelShader))
+		return;
+
+	target->PSSetShader(_pixelShader, classInstances, numClassInstances);
+
+	pixelShader = _pixelShader;
+	pixelShaderKnown = (numClassInstances == 0);
+}
+
+void DXStateFilterContext::GSSetShader(ID3D11GeometryShader *_geometryShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances) {
+
+	if (!issue(DXCommandType::GSSetShader, numClassInstances == 0 && geometryShaderKnown && geometryShader == _geometryShader))
+		return;
+
+	target->GSSetShader(_geometryShader, classInstances, numClassInstances);
+
+	geometryShader = _geometryShader;
+	geometryShaderKnown = (numClassInstances == 0);
+}
+
+
+// Shared implementation of the {VS|PS|GS}SetConstantBuffers(1) calls.  Returns true if every slot in the range already holds the given binding.
+bool DXStateFilterContext::constantBuffersUnchanged(ShaderStage stage, UINT startSlot, UINT numBuffers, ID3D11Buffer *const *buffers, const UINT *firstConstant, const UINT *numConstants) {
+
+	if (startSlot + numBuffers > D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT)
+		return false;
+
+	for (UINT i = 0; i < numBuffers; ++i) {
+
+		const ConstantBufferBinding &binding = constantBuffers[stage][startSlot + i];
+
+		if (!constantBufferKnown[stage][startSlot + i] || binding.buffer != buffers[i])
+			return false;
+
+		UINT first = (firstConstant && numConstants) ? firstConstant[i] : 0;
+		UINT count = (firstConstant && numConstants) ? numConstants[i] : 0;
+
+		if (binding.firstConstant != first || binding.numConstants != count)
+			return false;
+	}
+
+	return true;
+}
+
+void DXStateFilterContext::setConstantBuffers(ShaderStage stage, UINT startSlot, UINT numBuffers, ID3D11Buffer *const *buffers, const UINT *firstConstant, const UINT *numConstants) {
+
+	for (UINT i = 0; i < numBuffers && startSlot + i < D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT; ++i) {
+
+		ConstantBufferBinding &binding = constantBuffers[stage][startSlot + i];
+
+		binding.buffer = buffers[i];
+		binding.firstConstant = (firstConstant && numConstants) ? firstConstant[i] : 0;
+		binding.numConstants = (firstConstant && numConstants) ? numConstants[i] : 0;
+
+		constantBufferKnown[stage][startSlot + i] = true;
+	}
+}
+
+void DXStateFilterContext::VSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *buffers) {
+
+	if (!issue(DXCommandType::VSSetConstantBuffers, constantBuffersUnchanged(VertexStage, startSlot, numBuffers, buffers, nullptr, nullptr)))
+		return;
+
+	target->VSSetConstantBuffers(startSlot, numBuffers, buffers);
+	setConstantBuffers(VertexStage, startSlot, numBuffers, buffers, nullptr, nullptr);
+}
+
+void DXStateFilterContext::PSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *buffers) {
+
+	if (!issue(DXCommandType::PSSetConstantBuffers, constantBuffersUnchanged(PixelStage, startSlot, numBuffers, buffers, nullptr, nullptr)))
+		return;
+
+	target->PSSetConstantBuffers(startSlot, numBuffers, buffers);
+	setConstantBuffers(PixelStage, startSlot, numBuffers, buffers, nullptr, nullptr);
+}
+
+void DXStateFilterContext::GSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *buffers) {
+
+	if (!issue(DXCommandType::GSSetConstantBuffers, constantBuffersUnchanged(GeometryStage, startSlot, numBuffers, buffers, nullptr, nullptr)))
+		return;
+
+	target->GSSetConstantBuffers(startSlot, numBuffers, buffers);
+	setConstantBuffers(GeometryStage, startSlot, numBuffers, buffers, nullptr, nullptr);
+}
+
+void DXStateFilterContext::VSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *buffers, const UINT *firstConstant, const UINT *numConstants) {
+
+	if (!issue(DXCommandType::VSSetConstantBuffers1, constantBuffersUnchanged(VertexStage, startSlot, numBuffers, buffers, firstConstant, numConstants)))
+		return;
+
+	target->VSSetConstantBuffers1(startSlot, numBuffers, buffers, firstConstant, numConstants);
+	setConstantBuffers(VertexStage, startSlot, numBuffers, buffers, firstConstant, numConstants);
+}
+
+void DXStateFilterContext::PSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *buffers, const UINT *firstConstant, const UINT *numConstants) {
+
+	if (!issue(DXCommandType::PSSetConstantBuffers1, constantBuffersUnchanged(PixelStage, startSlot, numBuffers, buffers, firstConstant, numConstants)))
+		return;
+
+	target->PSSetConstantBuffers1(startSlot, numBuffers, buffers, firstConstant, numConstants);
+	setConstantBuffers(PixelStage, startSlot, numBuffers, buffers, firstConstant, numConstants);
+}
+
+void DXStateFilterContext::GSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *buffers, const UINT *firstConstant, const UINT *numConstants) {
+
+	if (!issue(DXCommandType::GSSetConstantBuffers1, constantBuffersUnchanged(GeometryStage, startSlot, numBuffers, buffers, firstConstant, numConstants)))
+		return;
+
+	target->GSSetConstantBuffers1(startSlot, numBuffers, buffers, firstConstant, numConstants);
+	setConstantBuffers(GeometryStage, startSlot, numBuffers, buffers, firstConstant, numConstants);
+}
+
+void DXStateFilterContext::PSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *shaderResourceViews) {
+
+	bool unchanged = (startSlot + numViews <= D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT);
+
+	for (UINT i = 0; unchanged && i < numViews; ++i)
+		unchanged = shaderResourceKnown[startSlot + i] && shaderResources[startSlot + i] == shaderResourceViews[i];
+
+	if (!issue(DXCommandType::PSSetShaderResources, unchanged))
+		return;
+
+	target->PSSetShaderResources(startSlot, numViews, shaderResourceViews);
+
+	for (UINT i = 0; i < numViews && startSlot + i < D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT; ++i) {
+
+		shaderResources[startSlot + i] = shaderResourceViews[i];
+		shaderResourceKnown[startSlot + i] = true;
+	}
+}
+
+void DXStateFilterContext::PSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *_samplers) {
+
+	bool unchanged = (startSlot + numSamplers <= D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT);
+
+	for (UINT i = 0; unchanged && i < numSamplers; ++i)
+		unchanged = samplerKnown[startSlot + i] && samplers[startSlot + i] == _samplers[i];
+
+	if (!issue(DXCommandType::PSSetSamplers, unchanged))
+		return;
+
+	target->PSSetSamplers(startSlot, numSamplers, _samplers);
+
+	for (UINT i = 0; i < numSamplers && startSlot + i < D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT; ++i) {
+
+		samplers[startSlot + i] = _samplers[i];
+		samplerKnown[startSlot + i] = true;
+	}
+}
+
+
+// Input assembler stage
+
+void DXStateFilterContext::IASetInputLayout(ID3D11InputLayout *_inputLayout) {
+
+	if (!issue(DXCommandType::IASetInputLayout, inputLayoutKnown && inputLayout == _inputLayout))
+		return;
+
+	target->IASetInputLayout(_inputLayout);
+
+	inputLayout = _inputLayout;
+	inputLayoutKnown = true;
+}
+
+void DXStateFilterContext::IASetVertexBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *_vertexBuffers, const UINT *strides, const UINT *offsets) {
+
+	bool unchanged = (startSlot + numBuffers <= D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT);
+
+	for (UINT i = 0; unchanged && i < numBuffers; ++i) {
+
+		const VertexBufferBinding &binding = vertexBuffers[startSlot + i];
+
+		unchanged = vertexBufferKnown[startSlot + i] && binding.buffer == _vertexBuffers[i] && binding.stride == strides[i] && binding.offset == offsets[i];
+	}
+
+	if (!issue(DXCommandType::IASetVertexBuffers, unchanged))
+		return;
+
+	target->IASetVertexBuffers(startSlot, numBuffers, _vertexBuffers, strides, offsets);
+
+	for (UINT i = 0; i < numBuffers && startSlot + i < D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT; ++i) {
+
+		VertexBufferBinding &binding = vertexBuffers[startSlot + i];
+
+		binding.buffer = _vertexBuffers[i];
+		binding.stride = strides[i];
+		binding.offset = offsets[i];
+
+		vertexBufferKnown[startSlot + i] = true;
+	}
+}
+
+void DXStateFilterContext::IASetIndexBuffer(ID3D11Buffer *_indexBuffer, DXGI_FORMAT format, UINT offset) {
+
+	if (!issue(DXCommandType::IASetIndexBuffer, indexBufferKnown && indexBuffer == _indexBuffer && indexFormat == format && indexOffset == offset))
+		return;
+
+	target->IASetIndexBuffer(_indexBuffer, format, offset);
+
+	indexBuffer = _indexBuffer;
+	indexFormat = format;
+	indexOffset = offset;
+	indexBufferKnown = true;
+}
+
+void DXStateFilterContext::IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY _topology) {
+
+	if (!issue(DXCommandType::IASetPrimitiveTopology, topologyKnown && topology == _topology))
+		return;
+
+	target->IASetPrimitiveTopology(_topology);
+
+	topology = _topology;
+	topologyKnown = true;
+}
+
+
+// Resource access - never filtered
+
+void DXStateFilterContext::ClearRenderTargetView(ID3D11RenderTargetView *renderTargetView, const FLOAT colour[4]) {
+
+	issue(DXCommandType::ClearRenderTargetView, false);
+	target->ClearRenderTargetView(renderTargetView, colour);
+}
+
+void DXStateFilterContext::ClearDepthStencilView(ID3D11DepthStencilView *depthStencilView, UINT clearFlags, FLOAT depth, UINT8 stencil) {
+
+	issue(DXCommandType::ClearDepthStencilView, false);
+	target->ClearDepthStencilView(depthStencilView, clearFlags, depth, stencil);
+}
+
+// Mapping a constant buffer with DISCARD renames it, so bindings of the buffer are forgotten and the next bind by range always reaches the driver
+HRESULT DXStateFilterContext::Map(ID3D11Resource *resource, UINT subresource, D3D11_MAP mapType, UINT mapFlags, D3D11_MAPPED_SUBRESOURCE *mappedResource) {
+
+	issue(DXCommandType::Map, false);
+
+	if (mapType == D3D11_MAP_WRITE_DISCARD) {
+
+		for (int stage = 0; stage < NumShaderStages; ++stage) {
+
+			for (int i = 0; i < D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT; ++i) {
+
+				if (constantBuffers[stage][i].buffer == resource)
+					constantBufferKnown[stage][i] = false;
+			}
+		}
+	}
+
+	return target->Map(resource, subresource, mapType, mapFlags, mappedResource);
+}
+
+void DXStateFilterContext::Unmap(ID3D11Resource *resource, UINT subresource) {
+
+	issue(DXCommandType::Unmap, false);
+	target->Unmap(resource, subresource);
+}
+
+void DXStateFilterContext::CopyResource(ID3D11Resource *dstResource, ID3D11Resource *srcResource) {
+
+	issue(DXCommandType::CopyResource, false);
+	target->CopyResource(dstResource, srcResource);
+}
+
+
+// Queries
+
+void DXStateFilterContext::End(ID3D11Asynchronous *async) {
+
+	issue(DXCommandType::End, false);
+	target->End(async);
+}
+
+HRESULT DXStateFilterContext::GetData(ID3D11Asynchronous *async, void *data, UINT dataSize, UINT getDataFlags) {
+
+	issue(DXCommandType::GetData, false);
+	return target->GetData(async, data, dataSize, getDataFlags);
+}
+
+
+// Draw calls
+
+void DXStateFilterContext::Draw(UINT vertexCount, UINT startVertexLocation) {
+
+	issue(DXCommandType::Draw, false);
+	target->Draw(vertexCount, startVertexLocation);
+}
+
+void DXStateFilterContext::DrawIndexed(UINT indexCount, UINT startIndexLocation, INT baseVertexLocation) {
+
+	issue(DXCommandType::DrawIndexed, false);
+	target->DrawIndexed(indexCount, startIndexLocation, baseVertexLocation);
+}
+
+void DXStateFilterContext::DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation) {
+
+	issue(DXCommandType::DrawIndexedInstanced, false);
+	target->DrawIndexedInstanced(indexCountPerInstance, instanceCount, startIndexLocation, baseVertexLocation, startInstanceLocation);
+}
+
+
+// Command lists.  Both calls reset the context they are made on to the default state unless its state is restored, so the shadowed state is forgotten.
+
+HRESULT DXStateFilterContext::FinishCommandList(BOOL restoreDeferredContextState, DXCommandList **commandList) {
+
+	issue(DXCommandType::FinishCommandList, false);
+
+	HRESULT hr = target->FinishCommandList(restoreDeferredContextState, commandList);
+
+	if (!restoreDeferredContextState)
+		invalidate();
+
+	return hr;
+}
+
+void DXStateFilterContext::ExecuteCommandList(DXCommandList *commandList, BOOL restoreContextState) {
+
+	issue(DXCommandType::ExecuteCommandList, false);
+
+	target->ExecuteCommandList(commandList, restoreContextState);
+
+	if (!restoreContextState)
+		invalidate();
+}
+
+
+// Return the wrapped context's Direct3D context.  State set directly on it is not seen by the filter (see invalidate).
+ID3D11DeviceContext* DXStateFilterContext::getD3DContext() {
+
+	return target->getD3DContext();
+}
+
+
+//
+// Filter interface
+//
+
+// Forget all shadowed state so the next call of each type is forwarded
+void DXStateFilterContext::invalidate() {
+
+	rasterizerStateKnown = false;
+	viewportsKnown = false;
+	depthStencilStateKnown = false;
+	blendStateKnown = false;
+	vertexShaderKnown = false;
+	pixelShaderKnown = false;
+	geometryShaderKnown = false;
+	inputLayoutKnown = false;
+	indexBufferKnown = false;
+	topologyKnown = false;
+
+	ZeroMemory(constantBuffers, sizeof(constantBuffers));
+	ZeroMemory(constantBufferKnown, sizeof(constantBufferKnown));
+	ZeroMemory(shaderResourceKnown, sizeof(shaderResourceKnown));
+	ZeroMemory(samplerKnown, sizeof(samplerKnown));
+	ZeroMemory(vertexBufferKnown, sizeof(vertexBufferKnown));
+}
+
+// Mark the end of a frame (used to report per-frame averages)
+void DXStateFilterContext::endFrame() {
+
+	issue(DXCommandType::Present, false);
+	framesCounted++;
+}
+
+// Enable or disable filtering.  Disabling forwards every call but keeps counting so the filtered and unfiltered call counts of the same frame can be compared.
+void DXStateFilterContext::setFiltering(const bool enabled) {
+
+	filtering = enabled;
+
+	// Start from a clean slate so both modes are measured from the same state
+	invalidate();
+}
+
+bool DXStateFilterContext::getFiltering() const {
+
+	return filtering;
+}
+
+// Reset the issued / filtered counters and the frame count
+void DXStateFilterContext::resetCounters() {
+
+	for (size_t i = 0; i < (size_t)DXCommandType::Count; ++i) {
+
+		issuedCount[i] = 0;
+		filteredCount[i] = 0;
+	}
+
+	framesCounted = 0;
+}
+
+DXContext* DXStateFilterContext::getTarget() {
+
+	return target;
+}
+
+uint64_t DXStateFilterContext::getIssuedCount(const DXCommandType type) const {
+
+	return (type < DXCommandType::Count) ? issuedCount[(size_t)type] : 0;
+}
+
+uint64_t DXStateFilterContext::getFilteredCount(const DXCommandType type) const {
+
+	return (type < DXCommandType::Count) ? filteredCount[(size_t)type] : 0;
+}
+
+uint64_t DXStateFilterContext::getTotalIssuedCount() const {
+
+	uint64_t total = 0;
+
+	for (size_t i = 0; i < (size_t)DXCommandType::Count; ++i)
+		total += issuedCount[i];
+
+	return total;
+}
+
+uint64_t DXStateFilterContext::getTotalFilteredCount() const {
+
+	uint64_t total = 0;
+
+	for (size_t i = 0; i < (size_t)DXCommandType::Count; ++i)
+		total += filteredCount[i];
+
+	return total;
+}
+
+uint64_t DXStateFilterContext::getFramesCounted() const {
+
+	return framesCounted;
+}
+
+// Print the issued and filtered counts of each call type (totals and per-frame averages) to stdout
+void DXStateFilterContext::reportCallCounts() const {
+
+	double frames = (framesCounted > 0) ? (double)framesCounted : 1.0;
+
+	cout << "State filter calls over " << framesCounted << " frames (filtering " << ((filtering) ? "on" : "off") << ")" << endl;
+	cout << left << setw(26) << "call" << right << setw(14) << "issued" << setw(14) << "filtered" << setw(14) << "issued/frame" << setw(16) << "filtered/frame" << endl;
+
+	for (size_t i = 0; i < (size_t)DXCommandType::Count; ++i) {
+
+		if (issuedCount[i] == 0 && filteredCount[i] == 0)
+			continue;
+
+		cout << left << setw(26) << DXCommandName((DXCommandType)i) << right << setw(14) << issuedCount[i] << setw(14) << filteredCount[i];
+		cout << setw(14) << fixed << setprecision(1) << (double)issuedCount[i] / frames << setw(16) << (double)filteredCount[i] / frames << endl;
+	}
+
+	cout << left << setw(26) << "all calls" << right << setw(14) << getTotalIssuedCount() << setw(14) << getTotalFilteredCount();
+	cout << setw(14) << fixed << setprecision(1) << (double)getTotalIssuedCount() / frames << setw(16) << (double)getTotalFilteredCount() / frames << endl << endl;
+}
@@ -0,0 +1,182 @@
+//
+// DXStateFilterContext.h
+//
+
+// DXContext wrapper that shadows the pipeline state bound through it and drops state calls that would not change it (for example re-binding the shader, input layout or sampler that is already bound).  All other calls are forwarded unchanged to the wrapped context.  Issued and filtered calls are counted per call type so the driver overhead of a frame can be measured.
+//
+// Bound objects are compared by pointer and are not retained.  invalidate() must be called if the wrapped context's state is changed without going through the filter, or if a bound state object or view is released and may be recreated at the same address.
+
+#pragma once
+
+#include <DXContext.h>
+
+
+class DXStateFilterContext : public DXContext {
+
+	// Shader stages with tracked constant buffers
+	enum ShaderStage : int {
+
+		VertexStage = 0,
+		PixelStage,
+		GeometryStage,
+
+		NumShaderStages
+	};
+
+	struct ConstantBufferBinding {
+
+		ID3D11Buffer					*buffer;
+
+		// Bound range in 16-byte constants.  numConstants is 0 when the whole buffer is bound.
+		UINT							firstConstant;
+		UINT							numConstants;
+	};
+
+	struct VertexBufferBinding {
+
+		ID3D11Buffer					*buffer;
+		UINT							stride;
+		UINT							offset;
+	};
+
+	DXContext							*target = nullptr;
+
+	// When false every call is forwarded (but still counted) so filtered and unfiltered frames can be compared
+	bool								filtering = true;
+
+	uint64_t							issuedCount[(size_t)DXCommandType::Count];
+	uint64_t							filteredCount[(size_t)DXCommandType::Count];
+	uint64_t							framesCounted = 0;
+
+	// Shadowed state.  Each item is only compared against when its known flag is set - unknown state is always forwarded.
+	ID3D11RasterizerState				*rasterizerState = nullptr;
+	bool								rasterizerStateKnown = false;
+
+	D3D11_VIEWPORT						viewports[D3D11_VIEWPORT_AND_SCISSORRECT_OBJECT_COUNT_PER_PIPELINE];
+	UINT								numViewports = 0;
+	bool								viewportsKnown = false;
+
+	ID3D11DepthStencilState				*depthStencilState = nullptr;
+	UINT								stencilRef = 0;
+	bool								depthStencilStateKnown = false;
+
+	ID3D11BlendState					*blendState = nullptr;
+	FLOAT								blendFactor[4];
+	UINT								sampleMask = 0;
+	bool								blendStateKnown = false;
+
+	ID3D11VertexShader					*vertexShader = nullptr;
+	bool								vertexShaderKnown = false;
+	ID3D11PixelShader					*pixelShader = nullptr;
+	bool								pixelShaderKnown = false;
+	ID3D11GeometryShader				*geometryShader = nullptr;
+	bool								geometryShaderKnown = false;
+
+	ConstantBufferBinding				constantBuffers[NumShaderStages][D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+	bool								constantBufferKnown[NumShaderStages][D3D11_COMMONSHADER_CONSTANT_BUFFER_API_SLOT_COUNT];
+
+	ID3D11ShaderResourceView			*shaderResources[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
+	bool								shaderResourceKnown[D3D11_COMMONSHADER_INPUT_RESOURCE_SLOT_COUNT];
+
+	ID3D11SamplerState					*samplers[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+	bool								samplerKnown[D3D11_COMMONSHADER_SAMPLER_SLOT_COUNT];
+
+	ID3D11InputLayout					*inputLayout = nullptr;
+	bool								inputLayoutKnown = false;
+
+	VertexBufferBinding					vertexBuffers[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+	bool								vertexBufferKnown[D3D11_IA_VERTEX_INPUT_RESOURCE_SLOT_COUNT];
+
+	ID3D11Buffer						*indexBuffer = nullptr;
+	DXGI_FORMAT							indexFormat = DXGI_FORMAT_UNKNOWN;
+	UINT								indexOffset = 0;
+	bool								indexBufferKnown = false;
+
+	D3D11_PRIMITIVE_TOPOLOGY			topology = D3D11_PRIMITIVE_TOPOLOGY_UNDEFINED;
+	bool								topologyKnown = false;
+
+	// Count the call and return true if it should be forwarded.  unchanged is true if the call would not change the shadowed state.
+	bool issue(DXCommandType type, bool unchanged);
+
+	// Shared implementation of the {VS|PS|GS}SetConstantBuffers(1) calls.  Returns true if every slot in the range already holds the given binding.
+	bool constantBuffersUnchanged(ShaderStage stage, UINT startSlot, UINT numBuffers, ID3D11Buffer *const *buffers, const UINT *firstConstant, const UINT *numConstants);
+	void setConstantBuffers(ShaderStage stage, UINT startSlot, UINT numBuffers, ID3D11Buffer *const *buffers, const UINT *firstConstant, const UINT *numConstants);
+
+public:
+
+	// The filter retains the given context
+	DXStateFilterContext(DXContext *_target);
+	~DXStateFilterContext();
+
+	void RSSetState(ID3D11RasterizerState *rasterizerState);
+	void RSSetViewports(UINT numViewports, const D3D11_VIEWPORT *viewports);
+
+	void OMSetDepthStencilState(ID3D11DepthStencilState *depthStencilState, UINT stencilRef);
+	void OMSetBlendState(ID3D11BlendState *blendState, const FLOAT blendFactor[4], UINT sampleMask);
+	void OMSetRenderTargets(UINT numViews, ID3D11RenderTargetView *const *renderTargetViews, ID3D11DepthStencilView *depthStencilView);
+	void OMGetRenderTargets(UINT numViews, ID3D11RenderTargetView **renderTargetViews, ID3D11DepthStencilView **depthStencilView);
+
+	void VSSetShader(ID3D11VertexShader *vertexShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances);
+	void PSSetShader(ID3D11PixelShader *pixelShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances);
+	void GSSetShader(ID3D11GeometryShader *geometryShader, ID3D11ClassInstance *const *classInstances, UINT numClassInstances);
+	void VSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers);
+	void PSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers);
+	void GSSetConstantBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers);
+	void VSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants);
+	void PSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants);
+	void GSSetConstantBuffers1(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *constantBuffers, const UINT *firstConstant, const UINT *numConstants);
+	void PSSetShaderResources(UINT startSlot, UINT numViews, ID3D11ShaderResourceView *const *shaderResourceViews);
+	void PSSetSamplers(UINT startSlot, UINT numSamplers, ID3D11SamplerState *const *samplers);
+
+	void IASetInputLayout(ID3D11InputLayout *inputLayout);
+	void IASetVertexBuffers(UINT startSlot, UINT numBuffers, ID3D11Buffer *const *vertexBuffers, const UINT *strides, const UINT *offsets);
+	void IASetIndexBuffer(ID3D11Buffer *indexBuffer, DXGI_FORMAT format, UINT offset);
+	void IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY topology);
+
+	void ClearRenderTargetView(ID3D11RenderTargetView *renderTargetView, const FLOAT colour[4]);
+	void ClearDepthStencilView(ID3D11DepthStencilView *depthStencilView, UINT clearFlags, FLOAT depth, UINT8 stencil);
+	HRESULT Map(ID3D11Resource *resource, UINT subresource, D3D11_MAP mapType, UINT mapFlags, D3D11_MAPPED_SUBRESOURCE *mappedResource);
+	void Unmap(ID3D11Resource *resource, UINT subresource);
+	void CopyResource(ID3D11Resource *dstResource, ID3D11Resource *srcResource);
+	void End(ID3D11Asynchronous *async);
+	HRESULT GetData(ID3D11Asynchronous *async, void *data, UINT dataSize, UINT getDataFlags);
+
+	void Draw(UINT vertexCount, UINT startVertexLocation);
+	void DrawIndexed(UINT indexCount, UINT startIndexLocation, INT baseVertexLocation);
+	void DrawIndexedInstanced(UINT indexCountPerInstance, UINT instanceCount, UINT startIndexLocation, INT baseVertexLocation, UINT startInstanceLocation);
+
+	// Both calls reset the context they are made on to the default state unless its state is restored, so the shadowed state is forgotten
+	HRESULT FinishCommandList(BOOL restoreDeferredContextState, DXCommandList **commandList);
+	void ExecuteCommandList(DXCommandList *commandList, BOOL restoreContextState);
+
+	// Return the wrapped context's Direct3D context.  State set directly on it is not seen by the filter (see invalidate).
+	ID3D11DeviceContext* getD3DContext();
+
+
+	//
+	// Filter interface
+	//
+
+	// Forget all shadowed state so the next call of each type is forwarded
+	void invalidate();
+
+	// Mark the end of a frame (used to report per-frame averages)
+	void endFrame();
+
+	// Enable or disable filtering.  Disabling forwards every call but keeps counting so the filtered and unfiltered call counts of the same frame can be compared.
+	void setFiltering(const bool enabled);
+	bool getFiltering() const;
+
+	// Reset the issued / filtered counters and the frame count
+	void resetCounters();
+
+	DXContext* getTarget();
+	uint64_t getIssuedCount(const DXCommandType type) const;
+	uint64_t getFilteredCount(const DXCommandType type) const;
+	uint64_t getTotalIssuedCount() const;
+	uint64_t getTotalFilteredCount() const;
+	uint64_t getFramesCounted() const;
+
+	// Print the issued and filtered counts of each call type (totals and per-frame averages) to stdout
+	void reportCallCounts() const;
+};
@@ -5,6 +5,9 @@
 
 #include <stdafx.h>
 #include <DXSystem.h>
+#include <DXImmediateContext.h>
+#include <DXRecordingContext.h>
+#include <DXStateFilterContext.h>
 
 
 //
@@ -12,7 +15,9 @@
 //
 
 // Private constructor
-DXSystem::DXSystem(HWND hwnd) {
+DXSystem::DXSystem(HWND hwnd, DXBackendType _backend) {
+
+	backend = _backend;
 
 	HRESULT hr = setupDeviceIndependentResources();
 
@@ -31,7 +36,7 @@ DXSystem::DXSystem(HWND hwnd) {
 
 
 // DXSystem factory method
-DXSystem* DXSystem::CreateDirectXSystem(HWND hwnd) {
+DXSystem* DXSystem::CreateDirectXSystem(HWND hwnd, DXBackendType backend) {
 
 	static bool _systemCreated = false;
 
@@ -39,7 +44,7 @@ DXSystem* DXSystem::CreateDirectXSystem(HWND hwnd) {
 
 	if (!_systemCreated) {
 
-		if (dxSystem = new DXSystem(hwnd))
+		if (dxSystem = new DXSystem(hwnd, backend))
 			_systemCreated = true;
 	}
 
@@ -54,6 +59,12 @@ DXSystem::~DXSystem() {
 		renderTargetView->Release();
 	if (depthStencilView)
 		depthStencilView->Release();
+
+	if (stateFilter)
+		stateFilter->release();
+
+	if (renderContext)
+		renderContext->release();
 }
 
 
@@ -88,6 +99,32 @@ HRESULT DXSystem::setupDeviceDependentResources(HWND hwnd) {
 	LONG height = clientRect.bottom - clientRect.top;
 
 
+	if (backend == DXBackendType::HEADLESS) {
+
+		// The NULL driver supports resource and state object creation but never renders, so no adapter or swap chain is required
+		HRESULT hr = D3D11CreateDevice(
+			NULL,
+			D3D_DRIVER_TYPE_NULL,
+			NULL,
+			0, // Not SINGLETHREADED - the device is shared by worker threads recording on deferred contexts
+			NULL,
+			0,
+			D3D11_SDK_VERSION,
+			&device,
+			&supportedFeatureLevel,
+			&context);
+
+		if (SUCCEEDED(hr)) {
+
+			recordingContext = new DXRecordingContext();
+			renderContext = recordingContext;
+			stateFilter = new DXStateFilterContext(renderContext);
+		}
+
+		return hr;
+	}
+
+
 	// Get default adapter
 	HRESULT hr = dxgiFactory->EnumAdapters(0, &defaultAdapter);
 
@@ -109,8 +146,7 @@ HRESULT DXSystem::setupDeviceDependentResources(HWND hwnd) {
 			D3D_DRIVER_TYPE_UNKNOWN, // Specify TYPE_UNKNOWN since we're specifying our own adapter 'defaultAdapter'
 			NULL,
 			D3D11_CREATE_DEVICE_DEBUG |
-			D3D11_CREATE_DEVICE_SINGLETHREADED |
-			D3D11_CREATE_DEVICE_BGRA_SUPPORT, // Needed for D2D interop
+			D3D11_CREATE_DEVICE_BGRA_SUPPORT, // Needed for D2D interop.  Not SINGLETHREADED - the device is shared by worker threads recording on deferred contexts.
 			dxFeatureLevels,
 			2,
 			D3D11_SDK_VERSION,
@@ -197,7 +233,8 @@ HRESULT DXSystem::setupDeviceDependentResources(HWND hwnd) {
 		// MakeWindowAssociation for Alt+Enter full screen switching
 		dxgiFactory->MakeWindowAssociation(0, 0);
 
-
+		renderContext = new DXImmediateContext(context);
+		stateFilter = new DXStateFilterContext(renderContext);
 	}
 
 	return hr;
@@ -217,9 +254,29 @@ HRESULT DXSystem::setupWindowDependentResources(HWND hwnd) {
 	// Create Render Target View
 	// Get the back buffer texture from the swap chain and derive the associated Render Target View (RTV)
 	ID3D11Texture2D *backBuffer = nullptr;
+	HRESULT hr;
+
+	if (backend == DXBackendType::HEADLESS) {
 
+		// No swap chain exists so create an offscreen texture the size of the window client area to stand in for the back buffer
+		D3D11_TEXTURE2D_DESC		backBufferDesc;
 
-	HRESULT hr = swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&backBuffer));
+		ZeroMemory(&backBufferDesc, sizeof(D3D11_TEXTURE2D_DESC));
+
+		backBufferDesc.Width = width;
+		backBufferDesc.Height = height;
+		backBufferDesc.MipLevels = 1;
+		backBufferDesc.ArraySize = 1;
+		backBufferDesc.Format = DXGI_FORMAT_R8G8B8A8_UNORM;
+		backBufferDesc.SampleDesc.Count = 1;
+		backBufferDesc.SampleDesc.Quality = 0;
+		backBufferDesc.Usage = D3D11_USAGE_DEFAULT;
+		backBufferDesc.BindFlags = D3D11_BIND_RENDER_TARGET;
+
+		hr = device->CreateTexture2D(&backBufferDesc, 0, &backBuffer);
+	}
+	else
+		hr = swapChain->GetBuffer(0, __uuidof(ID3D11Texture2D), reinterpret_cast<void**>(&backBuffer));
 
 	if (SUCCEEDED(hr)) {
 		hr = device->CreateRenderTargetView(backBuffer, 0, &renderTargetView);
@@ -276,6 +333,9 @@ HRESULT DXSystem::resizeSwapChainBuffers(HWND hwnd) {
 	// Detach the Render Target and Depth Stencil Views
 	context->OMSetRenderTargets(0, nullptr, nullptr);
 
+	// State has been set on the Direct3D context directly so the filter's shadowed state can no longer be trusted
+	stateFilter->invalidate();
+
 	// Release references to the swap chain's buffers by releasing references held on buffer view interfaces. 
 
 	if (renderTargetView)
@@ -284,8 +344,8 @@ HRESULT DXSystem::resizeSwapChainBuffers(HWND hwnd) {
 		depthStencilView->Release();
 
 
-	// Resize swap chain buffers
-	HRESULT hr = swapChain->ResizeBuffers(0, 0, 0, DXGI_FORMAT_UNKNOWN, 0);
+	// Resize swap chain buffers (the HEADLESS backend simply recreates its offscreen buffers)
+	HRESULT hr = (backend == DXBackendType::HEADLESS) ? S_OK : swapChain->ResizeBuffers(0, 0, 0, DXGI_FORMAT_UNKNOWN, 0);
 
 	if (SUCCEEDED(hr)) {
 
@@ -302,6 +362,14 @@ HRESULT DXSystem::resizeSwapChainBuffers(HWND hwnd) {
 // Present back buffer to the screen
 HRESULT DXSystem::presentBackBuffer() {
 
+	stateFilter->endFrame();
+
+	if (backend == DXBackendType::HEADLESS) {
+
+		recordingContext->endFrame();
+		return S_OK;
+	}
+
 #ifdef __USE_DXGI_1_3__
 
 	return swapChain->Present1(0, 0, &dxgiPresentParams);
@@ -316,18 +384,82 @@ HRESULT DXSystem::presentBackBuffer() {
 
 
 
+// Create a deferred context for recording commands on a worker thread.  The context is returned behind its own state filter and its commands reach the immediate context through FinishCommandList / ExecuteCommandList.  The caller owns the returned context.
+DXStateFilterContext* DXSystem::createDeferredContext() {
+
+	DXContext *deferredContext = nullptr;
+
+	if (backend == DXBackendType::HEADLESS) {
+
+		deferredContext = new DXRecordingContext();
+	}
+	else {
+
+		ID3D11DeviceContext *d3dDeferredContext = nullptr;
+
+		if (FAILED(device->CreateDeferredContext(0, &d3dDeferredContext)))
+			throw exception("DXSystem: Cannot create deferred context");
+
+		deferredContext = new DXImmediateContext(d3dDeferredContext);
+		d3dDeferredContext->Release();
+	}
+
+	DXStateFilterContext *filter = new DXStateFilterContext(deferredContext);
+
+	deferredContext->release();
+
+	return filter;
+}
+
+
+// Return true if constant buffers can be bound by range (VSSetConstantBuffers1 etc.) and mapped with D3D11_MAP_WRITE_NO_OVERWRITE.  Always true for the HEADLESS backend.
+bool DXSystem::supportsConstantBufferOffsetting() {
+
+	if (backend == DXBackendType::HEADLESS)
+		return true;
+
+	D3D11_FEATURE_DATA_D3D11_OPTIONS options;
+	ZeroMemory(&options, sizeof(D3D11_FEATURE_DATA_D3D11_OPTIONS));
+
+	if (FAILED(device->CheckFeatureSupport(D3D11_FEATURE_D3D11_OPTIONS, &options, sizeof(D3D11_FEATURE_DATA_D3D11_OPTIONS))))
+		return false;
+
+	return options.ConstantBufferOffsetting && options.MapNoOverwriteOnDynamicConstantBuffer;
+}
+
+
 // Accessor methods
 
+DXBackendType DXSystem::getBackend() {
+
+	return backend;
+}
+
 ID3D11Device* DXSystem::getDevice() {
 
 	return device;
 }
 
-ID3D11DeviceContext* DXSystem::getDeviceContext() {
+DXContext* DXSystem::getDeviceContext() {
+
+	return stateFilter;
+}
+
+ID3D11DeviceContext* DXSystem::getD3DDeviceContext() {
 
 	return context;
 }
 
+DXRecordingContext* DXSystem::getRecordingContext() {
+
+	return recordingContext;
+}
+
+DXStateFilterContext* DXSystem::getStateFilterContext() {
+
+	return stateFilter;
+}
+
 ID3D11RenderTargetView* DXSystem::getBackBufferRTV() {
 
 	return renderTargetView;
@@ -9,14 +9,25 @@
 
 #include <d3d11_2.h>
 #include <windows.h>
+#include <cstdint>
 #include <GUObject.h>
 
+class DXContext;
+class DXRecordingContext;
+class DXStateFilterContext;
+
 
 
 // Note: By default we use DXGI 1.3.  Comment out this line to use DXGI 1.1 on Windows 7
 // #define __USE_DXGI_1_3__			1
 
 
+// Rendering backends supported by DXSystem.  D3D11 renders to the window swap chain on the default adapter.  HEADLESS creates a NULL (non-rendering) Direct3D device so resources can still be created, but all pipeline, Map / Unmap and draw calls are captured by a DXRecordingContext and nothing is presented.
+//
+// HEADLESS removes the GPU from the frame loop, not Windows - Scene, Model, Effect and Texture create their resources through ID3D11Device so the Direct3D 11 runtime (for the NULL driver) and a window (hidden, giving the back buffer size) are still required.  It measures the CPU cost and API call counts of a frame on a Windows machine without a usable GPU (a build server or virtual machine) and does not build or run on other platforms.
+enum class DXBackendType : uint8_t { D3D11 = 0, HEADLESS };
+
+
 class DXSystem : public GUObject {
 
 #ifdef __USE_DXGI_1_3__
@@ -38,6 +49,15 @@ class DXSystem : public GUObject {
 	ID3D11Device							*device = nullptr;
 	ID3D11DeviceContext						*context = nullptr;
 	D3D_FEATURE_LEVEL						supportedFeatureLevel;
+
+	DXBackendType							backend = DXBackendType::D3D11;
+
+	// Rendering context used by the application - wraps context (D3D11) or records calls (HEADLESS)
+	DXContext								*renderContext = nullptr;
+	DXRecordingContext						*recordingContext = nullptr;
+
+	// Redundant state filter in front of renderContext - returned by getDeviceContext()
+	DXStateFilterContext					*stateFilter = nullptr;
 	
 	ID3D11RenderTargetView *renderTargetView = nullptr;
 	ID3D11DepthStencilView		*depthStencilView = nullptr;
@@ -49,7 +69,7 @@ class DXSystem : public GUObject {
 	//
 
 	// Private constructor
-	DXSystem(HWND hwnd);
+	DXSystem(HWND hwnd, DXBackendType _backend);
 
 
 public:
@@ -58,8 +78,8 @@ public:
 	// Public interface
 	//
 
-	// DXSystem factory method
-	static DXSystem* CreateDirectXSystem(HWND hwnd);
+	// DXSystem factory method.  The backend determines whether calls made through getDeviceContext() reach Direct3D or are recorded.
+	static DXSystem* CreateDirectXSystem(HWND hwnd, DXBackendType backend = DXBackendType::D3D11);
 
 	// Destructor
 	~DXSystem();
@@ -84,9 +104,27 @@ public:
 	HRESULT presentBackBuffer();
 
 
+	// Create a deferred context for recording commands on a worker thread.  The context is returned behind its own state filter and its commands reach the immediate context through FinishCommandList / ExecuteCommandList.  The caller owns the returned context.
+	DXStateFilterContext* createDeferredContext();
+
+
+	// Return true if constant buffers can be bound by range (VSSetConstantBuffers1 etc.) and mapped with D3D11_MAP_WRITE_NO_OVERWRITE.  Always true for the HEADLESS backend.
+	bool supportsConstantBufferOffsetting();
+
+
 	// Accessor methods
+	DXBackendType getBackend();
 	ID3D11Device* getDevice();
-	ID3D11DeviceContext* getDeviceContext();
+	DXContext* getDeviceContext();
+
+	// Return the Direct3D immediate context (the NULL device context for the HEADLESS backend).  Only needed for load-time operations that bypass DXContext such as staging readbacks.
+	ID3D11DeviceContext* getD3DDeviceContext();
+
+	// Return the recording context for the HEADLESS backend, nullptr otherwise
+	DXRecordingContext* getRecordingContext();
+
+	// Return the redundant state filter all calls made through getDeviceContext() pass through
+	DXStateFilterContext* getStateFilterContext();
 	ID3D11RenderTargetView* getBackBufferRTV();
 	ID3D11DepthStencilView* getDepthStencil();
 	ID3D11Texture2D* getDepthStencilBuffer();
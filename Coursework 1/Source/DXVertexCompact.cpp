@@ -0,0 +1,89 @@
+
+//
+// DXVertexCompact.cpp
+//
+
+#include <stdafx.h>
+#include <DXVertexCompact.h>
+
+using namespace std;
+using namespace DirectX;
+using namespace DirectX::PackedVector;
+
+
+// Vertex input descriptor based on DXVertexCompact
+static const D3D11_INPUT_ELEMENT_DESC compactVertexDesc[] = {
+
+		{ "POSITION", 0, DXGI_FORMAT_R32G32B32_FLOAT, 0, 0, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "NORMAL", 0, DXGI_FORMAT_R10G10B10A2_UNORM, 0, 12, D3D11_INPUT_PER_VERTEX_DATA, 0 },
+		{ "TEXCOORD", 0, DXGI_FORMAT_R16G16_FLOAT, 0, 16, D3D11_INPUT_PER_VERTEX_DATA, 0 }
+};
+
+
+// Pack the position, normal and texture coordinates of vertex (the material colours are dropped)
+DXVertexCompact DXVertexCompact::pack(const DXVertexExt &vertex) {
+
+	DXVertexCompact packed;
+
+	// Normals are renormalised and mapped from [-1, 1] to the [0, 1] range of the UNORM components
+	XMVECTOR normal = XMVector3Normalize(XMLoadFloat3(&vertex.normal));
+
+	packed.pos = vertex.pos;
+	XMStoreUDecN4(&packed.normal, XMVectorMultiplyAdd(normal, XMVectorReplicate(0.5f), XMVectorReplicate(0.5f)));
+	XMStoreHalf2(&packed.texCoord, XMLoadFloat2(&vertex.texCoord));
+
+	return packed;
+}
+
+// Pack count vertices into packed (resized to count)
+void DXVertexCompact::packVertices(const DXVertexExt *vertices, const uint32_t count, vector<DXVertexCompact> *packed) {
+
+	packed->resize(count);
+
+	for (uint32_t i = 0; i < count; ++i)
+		(*packed)[i] = pack(vertices[i]);
+}
+
+// Return the vertex unpacked with the given material colours
+DXVertexExt DXVertexCompact::unpack(const XMCOLOR matDiffuse, const XMCOLOR matSpecular) const {
+
+	DXVertexExt vertex;
+
+	vertex.pos = pos;
+	XMStoreFloat3(&vertex.normal, XMVector3Normalize(XMVectorMultiplyAdd(XMLoadUDecN4(&normal), XMVectorReplicate(2.0f), XMVectorReplicate(-1.0f))));
+	XMStoreFloat2(&vertex.texCoord, XMLoadHalf2(&texCoord));
+	vertex.matDiffuse = matDiffuse;
+	vertex.matSpecular = matSpecular;
+
+	return vertex;
+}
+
+// Return the narrowest index format holding every index - if it is DXGI_FORMAT_R16_UINT the indices are copied to indices16 (resized to count), otherwise indices16 is cleared and the indices are used as they are
+DXGI_FORMAT DXVertexCompact::packIndices(const uint32_t *indices, const uint32_t count, vector<uint16_t> *indices16) {
+
+	indices16->clear();
+
+	for (uint32_t i = 0; i < count; ++i)
+		if (indices[i] > 0xFFFF)
+			return DXGI_FORMAT_R32_UINT;
+
+	indices16->resize(count);
+
+	for (uint32_t i = 0; i < count; ++i)
+		(*indices16)[i] = (uint16_t)indices[i];
+
+	return DXGI_FORMAT_R16_UINT;
+}
+
+// Return the size in bytes of an index of the given format
+UINT DXVertexCompact::indexStride(const DXGI_FORMAT format) {
+
+	return (format == DXGI_FORMAT_R16_UINT) ? sizeof(uint16_t) : sizeof(uint32_t);
+}
+
+
+// Create an input layout object mapping the vertex structure to the vertex shader input defined in the shader bytecode *shaderBlob
+HRESULT DXVertexCompact::createInputLayout(ID3D11Device *device, char *shaderByteCode, uint32_t shaderSizeBytes, ID3D11InputLayout **layout) {
+
+	return device->CreateInputLayout(compactVertexDesc, ARRAYSIZE(compactVertexDesc), shaderByteCode, shaderSizeBytes, layout);
+}
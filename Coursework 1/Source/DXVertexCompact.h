@@ -0,0 +1,41 @@
+
+//
+// DXVertexCompact.h
+//
+
+// Compact vertex structure used for the vertex buffers of Model, StaticBatch, Box and Grid meshes (20 bytes against the 40 of DXVertexExt).  The normal is packed as 10:10:10:2 UNORM (xyz = normal * 0.5 + 0.5) and the texture coordinates as half floats.  The material colours are not stored per vertex - the vertex shaders read them from the per-object constants (see CBufferPerObject).  DXVertexExt remains the CPU side format the meshes are built and kept in.
+
+#pragma once
+
+#include <d3d11_2.h>
+#include <DirectXMath.h>
+#include <DirectXPackedVector.h>
+#include <DXVertexExt.h>
+#include <cstdint>
+#include <vector>
+
+
+struct DXVertexCompact {
+
+	DirectX::XMFLOAT3					pos;
+	DirectX::PackedVector::XMUDECN4		normal;
+	DirectX::PackedVector::XMHALF2		texCoord;
+
+	// Pack the position, normal and texture coordinates of vertex (the material colours are dropped)
+	static DXVertexCompact pack(const DXVertexExt &vertex);
+
+	// Pack count vertices into packed (resized to count)
+	static void packVertices(const DXVertexExt *vertices, const uint32_t count, std::vector<DXVertexCompact> *packed);
+
+	// Return the vertex unpacked with the given material colours
+	DXVertexExt unpack(const DirectX::PackedVector::XMCOLOR matDiffuse, const DirectX::PackedVector::XMCOLOR matSpecular) const;
+
+	// Return the narrowest index format holding every index - if it is DXGI_FORMAT_R16_UINT the indices are copied to indices16 (resized to count), otherwise indices16 is cleared and the indices are used as they are
+	static DXGI_FORMAT packIndices(const uint32_t *indices, const uint32_t count, std::vector<uint16_t> *indices16);
+
+	// Return the size in bytes of an index of the given format
+	static UINT indexStride(const DXGI_FORMAT format);
+
+	// Create an input layout object mapping the vertex structure to the vertex shader input defined in the shader bytecode *shaderBlob
+	static HRESULT createInputLayout(ID3D11Device *device, char *shaderBytecode, uint32_t shaderSizeBytes, ID3D11InputLayout **layout);
+};
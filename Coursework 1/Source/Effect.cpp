@@ -6,7 +6,7 @@
 
 using namespace std;
 
-void Effect::bindPipeline(ID3D11DeviceContext *context){
+void Effect::bindPipeline(DXContext *context){
 	context->RSSetState(RasterizerState);
 	// Apply dsState
 	context->OMSetDepthStencilState(DepthStencilState, 0);
@@ -16,6 +16,20 @@ void Effect::bindPipeline(ID3D11DeviceContext *context){
 	context->GSSetShader(GeometryShader, 0, 0);
 }
 
+// Return true if the effect's blend state combines the output with the render target (any blend other than ONE / ZERO), so objects drawn with it must be sorted back-to-front
+bool Effect::isBlended() {
+
+	if (!BlendState)
+		return false;
+
+	D3D11_BLEND_DESC blendDesc;
+	BlendState->GetDesc(&blendDesc);
+
+	const D3D11_RENDER_TARGET_BLEND_DESC &rtBlend = blendDesc.RenderTarget[0];
+
+	return rtBlend.BlendEnable && !(rtBlend.SrcBlend == D3D11_BLEND_ONE && rtBlend.DestBlend == D3D11_BLEND_ZERO);
+}
+
 void Effect::initDefaultStates(ID3D11Device *device ){
 	
 	D3D11_RASTERIZER_DESC			RSdesc;
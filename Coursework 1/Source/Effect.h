@@ -1,4 +1,7 @@
 #pragma once
+
+class DXContext;
+
 class Effect
 {
 	ID3D11RasterizerState					*RasterizerState = nullptr;
@@ -37,7 +40,8 @@ public:
 	void setDepthStencilState(ID3D11DepthStencilState	*_DepthStencilState){ DepthStencilState = _DepthStencilState; };
 	void setBlendState(ID3D11BlendState	*_BlendState){ BlendState = _BlendState; };
 	void initDefaultStates(ID3D11Device *device);
-	void bindPipeline(ID3D11DeviceContext *context);
+	void bindPipeline(DXContext *context);
+	bool isBlended();
 
 	uint32_t Effect::CreateVertexShader(ID3D11Device *device, const char *filename, char **VSBytecode, ID3D11VertexShader **vertexShader);
 	HRESULT Effect::CreatePixelShader(ID3D11Device *device, const char *filename, char **PSBytecode, ID3D11PixelShader **pixelShader);
@@ -0,0 +1,125 @@
+
+//
+// FixedTimestep.cpp
+//
+
+#include <stdafx.h>
+#include <FixedTimestep.h>
+#include <cmath>
+
+using namespace std;
+
+
+FixedTimestep::FixedTimestep(const double stepsPerSecond, const int maxSteps) {
+
+	setStepRate(stepsPerSecond);
+	setMaxStepsPerFrame(maxSteps);
+}
+
+
+// Set the number of simulation steps per second.  Accumulated time is kept so the rate can be changed while running.
+void FixedTimestep::setStepRate(const double stepsPerSecond) {
+
+	if (stepsPerSecond <= 0.0)
+		throw exception("FixedTimestep: Step rate must be positive");
+
+	stepLength = 1.0 / stepsPerSecond;
+}
+
+void FixedTimestep::setMaxStepsPerFrame(const int maxSteps) {
+
+	maxStepsPerFrame = max(maxSteps, 1);
+}
+
+// Restart the simulation at the given time, discarding accumulated time
+void FixedTimestep::reset(const gu_seconds time) {
+
+	accumulator = 0.0;
+	simulationTime = time;
+	startTime = time;
+	stepsPending = 0;
+	stepCount = 0;
+	timeDropped = 0.0;
+}
+
+// Add the time elapsed since the last frame.  Follow with step() until it returns false.
+void FixedTimestep::advance(const gu_seconds elapsed) {
+
+	accumulator += max(elapsed, 0.0);
+
+	// Compare against a slightly shortened step so accumulated rounding error does not delay a step by a whole frame
+	const gu_seconds stepThreshold = stepLength * (1.0 - 1e-9);
+
+	// Whole steps in the accumulator - counted directly so a long stall costs no more than a short frame (and kept as a double so it cannot overflow before the limit is applied)
+	gu_seconds steps = (accumulator >= stepThreshold) ? floor((accumulator - stepThreshold) / stepLength) + 1.0 : 0.0;
+
+	if (steps > maxStepsPerFrame) {
+
+		gu_seconds dropped = (steps - maxStepsPerFrame) * stepLength;
+
+		accumulator -= dropped;
+		timeDropped += dropped;
+		steps = maxStepsPerFrame;
+	}
+
+	stepsPending = (int)steps;
+}
+
+// Consume one step of accumulated time.  Returns false when no whole step remains for this frame, otherwise advances getSimulationTime() by one step and returns true.
+bool FixedTimestep::step() {
+
+	if (stepsPending == 0)
+		return false;
+
+	stepsPending--;
+	accumulator = max(accumulator - stepLength, 0.0);
+
+	stepCount++;
+	simulationTime += stepLength;
+
+	return true;
+}
+
+
+// Query methods
+
+double FixedTimestep::getStepRate() const {
+
+	return 1.0 / stepLength;
+}
+
+gu_seconds FixedTimestep::getStepLength() const {
+
+	return stepLength;
+}
+
+int FixedTimestep::getMaxStepsPerFrame() const {
+
+	return maxStepsPerFrame;
+}
+
+gu_seconds FixedTimestep::getSimulationTime() const {
+
+	return simulationTime;
+}
+
+float FixedTimestep::getInterpolationFactor() const {
+
+	return (float)min(accumulator / stepLength, 1.0);
+}
+
+gu_seconds FixedTimestep::getRenderTime() const {
+
+	// Before the first step there is no previous state to interpolate from
+	return max(simulationTime - stepLength + min(accumulator, stepLength), startTime);
+}
+
+uint64_t FixedTimestep::getStepCount() const {
+
+	return stepCount;
+}
+
+gu_seconds FixedTimestep::getTimeDropped() const {
+
+	return timeDropped;
+}
@@ -0,0 +1,70 @@
+
+//
+// FixedTimestep.h
+//
+
+// Model a fixed-step simulation clock.  Elapsed (variable) frame time is accumulated and consumed in steps of a fixed length so the simulation advances identically whatever the frame rate.  The time left over after the last whole step gives the interpolation factor between the previous and current simulation states for rendering.
+//
+// The class does not read the system clock - elapsed time is passed to advance() - so it can be driven from CGDClock or from a virtual clock (for example a fixed sequence of frame times in a test).
+
+#pragma once
+
+#include <GUObject.h>
+#include <CGDClock.h>
+
+
+class FixedTimestep : public GUObject {
+
+	gu_seconds				stepLength;
+
+	// Upper bound on the steps run for a single advance().  Time beyond this is dropped so a long frame (or a breakpoint) does not cause a spiral of ever longer catch-up frames.
+	int						maxStepsPerFrame;
+
+	// Time accumulated but not yet consumed by a step
+	gu_seconds				accumulator = 0.0;
+
+	// Simulation time after the latest step and at the last reset()
+	gu_seconds				simulationTime = 0.0;
+	gu_seconds				startTime = 0.0;
+
+	// Steps remaining to be run for the current advance()
+	int						stepsPending = 0;
+
+	uint64_t				stepCount = 0;
+	gu_seconds				timeDropped = 0.0;
+
+public:
+
+	FixedTimestep(const double stepsPerSecond = 60.0, const int maxSteps = 8);
+
+	// Set the number of simulation steps per second.  Accumulated time is kept so the rate can be changed while running.
+	void setStepRate(const double stepsPerSecond);
+	void setMaxStepsPerFrame(const int maxSteps);
+
+	// Restart the simulation at the given time, discarding accumulated time
+	void reset(const gu_seconds time = 0.0);
+
+	// Add the time elapsed since the last frame.  Follow with step() until it returns false.
+	void advance(const gu_seconds elapsed);
+
+	// Consume one step of accumulated time.  Returns false when no whole step remains for this frame, otherwise advances getSimulationTime() by one step and returns true.
+	bool step();
+
+	// Query methods
+	double getStepRate() const;
+	gu_seconds getStepLength() const;
+	int getMaxStepsPerFrame() const;
+
+	// Time of the latest simulated state
+	gu_seconds getSimulationTime() const;
+
+	// Fraction [0, 1) of a step between the previous and latest simulated states at which the frame should be rendered
+	float getInterpolationFactor() const;
+
+	// Time the frame is rendered at - between the previous and latest simulated states
+	gu_seconds getRenderTime() const;
+
+	// Total steps run and total time dropped by the maxStepsPerFrame limit since the last reset()
+	uint64_t getStepCount() const;
+	gu_seconds getTimeDropped() const;
+};
@@ -0,0 +1,246 @@
+
+//
+// FrustumCuller.cpp
+//
+
+#include <stdafx.h>
+#include <FrustumCuller.h>
+
+using namespace std;
+using namespace DirectX;
+
+
+FrustumCuller::FrustumCuller() {
+
+	ZeroMemory(views, sizeof(views));
+	ZeroMemory(visibleCount, sizeof(visibleCount));
+}
+
+
+// Set the view-projection matrix and eye position of a view.  viewportHeight is the height of the view's viewport in pixels and is only used for contribution culling.
+void FrustumCuller::setView(const int view, FXMMATRIX viewProj, FXMVECTOR eyePos, const float viewportHeight) {
+
+	if (view < 0 || view >= MaxViews)
+		throw exception("FrustumCuller: View index out of range");
+
+	View &v = views[view];
+
+	// Planes are combinations of the columns of the view-projection matrix (Direct3D clip space, 0 <= z <= w)
+	XMMATRIX columns = XMMatrixTranspose(viewProj);
+
+	XMVECTOR planes[6] = {
+
+		columns.r[3] + columns.r[0],	// left
+		columns.r[3] - columns.r[0],	// right
+		columns.r[3] + columns.r[1],	// bottom
+		columns.r[3] - columns.r[1],	// top
+		columns.r[2],					// near
+		columns.r[3] - columns.r[2]		// far
+	};
+
+	for (int i = 0; i < 6; ++i)
+		XMStoreFloat4(&v.planes[i], XMPlaneNormalize(planes[i]));
+
+	XMStoreFloat3(&v.eyePos, eyePos);
+
+	// The y scale of the projection is the length of the second column's xyz (the view matrix is a rigid transform)
+	v.pixelScale = 0.5f * viewportHeight * XMVectorGetX(XMVector3Length(columns.r[1]));
+	v.enabled = true;
+}
+
+void FrustumCuller::disableView(const int view) {
+
+	if (view >= 0 && view < MaxViews)
+		views[view].enabled = false;
+}
+
+
+// Set the minimum projected diameter in pixels of spheres visible in the given view.  0 disables contribution culling for the view.
+void FrustumCuller::setContributionThreshold(const int view, const float pixels) {
+
+	if (view < 0 || view >= MaxViews)
+		throw exception("FrustumCuller: View index out of range");
+
+	views[view].contributionThreshold = max(pixels, 0.0f);
+}
+
+float FrustumCuller::getContributionThreshold(const int view) const {
+
+	return (view >= 0 && view < MaxViews) ? views[view].contributionThreshold : 0.0f;
+}
+
+
+// Remove all spheres
+void FrustumCuller::clear() {
+
+	centreX.clear();
+	centreY.clear();
+	centreZ.clear();
+	radius.clear();
+	unbounded.clear();
+	masks.clear();
+
+	sphereCount = 0;
+}
+
+// Add a world space bounding sphere and return its index
+uint32_t FrustumCuller::addSphere(const XMFLOAT3 &centre, const float r) {
+
+	uint32_t index = sphereCount++;
+
+	// cull() leaves the arrays padded to a multiple of four, so a sphere added after it overwrites the padding rather than following it
+	if (centreX.size() < sphereCount) {
+
+		centreX.resize(sphereCount);
+		centreY.resize(sphereCount);
+		centreZ.resize(sphereCount);
+		radius.resize(sphereCount);
+	}
+
+	if (unbounded.size() < sphereCount)
+		unbounded.resize(sphereCount);
+
+	centreX[index] = centre.x;
+	centreY[index] = centre.y;
+	centreZ[index] = centre.z;
+	radius[index] = r;
+	unbounded[index] = false;
+
+	return index;
+}
+
+// Add an object with no bounds.  It is reported visible in every enabled view.
+uint32_t FrustumCuller::addUnbounded() {
+
+	uint32_t index = addSphere(XMFLOAT3(0.0f, 0.0f, 0.0f), 0.0f);
+
+	unbounded[index] = true;
+
+	return index;
+}
+
+
+// Test every sphere against every enabled view.  Views that are not enabled have their bit clear in every mask.
+void FrustumCuller::cull() {
+
+	// Pad the arrays to a multiple of four so every block loads four spheres.  Padding spheres are discarded.
+	uint32_t paddedCount = (sphereCount + 3) & ~3;
+
+	centreX.resize(paddedCount, 0.0f);
+	centreY.resize(paddedCount, 0.0f);
+	centreZ.resize(paddedCount, 0.0f);
+	radius.resize(paddedCount, 0.0f);
+	masks.resize(paddedCount);
+
+	ZeroMemory(visibleCount, sizeof(visibleCount));
+
+	for (uint32_t i = 0; i < paddedCount; i += 4) {
+
+		XMVECTOR x = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&centreX[i]));
+		XMVECTOR y = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&centreY[i]));
+		XMVECTOR z = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&centreZ[i]));
+		XMVECTOR r = XMLoadFloat4(reinterpret_cast<const XMFLOAT4*>(&radius[i]));
+		XMVECTOR negR = XMVectorNegate(r);
+
+		XMVECTOR blockMask = XMVectorZero();
+
+		for (int v = 0; v < MaxViews; ++v) {
+
+			const View &view = views[v];
+
+			if (!view.enabled)
+				continue;
+
+			XMVECTOR visible = XMVectorTrueInt();
+
+			for (int p = 0; p < 6; ++p) {
+
+				XMVECTOR plane = XMLoadFloat4(&view.planes[p]);
+
+				// Signed distance of each centre from the plane
+				XMVECTOR d = XMVectorMultiplyAdd(x, XMVectorSplatX(plane), XMVectorMultiplyAdd(y, XMVectorSplatY(plane), XMVectorMultiplyAdd(z, XMVectorSplatZ(plane), XMVectorSplatW(plane))));
+
+				visible = XMVectorAndInt(visible, XMVectorGreaterOrEqual(d, negR));
+			}
+
+			if (view.contributionThreshold > 0.0f) {
+
+				// Projected diameter 2 * r * pixelScale / distance >= threshold, compared squared to avoid the square root.  Spheres containing the eye always pass.
+				XMVECTOR dx = x - XMVectorReplicate(view.eyePos.x);
+				XMVECTOR dy = y - XMVectorReplicate(view.eyePos.y);
+				XMVECTOR dz = z - XMVectorReplicate(view.eyePos.z);
+				XMVECTOR distanceSq = XMVectorMultiplyAdd(dx, dx, XMVectorMultiplyAdd(dy, dy, dz * dz));
+
+				XMVECTOR projected = r * XMVectorReplicate(2.0f * view.pixelScale);
+				XMVECTOR threshold = XMVectorReplicate(view.contributionThreshold);
+
+				visible = XMVectorAndInt(visible, XMVectorGreaterOrEqual(projected * projected, threshold * threshold * distanceSq));
+			}
+
+			blockMask = XMVectorOrInt(blockMask, XMVectorAndInt(visible, XMVectorReplicateInt(1 << v)));
+		}
+
+		XMUINT4 laneMasks;
+
+		XMStoreUInt4(&laneMasks, blockMask);
+
+		masks[i] = (uint8_t)laneMasks.x;
+		masks[i + 1] = (uint8_t)laneMasks.y;
+		masks[i + 2] = (uint8_t)laneMasks.z;
+		masks[i + 3] = (uint8_t)laneMasks.w;
+	}
+
+	uint8_t enabledMask = 0;
+
+	for (int v = 0; v < MaxViews; ++v) {
+
+		if (views[v].enabled)
+			enabledMask |= (uint8_t)(1 << v);
+	}
+
+	for (uint32_t i = 0; i < sphereCount; ++i) {
+
+		if (unbounded[i])
+			masks[i] = enabledMask;
+
+		for (int v = 0; v < MaxViews; ++v)
+			visibleCount[v] += (masks[i] >> v) & 1;
+	}
+}
+
+
+// Accessor methods
+
+uint8_t FrustumCuller::getMask(const uint32_t index) const {
+
+	return (index < sphereCount) ? masks[index] : 0;
+}
+
+// Replace the view mask of the given sphere - used by later culling stages (for example occlusion culling) to clear view bits
+void FrustumCuller::setMask(const uint32_t index, const uint8_t mask) {
+
+	if (index < sphereCount)
+		masks[index] = mask;
+}
+
+// Return the given sphere.  Returns false for objects added with addUnbounded.
+bool FrustumCuller::getSphere(const uint32_t index, XMFLOAT3 *centre, float *r) const {
+
+	if (index >= sphereCount || unbounded[index])
+		return false;
+
+	*centre = XMFLOAT3(centreX[index], centreY[index], centreZ[index]);
+	*r = radius[index];
+
+	return true;
+}
+
+uint32_t FrustumCuller::getSphereCount() const {
+
+	return sphereCount;
+}
+
+uint32_t FrustumCuller::getVisibleCount(const int view) const {
+
+	return (view >= 0 && view < MaxViews) ? visibleCount[view] : 0;
+}
@@ -0,0 +1,93 @@
+//
+// FrustumCuller.h
+//
+
+// Cull bounding spheres against up to MaxViews view frusta at once.  Spheres are stored as structure-of-arrays and tested four at a time against every plane of every view with DirectXMath vector operations, producing a bit mask of the views each sphere is visible in (bit v set if visible in view v).
+//
+// Each view can also reject spheres whose projected diameter is below a threshold in pixels (contribution culling) - useful for small, low resolution views such as the faces of a dynamic cube map where distant small objects cover a pixel or less.
+
+#pragma once
+
+#include <GUObject.h>
+#include <DirectXMath.h>
+#include <vector>
+
+
+class FrustumCuller : public GUObject {
+
+public:
+
+	static const int		MaxViews = 8;
+
+private:
+
+	struct View {
+
+		// World space planes (xyz = inward normal, w = distance).  A point p is inside when dot(p, n) + w >= 0.
+		DirectX::XMFLOAT4	planes[6];
+
+		DirectX::XMFLOAT3	eyePos;
+
+		// Projected size in pixels of a unit length at unit distance (half the viewport height times the projection y scale)
+		float				pixelScale;
+
+		// Minimum projected diameter in pixels of a visible sphere.  0 disables contribution culling.
+		float				contributionThreshold;
+
+		bool				enabled;
+	};
+
+	View					views[MaxViews];
+
+	// Sphere centres and radii (structure-of-arrays, padded to a multiple of four)
+	std::vector<float>		centreX;
+	std::vector<float>		centreY;
+	std::vector<float>		centreZ;
+	std::vector<float>		radius;
+
+	// Spheres added with addUnbounded are visible in every enabled view
+	std::vector<bool>		unbounded;
+
+	std::vector<uint8_t>	masks;
+
+	uint32_t				sphereCount = 0;
+	uint32_t				visibleCount[MaxViews];
+
+public:
+
+	FrustumCuller();
+
+	// Set the view-projection matrix and eye position of a view.  viewportHeight is the height of the view's viewport in pixels and is only used for contribution culling.
+	void setView(const int view, DirectX::FXMMATRIX viewProj, DirectX::FXMVECTOR eyePos, const float viewportHeight);
+	void disableView(const int view);
+
+	// Set the minimum projected diameter in pixels of spheres visible in the given view.  0 disables contribution culling for the view.
+	void setContributionThreshold(const int view, const float pixels);
+	float getContributionThreshold(const int view) const;
+
+	// Remove all spheres.  Called before the spheres of a frame are added.
+	void clear();
+
+	// Add a world space bounding sphere and return its index.  Spheres may also be added after cull() - their masks are valid after the next cull().
+	uint32_t addSphere(const DirectX::XMFLOAT3 &centre, const float r);
+
+	// Add an object with no bounds.  It is reported visible in every enabled view.
+	uint32_t addUnbounded();
+
+	// Test every sphere against every enabled view.  Views that are not enabled have their bit clear in every mask.
+	void cull();
+
+	// Return the view mask of the given sphere (valid after cull())
+	uint8_t getMask(const uint32_t index) const;
+
+	// Replace the view mask of the given sphere - used by later culling stages (for example occlusion culling) to clear view bits
+	void setMask(const uint32_t index, const uint8_t mask);
+
+	// Return the given sphere.  Returns false for objects added with addUnbounded.
+	bool getSphere(const uint32_t index, DirectX::XMFLOAT3 *centre, float *r) const;
+
+	uint32_t getSphereCount() const;
+
+	// Return the number of spheres visible in the given view after the last cull()
+	uint32_t getVisibleCount(const int view) const;
+};
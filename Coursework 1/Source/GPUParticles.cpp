@@ -104,37 +104,24 @@ GPUParticles::GPUParticles(ID3D11Device *device, Effect *_effect, ID3D11ShaderRe
 }
 
 
-void GPUParticles::render(ID3D11DeviceContext *context) {
-
-	// Validate object before rendering (see notes in constructor)
-	if (!context || !vertexBuffer || !effect)
-		return;
-
-	effect->bindPipeline(context);
+void GPUParticles::bindGeometry(DXContext *context) {
 
 	// Set vertex layout
 	context->IASetInputLayout(effect->getVSInputLayout());
 
-	// Set vertex and index buffers for IA
+	// Set vertex buffer for IA
 	ID3D11Buffer* vertexBuffers[] = { vertexBuffer };
 	UINT vertexStrides[] = { sizeof(DXVertexParticle) };
 	UINT vertexOffsets[] = { 0 };
 
 	context->IASetVertexBuffers(0, 1, vertexBuffers, vertexStrides, vertexOffsets);
 
-
 	// Set primitive topology for IA
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_POINTLIST);
+}
 
-	// Bind texture resource views and texture sampler objects to the PS stage of the pipeline
-	if (textureResourceView && linearSampler) {
-
-		context->PSSetShaderResources(0, 1, &textureResourceView);
-		context->PSSetSamplers(0, 1, &linearSampler);
-	}
+void GPUParticles::draw(DXContext *context) {
 
 	// Draw particles object using Geometry Shader
-
 	context->Draw(N_PART, 0);
 }
-
@@ -10,5 +10,6 @@ class GPUParticles : public Particles{
 public:
 
 	GPUParticles(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *tex_view, Material *_material);
-	void render(ID3D11DeviceContext *context);
+	void bindGeometry(DXContext *context);
+	void draw(DXContext *context);
 };
\ No newline at end of file
@@ -6,6 +6,7 @@
 #include <stdafx.h>
 #include <GUMemory.h>
 #include <iostream>
+#include <atomic>
 
 
 using namespace std;
@@ -15,8 +16,9 @@ using namespace std;
 // Memory allocation / free counters
 //
 
-static unsigned long			total_malloc_calls = 0;
-static unsigned long			total_free_calls = 0;
+// Atomic since memory is allocated and freed from worker threads (see WorkerPool).  Default constructed so the counters are zero-initialised statics - an initialiser would be run dynamically, after allocations made during static initialisation.
+static atomic<unsigned long>	total_malloc_calls;
+static atomic<unsigned long>	total_free_calls;
 
 
 
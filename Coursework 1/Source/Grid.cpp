@@ -2,6 +2,7 @@
 #include <stdafx.h>
 #include <Grid.h>
 #include <DXVertexExt.h>
+#include <DXVertexCompact.h>
 #include <Material.h>
 using namespace std;
 using namespace DirectX;
@@ -49,10 +50,15 @@ Grid::Grid(UINT widthl, UINT heightl, ID3D11Device *device, Effect *_effect, ID3
 		ZeroMemory(&vertexDesc, sizeof(D3D11_BUFFER_DESC));
 		ZeroMemory(&vertexData, sizeof(D3D11_SUBRESOURCE_DATA));
 
+		// The vertices are kept as DXVertexExt (see Terrain) and packed for upload
+		vector<DXVertexCompact> packedVertices;
+
+		DXVertexCompact::packVertices(vertices, width*height, &packedVertices);
+
 		vertexDesc.Usage = D3D11_USAGE_IMMUTABLE;
-		vertexDesc.ByteWidth = sizeof(DXVertexExt) * width*height;
+		vertexDesc.ByteWidth = sizeof(DXVertexCompact) * width*height;
 		vertexDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		vertexData.pSysMem = vertices;
+		vertexData.pSysMem = packedVertices.data();
 
 		HRESULT hr = device->CreateBuffer(&vertexDesc, &vertexData, &vertexBuffer);
 
@@ -75,15 +81,20 @@ Grid::Grid(UINT widthl, UINT heightl, ID3D11Device *device, Effect *_effect, ID3
 		}
 
 
+		// 16 bit indices for grids of up to 65536 vertices
+		vector<uint16_t> packedIndices;
+
+		indexFormat = DXVertexCompact::packIndices(indices, numInd, &packedIndices);
+
 		D3D11_BUFFER_DESC indexDesc;
 		indexDesc.Usage = D3D11_USAGE_IMMUTABLE;
-		indexDesc.ByteWidth = sizeof(UINT)* numInd;
+		indexDesc.ByteWidth = DXVertexCompact::indexStride(indexFormat) * numInd;
 		indexDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
 		indexDesc.CPUAccessFlags = 0;
 		indexDesc.MiscFlags = 0;
 		indexDesc.StructureByteStride = 0;
 		D3D11_SUBRESOURCE_DATA indexData;
-		indexData.pSysMem = indices;
+		indexData.pSysMem = (indexFormat == DXGI_FORMAT_R16_UINT) ? (const void*)packedIndices.data() : (const void*)indices;
 		
 		hr = device->CreateBuffer(&indexDesc, &indexData, &indexBuffer);
 		
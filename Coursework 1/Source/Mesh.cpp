@@ -2,6 +2,9 @@
 #include "Mesh.h"
 #include "Material.h"
 #include "Effect.h"
+#include "DXVertexCompact.h"
+
+using namespace DirectX;
 
 Mesh::Mesh(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *_texView, Material *_material)
 {
@@ -37,15 +40,11 @@ Mesh::~Mesh()
 }
 
 
-void Mesh::render(ID3D11DeviceContext *context) {
+void Mesh::render(DXContext *context) {
 
+	// bindPipeline sets the vertex and pixel shaders of the effect
 	effect->bindPipeline(context);
 
-	// set shader reflection map shaders for shark
-	context->VSSetShader(effect->getVertexShader(), 0, 0);
-	context->PSSetShader(effect->getPixelShader(), 0, 0);
-
-
 	// Validate DXModel before rendering (see notes in constructor)
 	if (!context || !vertexBuffer || !indexBuffer || !effect)
 		return;
@@ -55,11 +54,11 @@ void Mesh::render(ID3D11DeviceContext *context) {
 
 	// Set DXModel vertex and index buffers for IA
 	ID3D11Buffer* vertexBuffers[] = { vertexBuffer };
-	UINT vertexStrides[] = { sizeof(DXVertexExt) };
+	UINT vertexStrides[] = { sizeof(DXVertexCompact) };
 	UINT vertexOffsets[] = { 0 };
 
 	context->IASetVertexBuffers(0, 1, vertexBuffers, vertexStrides, vertexOffsets);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	context->IASetIndexBuffer(indexBuffer, indexFormat, 0);
 
 	// Set primitive topology for IA
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -75,3 +74,10 @@ void Mesh::render(ID3D11DeviceContext *context) {
 	// Draw Mesh
 	context->DrawIndexed(numInd, 0, 0);
 }
+
+// Return the material colours to write to the per-object constants before render (see CBufferPerObject)
+void Mesh::getMaterialColours(XMFLOAT4 *diffuse, XMFLOAT4 *specular) {
+
+	XMStoreFloat4(diffuse, PackedVector::XMLoadColor(&material->getColour()->diffuse));
+	XMStoreFloat4(specular, PackedVector::XMLoadColor(&material->getColour()->specular));
+}
@@ -5,6 +5,7 @@
 class Texture;
 class Material;
 class Effect;
+class DXContext;
 
 class Mesh
 {
@@ -16,13 +17,19 @@ protected:
 	ID3D11Buffer				*vertexBuffer = nullptr;
 	ID3D11Buffer				*indexBuffer = nullptr;
 
+	// Vertex buffers hold DXVertexCompact vertices - the index format is DXGI_FORMAT_R16_UINT when every index fits in 16 bits
+	DXGI_FORMAT					indexFormat = DXGI_FORMAT_R32_UINT;
+
 	// Augment grid with texture view
 	ID3D11ShaderResourceView		*textureResourceView = nullptr;
 	ID3D11SamplerState				*linearSampler = nullptr;
 
 public:
 	Mesh(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *tex_view, Material *_material);
-	void render(ID3D11DeviceContext *context);
+	void render(DXContext *context);
+
+	// Return the material colours to write to the per-object constants before render (see CBufferPerObject)
+	void getMaterialColours(DirectX::XMFLOAT4 *diffuse, DirectX::XMFLOAT4 *specular);
 	~Mesh();
 };
 
@@ -0,0 +1,382 @@
+
+//
+// MeshOptimizer.cpp
+//
+
+#include <stdafx.h>
+#include <MeshOptimizer.h>
+#include <algorithm>
+#include <cmath>
+
+using namespace std;
+
+
+static const uint32_t NoVertex = 0xFFFFFFFF;
+
+// FIFO cache modelled with a time stamp per vertex - a vertex is in the cache while fewer than cacheSize vertices have been added since it was
+struct VertexCache {
+
+	vector<uint32_t>					added;
+	uint32_t							time;
+	uint32_t							size;
+
+	VertexCache(const uint32_t vertexCount, const uint32_t cacheSize) : added(vertexCount, 0), time(cacheSize + 1), size(cacheSize) {}
+
+	// Return 1 if vertex v missed the cache (and add it) or 0 if it hit
+	uint32_t access(const uint32_t v) {
+
+		if (time - added[v] <= size)
+			return 0;
+
+		added[v] = time++;
+
+		return 1;
+	}
+
+	// Empty the cache
+	void flush() {
+
+		time += size + 1;
+	}
+};
+
+// Return the position of vertex v
+static const float* vertexPosition(const float *positions, const size_t stride, const uint32_t v) {
+
+	return reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + v * stride);
+}
+
+
+// Simulate drawing the triangles of indices through a FIFO cache of cacheSize entries.  Indices must be less than vertexCount.
+MeshOptimizer::CacheStats MeshOptimizer::analyzeVertexCache(const uint32_t *indices, const uint32_t indexCount, const uint32_t vertexCount, const uint32_t cacheSize) {
+
+	CacheStats stats = { 0, indexCount / 3, 0 };
+
+	VertexCache cache(vertexCount, cacheSize);
+	vector<uint8_t> used(vertexCount, 0);
+
+	for (uint32_t i = 0; i < stats.triangles * 3; i++) {
+
+		stats.transformed += cache.access(indices[i]);
+
+		if (!used[indices[i]]) {
+
+			used[indices[i]] = 1;
+			stats.vertices++;
+		}
+	}
+
+	return stats;
+}
+
+// Reorder the triangles of indices in place for a cache of cacheSize entries, keeping the winding of each triangle.  The first triangle of each cluster the reordering dead-ended into is written to clusters (see optimizeOverdraw).  Indices must be less than vertexCount.
+void MeshOptimizer::optimizeVertexCache(uint32_t *indices, const uint32_t indexCount, const uint32_t vertexCount, vector<uint32_t> *clusters, const uint32_t cacheSize) {
+
+	const uint32_t triangleCount = indexCount / 3;
+
+	clusters->clear();
+
+	if (triangleCount == 0)
+		return;
+
+	// Triangles using each vertex - the triangles of vertex v are adjacency[adjacencyStart[v]] to adjacency[adjacencyStart[v + 1] - 1]
+	vector<uint32_t> adjacencyStart(vertexCount + 1, 0);
+	vector<uint32_t> adjacency(triangleCount * 3);
+
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+		adjacencyStart[indices[i] + 1]++;
+
+	for (uint32_t v = 0; v < vertexCount; v++)
+		adjacencyStart[v + 1] += adjacencyStart[v];
+
+	vector<uint32_t> fill(adjacencyStart.begin(), adjacencyStart.end() - 1);
+
+	for (uint32_t i = 0; i < triangleCount * 3; i++)
+		adjacency[fill[indices[i]]++] = i / 3;
+
+	// Triangles of each vertex not yet emitted
+	vector<uint32_t> live(vertexCount);
+
+	for (uint32_t v = 0; v < vertexCount; v++)
+		live[v] = adjacencyStart[v + 1] - adjacencyStart[v];
+
+	VertexCache cache(vertexCount, cacheSize);
+	vector<uint8_t> emitted(triangleCount, 0);
+	vector<uint32_t> deadEndStack;
+	vector<uint32_t> candidates;
+	vector<uint32_t> output;
+
+	output.reserve(triangleCount * 3);
+
+	// Vertices are tried in order when there is no recently used vertex left to restart from
+	uint32_t nextUnvisited = 0;
+
+	auto skipDeadEnd = [&]() -> uint32_t {
+
+		while (!deadEndStack.empty()) {
+
+			uint32_t v = deadEndStack.back();
+
+			deadEndStack.pop_back();
+
+			if (live[v] > 0)
+				return v;
+		}
+
+		for (; nextUnvisited < vertexCount; nextUnvisited++)
+			if (live[nextUnvisited] > 0)
+				return nextUnvisited;
+
+		return NoVertex;
+	};
+
+	uint32_t fanVertex = skipDeadEnd();
+
+	clusters->push_back(0);
+
+	while (fanVertex != NoVertex) {
+
+		// Emit the remaining triangles around the fan vertex
+		candidates.clear();
+
+		for (uint32_t a = adjacencyStart[fanVertex]; a < adjacencyStart[fanVertex + 1]; a++) {
+
+			uint32_t triangle = adjacency[a];
+
+			if (emitted[triangle])
+				continue;
+
+			for (uint32_t corner = 0; corner < 3; corner++) {
+
+				uint32_t v = indices[triangle * 3 + corner];
+
+				output.push_back(v);
+				deadEndStack.push_back(v);
+				candidates.push_back(v);
+				live[v]--;
+				cache.access(v);
+			}
+
+			emitted[triangle] = 1;
+		}
+
+		// Move to the candidate added to the cache earliest that will still be in the cache once its own fan is emitted (each triangle can add up to two vertices)
+		uint32_t next = NoVertex;
+		int bestPriority = -1;
+
+		for (size_t c = 0; c < candidates.size(); c++) {
+
+			uint32_t v = candidates[c];
+
+			if (live[v] == 0)
+				continue;
+
+			uint32_t age = cache.time - cache.added[v];
+			int priority = (age + 2 * live[v] <= cacheSize) ? (int)age : 0;
+
+			if (priority > bestPriority) {
+
+				bestPriority = priority;
+				next = v;
+			}
+		}
+
+		if (next == NoVertex) {
+
+			next = skipDeadEnd();
+
+			if (next != NoVertex && output.size() / 3 != clusters->back())
+				clusters->push_back((uint32_t)output.size() / 3);
+		}
+
+		fanVertex = next;
+	}
+
+	copy(output.begin(), output.end(), indices);
+}
+
+// Reorder the clusters left by optimizeVertexCache so the clusters facing away from the mesh centre draw first.  Each cluster is first split wherever the ACMR of its triangles so far is within threshold of the ACMR of the whole cluster.  positions points to the first vertex position.
+void MeshOptimizer::optimizeOverdraw(uint32_t *indices, const uint32_t indexCount, const float *positions, const size_t stride, const uint32_t vertexCount, const vector<uint32_t> &clusters, const float threshold, const uint32_t cacheSize) {
+
+	const uint32_t triangleCount = indexCount / 3;
+
+	if (triangleCount == 0 || clusters.empty())
+		return;
+
+	// Split each cluster into smaller ones that start with an empty cache.  A split is made once the triangles since the last split are drawn nearly as efficiently as the whole cluster.
+	VertexCache cache(vertexCount, cacheSize);
+	vector<uint32_t> splitClusters;
+
+	for (size_t c = 0; c < clusters.size(); c++) {
+
+		uint32_t start = clusters[c];
+		uint32_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangleCount;
+		uint32_t misses = 0;
+
+		cache.flush();
+
+		for (uint32_t t = start; t < end; t++)
+			misses += cache.access(indices[t * 3]) + cache.access(indices[t * 3 + 1]) + cache.access(indices[t * 3 + 2]);
+
+		float clusterThreshold = threshold * (float)misses / (float)(end - start);
+		uint32_t splitStart = start;
+
+		splitClusters.push_back(start);
+		misses = 0;
+		cache.flush();
+
+		for (uint32_t t = start; t + 1 < end; t++) {
+
+			misses += cache.access(indices[t * 3]) + cache.access(indices[t * 3 + 1]) + cache.access(indices[t * 3 + 2]);
+
+			if ((float)misses <= clusterThreshold * (float)(t + 1 - splitStart)) {
+
+				splitClusters.push_back(t + 1);
+				splitStart = t + 1;
+				misses = 0;
+				cache.flush();
+			}
+		}
+	}
+
+	// Area weighted centroid and normal of each cluster and of the whole mesh
+	const size_t clusterCount = splitClusters.size();
+
+	vector<float> clusterCentroid(clusterCount * 3, 0.0f);
+	vector<float> clusterNormal(clusterCount * 3, 0.0f);
+	vector<float> clusterArea(clusterCount, 0.0f);
+	float meshCentroid[3] = { 0.0f, 0.0f, 0.0f };
+	float meshArea = 0.0f;
+
+	for (size_t c = 0; c < clusterCount; c++) {
+
+		uint32_t start = splitClusters[c];
+		uint32_t end = (c + 1 < clusterCount) ? splitClusters[c + 1] : triangleCount;
+
+		for (uint32_t t = start; t < end; t++) {
+
+			const float *p0 = vertexPosition(positions, stride, indices[t * 3]);
+			const float *p1 = vertexPosition(positions, stride, indices[t * 3 + 1]);
+			const float *p2 = vertexPosition(positions, stride, indices[t * 3 + 2]);
+
+			float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+			float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+			// Indices are wound clockwise so the cross product points out of the front face
+			float normal[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+			float area = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]) * 0.5f;
+
+			for (int axis = 0; axis < 3; axis++) {
+
+				float centre = (p0[axis] + p1[axis] + p2[axis]) / 3.0f;
+
+				clusterCentroid[c * 3 + axis] += centre * area;
+				clusterNormal[c * 3 + axis] += normal[axis];
+				meshCentroid[axis] += centre * area;
+			}
+
+			clusterArea[c] += area;
+		}
+
+		meshArea += clusterArea[c];
+	}
+
+	if (meshArea <= 0.0f)
+		return;
+
+	for (int axis = 0; axis < 3; axis++)
+		meshCentroid[axis] /= meshArea;
+
+	// Clusters facing away from the centre of the mesh are likely to occlude the others so sort them first.  Degenerate clusters sort to the middle.
+	vector<float> sortKey(clusterCount, 0.0f);
+	vector<uint32_t> order(clusterCount);
+
+	for (size_t c = 0; c < clusterCount; c++) {
+
+		order[c] = (uint32_t)c;
+
+		const float *n = &clusterNormal[c * 3];
+		float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+		if (clusterArea[c] <= 0.0f || length <= 0.0f)
+			continue;
+
+		for (int axis = 0; axis < 3; axis++)
+			sortKey[c] += (clusterCentroid[c * 3 + axis] / clusterArea[c] - meshCentroid[axis]) * n[axis] / length;
+	}
+
+	stable_sort(order.begin(), order.end(), [&sortKey](const uint32_t a, const uint32_t b) { return sortKey[a] > sortKey[b]; });
+
+	vector<uint32_t> sorted;
+
+	sorted.reserve(triangleCount * 3);
+
+	for (size_t i = 0; i < clusterCount; i++) {
+
+		uint32_t start = splitClusters[order[i]];
+		uint32_t end = (order[i] + 1 < clusterCount) ? splitClusters[order[i] + 1] : triangleCount;
+
+		sorted.insert(sorted.end(), indices + start * 3, indices + end * 3);
+	}
+
+	copy(sorted.begin(), sorted.end(), indices);
+}
+
+// Reorder the triangles of indices with optimizeVertexCache then optimizeOverdraw.  Splitting clusters for overdraw restarts the cache, so if the result transforms more vertices than the source order the plain Tipsify order is kept instead, or the source order if Tipsify did no better.  If before and after are given they are set to the statistics of the source and final orders.
+void MeshOptimizer::optimizeTriangles(uint32_t *indices, const uint32_t indexCount, const float *positions, const size_t stride, const uint32_t vertexCount, CacheStats *before, CacheStats *after) {
+
+	CacheStats sourceStats = analyzeVertexCache(indices, indexCount, vertexCount);
+	vector<uint32_t> sourceOrder(indices, indices + indexCount);
+	vector<uint32_t> clusters;
+
+	optimizeVertexCache(indices, indexCount, vertexCount, &clusters);
+
+	CacheStats cacheStats = analyzeVertexCache(indices, indexCount, vertexCount);
+	vector<uint32_t> cacheOrder(indices, indices + indexCount);
+
+	optimizeOverdraw(indices, indexCount, positions, stride, vertexCount, clusters);
+
+	CacheStats finalStats = analyzeVertexCache(indices, indexCount, vertexCount);
+
+	if (finalStats.transformed > sourceStats.transformed) {
+
+		if (cacheStats.transformed <= sourceStats.transformed) {
+
+			copy(cacheOrder.begin(), cacheOrder.end(), indices);
+			finalStats = cacheStats;
+		}
+		else {
+
+			copy(sourceOrder.begin(), sourceOrder.end(), indices);
+			finalStats = sourceStats;
+		}
+	}
+
+	if (before)
+		*before = sourceStats;
+
+	if (after)
+		*after = finalStats;
+}
+
+// Renumber the vertices in the order indices first uses them and rewrite indices to match.  remap[v] is set to the new number of vertex v for vertexCount vertices - unused vertices follow the used ones in their original order.
+void MeshOptimizer::optimizeVertexFetch(uint32_t *indices, const uint32_t indexCount, const uint32_t vertexCount, vector<uint32_t> *remap) {
+
+	remap->assign(vertexCount, NoVertex);
+
+	uint32_t next = 0;
+
+	for (uint32_t i = 0; i < indexCount; i++) {
+
+		uint32_t &newIndex = (*remap)[indices[i]];
+
+		if (newIndex == NoVertex)
+			newIndex = next++;
+
+		indices[i] = newIndex;
+	}
+
+	for (uint32_t v = 0; v < vertexCount; v++)
+		if ((*remap)[v] == NoVertex)
+			(*remap)[v] = next++;
+}
@@ -0,0 +1,47 @@
+//
+// MeshOptimizer.h
+//
+
+// Load-time triangle and vertex reordering for the post-transform vertex cache, overdraw and vertex fetch.  Triangles are first reordered with Tipsify (Sander, Nehab and Barczak, "Fast Triangle Reordering for Vertex Locality and Reduced Overdraw", 2007) - triangles are fanned around one vertex at a time, moving next to the vertex still in the cache that was added earliest and jumping to a recently used vertex with live triangles when the fan dead-ends.  The dead-ends split the result into clusters that share little with each other, which are split further where doing so costs little cache efficiency and then sorted so the clusters facing out from the mesh centre draw first and occlude the rest.  Finally vertices are renumbered in the order the triangles first use them so vertex fetch walks the vertex buffer forwards.
+//
+// The cache is modelled as a FIFO of CacheSize entries.  ACMR (average cache miss ratio) is the number of vertex shader invocations per triangle - between 0.5 for an ideal regular grid and 3.  ATVR (average transform to vertex ratio) is the number of invocations per vertex used - 1 is ideal.
+//
+// The class does not depend on Direct3D - positions are read as 3 floats at the given byte stride.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+class MeshOptimizer {
+
+public:
+
+	// Simulated post-transform cache size
+	static const uint32_t				CacheSize = 16;
+
+	// Result of analyzeVertexCache
+	struct CacheStats {
+
+		uint32_t						transformed; // vertex shader invocations (cache misses)
+		uint32_t						triangles;
+		uint32_t						vertices; // distinct vertices used by the triangles
+	};
+
+	// Simulate drawing the triangles of indices through a FIFO cache of cacheSize entries.  Indices must be less than vertexCount.
+	static CacheStats analyzeVertexCache(const uint32_t *indices, const uint32_t indexCount, const uint32_t vertexCount, const uint32_t cacheSize = CacheSize);
+
+	// Reorder the triangles of indices in place for a cache of cacheSize entries, keeping the winding of each triangle.  The first triangle of each cluster the reordering dead-ended into is written to clusters (see optimizeOverdraw).  Indices must be less than vertexCount.
+	static void optimizeVertexCache(uint32_t *indices, const uint32_t indexCount, const uint32_t vertexCount, std::vector<uint32_t> *clusters, const uint32_t cacheSize = CacheSize);
+
+	// Reorder the clusters left by optimizeVertexCache so the clusters facing away from the mesh centre draw first.  Each cluster is first split wherever the ACMR of its triangles so far is within threshold of the ACMR of the whole cluster.  positions points to the first vertex position.
+	static void optimizeOverdraw(uint32_t *indices, const uint32_t indexCount, const float *positions, const size_t stride, const uint32_t vertexCount, const std::vector<uint32_t> &clusters, const float threshold = 1.05f, const uint32_t cacheSize = CacheSize);
+
+	// Reorder the triangles of indices with optimizeVertexCache then optimizeOverdraw.  Splitting clusters for overdraw restarts the cache, so if the result transforms more vertices than the source order the plain Tipsify order is kept instead, or the source order if Tipsify did no better.  If before and after are given they are set to the statistics of the source and final orders.
+	static void optimizeTriangles(uint32_t *indices, const uint32_t indexCount, const float *positions, const size_t stride, const uint32_t vertexCount, CacheStats *before = nullptr, CacheStats *after = nullptr);
+
+	// Renumber the vertices in the order indices first uses them and rewrite indices to match.  remap[v] is set to the new number of vertex v for vertexCount vertices - unused vertices follow the used ones in their original order.
+	static void optimizeVertexFetch(uint32_t *indices, const uint32_t indexCount, const uint32_t vertexCount, std::vector<uint32_t> *remap);
+};
@@ -0,0 +1,134 @@
+
+//
+// MeshSimplifier.cpp
+//
+
+#include <stdafx.h>
+#include <MeshSimplifier.h>
+#include <cmath>
+#include <cfloat>
+#include <set>
+#include <tuple>
+#include <unordered_map>
+
+using namespace std;
+
+
+// Return the index (0 - 5) of the dominant signed axis of a normal
+static uint32_t normalAxis(const float *normal) {
+
+	float ax = fabsf(normal[0]);
+	float ay = fabsf(normal[1]);
+	float az = fabsf(normal[2]);
+
+	if (ax >= ay && ax >= az)
+		return (normal[0] < 0.0f) ? 1 : 0;
+	else if (ay >= az)
+		return (normal[1] < 0.0f) ? 3 : 2;
+	else
+		return (normal[2] < 0.0f) ? 5 : 4;
+}
+
+
+// Set remap[v] to the representative vertex of the cluster containing vertex v for vertexCount vertices.  positions and normals point to the first vertex position and normal.
+void MeshSimplifier::clusterVertices(const float *positions, const float *normals, const size_t stride, const uint32_t vertexCount, const float cellSize, vector<uint32_t> *remap) {
+
+	remap->resize(vertexCount);
+
+	if (vertexCount == 0)
+		return;
+
+	const float invCellSize = 1.0f / max(cellSize, 1e-6f);
+
+	// Cluster keys pack 20 bits of each cell coordinate and the normal axis
+	unordered_map<uint64_t, uint32_t> clusterIDs;
+	vector<uint32_t> clusterOf(vertexCount);
+	vector<float> clusterSum;
+	vector<uint32_t> clusterCount;
+
+	for (uint32_t v = 0; v < vertexCount; v++) {
+
+		const float *p = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + v * stride);
+		const float *n = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(normals) + v * stride);
+
+		uint64_t key = 0;
+
+		for (int axis = 0; axis < 3; axis++)
+			key = (key << 20) | ((uint64_t)(int64_t)floorf(p[axis] * invCellSize) & 0xFFFFF);
+
+		key = (key << 3) | normalAxis(n);
+
+		unordered_map<uint64_t, uint32_t>::iterator cluster = clusterIDs.find(key);
+
+		if (cluster == clusterIDs.end()) {
+
+			cluster = clusterIDs.insert(make_pair(key, (uint32_t)clusterCount.size())).first;
+			clusterSum.insert(clusterSum.end(), 3, 0.0f);
+			clusterCount.push_back(0);
+		}
+
+		uint32_t id = cluster->second;
+
+		clusterOf[v] = id;
+		clusterSum[id * 3] += p[0];
+		clusterSum[id * 3 + 1] += p[1];
+		clusterSum[id * 3 + 2] += p[2];
+		clusterCount[id]++;
+	}
+
+	// The representative of each cluster is its vertex nearest the cluster mean so the attributes of a real vertex (texture coordinates, normal) are kept
+	vector<uint32_t> representative(clusterCount.size(), 0);
+	vector<float> nearest(clusterCount.size(), FLT_MAX);
+
+	for (uint32_t v = 0; v < vertexCount; v++) {
+
+		const float *p = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + v * stride);
+
+		uint32_t id = clusterOf[v];
+		float invCount = 1.0f / (float)clusterCount[id];
+
+		float dx = p[0] - clusterSum[id * 3] * invCount;
+		float dy = p[1] - clusterSum[id * 3 + 1] * invCount;
+		float dz = p[2] - clusterSum[id * 3 + 2] * invCount;
+		float distanceSq = dx * dx + dy * dy + dz * dz;
+
+		if (distanceSq < nearest[id]) {
+
+			nearest[id] = distanceSq;
+			representative[id] = v;
+		}
+	}
+
+	for (uint32_t v = 0; v < vertexCount; v++)
+		(*remap)[v] = representative[clusterOf[v]];
+}
+
+// Append the triangles of indices remapped by remap to outIndices, dropping degenerate and duplicate triangles.  Returns the number of triangles appended.
+uint32_t MeshSimplifier::remapTriangles(const uint32_t *indices, const uint32_t indexCount, const vector<uint32_t> &remap, vector<uint32_t> *outIndices) {
+
+	set<tuple<uint32_t, uint32_t, uint32_t> > emitted;
+	uint32_t triangleCount = 0;
+
+	for (uint32_t i = 0; i + 2 < indexCount; i += 3) {
+
+		uint32_t a = remap[indices[i]];
+		uint32_t b = remap[indices[i + 1]];
+		uint32_t c = remap[indices[i + 2]];
+
+		if (a == b || b == c || a == c)
+			continue;
+
+		// Rotate the smallest index first (keeping the winding) so the same triangle always has the same key
+		tuple<uint32_t, uint32_t, uint32_t> key = (a < b && a < c) ? make_tuple(a, b, c) : (b < c) ? make_tuple(b, c, a) : make_tuple(c, a, b);
+
+		if (!emitted.insert(key).second)
+			continue;
+
+		outIndices->push_back(a);
+		outIndices->push_back(b);
+		outIndices->push_back(c);
+		triangleCount++;
+	}
+
+	return triangleCount;
+}
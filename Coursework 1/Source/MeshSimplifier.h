@@ -0,0 +1,25 @@
+//
+// MeshSimplifier.h
+//
+
+// Load-time mesh simplification by vertex clustering.  Vertices are grouped by the cell of a uniform grid containing them (and by the dominant axis of their normal so the opposite sides of thin walls are not merged) and each cluster is replaced by its vertex nearest the cluster mean.  Triangles are then remapped to the cluster representatives - triangles whose corners fall in fewer than three clusters vanish along with duplicates.  The simplified triangles index the original vertices so a simplified mesh can share the vertex buffer of the mesh it was made from.
+//
+// The class does not depend on Direct3D - positions and normals are read as 3 floats at the given byte stride.
+
+#pragma once
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+
+class MeshSimplifier {
+
+public:
+
+	// Set remap[v] to the representative vertex of the cluster containing vertex v for vertexCount vertices.  positions and normals point to the first vertex position and normal.
+	static void clusterVertices(const float *positions, const float *normals, const size_t stride, const uint32_t vertexCount, const float cellSize, std::vector<uint32_t> *remap);
+
+	// Append the triangles of indices remapped by remap to outIndices, dropping degenerate and duplicate triangles.  Returns the number of triangles appended.
+	static uint32_t remapTriangles(const uint32_t *indices, const uint32_t indexCount, const std::vector<uint32_t> &remap, std::vector<uint32_t> *outIndices);
+};
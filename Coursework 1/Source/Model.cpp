@@ -3,7 +3,14 @@
 #include <Model.h>
 #include <Material.h>
 #include <Effect.h>
+#include <CookedMesh.h>
+#include <ModelImporter.h>
+#include <MeshOptimizer.h>
+#include <WorkerPool.h>
 #include <iostream>
+#include <iomanip>
+#include <algorithm>
+#include <sstream>
 #include <exception>
 #include <CoreStructures\CoreStructures.h>
 #include <CGImport3\CGModel\CGModel.h>
@@ -14,15 +21,22 @@ using namespace DirectX;
 using namespace DirectX::PackedVector;
 using namespace CoreStructures;
 
-Model::Model(ID3D11Device *device, Effect *_effect, const std::wstring& filename, ID3D11ShaderResourceView *tex_view, Material *_material) {
+
+// Set by the -cookmodels command line option (see setCookModels())
+bool Model::cookModels = false;
+
+// Set by Scene while it creates its models (see setImportPool())
+WorkerPool *Model::importPool = nullptr;
+
+Model::Model(ID3D11Device *device, Effect *_effect, const std::wstring& filename, ID3D11ShaderResourceView *tex_view, Material *_material, const bool keepMeshData) {
 	
 	Num_Textures = 1;
-	load(device, _effect, filename, tex_view, _material);
+	load(device, _effect, filename, tex_view, _material, keepMeshData);
 }
 
-Model::Model(ID3D11Device *device, Effect *_effect, const std::wstring& filename, ID3D11ShaderResourceView *_tex_view_array[],int _num_textures, Material *_material) {
+Model::Model(ID3D11Device *device, Effect *_effect, const std::wstring& filename, ID3D11ShaderResourceView *_tex_view_array[],int _num_textures, Material *_material, const bool keepMeshData) {
 	
-	load(device, _effect, filename, _tex_view_array[0], _material);
+	load(device, _effect, filename, _tex_view_array[0], _material, keepMeshData);
 	Num_Textures = min(8,_num_textures);
 	for (int i=1; i < Num_Textures; i++)
 	{
@@ -32,7 +46,7 @@ Model::Model(ID3D11Device *device, Effect *_effect, const std::wstring& filename
 
 }	
 
-void Model::load(ID3D11Device *device, Effect *_effect, const std::wstring& filename, ID3D11ShaderResourceView *tex_view, Material *_material) {
+void Model::load(ID3D11Device *device, Effect *_effect, const std::wstring& filename, ID3D11ShaderResourceView *tex_view, Material *_material, const bool keepMeshData) {
 	printf("entering model init");
 	
 	effect = _effect;
@@ -40,16 +54,196 @@ void Model::load(ID3D11Device *device, Effect *_effect, const std::wstring& file
 	inputLayout->AddRef();
 	material = _material;
 	worldMatrix = XMMatrixIdentity();
-	
-	CGModel *actualModel = nullptr;
-	DXVertexExt *_vertexBuffer = nullptr;
-	uint32_t *_indexBuffer = nullptr;
+	boundsCentre = XMFLOAT3(0.0f, 0.0f, 0.0f);
+
+	CookedMesh *cookedMesh = nullptr;
 
 	try
 	{
 		if (!device || !inputLayout)
 			throw exception("Invalid parameters for Model instantiation");
 
+		// Load the cooked mesh if there is an up to date one (see CookedMesh), otherwise import the source model
+		if (!cookModels)
+			cookedMesh = openCookedMesh(filename);
+
+		if (cookedMesh) {
+
+			loadCookedMesh(device, cookedMesh, keepMeshData);
+
+			cookedMesh->release();
+			cookedMesh = nullptr;
+		}
+		else
+			importModel(device, filename, keepMeshData);
+
+
+		D3D11_SAMPLER_DESC linearDesc;
+
+		ZeroMemory(&linearDesc, sizeof(D3D11_SAMPLER_DESC));
+
+		linearDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
+		linearDesc.AddressU = D3D11_TEXTURE_ADDRESS_MIRROR;
+		linearDesc.AddressV = D3D11_TEXTURE_ADDRESS_MIRROR;
+		linearDesc.AddressW = D3D11_TEXTURE_ADDRESS_MIRROR;
+		linearDesc.MinLOD = 0.0f;
+		linearDesc.MaxLOD = D3D11_FLOAT32_MAX; // prefiltered cube maps are sampled by level (see reflection_probe_ps)
+		linearDesc.MipLODBias = 0.0f;
+		//linearDesc.MaxAnisotropy = 0; // Unused for isotropic filtering
+		linearDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
+
+		HRESULT hr = device->CreateSamplerState(&linearDesc, &sampler);
+
+		// Setup texture interfaces
+		textureResourceViewArray[0] = tex_view;
+		if (textureResourceViewArray[0])
+			textureResourceViewArray[0]->AddRef();
+	}
+	catch (exception& e)
+	{
+		cout << "Model could not be instantiated due to:\n";
+		cout << e.what() << endl;
+
+		if (cookedMesh)
+			cookedMesh->release();
+
+
+		if (vertexBuffer)
+			vertexBuffer->Release();
+
+		if (indexBuffer)
+			indexBuffer->Release();
+
+		if (inputLayout)
+			inputLayout->Release();
+
+		vertexBuffer = nullptr;
+		indexBuffer = nullptr;
+		inputLayout = nullptr;
+
+		numMeshes = 0;
+	}
+}
+
+// Import the source model and create the buffers from it.  obj and 3ds files are read by ModelImporter and other formats through CGImport3.  When cooking is enabled the converted mesh is also written to the model's cooked mesh file.  Throws an exception if the model cannot be imported.
+void Model::importModel(ID3D11Device *device, const std::wstring& filename, const bool keepMeshData) {
+
+	vector<DXVertexExt> vertices;
+	vector<uint32_t> indices;
+
+	// Model paths are plain ASCII
+	string path;
+
+	for (size_t i = 0; i < filename.length(); ++i)
+		path += (char)filename[i];
+
+	if (ModelImporter::isSupported(path))
+		readNativeModel(path, &vertices, &indices);
+	else
+		readCGModel(filename, &vertices, &indices);
+
+	if (numMeshes == 0 || vertices.empty())
+		throw exception("Empty model loaded");
+
+	optimizeMeshes(filename, &vertices, &indices);
+
+	uint32_t numVertices = (uint32_t)vertices.size();
+	uint32_t numIndices = (uint32_t)indices.size();
+
+	// Bounding sphere - centred on the axis-aligned bounds and enclosing every vertex
+	XMVECTOR boundsMin = XMLoadFloat3(&vertices[0].pos);
+	XMVECTOR boundsMax = boundsMin;
+
+	for (uint32_t k = 1; k < numVertices; ++k) {
+
+		XMVECTOR pos = XMLoadFloat3(&vertices[k].pos);
+
+		boundsMin = XMVectorMin(boundsMin, pos);
+		boundsMax = XMVectorMax(boundsMax, pos);
+	}
+
+	XMVECTOR centre = (boundsMin + boundsMax) * 0.5f;
+	XMVECTOR radiusSq = XMVectorZero();
+
+	for (uint32_t k = 0; k < numVertices; ++k)
+		radiusSq = XMVectorMax(radiusSq, XMVector3LengthSq(XMLoadFloat3(&vertices[k].pos) - centre));
+
+	XMStoreFloat3(&boundsCentre, centre);
+	boundsRadius = sqrtf(XMVectorGetX(radiusSq));
+
+	// Pack the vertices, and the indices if every one fits in 16 bits, for upload (see DXVertexCompact).  Indices are relative to the base vertex of their sub-mesh so only a sub-mesh of more than 65536 vertices needs 32 bit indices.
+	vector<DXVertexCompact> packedVertices;
+	vector<uint16_t> packedIndices;
+
+	DXVertexCompact::packVertices(vertices.data(), numVertices, &packedVertices);
+	indexFormat = DXVertexCompact::packIndices(indices.data(), numIndices, &packedIndices);
+
+	const void *indexData = (indexFormat == DXGI_FORMAT_R16_UINT) ? (const void*)packedIndices.data() : (const void*)indices.data();
+
+	createBuffers(device, packedVertices.data(), numVertices, indexData, numIndices);
+
+	if (cookModels)
+		writeCookedMesh(filename, packedVertices.data(), numVertices, indexData, numIndices);
+
+	if (keepMeshData) {
+
+		meshVertices.swap(vertices);
+		meshIndices.swap(indices);
+	}
+}
+
+// Read an obj or 3ds model with ModelImporter (see setImportPool()).  The importer has already converted the vertices to the left-handed frame so only the material colours need adding.
+void Model::readNativeModel(const std::string& filename, std::vector<DXVertexExt> *vertices, std::vector<uint32_t> *indices) {
+
+	ModelImporter *importer = new ModelImporter(importPool);
+
+	if (!importer->import(filename)) {
+
+		string message = importer->getError();
+
+		importer->release();
+		throw exception(message.c_str());
+	}
+
+	const vector<ModelImporter::Mesh> &meshes = importer->getMeshes();
+
+	numMeshes = (uint32_t)meshes.size();
+
+	for (uint32_t i = 0; i < numMeshes; ++i) {
+
+		baseVertexOffset.push_back(meshes[i].baseVertex);
+		indexCount.push_back(meshes[i].indexCount);
+	}
+
+	const vector<ModelImporter::Vertex> &importedVertices = importer->getVertices();
+	XMCOLOR matDiffuse = material->getColour()->diffuse;
+	XMCOLOR matSpecular = material->getColour()->specular;
+
+	vertices->resize(importedVertices.size());
+
+	for (size_t k = 0; k < importedVertices.size(); ++k) {
+
+		DXVertexExt &vertex = (*vertices)[k];
+
+		vertex.pos = XMFLOAT3(importedVertices[k].pos);
+		vertex.normal = XMFLOAT3(importedVertices[k].normal);
+		vertex.texCoord = XMFLOAT2(importedVertices[k].texCoord);
+		vertex.matDiffuse = matDiffuse;
+		vertex.matSpecular = matSpecular;
+	}
+
+	*indices = importer->getIndices();
+
+	importer->release();
+}
+
+// Read the source model through CGImport3 and convert each CGPolyMesh to the left-handed frame
+void Model::readCGModel(const std::wstring& filename, std::vector<DXVertexExt> *vertices, std::vector<uint32_t> *indices) {
+
+	CGModel *actualModel = nullptr;
+
+	try
+	{
 		actualModel = new CGModel();
 
 		if (!actualModel)
@@ -107,23 +301,13 @@ void Model::load(ID3D11Device *device, Effect *_effect, const std::wstring& file
 		}
 		
 
-		// Create vertex buffer
-		_vertexBuffer = (DXVertexExt*)malloc(numVertices * sizeof(DXVertexExt));
-
-		if (!_vertexBuffer)
-			throw exception("Cannot create vertex buffer");
-
-
-		// Create index buffer
-		_indexBuffer = (uint32_t*)malloc(numIndices * sizeof(uint32_t));
-
-		if (!_indexBuffer)
-			throw exception("Cannot create index buffer");
+		vertices->resize(numVertices);
+		indices->resize(numIndices);
 
 
 		// Copy vertex data into single buffer
-		DXVertexExt *vptr = _vertexBuffer;
-		uint32_t *indexPtr = _indexBuffer;
+		DXVertexExt *vptr = vertices->data();
+		uint32_t *indexPtr = indices->data();
 
 		for (uint32_t i = 0; i < numMeshes; ++i) {
 
@@ -162,112 +346,244 @@ void Model::load(ID3D11Device *device, Effect *_effect, const std::wstring& file
 			}
 		}
 
-		
-		//
-		// Setup DX vertex buffer interfaces
-		//
+		// Dispose of local resources
+		actualModel->release();
+	}
+	catch (exception&)
+	{
+		if (actualModel)
+			actualModel->release();
 
-		D3D11_BUFFER_DESC vertexDesc;
-		D3D11_SUBRESOURCE_DATA vertexData;
+		throw;
+	}
+}
 
-		ZeroMemory(&vertexDesc, sizeof(D3D11_BUFFER_DESC));
-		ZeroMemory(&vertexData, sizeof(D3D11_SUBRESOURCE_DATA));
+// Reorder the triangles and vertices of each sub-mesh for the post-transform cache, overdraw and vertex fetch (see MeshOptimizer) and report the ACMR and ATVR before and after
+void Model::optimizeMeshes(const std::wstring& filename, std::vector<DXVertexExt> *vertices, std::vector<uint32_t> *indices) {
 
-		vertexDesc.Usage = D3D11_USAGE_IMMUTABLE;
-		vertexDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		vertexDesc.ByteWidth = numVertices * sizeof(DXVertexExt);
-		vertexData.pSysMem = _vertexBuffer;
+	MeshOptimizer::CacheStats before = { 0, 0, 0 };
+	MeshOptimizer::CacheStats after = { 0, 0, 0 };
 
-		HRESULT hr = device->CreateBuffer(&vertexDesc, &vertexData, &vertexBuffer);
+	uint32_t indexOffset = 0;
 
-		if (!SUCCEEDED(hr))
-			throw exception("Vertex buffer cannot be created");
+	for (uint32_t i = 0; i < numMeshes; ++i) {
 
+		// The vertices of each sub-mesh run up to the base vertex of the next
+		uint32_t baseVertex = baseVertexOffset[i];
+		uint32_t meshVertexCount = ((i + 1 < numMeshes) ? baseVertexOffset[i + 1] : (uint32_t)vertices->size()) - baseVertex;
+		uint32_t meshIndexCount = indexCount[i];
+		uint32_t *meshIndexData = indices->data() + indexOffset;
 
-		// Setup index buffer
-		D3D11_BUFFER_DESC indexDesc;
-		D3D11_SUBRESOURCE_DATA indexData;
+		indexOffset += meshIndexCount;
 
-		ZeroMemory(&indexDesc, sizeof(D3D11_BUFFER_DESC));
-		ZeroMemory(&indexData, sizeof(D3D11_SUBRESOURCE_DATA));
+		if (meshVertexCount == 0 || meshIndexCount < 3 || *max_element(meshIndexData, meshIndexData + meshIndexCount) >= meshVertexCount)
+			continue;
 
-		indexDesc.Usage = D3D11_USAGE_IMMUTABLE;
-		indexDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
-		indexDesc.ByteWidth = numIndices * sizeof(uint32_t);
-		indexData.pSysMem = _indexBuffer;
+		MeshOptimizer::CacheStats sourceStats, meshStats;
 
-		hr = device->CreateBuffer(&indexDesc, &indexData, &indexBuffer);
+		MeshOptimizer::optimizeTriangles(meshIndexData, meshIndexCount, &(*vertices)[baseVertex].pos.x, sizeof(DXVertexExt), meshVertexCount, &sourceStats, &meshStats);
 
-		if (!SUCCEEDED(hr))
-			throw exception("Index buffer cannot be created");
+		// Store the vertices in the order the triangles first use them
+		vector<uint32_t> remap;
 
-		// Build the vertex input layout - this is done here since each object may load it's data into the IA differently.  This requires the compiled vertex shader bytecode.
-		//hr = DXVertexExt::createInputLayout(device, vsBytecode, &inputLayout);
+		MeshOptimizer::optimizeVertexFetch(meshIndexData, meshIndexCount, meshVertexCount, &remap);
 
-		if (!SUCCEEDED(hr))
-			throw exception("Cannot create input layout interface");
-		
+		vector<DXVertexExt> sourceVertices(vertices->begin() + baseVertex, vertices->begin() + baseVertex + meshVertexCount);
 
+		for (uint32_t v = 0; v < meshVertexCount; ++v)
+			(*vertices)[baseVertex + remap[v]] = sourceVertices[v];
 
-		D3D11_SAMPLER_DESC linearDesc;
+		before.transformed += sourceStats.transformed;
+		before.triangles += sourceStats.triangles;
+		before.vertices += sourceStats.vertices;
+		after.transformed += meshStats.transformed;
+		after.triangles += meshStats.triangles;
+		after.vertices += meshStats.vertices;
+	}
 
-		ZeroMemory(&linearDesc, sizeof(D3D11_SAMPLER_DESC));
+	if (before.triangles == 0)
+		return;
 
-		linearDesc.Filter = D3D11_FILTER_MIN_MAG_MIP_LINEAR;
-		linearDesc.AddressU = D3D11_TEXTURE_ADDRESS_MIRROR;
-		linearDesc.AddressV = D3D11_TEXTURE_ADDRESS_MIRROR;
-		linearDesc.AddressW = D3D11_TEXTURE_ADDRESS_MIRROR;
-		linearDesc.MinLOD = 0.0f;
-		linearDesc.MaxLOD = 0.0f;
-		linearDesc.MipLODBias = 0.0f;
-		//linearDesc.MaxAnisotropy = 0; // Unused for isotropic filtering
-		linearDesc.ComparisonFunc = D3D11_COMPARISON_ALWAYS;
+	// Models are imported in parallel so the report is written in one piece
+	wostringstream report;
 
-		hr = device->CreateSamplerState(&linearDesc, &sampler);
+	report << fixed << setprecision(3);
+	report << L"Optimised " << filename << L" (" << before.triangles << L" triangles) - ACMR " << (float)before.transformed / before.triangles << L" -> " << (float)after.transformed / after.triangles;
+	report << L", ATVR " << (float)before.transformed / before.vertices << L" -> " << (float)after.transformed / after.vertices << endl;
 
-		// Setup texture interfaces
-		textureResourceViewArray[0] = tex_view;
-		if (textureResourceViewArray[0])
-			textureResourceViewArray[0]->AddRef();
+	wcout << report.str();
+}
 
+// Create the immutable vertex and index buffers from the given mesh data.  indices are in indexFormat.  Throws an exception if either buffer cannot be created.
+void Model::createBuffers(ID3D11Device *device, const DXVertexCompact *vertices, const uint32_t numVertices, const void *indices, const uint32_t numIndices) {
 
+	//
+	// Setup DX vertex buffer interfaces
+	//
 
+	D3D11_BUFFER_DESC vertexDesc;
+	D3D11_SUBRESOURCE_DATA vertexData;
 
-		// Dispose of local resources
-		free(_vertexBuffer);
-		free(_indexBuffer);
-		actualModel->release();
+	ZeroMemory(&vertexDesc, sizeof(D3D11_BUFFER_DESC));
+	ZeroMemory(&vertexData, sizeof(D3D11_SUBRESOURCE_DATA));
+
+	vertexDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	vertexDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+	vertexDesc.ByteWidth = numVertices * sizeof(DXVertexCompact);
+	vertexData.pSysMem = vertices;
+
+	HRESULT hr = device->CreateBuffer(&vertexDesc, &vertexData, &vertexBuffer);
+
+	if (!SUCCEEDED(hr))
+		throw exception("Vertex buffer cannot be created");
+
+
+	// Setup index buffer
+	D3D11_BUFFER_DESC indexDesc;
+	D3D11_SUBRESOURCE_DATA indexData;
+
+	ZeroMemory(&indexDesc, sizeof(D3D11_BUFFER_DESC));
+	ZeroMemory(&indexData, sizeof(D3D11_SUBRESOURCE_DATA));
+
+	indexDesc.Usage = D3D11_USAGE_IMMUTABLE;
+	indexDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+	indexDesc.ByteWidth = numIndices * DXVertexCompact::indexStride(indexFormat);
+	indexData.pSysMem = indices;
+
+	hr = device->CreateBuffer(&indexDesc, &indexData, &indexBuffer);
+
+	if (!SUCCEEDED(hr))
+		throw exception("Index buffer cannot be created");
+}
+
+// Map the cooked mesh of the given source model.  Returns nullptr if there is no cooked mesh, or it was cooked from a different version of the source.
+CookedMesh* Model::openCookedMesh(const std::wstring& filename) {
+
+	CookedMesh *cookedMesh = CookedMesh::CreateCookedMesh(filename + CookedMesh::Extension);
+
+	if (!cookedMesh)
+		return nullptr;
+
+	const CookedMesh::Header *header = cookedMesh->getHeader();
+	uint64_t sourceSize, sourceWriteTime;
+
+	// A cooked mesh without its source is used as it is
+	bool stale = CookedMesh::getFileStamp(filename, &sourceSize, &sourceWriteTime) && (sourceSize != header->sourceSize || sourceWriteTime != header->sourceWriteTime);
+
+	if (stale) {
+
+		wcout << L"Cooked mesh of " << filename << L" is out of date - importing the source model" << endl;
+
+		cookedMesh->release();
+		return nullptr;
 	}
-	catch (exception& e)
-	{
-		cout << "Model could not be instantiated due to:\n";
-		cout << e.what() << endl;
 
-		if (_vertexBuffer)
-			free(_vertexBuffer);
+	return cookedMesh;
+}
 
-		if (_indexBuffer)
-			free(_indexBuffer);
+// Create the buffers straight from the mapped cooked mesh and read its sub-mesh table and bounds
+void Model::loadCookedMesh(ID3D11Device *device, CookedMesh *cookedMesh, const bool keepMeshData) {
 
-		if (actualModel)
-			actualModel->release();
+	const CookedMesh::Header *header = cookedMesh->getHeader();
+	const CookedMesh::SubMesh *meshes = cookedMesh->getMeshes();
 
+	numMeshes = header->numMeshes;
 
-		if (vertexBuffer)
-			vertexBuffer->Release();
+	for (uint32_t i = 0; i < numMeshes; ++i) {
 
-		if (indexBuffer)
-			indexBuffer->Release();
+		baseVertexOffset.push_back(meshes[i].baseVertex);
+		indexCount.push_back(meshes[i].indexCount);
+	}
 
-		if (inputLayout)
-			inputLayout->Release();
+	boundsCentre = XMFLOAT3(header->boundsCentre[0], header->boundsCentre[1], header->boundsCentre[2]);
+	boundsRadius = header->boundsRadius;
 
-		vertexBuffer = nullptr;
-		indexBuffer = nullptr;
-		inputLayout = nullptr;
+	indexFormat = cookedMesh->getIndexFormat();
 
-		numMeshes = 0;
+	createBuffers(device, cookedMesh->getVertices(), header->numVertices, cookedMesh->getIndices(), header->numIndices);
+
+	// The CPU copy is unpacked back to DXVertexExt with the material colours and 32 bit indices
+	if (keepMeshData) {
+
+		const DXVertexCompact *vertices = cookedMesh->getVertices();
+		XMCOLOR matDiffuse = material->getColour()->diffuse;
+		XMCOLOR matSpecular = material->getColour()->specular;
+
+		meshVertices.resize(header->numVertices);
+
+		for (uint32_t k = 0; k < header->numVertices; ++k)
+			meshVertices[k] = vertices[k].unpack(matDiffuse, matSpecular);
+
+		if (indexFormat == DXGI_FORMAT_R16_UINT) {
+
+			const uint16_t *indices = static_cast<const uint16_t*>(cookedMesh->getIndices());
+
+			meshIndices.assign(indices, indices + header->numIndices);
+		}
+		else {
+
+			const uint32_t *indices = static_cast<const uint32_t*>(cookedMesh->getIndices());
+
+			meshIndices.assign(indices, indices + header->numIndices);
+		}
+	}
+}
+
+// Write the packed mesh of the given source model to its cooked mesh file.  indices are in indexFormat.
+void Model::writeCookedMesh(const std::wstring& filename, const DXVertexCompact *vertices, const uint32_t numVertices, const void *indices, const uint32_t numIndices) {
+
+	CookedMesh::Header header;
+
+	ZeroMemory(&header, sizeof(CookedMesh::Header));
+
+	header.numMeshes = numMeshes;
+	header.numVertices = numVertices;
+	header.numIndices = numIndices;
+	header.indexStride = DXVertexCompact::indexStride(indexFormat);
+	header.boundsCentre[0] = boundsCentre.x;
+	header.boundsCentre[1] = boundsCentre.y;
+	header.boundsCentre[2] = boundsCentre.z;
+	header.boundsRadius = boundsRadius;
+
+	CookedMesh::getFileStamp(filename, &header.sourceSize, &header.sourceWriteTime);
+
+	vector<CookedMesh::SubMesh> meshes(numMeshes);
+
+	for (uint32_t i = 0; i < numMeshes; ++i) {
+
+		meshes[i].baseVertex = baseVertexOffset[i];
+		meshes[i].indexCount = indexCount[i];
 	}
+
+	wstring cookedFilename = filename + CookedMesh::Extension;
+
+	if (CookedMesh::write(cookedFilename, header, meshes.data(), vertices, indices))
+		wcout << L"Cooked " << filename << L" to " << cookedFilename << endl;
+	else
+		wcout << L"Cannot write " << cookedFilename << endl;
+}
+
+// Cook every model loaded from now on - the source is imported and the converted mesh written to its cooked mesh file (see CookedMesh)
+void Model::setCookModels(const bool enabled) {
+
+	cookModels = enabled;
+}
+
+bool Model::getCookModels() {
+
+	return cookModels;
+}
+
+// Spread the import of obj and 3ds models across the given pool.  The pool is retained until it is replaced - pass nullptr to release it and import on the calling thread.
+void Model::setImportPool(WorkerPool *pool) {
+
+	if (pool)
+		pool->retain();
+
+	if (importPool)
+		importPool->release();
+
+	importPool = pool;
 }
 
 
@@ -276,52 +592,144 @@ Model::~Model() {
 
 }
 
-//void Model::update(ID3D11DeviceContext *context) {
+//void Model::update(DXContext *context) {
 
-void Model::render(ID3D11DeviceContext *context) {
+UINT Model::getTextures(ID3D11ShaderResourceView **views, ID3D11SamplerState **_sampler) {
 
-	effect->bindPipeline(context);
+	if (!textureResourceViewArray[0] || !sampler)
+		return 0;
 
-	//// set  shaders for effect
-	context->VSSetShader(effect->getVertexShader(), 0, 0);
-	context->PSSetShader(effect->getPixelShader(), 0, 0);
+	for (int i = 0; i < Num_Textures; i++)
+		views[i] = textureResourceViewArray[i];
 
-	// Validate Model before rendering (see notes in constructor)
-	if (!context || !vertexBuffer || !indexBuffer || !effect)
-		return;
+	*_sampler = sampler;
+
+	return Num_Textures;
+}
+
+// Replace one of the additional textures (index 1 onwards) passed to the texture array constructor.  As with the constructor the view is not retained.
+void Model::setTexture(const int index, ID3D11ShaderResourceView *view) {
+
+	if (index > 0 && index < Num_Textures)
+		textureResourceViewArray[index] = view;
+}
+
+void Model::bindGeometry(DXContext *context) {
 
 	// Set vertex layout
 	context->IASetInputLayout(effect->getVSInputLayout());
 
 	// Set Model vertex and index buffers for IA
 	ID3D11Buffer* vertexBuffers[] = { vertexBuffer };
-	UINT vertexStrides[] = { sizeof(DXVertexExt) };
+	UINT vertexStrides[] = { sizeof(DXVertexCompact) };
 	UINT vertexOffsets[] = { 0 };
 
 	context->IASetVertexBuffers(0, 1, vertexBuffers, vertexStrides, vertexOffsets);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	context->IASetIndexBuffer(indexBuffer, indexFormat, 0);
 
 	// Set primitive topology for IA
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
 
+void Model::draw(DXContext *context) {
 
-	// Bind texture resource views and texture sampler objects to the PS stage of the pipeline
-	if (textureResourceViewArray[0] && sampler) {
+	// Draw Model
+	for (uint32_t indexOffset = 0, i = 0; i < numMeshes; indexOffset += indexCount[i], ++i)
+		context->DrawIndexed(indexCount[i], indexOffset, baseVertexOffset[i]);
+}
 
-		context->PSSetShaderResources(0, Num_Textures, textureResourceViewArray);
-		context->PSSetSamplers(0, 1, &sampler);
-	}
 
+// Instanced rendering
 
-	// Draw Model
+void Model::bindInstancedGeometry(DXContext *context, ID3D11InputLayout *instancedLayout, ID3D11Buffer *instanceBuffer) {
+
+	context->IASetInputLayout(instancedLayout);
+
+	// Model vertices in slot 0, instance data in slot 1
+	ID3D11Buffer* vertexBuffers[] = { vertexBuffer, instanceBuffer };
+	UINT vertexStrides[] = { sizeof(DXVertexCompact), sizeof(DXInstanceData) };
+	UINT vertexOffsets[] = { 0, 0 };
+
+	context->IASetVertexBuffers(0, 2, vertexBuffers, vertexStrides, vertexOffsets);
+	context->IASetIndexBuffer(indexBuffer, indexFormat, 0);
+
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+void Model::drawInstanced(DXContext *context, const DXInstanceRange &range) {
+
+	// One draw per sub-mesh for every instance in the range
 	for (uint32_t indexOffset = 0, i = 0; i < numMeshes; indexOffset += indexCount[i], ++i)
-		context->DrawIndexed(indexCount[i], indexOffset, baseVertexOffset[i]);
+		context->DrawIndexedInstanced(indexCount[i], range.numInstances, indexOffset, baseVertexOffset[i], range.firstInstance);
+}
+
+// Render the given range of the instance buffer with instancedEffect - binds the effect, textures and instanced geometry then issues the draw calls
+void Model::renderInstanced(DXContext *context, Effect *instancedEffect, ID3D11Buffer *instanceBuffer, const DXInstanceRange &range) {
+
+	if (!context || !vertexBuffer || !indexBuffer || !instancedEffect || !instanceBuffer || range.numInstances == 0)
+		return;
+
+	instancedEffect->bindPipeline(context);
+	bindTextures(context);
+	bindInstancedGeometry(context, instancedEffect->getVSInputLayout(), instanceBuffer);
+	drawInstanced(context, range);
+}
+
+// Return the model space bounding sphere of the model.  Returns false if the model has no geometry.
+bool Model::getBoundingSphere(XMFLOAT3 *centre, float *radius) {
+
+	*centre = boundsCentre;
+	*radius = boundsRadius;
+
+	return (vertexBuffer != nullptr);
+}
+
+// Return the diffuse and specular colours of the model's material
+void Model::getMaterialColours(XMFLOAT4 *diffuse, XMFLOAT4 *specular) {
+
+	XMStoreFloat4(diffuse, XMLoadColor(&material->getColour()->diffuse));
+	XMStoreFloat4(specular, XMLoadColor(&material->getColour()->specular));
+}
+
+
+// Sub-mesh layout and the CPU copy of the mesh data
+
+uint32_t Model::getMeshCount() {
+
+	return numMeshes;
+}
+
+uint32_t Model::getMeshIndexCount(const uint32_t mesh) {
+
+	return indexCount[mesh];
+}
+
+uint32_t Model::getMeshBaseVertex(const uint32_t mesh) {
+
+	return baseVertexOffset[mesh];
+}
+
+const vector<DXVertexExt>& Model::getMeshVertices() {
+
+	return meshVertices;
+}
+
+const vector<uint32_t>& Model::getMeshIndices() {
+
+	return meshIndices;
+}
+
+// Free the CPU copy of the mesh data once it is no longer needed
+void Model::releaseMeshData() {
+
+	vector<DXVertexExt>().swap(meshVertices);
+	vector<uint32_t>().swap(meshIndices);
 }
 
 
-//void Model::update(ID3D11DeviceContext *context) {
+//void Model::update(DXContext *context) {
 
-void Model::renderSimp(ID3D11DeviceContext *context) {
+void Model::renderSimp(DXContext *context) {
 
 
 
@@ -334,11 +742,11 @@ void Model::renderSimp(ID3D11DeviceContext *context) {
 
 	// Set Model vertex and index buffers for IA
 	ID3D11Buffer* vertexBuffers[] = { vertexBuffer };
-	UINT vertexStrides[] = { sizeof(DXVertexExt) };
+	UINT vertexStrides[] = { sizeof(DXVertexCompact) };
 	UINT vertexOffsets[] = { 0 };
 
 	context->IASetVertexBuffers(0, 1, vertexBuffers, vertexStrides, vertexOffsets);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	context->IASetIndexBuffer(indexBuffer, indexFormat, 0);
 
 	// Set primitive topology for IA
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -3,13 +3,16 @@
 // Model.h
 //
 
-// Version 1.  Encapsulate the mesh contents of a CGModel imported via CGImport3.  Currently supports obj, 3ds or gsf files.  md2, md3 and md5 (CGImport4) untested.  For version 1 a single texture and sampler interface are associated with the Model.
+// Version 1.  Encapsulate the mesh contents of an imported model.  Currently supports obj, 3ds (read by ModelImporter) or gsf (CGImport3) files.  md2, md3 and md5 (CGImport4) untested.  Imported meshes are reordered for the vertex cache, overdraw and vertex fetch (see MeshOptimizer) before upload and cooking, and uploaded as DXVertexCompact vertices with 16 bit indices when they fit.  For version 1 a single texture and sampler interface are associated with the Model.
 
 
 #pragma once
 #include <d3d11_2.h>
 #include <DirectXMath.h>
 #include <DXBaseModel.h>
+#include <DXInstanceBuffer.h>
+#include <DXVertexExt.h>
+#include <DXVertexCompact.h>
 #include <Animation.h>
 #include <string>
 #include <vector>
@@ -18,12 +21,13 @@
 class Texture;
 class Material;
 class Effect;
+class CookedMesh;
+class WorkerPool;
 
 
 class Model : public DXBaseModel {
 	Animation *animation= nullptr;
 	Material *material = nullptr;
-	Effect *effect = nullptr;
 
 	uint32_t							numMeshes = 0;
 	std::vector<uint32_t>				indexCount;
@@ -34,17 +38,76 @@ class Model : public DXBaseModel {
 	ID3D11ShaderResourceView			*textureResourceViewArray[8];
 	ID3D11SamplerState					*sampler = nullptr;
 	DirectX::XMMATRIX worldMatrix;
+
+	// Copy of the vertex and index data kept after the buffers are created if requested at load (see StaticBatchBuilder).  Indices are relative to the base vertex of their sub-mesh.
+	std::vector<DXVertexExt>			meshVertices;
+	std::vector<uint32_t>				meshIndices;
+
+	// Bounding sphere of the vertices in model space (computed by load)
+	DirectX::XMFLOAT3					boundsCentre;
+	float								boundsRadius = 0.0f;
+
+	// Import every model from its source and write its cooked mesh (see setCookModels())
+	static bool							cookModels;
+
+	// Pool the obj and 3ds importers parse on (see setImportPool())
+	static WorkerPool					*importPool;
+
+	// Load steps - each throws an exception on failure (see load)
+	void importModel(ID3D11Device *device, const std::wstring& filename, const bool keepMeshData);
+	void readNativeModel(const std::string& filename, std::vector<DXVertexExt> *vertices, std::vector<uint32_t> *indices);
+	void readCGModel(const std::wstring& filename, std::vector<DXVertexExt> *vertices, std::vector<uint32_t> *indices);
+	void optimizeMeshes(const std::wstring& filename, std::vector<DXVertexExt> *vertices, std::vector<uint32_t> *indices);
+	void createBuffers(ID3D11Device *device, const DXVertexCompact *vertices, const uint32_t numVertices, const void *indices, const uint32_t numIndices);
+	CookedMesh* openCookedMesh(const std::wstring& filename);
+	void loadCookedMesh(ID3D11Device *device, CookedMesh *cookedMesh, const bool keepMeshData);
+	void writeCookedMesh(const std::wstring& filename, const DXVertexCompact *vertices, const uint32_t numVertices, const void *indices, const uint32_t numIndices);
 public:
 
-	Model(ID3D11Device *device, Effect *_effect, const std::wstring& filename, ID3D11ShaderResourceView *tex_view, Material *_material);
-	Model(ID3D11Device *device, Effect *_effect, const std::wstring& filename, ID3D11ShaderResourceView *_tex_view_array[], int _num_textures, Material *_material);
+	// If keepMeshData is true a CPU copy of the vertex and index data is kept (see getMeshVertices / getMeshIndices)
+	Model(ID3D11Device *device, Effect *_effect, const std::wstring& filename, ID3D11ShaderResourceView *tex_view, Material *_material, const bool keepMeshData = false);
+	Model(ID3D11Device *device, Effect *_effect, const std::wstring& filename, ID3D11ShaderResourceView *_tex_view_array[], int _num_textures, Material *_material, const bool keepMeshData = false);
 
 	
 	~Model();
 	DirectX::XMMATRIX update(double time){ if (animation != nullptr)worldMatrix= animation->update(time); return worldMatrix; };
-	void load(ID3D11Device *device, Effect *_effect, const std::wstring& filename, ID3D11ShaderResourceView *tex_view, Material *_material);
-	void update(ID3D11DeviceContext *context, double time);
-	void render(ID3D11DeviceContext *context);
-	void renderSimp(ID3D11DeviceContext *context);
+	// Load the model's cooked mesh (see CookedMesh) if it is up to date, otherwise import filename
+	void load(ID3D11Device *device, Effect *_effect, const std::wstring& filename, ID3D11ShaderResourceView *tex_view, Material *_material, const bool keepMeshData = false);
+
+	// When enabled every model loaded is imported from its source and its cooked mesh is written next to it
+	static void setCookModels(const bool enabled);
+	static bool getCookModels();
+
+	// Parse obj and 3ds models loaded from now on across the given pool (nullptr to parse on the calling thread)
+	static void setImportPool(WorkerPool *pool);
+	void update(DXContext *context, double time);
+	UINT getTextures(ID3D11ShaderResourceView **views, ID3D11SamplerState **sampler);
+
+	// Replace one of the additional textures (index 1 onwards) passed to the texture array constructor.  As with the constructor the view is not retained.
+	void setTexture(const int index, ID3D11ShaderResourceView *view);
+	void bindGeometry(DXContext *context);
+	void draw(DXContext *context);
+
+	// Instanced rendering - the transforms of the per-object constants are replaced by a per-instance vertex stream (DXInstanceData) in slot 1 while the material colours are still read from the per-object constants.  instancedEffect must use a vertex shader and input layout that read the instance stream (see instancedCompactVertexDesc).
+	void bindInstancedGeometry(DXContext *context, ID3D11InputLayout *instancedLayout, ID3D11Buffer *instanceBuffer);
+	void drawInstanced(DXContext *context, const DXInstanceRange &range);
+	void renderInstanced(DXContext *context, Effect *instancedEffect, ID3D11Buffer *instanceBuffer, const DXInstanceRange &range);
+
+	// Return the model space bounding sphere of the model.  Returns false if the model has no geometry.
+	bool getBoundingSphere(DirectX::XMFLOAT3 *centre, float *radius);
+
+	// Return the diffuse and specular colours of the model's material
+	void getMaterialColours(DirectX::XMFLOAT4 *diffuse, DirectX::XMFLOAT4 *specular);
+
+	// Sub-mesh layout and the CPU copy of the mesh data.  The vectors are empty unless the model was loaded with keepMeshData.
+	uint32_t getMeshCount();
+	uint32_t getMeshIndexCount(const uint32_t mesh);
+	uint32_t getMeshBaseVertex(const uint32_t mesh);
+	const std::vector<DXVertexExt>& getMeshVertices();
+	const std::vector<uint32_t>& getMeshIndices();
+
+	// Free the CPU copy of the mesh data once it is no longer needed
+	void releaseMeshData();
+	void renderSimp(DXContext *context);
 	void setAnimation(Animation *newAnimation){ animation = newAnimation; };
 };
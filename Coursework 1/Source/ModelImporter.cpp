@@ -0,0 +1,1077 @@
+
+//
+// ModelImporter.cpp
+//
+
+#include <stdafx.h>
+#include <ModelImporter.h>
+#include <WorkerPool.h>
+#include <algorithm>
+#include <climits>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+using namespace std;
+
+
+// obj files are split into about 4 chunks per thread but no chunk is smaller than this
+static const size_t OBJMinChunkSize = 16 * 1024;
+
+// Face corner component with no index (v/vt/vn)
+static const int32_t NoIndex = INT_MIN;
+
+// 3ds chunk identifiers.  Only the chunks leading to triangle mesh data and the smoothing groups of the faces are read - materials, keyframes and the local matrix (3ds vertices are stored in world space) are skipped.
+static const uint16_t Chunk3DSMain = 0x4D4D;
+static const uint16_t Chunk3DSEditor = 0x3D3D;
+static const uint16_t Chunk3DSObject = 0x4000;
+static const uint16_t Chunk3DSTriMesh = 0x4100;
+static const uint16_t Chunk3DSVertices = 0x4110;
+static const uint16_t Chunk3DSFaces = 0x4120;
+static const uint16_t Chunk3DSTexCoords = 0x4140;
+static const uint16_t Chunk3DSSmoothing = 0x4150;
+
+
+// Parsed contents of one line aligned chunk of an obj file.  Positive indices are converted to 0-based file indices as they are read.  Negative (relative) indices can only be resolved once the number of elements in the preceding chunks is known so they are stored relative to the start of the chunk and flagged.
+struct OBJChunk {
+
+	const char							*begin;
+	const char							*end;
+
+	std::vector<float>					positions; // 3 floats per position
+	std::vector<float>					texCoords; // 2 floats per texture coordinate
+	std::vector<float>					normals; // 3 floats per normal
+
+	// 3 corners per triangle and v, vt, vn per corner
+	std::vector<int32_t>				corners;
+
+	// Bit c of each entry is set if component c of the corner is relative to the chunk
+	std::vector<uint8_t>				relative;
+
+	// Chunk triangle index at which each g or o statement starts a new sub-mesh
+	std::vector<uint32_t>				groupStarts;
+
+	bool								valid = true;
+};
+
+// Vertices and indices of one sub-mesh, built in parallel with the others before they are joined
+struct ModelImporter::MeshData {
+
+	std::vector<Vertex>					vertices;
+	std::vector<uint32_t>				indices;
+};
+
+// Hash map key of three 32 bit values - the v/vt/vn indices of an obj face corner or the bits of a 3ds vertex position
+struct TripleKey {
+
+	int32_t								a, b, c;
+
+	bool operator==(const TripleKey &key) const {
+
+		return a == key.a && b == key.b && c == key.c;
+	}
+};
+
+struct TripleKeyHash {
+
+	size_t operator()(const TripleKey &key) const {
+
+		return (size_t)(uint32_t)key.a * 73856093u ^ (size_t)(uint32_t)key.b * 19349663u ^ (size_t)(uint32_t)key.c * 83492791u;
+	}
+};
+
+
+//
+// Text parsing
+//
+
+static const char* skipSpace(const char *p) {
+
+	while (*p == ' ' || *p == '\t')
+		++p;
+
+	return p;
+}
+
+static bool isDigit(const char c) {
+
+	return c >= '0' && c <= '9';
+}
+
+// Parse a decimal number with optional sign, fraction and exponent.  strtod is avoided as it is locale dependent and much slower.
+static const char* parseFloat(const char *p, float *value) {
+
+	p = skipSpace(p);
+
+	bool negative = (*p == '-');
+
+	if (*p == '-' || *p == '+')
+		++p;
+
+	double result = 0.0;
+
+	while (isDigit(*p))
+		result = result * 10.0 + (*p++ - '0');
+
+	if (*p == '.') {
+
+		double fraction = 0.0;
+		double divisor = 1.0;
+
+		for (++p; isDigit(*p); ++p) {
+
+			fraction = fraction * 10.0 + (*p - '0');
+			divisor *= 10.0;
+		}
+
+		result += fraction / divisor;
+	}
+
+	if (*p == 'e' || *p == 'E') {
+
+		++p;
+
+		bool negativeExponent = (*p == '-');
+
+		if (*p == '-' || *p == '+')
+			++p;
+
+		int exponent = 0;
+
+		while (isDigit(*p))
+			exponent = exponent * 10 + (*p++ - '0');
+
+		result *= pow(10.0, negativeExponent ? -exponent : exponent);
+	}
+
+	*value = (float)(negative ? -result : result);
+
+	return p;
+}
+
+// Parse a signed integer.  Returns 0 (not a valid obj index) if there are no digits.
+static const char* parseIndex(const char *p, int32_t *value) {
+
+	bool negative = (*p == '-');
+
+	if (negative)
+		++p;
+
+	int32_t result = 0;
+
+	while (isDigit(*p))
+		result = result * 10 + (*p++ - '0');
+
+	*value = negative ? -result : result;
+
+	return p;
+}
+
+
+//
+// Shared mesh building
+//
+
+// Set the normal of each vertex flagged in needsNormal to the average of the normals of the faces sharing its position.  positionSlot maps each vertex to its position (slots 0 to numSlots - 1).  Works on the converted vertices and reversed triangles, whose face normals are the converted source face normals.
+void ModelImporter::averageFaceNormals(MeshData *mesh, const vector<uint32_t> &positionSlot, const uint32_t numSlots, const vector<uint8_t> &needsNormal) {
+
+	vector<float> slotNormals(numSlots * 3, 0.0f);
+
+	for (size_t i = 0; i + 2 < mesh->indices.size(); i += 3) {
+
+		const float *p0 = mesh->vertices[mesh->indices[i]].pos;
+		const float *p1 = mesh->vertices[mesh->indices[i + 1]].pos;
+		const float *p2 = mesh->vertices[mesh->indices[i + 2]].pos;
+
+		float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+
+		float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+		// Degenerate triangles have no normal to contribute
+		if (length <= 0.0f)
+			continue;
+
+		for (int k = 0; k < 3; ++k) {
+
+			float *slotNormal = &slotNormals[positionSlot[mesh->indices[i + k]] * 3];
+
+			slotNormal[0] += n[0] / length;
+			slotNormal[1] += n[1] / length;
+			slotNormal[2] += n[2] / length;
+		}
+	}
+
+	for (size_t v = 0; v < mesh->vertices.size(); ++v) {
+
+		if (!needsNormal[v])
+			continue;
+
+		const float *slotNormal = &slotNormals[positionSlot[v] * 3];
+		float length = sqrtf(slotNormal[0] * slotNormal[0] + slotNormal[1] * slotNormal[1] + slotNormal[2] * slotNormal[2]);
+		float *normal = mesh->vertices[v].normal;
+
+		if (length > 0.0f) {
+
+			normal[0] = slotNormal[0] / length;
+			normal[1] = slotNormal[1] / length;
+			normal[2] = slotNormal[2] / length;
+		}
+		else {
+
+			normal[0] = 0.0f;
+			normal[1] = 1.0f;
+			normal[2] = 0.0f;
+		}
+	}
+}
+
+// Set the normals of a mesh with 3ds smoothing groups.  faceGroups holds the group mask of each triangle.  The normal at each corner is the average of the normals of the faces sharing its position whose masks share a bit with the mask of the corner's face, and the corners of faces in no group (mask 0) take the face normal.  A vertex whose corners need different normals is split - the first normal is kept by the vertex and a copy of the vertex is appended for each different normal.
+void ModelImporter::smoothingGroupNormals(MeshData *mesh, const vector<uint32_t> &positionSlot, const uint32_t numSlots, const vector<uint32_t> &faceGroups) {
+
+	size_t numFaces = mesh->indices.size() / 3;
+	size_t numSourceVertices = mesh->vertices.size();
+
+	vector<float> faceNormals(numFaces * 3, 0.0f);
+
+	// Faces sharing each position in face order - the faces of slot s are slotFaces[slotStart[s]] to slotFaces[slotStart[s + 1] - 1]
+	vector<uint32_t> slotStart(numSlots + 1, 0);
+	vector<uint32_t> slotFaces(numFaces * 3);
+
+	for (size_t f = 0; f < numFaces; ++f) {
+
+		const float *p0 = mesh->vertices[mesh->indices[f * 3]].pos;
+		const float *p1 = mesh->vertices[mesh->indices[f * 3 + 1]].pos;
+		const float *p2 = mesh->vertices[mesh->indices[f * 3 + 2]].pos;
+
+		float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+		float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+		float n[3] = { e1[1] * e2[2] - e1[2] * e2[1], e1[2] * e2[0] - e1[0] * e2[2], e1[0] * e2[1] - e1[1] * e2[0] };
+
+		float length = sqrtf(n[0] * n[0] + n[1] * n[1] + n[2] * n[2]);
+
+		// Degenerate triangles have no normal to contribute
+		if (length > 0.0f) {
+
+			faceNormals[f * 3] = n[0] / length;
+			faceNormals[f * 3 + 1] = n[1] / length;
+			faceNormals[f * 3 + 2] = n[2] / length;
+		}
+
+		for (int k = 0; k < 3; ++k)
+			slotStart[positionSlot[mesh->indices[f * 3 + k]] + 1]++;
+	}
+
+	for (uint32_t s = 0; s < numSlots; ++s)
+		slotStart[s + 1] += slotStart[s];
+
+	vector<uint32_t> slotEnd(slotStart.begin(), slotStart.end() - 1);
+
+	for (size_t f = 0; f < numFaces; ++f)
+		for (int k = 0; k < 3; ++k)
+			slotFaces[slotEnd[positionSlot[mesh->indices[f * 3 + k]]]++] = (uint32_t)f;
+
+	// Vertex used for each source vertex and mask.  The corners of a source vertex in faces with the same mask share a normal, the corners in faces with mask 0 each have their own.
+	unordered_map<TripleKey, uint32_t, TripleKeyHash> cornerVertices;
+	vector<uint8_t> vertexUsed(numSourceVertices, 0);
+
+	// The copies of each vertex with a different normal are chained from the vertex
+	const uint32_t NoCopy = UINT32_MAX;
+	vector<uint32_t> nextCopy(numSourceVertices, NoCopy);
+
+	for (size_t f = 0; f < numFaces; ++f) {
+
+		uint32_t group = faceGroups[f];
+
+		for (int k = 0; k < 3; ++k) {
+
+			uint32_t v = mesh->indices[f * 3 + k];
+			TripleKey key = { (int32_t)v, (int32_t)group, (group) ? -1 : (int32_t)f };
+
+			auto corner = cornerVertices.insert(make_pair(key, v));
+
+			if (corner.second) {
+
+				float normal[3] = { 0.0f, 0.0f, 0.0f };
+
+				if (group == 0) {
+
+					normal[0] = faceNormals[f * 3];
+					normal[1] = faceNormals[f * 3 + 1];
+					normal[2] = faceNormals[f * 3 + 2];
+				}
+				else {
+
+					uint32_t slot = positionSlot[v];
+
+					for (uint32_t i = slotStart[slot]; i < slotStart[slot + 1]; ++i) {
+
+						uint32_t face = slotFaces[i];
+
+						if (faceGroups[face] & group) {
+
+							normal[0] += faceNormals[face * 3];
+							normal[1] += faceNormals[face * 3 + 1];
+							normal[2] += faceNormals[face * 3 + 2];
+						}
+					}
+				}
+
+				float length = sqrtf(normal[0] * normal[0] + normal[1] * normal[1] + normal[2] * normal[2]);
+
+				if (length > 0.0f) {
+
+					normal[0] /= length;
+					normal[1] /= length;
+					normal[2] /= length;
+				}
+				else {
+
+					normal[0] = 0.0f;
+					normal[1] = 1.0f;
+					normal[2] = 0.0f;
+				}
+
+				if (vertexUsed[v]) {
+
+					// Reuse the vertex or a copy of it if one already has the normal (when different masks give the same faces)
+					uint32_t match = v;
+
+					while (match != NoCopy && memcmp(mesh->vertices[match].normal, normal, sizeof(normal)) != 0)
+						match = nextCopy[match];
+
+					if (match == NoCopy) {
+
+						Vertex split = mesh->vertices[v];
+
+						match = (uint32_t)mesh->vertices.size();
+						mesh->vertices.push_back(split);
+
+						nextCopy.push_back(nextCopy[v]);
+						nextCopy[v] = match;
+					}
+
+					corner.first->second = match;
+				}
+
+				vertexUsed[v] = 1;
+				memcpy(mesh->vertices[corner.first->second].normal, normal, sizeof(normal));
+			}
+
+			mesh->indices[f * 3 + k] = corner.first->second;
+		}
+	}
+
+	// Vertices no face references have no normal
+	for (size_t v = 0; v < numSourceVertices; ++v) {
+
+		if (!vertexUsed[v]) {
+
+			mesh->vertices[v].normal[0] = 0.0f;
+			mesh->vertices[v].normal[1] = 1.0f;
+			mesh->vertices[v].normal[2] = 0.0f;
+		}
+	}
+}
+
+
+// If _pool is not null it is retained and used for all parsing
+ModelImporter::ModelImporter(WorkerPool *_pool) {
+
+	pool = _pool;
+
+	if (pool)
+		pool->retain();
+}
+
+ModelImporter::~ModelImporter() {
+
+	if (pool)
+		pool->release();
+}
+
+
+// Call body(i) for i in [0, count) across the pool
+void ModelImporter::parallelFor(const int count, const function<void(int)> &body) {
+
+	if (pool && count > 1)
+		pool->parallelFor(count, body);
+	else
+		for (int i = 0; i < count; ++i)
+			body(i);
+}
+
+// Return true if filename has an extension the importer reads (.obj or .3ds in any case)
+bool ModelImporter::isSupported(const string &filename) {
+
+	if (filename.length() < 4)
+		return false;
+
+	string ext = filename.substr(filename.length() - 4);
+
+	transform(ext.begin(), ext.end(), ext.begin(), [](char c) { return (char)tolower(c); });
+
+	return ext == ".obj" || ext == ".3ds";
+}
+
+// Import the given file, replacing any previous contents.  Returns false and sets the error message if the file cannot be read or holds no triangles.
+bool ModelImporter::import(const string &filename) {
+
+	vertices.clear();
+	indices.clear();
+	meshes.clear();
+	error.clear();
+
+	if (!isSupported(filename)) {
+
+		error = "Object file format not supported";
+		return false;
+	}
+
+	vector<char> data;
+
+	if (!readFile(filename, &data))
+		return false;
+
+	string ext = filename.substr(filename.length() - 4);
+	bool parsed = (ext[1] == 'o' || ext[1] == 'O') ? parseOBJ(data) : parse3DS(data);
+
+	if (!parsed)
+		return false;
+
+	if (indices.empty()) {
+
+		error = "Model holds no triangles";
+		return false;
+	}
+
+	return true;
+}
+
+// Read the whole file into data followed by a terminating 0 so the text parsers never need to check for the end of the buffer
+bool ModelImporter::readFile(const string &filename, vector<char> *data) {
+
+	string path = filename;
+
+#ifndef _WIN32
+	// Model paths are written with Windows separators
+	replace(path.begin(), path.end(), '\\', '/');
+#endif
+
+	FILE *file = fopen(path.c_str(), "rb");
+
+	if (!file) {
+
+		error = "Cannot open " + filename;
+		return false;
+	}
+
+	fseek(file, 0, SEEK_END);
+	long size = ftell(file);
+	fseek(file, 0, SEEK_SET);
+
+	bool read = size >= 0;
+
+	if (read) {
+
+		data->resize((size_t)size + 1);
+		read = fread(data->data(), 1, (size_t)size, file) == (size_t)size;
+		data->back() = 0;
+	}
+
+	fclose(file);
+
+	if (!read)
+		error = "Cannot read " + filename;
+
+	return read;
+}
+
+// Parse an obj file.  The chunks are parsed in parallel, their elements joined and relative indices resolved, then each sub-mesh is built in parallel by giving every distinct v/vt/vn corner its own vertex.
+bool ModelImporter::parseOBJ(const vector<char> &data) {
+
+	const char *text = data.data();
+	size_t length = data.size() - 1;
+
+	// Split the file at line ends
+	int concurrency = pool ? pool->getConcurrency() : 1;
+	size_t numChunks = max<size_t>(min(length / OBJMinChunkSize, (size_t)concurrency * 4), 1);
+
+	vector<OBJChunk> chunks(numChunks);
+	const char *chunkBegin = text;
+
+	for (size_t c = 0; c < numChunks; ++c) {
+
+		const char *chunkEnd = text + length * (c + 1) / numChunks;
+
+		if (chunkEnd < chunkBegin)
+			chunkEnd = chunkBegin;
+
+		while (chunkEnd < text + length && *chunkEnd != '\n')
+			++chunkEnd;
+
+		if (chunkEnd < text + length)
+			++chunkEnd;
+
+		chunks[c].begin = chunkBegin;
+		chunks[c].end = chunkEnd;
+		chunkBegin = chunkEnd;
+	}
+
+	parallelFor((int)numChunks, [&](int c) {
+
+		OBJChunk &chunk = chunks[c];
+
+		// Face corners of the current polygon (v, vt, vn and the relative flags)
+		vector<int32_t> polygon;
+		vector<uint8_t> polygonRelative;
+
+		const char *line = chunk.begin;
+
+		while (line < chunk.end) {
+
+			const char *lineEnd = static_cast<const char*>(memchr(line, '\n', chunk.end - line));
+
+			if (!lineEnd)
+				lineEnd = chunk.end;
+
+			const char *p = skipSpace(line);
+
+			if (p[0] == 'v' && (p[1] == ' ' || p[1] == '\t')) {
+
+				float position[3];
+
+				p = parseFloat(p + 1, &position[0]);
+				p = parseFloat(p, &position[1]);
+				parseFloat(p, &position[2]);
+
+				chunk.positions.insert(chunk.positions.end(), position, position + 3);
+			}
+			else if (p[0] == 'v' && p[1] == 't') {
+
+				float texCoord[2];
+
+				p = parseFloat(p + 2, &texCoord[0]);
+				parseFloat(p, &texCoord[1]);
+
+				chunk.texCoords.insert(chunk.texCoords.end(), texCoord, texCoord + 2);
+			}
+			else if (p[0] == 'v' && p[1] == 'n') {
+
+				float normal[3];
+
+				p = parseFloat(p + 2, &normal[0]);
+				p = parseFloat(p, &normal[1]);
+				parseFloat(p, &normal[2]);
+
+				chunk.normals.insert(chunk.normals.end(), normal, normal + 3);
+			}
+			else if (p[0] == 'f' && (p[1] == ' ' || p[1] == '\t')) {
+
+				int32_t counts[3] = { (int32_t)chunk.positions.size() / 3, (int32_t)chunk.texCoords.size() / 2, (int32_t)chunk.normals.size() / 3 };
+
+				polygon.clear();
+				polygonRelative.clear();
+
+				p = skipSpace(p + 1);
+
+				while (p < lineEnd && (isDigit(*p) || *p == '-')) {
+
+					int32_t corner[3] = { NoIndex, NoIndex, NoIndex };
+					uint8_t relative = 0;
+
+					for (int k = 0; k < 3; ++k) {
+
+						if (k > 0) {
+
+							if (*p != '/')
+								break;
+
+							++p;
+						}
+
+						int32_t index;
+						const char *indexEnd = parseIndex(p, &index);
+
+						if (indexEnd == p)
+							continue;
+
+						p = indexEnd;
+
+						if (index > 0)
+							corner[k] = index - 1;
+						else if (index < 0) {
+
+							corner[k] = counts[k] + index;
+							relative |= 1 << k;
+						}
+						else
+							chunk.valid = false;
+					}
+
+					if (corner[0] == NoIndex)
+						chunk.valid = false;
+
+					polygon.insert(polygon.end(), corner, corner + 3);
+					polygonRelative.push_back(relative);
+
+					// Skip anything else in the token
+					while (*p && *p != ' ' && *p != '\t' && *p != '\r' && *p != '\n')
+						++p;
+
+					p = skipSpace(p);
+				}
+
+				// Triangulate the polygon as a fan around its first corner
+				for (size_t k = 2; k < polygonRelative.size(); ++k) {
+
+					size_t fan[3] = { 0, k - 1, k };
+
+					for (int f = 0; f < 3; ++f) {
+
+						chunk.corners.insert(chunk.corners.end(), &polygon[fan[f] * 3], &polygon[fan[f] * 3] + 3);
+						chunk.relative.push_back(polygonRelative[fan[f]]);
+					}
+				}
+			}
+			else if ((p[0] == 'g' || p[0] == 'o') && (p[1] == ' ' || p[1] == '\t' || p[1] == '\r' || p[1] == '\n' || p[1] == 0))
+				chunk.groupStarts.push_back((uint32_t)(chunk.relative.size() / 3));
+
+			line = lineEnd + 1;
+		}
+	});
+
+	// Join the chunks' elements and triangles
+	vector<size_t> positionBase(numChunks), texCoordBase(numChunks), normalBase(numChunks), cornerBase(numChunks);
+	size_t numPositions = 0, numTexCoords = 0, numNormals = 0, numCorners = 0;
+	vector<uint32_t> meshStarts(1, 0);
+
+	for (size_t c = 0; c < numChunks; ++c) {
+
+		if (!chunks[c].valid) {
+
+			error = "Invalid face in obj file";
+			return false;
+		}
+
+		positionBase[c] = numPositions;
+		texCoordBase[c] = numTexCoords;
+		normalBase[c] = numNormals;
+		cornerBase[c] = numCorners;
+
+		for (size_t g = 0; g < chunks[c].groupStarts.size(); ++g)
+			meshStarts.push_back((uint32_t)(numCorners / 3) + chunks[c].groupStarts[g]);
+
+		numPositions += chunks[c].positions.size() / 3;
+		numTexCoords += chunks[c].texCoords.size() / 2;
+		numNormals += chunks[c].normals.size() / 3;
+		numCorners += chunks[c].relative.size();
+	}
+
+	meshStarts.push_back((uint32_t)(numCorners / 3));
+
+	vector<float> positions(numPositions * 3), texCoords(numTexCoords * 2), normals(numNormals * 3);
+	vector<int32_t> corners(numCorners * 3);
+	vector<uint8_t> chunkValid(numChunks, 1);
+
+	parallelFor((int)numChunks, [&](int c) {
+
+		OBJChunk &chunk = chunks[c];
+
+		copy(chunk.positions.begin(), chunk.positions.end(), positions.begin() + positionBase[c] * 3);
+		copy(chunk.texCoords.begin(), chunk.texCoords.end(), texCoords.begin() + texCoordBase[c] * 2);
+		copy(chunk.normals.begin(), chunk.normals.end(), normals.begin() + normalBase[c] * 3);
+
+		const int64_t bases[3] = { (int64_t)positionBase[c], (int64_t)texCoordBase[c], (int64_t)normalBase[c] };
+		const int64_t counts[3] = { (int64_t)numPositions, (int64_t)numTexCoords, (int64_t)numNormals };
+
+		for (size_t i = 0; i < chunk.relative.size(); ++i) {
+
+			int32_t *corner = &corners[(cornerBase[c] + i) * 3];
+
+			for (int k = 0; k < 3; ++k) {
+
+				int64_t index = chunk.corners[i * 3 + k];
+
+				if (index != NoIndex) {
+
+					if (chunk.relative[i] & (1 << k))
+						index += bases[k];
+
+					if (index < 0 || index >= counts[k])
+						chunkValid[c] = 0;
+				}
+
+				corner[k] = (int32_t)index;
+			}
+		}
+
+		// The chunk's parsed data is no longer needed
+		vector<float>().swap(chunk.positions);
+		vector<float>().swap(chunk.texCoords);
+		vector<float>().swap(chunk.normals);
+		vector<int32_t>().swap(chunk.corners);
+	});
+
+	if (find(chunkValid.begin(), chunkValid.end(), 0) != chunkValid.end()) {
+
+		error = "Face index out of range in obj file";
+		return false;
+	}
+
+	// Build the sub-meshes
+	vector<MeshData> meshData(meshStarts.size() - 1);
+
+	parallelFor((int)meshData.size(), [&](int m) {
+
+		MeshData &mesh = meshData[m];
+		uint32_t firstTriangle = meshStarts[m];
+		uint32_t numTriangles = meshStarts[m + 1] - firstTriangle;
+
+		if (numTriangles == 0)
+			return;
+
+		unordered_map<TripleKey, uint32_t, TripleKeyHash> vertexMap;
+		unordered_map<int32_t, uint32_t> positionMap;
+		vector<uint32_t> positionSlot;
+		vector<uint8_t> needsNormal;
+		bool missingNormals = false;
+
+		vertexMap.reserve(numTriangles * 2);
+		mesh.indices.resize(numTriangles * 3);
+
+		for (uint32_t i = 0; i < numTriangles * 3; ++i) {
+
+			const int32_t *corner = &corners[((size_t)firstTriangle * 3 + i) * 3];
+			TripleKey key = { corner[0], corner[1], corner[2] };
+
+			auto inserted = vertexMap.insert(make_pair(key, (uint32_t)mesh.vertices.size()));
+
+			if (inserted.second) {
+
+				Vertex vertex;
+				const float *pos = &positions[(size_t)key.a * 3];
+
+				// Mirror x for the left-handed frame and flip t
+				vertex.pos[0] = -pos[0];
+				vertex.pos[1] = pos[1];
+				vertex.pos[2] = pos[2];
+
+				if (key.c != NoIndex) {
+
+					const float *normal = &normals[(size_t)key.c * 3];
+
+					vertex.normal[0] = -normal[0];
+					vertex.normal[1] = normal[1];
+					vertex.normal[2] = normal[2];
+				}
+				else
+					missingNormals = true;
+
+				if (key.b != NoIndex) {
+
+					vertex.texCoord[0] = texCoords[(size_t)key.b * 2];
+					vertex.texCoord[1] = 1.0f - texCoords[(size_t)key.b * 2 + 1];
+				}
+				else {
+
+					vertex.texCoord[0] = 0.0f;
+					vertex.texCoord[1] = 0.0f;
+				}
+
+				auto slot = positionMap.insert(make_pair(key.a, (uint32_t)positionMap.size()));
+
+				positionSlot.push_back(slot.first->second);
+				needsNormal.push_back(key.c == NoIndex);
+				mesh.vertices.push_back(vertex);
+			}
+
+			// Reverse the winding of each triangle
+			uint32_t triangleCorner = i % 3;
+
+			mesh.indices[i - triangleCorner + (2 - triangleCorner)] = inserted.first->second;
+		}
+
+		if (missingNormals)
+			averageFaceNormals(&mesh, positionSlot, (uint32_t)positionMap.size(), needsNormal);
+	});
+
+	joinMeshes(meshData);
+
+	return true;
+}
+
+// Parse a 3ds file.  The chunk tree is walked on the calling thread to find the triangle meshes, which are then converted in parallel straight from the file data.
+bool ModelImporter::parse3DS(const vector<char> &data) {
+
+	// Location of a triangle mesh's data in the file
+	struct TriMesh {
+
+		const uint8_t					*vertexData = nullptr;
+		uint32_t						numVertices = 0;
+		const uint8_t					*faceData = nullptr;
+		uint32_t						numFaces = 0;
+		const uint8_t					*texCoordData = nullptr;
+		uint32_t						numTexCoords = 0;
+		const uint8_t					*smoothingData = nullptr; // a 32 bit group mask per face
+	};
+
+	vector<TriMesh> triMeshes;
+
+	// Walk the chunks in [p, end) descending into those that lead to triangle mesh data
+	function<void(const uint8_t*, const uint8_t*)> walkChunks = [&](const uint8_t *p, const uint8_t *end) {
+
+		while (end - p >= 6) {
+
+			uint16_t id;
+			uint32_t length;
+
+			memcpy(&id, p, sizeof(uint16_t));
+			memcpy(&length, p + 2, sizeof(uint32_t));
+
+			// Stop at a truncated or corrupt chunk
+			if (length < 6 || length > (size_t)(end - p))
+				return;
+
+			const uint8_t *body = p + 6;
+			const uint8_t *chunkEnd = p + length;
+			uint16_t count = 0;
+
+			if (chunkEnd - body >= 2)
+				memcpy(&count, body, sizeof(uint16_t));
+
+			switch (id) {
+
+			case Chunk3DSMain:
+			case Chunk3DSEditor:
+				walkChunks(body, chunkEnd);
+				break;
+
+			case Chunk3DSObject: {
+
+				// The object name is followed by the object's chunks
+				const uint8_t *nameEnd = static_cast<const uint8_t*>(memchr(body, 0, chunkEnd - body));
+
+				if (nameEnd)
+					walkChunks(nameEnd + 1, chunkEnd);
+
+				break;
+			}
+
+			case Chunk3DSTriMesh:
+				triMeshes.push_back(TriMesh());
+				walkChunks(body, chunkEnd);
+				break;
+
+			case Chunk3DSVertices:
+				if (!triMeshes.empty() && (size_t)(chunkEnd - body) >= 2 + count * 12u) {
+
+					triMeshes.back().vertexData = body + 2;
+					triMeshes.back().numVertices = count;
+				}
+				break;
+
+			case Chunk3DSFaces:
+				if (!triMeshes.empty() && (size_t)(chunkEnd - body) >= 2 + count * 8u) {
+
+					triMeshes.back().faceData = body + 2;
+					triMeshes.back().numFaces = count;
+
+					// The face list is followed by the face material and smoothing group chunks
+					walkChunks(body + 2 + count * 8u, chunkEnd);
+				}
+				break;
+
+			case Chunk3DSSmoothing:
+				if (!triMeshes.empty() && triMeshes.back().faceData && (size_t)(chunkEnd - body) >= triMeshes.back().numFaces * 4u)
+					triMeshes.back().smoothingData = body;
+				break;
+
+			case Chunk3DSTexCoords:
+				if (!triMeshes.empty() && (size_t)(chunkEnd - body) >= 2 + count * 8u) {
+
+					triMeshes.back().texCoordData = body + 2;
+					triMeshes.back().numTexCoords = count;
+				}
+				break;
+			}
+
+			p = chunkEnd;
+		}
+	};
+
+	const uint8_t *fileData = reinterpret_cast<const uint8_t*>(data.data());
+
+	walkChunks(fileData, fileData + data.size() - 1);
+
+	if (triMeshes.empty()) {
+
+		error = "No triangle meshes in 3ds file";
+		return false;
+	}
+
+	vector<MeshData> meshData(triMeshes.size());
+
+	parallelFor((int)meshData.size(), [&](int m) {
+
+		const TriMesh &triMesh = triMeshes[m];
+		MeshData &mesh = meshData[m];
+
+		if (triMesh.numVertices == 0 || triMesh.numFaces == 0)
+			return;
+
+		bool hasTexCoords = triMesh.texCoordData && triMesh.numTexCoords == triMesh.numVertices;
+
+		mesh.vertices.resize(triMesh.numVertices);
+
+		// 3ds files are z-up - turn them y-up then mirror x for the left-handed frame and flip t
+		for (uint32_t v = 0; v < triMesh.numVertices; ++v) {
+
+			float pos[3];
+
+			memcpy(pos, triMesh.vertexData + v * 12, sizeof(pos));
+
+			Vertex &vertex = mesh.vertices[v];
+
+			vertex.pos[0] = -pos[0];
+			vertex.pos[1] = pos[2];
+			vertex.pos[2] = -pos[1];
+
+			if (hasTexCoords) {
+
+				float texCoord[2];
+
+				memcpy(texCoord, triMesh.texCoordData + v * 8, sizeof(texCoord));
+
+				vertex.texCoord[0] = texCoord[0];
+				vertex.texCoord[1] = 1.0f - texCoord[1];
+			}
+			else {
+
+				vertex.texCoord[0] = 0.0f;
+				vertex.texCoord[1] = 0.0f;
+			}
+		}
+
+		// Faces are 3 vertex indices and a flags word - faces referencing missing vertices are dropped.  The smoothing group mask of each face kept is read alongside.
+		vector<uint32_t> faceGroups;
+
+		mesh.indices.reserve(triMesh.numFaces * 3);
+
+		for (uint32_t f = 0; f < triMesh.numFaces; ++f) {
+
+			uint16_t face[4];
+
+			memcpy(face, triMesh.faceData + f * 8, sizeof(face));
+
+			if (face[0] >= triMesh.numVertices || face[1] >= triMesh.numVertices || face[2] >= triMesh.numVertices)
+				continue;
+
+			mesh.indices.push_back(face[2]);
+			mesh.indices.push_back(face[1]);
+			mesh.indices.push_back(face[0]);
+
+			if (triMesh.smoothingData) {
+
+				uint32_t group;
+
+				memcpy(&group, triMesh.smoothingData + f * 4, sizeof(uint32_t));
+				faceGroups.push_back(group);
+			}
+		}
+
+		// 3ds files hold no normals.  Vertices split at texture seams share the position of the vertices they were split from, so positions are matched exactly to smooth across the seams.  Meshes without smoothing groups are smoothed across every face.
+		unordered_map<TripleKey, uint32_t, TripleKeyHash> positionMap;
+		vector<uint32_t> positionSlot(triMesh.numVertices);
+
+		for (uint32_t v = 0; v < triMesh.numVertices; ++v) {
+
+			TripleKey key;
+
+			memcpy(&key, triMesh.vertexData + v * 12, sizeof(key));
+
+			auto slot = positionMap.insert(make_pair(key, (uint32_t)positionMap.size()));
+
+			positionSlot[v] = slot.first->second;
+		}
+
+		if (triMesh.smoothingData)
+			smoothingGroupNormals(&mesh, positionSlot, (uint32_t)positionMap.size(), faceGroups);
+		else
+			averageFaceNormals(&mesh, positionSlot, (uint32_t)positionMap.size(), vector<uint8_t>(triMesh.numVertices, 1));
+	});
+
+	joinMeshes(meshData);
+
+	return true;
+}
+
+// Append the non-empty sub-meshes to the vertices, indices and mesh table
+void ModelImporter::joinMeshes(vector<MeshData> &meshData) {
+
+	vector<size_t> indexBase(meshData.size());
+	uint32_t numVertices = 0;
+	size_t numIndices = 0;
+
+	for (size_t m = 0; m < meshData.size(); ++m) {
+
+		indexBase[m] = numIndices;
+
+		if (meshData[m].indices.empty())
+			continue;
+
+		Mesh mesh = { numVertices, (uint32_t)meshData[m].indices.size() };
+
+		meshes.push_back(mesh);
+
+		numVertices += (uint32_t)meshData[m].vertices.size();
+		numIndices += meshData[m].indices.size();
+	}
+
+	vertices.resize(numVertices);
+	indices.resize(numIndices);
+
+	vector<uint32_t> vertexBase(meshData.size());
+
+	for (size_t m = 0, v = 0; m < meshData.size(); ++m) {
+
+		vertexBase[m] = (uint32_t)v;
+
+		if (!meshData[m].indices.empty())
+			v += meshData[m].vertices.size();
+	}
+
+	parallelFor((int)meshData.size(), [&](int m) {
+
+		if (meshData[m].indices.empty())
+			return;
+
+		copy(meshData[m].vertices.begin(), meshData[m].vertices.end(), vertices.begin() + vertexBase[m]);
+		copy(meshData[m].indices.begin(), meshData[m].indices.end(), indices.begin() + indexBase[m]);
+	});
+}
+
+
+// Accessor methods
+const vector<ModelImporter::Vertex>& ModelImporter::getVertices() const {
+
+	return vertices;
+}
+
+const vector<uint32_t>& ModelImporter::getIndices() const {
+
+	return indices;
+}
+
+const vector<ModelImporter::Mesh>& ModelImporter::getMeshes() const {
+
+	return meshes;
+}
+
+const string& ModelImporter::getError() const {
+
+	return error;
+}
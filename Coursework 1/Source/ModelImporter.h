@@ -0,0 +1,83 @@
+//
+// ModelImporter.h
+//
+
+// Native obj and 3ds import.  The whole file is read into memory and parsed in place - obj files are split into line aligned chunks that are parsed in parallel and then joined, 3ds files are walked chunk by chunk straight from the file data with the triangle meshes converted in parallel.  Each obj group or object and each 3ds triangle mesh becomes a sub-mesh.  Normals missing from the file are computed by averaging the normals of the faces sharing each position.  3ds smoothing groups are honoured - only faces whose groups overlap are averaged and faces in no group are flat shaded.
+//
+// The output matches what Model made of a CGImport3 model - vertices are converted to the left-handed Direct3D frame (x negated, 3ds z-up turned to y-up, t flipped) and each triangle's winding reversed to suit, with indices relative to the base vertex of their sub-mesh.  Work is spread across the given WorkerPool, or done on the calling thread if there is none.
+//
+// The class does not depend on Direct3D or Windows.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <vector>
+
+class WorkerPool;
+
+
+class ModelImporter : public GUObject {
+
+public:
+
+	struct Vertex {
+
+		float							pos[3];
+		float							normal[3];
+		float							texCoord[2];
+	};
+
+	// Sub-mesh entry.  The sub-meshes' vertices and indices are stored in order.
+	struct Mesh {
+
+		uint32_t						baseVertex;
+		uint32_t						indexCount;
+	};
+
+private:
+
+	// Vertices and indices of one sub-mesh, built in parallel with the others before they are joined
+	struct MeshData;
+
+	WorkerPool							*pool = nullptr;
+
+	std::vector<Vertex>					vertices;
+	std::vector<uint32_t>				indices;
+	std::vector<Mesh>					meshes;
+
+	std::string							error;
+
+	// Call body(i) for i in [0, count) across the pool
+	void parallelFor(const int count, const std::function<void(int)> &body);
+
+	bool readFile(const std::string &filename, std::vector<char> *data);
+	bool parseOBJ(const std::vector<char> &data);
+	bool parse3DS(const std::vector<char> &data);
+
+	// Append the non-empty sub-meshes to the vertices, indices and mesh table
+	void joinMeshes(std::vector<MeshData> &meshData);
+
+	static void averageFaceNormals(MeshData *mesh, const std::vector<uint32_t> &positionSlot, const uint32_t numSlots, const std::vector<uint8_t> &needsNormal);
+	static void smoothingGroupNormals(MeshData *mesh, const std::vector<uint32_t> &positionSlot, const uint32_t numSlots, const std::vector<uint32_t> &faceGroups);
+
+public:
+
+	// If _pool is not null it is retained and used for all parsing
+	ModelImporter(WorkerPool *_pool = nullptr);
+	~ModelImporter();
+
+	// Return true if filename has an extension the importer reads (.obj or .3ds in any case)
+	static bool isSupported(const std::string &filename);
+
+	// Import the given file, replacing any previous contents.  Returns false and sets the error message if the file cannot be read or holds no triangles.
+	bool import(const std::string &filename);
+
+	// Accessor methods
+	const std::vector<Vertex>& getVertices() const;
+	const std::vector<uint32_t>& getIndices() const;
+	const std::vector<Mesh>& getMeshes() const;
+	const std::string& getError() const;
+};
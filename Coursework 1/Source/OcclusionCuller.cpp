@@ -0,0 +1,630 @@
+
+//
+// OcclusionCuller.cpp
+//
+
+#include <stdafx.h>
+#include <OcclusionCuller.h>
+#include <WorkerPool.h>
+#include <algorithm>
+#include <cfloat>
+#include <cmath>
+#include <emmintrin.h>
+
+using namespace std;
+
+
+// Vertices transformed per task by transformOccluders (a multiple of four)
+static const uint32_t		TransformChunkSize = 4096;
+
+// Clip space x and y are clipped to +/- GuardBand * w so screen space coordinates stay small enough for exact edge functions
+static const float			GuardBand = 4.0f;
+
+// Maximum vertices of a triangle clipped against the near plane and the four guard band planes
+static const int			MaxClippedVertices = 8;
+
+
+// Return the signed distance of a clip space vertex from clipping plane p (near, left, right, bottom, top).  The vertex is inside when the distance is >= 0.
+static float clipDistance(const float *v, const int p) {
+
+	switch (p) {
+
+	case 0: return v[2];
+	case 1: return GuardBand * v[3] + v[0];
+	case 2: return GuardBand * v[3] - v[0];
+	case 3: return GuardBand * v[3] + v[1];
+	default: return GuardBand * v[3] - v[1];
+	}
+}
+
+
+// Create a culler for numViews views, each with a width x height depth buffer.  The dimensions are rounded up to a multiple of HiZBlockSize.
+OcclusionCuller::OcclusionCuller(const int numViews, const int _width, const int _height) {
+
+	blocksX = max((_width + HiZBlockSize - 1) / HiZBlockSize, 1);
+	blocksY = max((_height + HiZBlockSize - 1) / HiZBlockSize, 1);
+	width = blocksX * HiZBlockSize;
+	height = blocksY * HiZBlockSize;
+
+	views.resize(max(numViews, 0));
+
+	for (size_t i = 0; i < views.size(); ++i) {
+
+		views[i].depth.assign(width * height, 1.0f);
+		views[i].hiZ.assign(blocksX * blocksY, 1.0f);
+		views[i].bins.resize(blocksY);
+		views[i].rendered = false;
+	}
+}
+
+
+// Add an occluder mesh.  positions points to the first vertex position (3 floats), stride is the distance in bytes between vertex positions and world is a row-major matrix (nullptr for identity).  Occluders are static - the mesh is transformed to world space and copied.
+void OcclusionCuller::addOccluder(const float *positions, const size_t stride, const uint32_t vertexCount, const uint32_t *indices, const uint32_t indexCount, const float *world) {
+
+	static const float identity[16] = { 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f, 0.0f, 0.0f, 0.0f, 0.0f, 1.0f };
+
+	if (!positions || !indices || vertexCount == 0 || indexCount < 3)
+		return;
+
+	const float *m = (world) ? world : identity;
+
+	// Remove the padding added after the previous occluder
+	occluderX.resize(occluderVertexCount);
+	occluderY.resize(occluderVertexCount);
+	occluderZ.resize(occluderVertexCount);
+
+	uint32_t baseVertex = occluderVertexCount;
+
+	for (uint32_t i = 0; i < vertexCount; ++i) {
+
+		const float *p = reinterpret_cast<const float*>(reinterpret_cast<const uint8_t*>(positions) + i * stride);
+
+		occluderX.push_back(p[0] * m[0] + p[1] * m[4] + p[2] * m[8] + m[12]);
+		occluderY.push_back(p[0] * m[1] + p[1] * m[5] + p[2] * m[9] + m[13]);
+		occluderZ.push_back(p[0] * m[2] + p[1] * m[6] + p[2] * m[10] + m[14]);
+	}
+
+	occluderVertexCount += vertexCount;
+
+	for (uint32_t i = 0; i + 2 < indexCount; i += 3) {
+
+		if (indices[i] >= vertexCount || indices[i + 1] >= vertexCount || indices[i + 2] >= vertexCount)
+			continue;
+
+		occluderIndices.push_back(baseVertex + indices[i]);
+		occluderIndices.push_back(baseVertex + indices[i + 1]);
+		occluderIndices.push_back(baseVertex + indices[i + 2]);
+	}
+
+	// Pad to a multiple of four so the transform always loads four vertices
+	uint32_t paddedCount = (occluderVertexCount + 3) & ~3;
+
+	occluderX.resize(paddedCount, 0.0f);
+	occluderY.resize(paddedCount, 0.0f);
+	occluderZ.resize(paddedCount, 0.0f);
+}
+
+void OcclusionCuller::clearOccluders() {
+
+	occluderX.clear();
+	occluderY.clear();
+	occluderZ.clear();
+	occluderIndices.clear();
+	occluderVertexCount = 0;
+
+	for (size_t i = 0; i < views.size(); ++i)
+		invalidate((int)i);
+}
+
+
+// Transform the occluder vertices to the clip space of the view, four at a time
+void OcclusionCuller::transformOccluders(View &view, WorkerPool *pool) {
+
+	uint32_t paddedCount = (uint32_t)occluderX.size();
+
+	view.clipX.resize(paddedCount);
+	view.clipY.resize(paddedCount);
+	view.clipZ.resize(paddedCount);
+	view.clipW.resize(paddedCount);
+
+	const float *m = view.viewProj;
+
+	auto transformChunk = [this, &view, m, paddedCount](int chunk) {
+
+		uint32_t first = chunk * TransformChunkSize;
+		uint32_t last = min(first + TransformChunkSize, paddedCount);
+
+		// Columns of the matrix splatted across four vertices
+		__m128 m00 = _mm_set1_ps(m[0]), m10 = _mm_set1_ps(m[4]), m20 = _mm_set1_ps(m[8]), m30 = _mm_set1_ps(m[12]);
+		__m128 m01 = _mm_set1_ps(m[1]), m11 = _mm_set1_ps(m[5]), m21 = _mm_set1_ps(m[9]), m31 = _mm_set1_ps(m[13]);
+		__m128 m02 = _mm_set1_ps(m[2]), m12 = _mm_set1_ps(m[6]), m22 = _mm_set1_ps(m[10]), m32 = _mm_set1_ps(m[14]);
+		__m128 m03 = _mm_set1_ps(m[3]), m13 = _mm_set1_ps(m[7]), m23 = _mm_set1_ps(m[11]), m33 = _mm_set1_ps(m[15]);
+
+		for (uint32_t i = first; i < last; i += 4) {
+
+			__m128 x = _mm_loadu_ps(&occluderX[i]);
+			__m128 y = _mm_loadu_ps(&occluderY[i]);
+			__m128 z = _mm_loadu_ps(&occluderZ[i]);
+
+			_mm_storeu_ps(&view.clipX[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m00), _mm_mul_ps(y, m10)), _mm_add_ps(_mm_mul_ps(z, m20), m30)));
+			_mm_storeu_ps(&view.clipY[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m01), _mm_mul_ps(y, m11)), _mm_add_ps(_mm_mul_ps(z, m21), m31)));
+			_mm_storeu_ps(&view.clipZ[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m02), _mm_mul_ps(y, m12)), _mm_add_ps(_mm_mul_ps(z, m22), m32)));
+			_mm_storeu_ps(&view.clipW[i], _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, m03), _mm_mul_ps(y, m13)), _mm_add_ps(_mm_mul_ps(z, m23), m33)));
+		}
+	};
+
+	int numChunks = (int)((paddedCount + TransformChunkSize - 1) / TransformChunkSize);
+
+	if (pool && numChunks > 1)
+		pool->parallelFor(numChunks, transformChunk);
+	else {
+
+		for (int i = 0; i < numChunks; ++i)
+			transformChunk(i);
+	}
+}
+
+// Clip the occluder triangles, set up their edge and depth equations and bin them into bands
+void OcclusionCuller::setupTriangles(View &view) {
+
+	view.triangles.clear();
+
+	for (int i = 0; i < blocksY; ++i)
+		view.bins[i].clear();
+
+	for (size_t t = 0; t + 2 < occluderIndices.size(); t += 3) {
+
+		float v[3][4];
+
+		for (int k = 0; k < 3; ++k) {
+
+			uint32_t index = occluderIndices[t + k];
+
+			v[k][0] = view.clipX[index];
+			v[k][1] = view.clipY[index];
+			v[k][2] = view.clipZ[index];
+			v[k][3] = view.clipW[index];
+		}
+
+		// Outcodes against the near and guard band planes
+		int outsideAll = 0x1F, outsideAny = 0;
+
+		for (int k = 0; k < 3; ++k) {
+
+			int outcode = 0;
+
+			for (int p = 0; p < 5; ++p) {
+
+				if (clipDistance(v[k], p) < 0.0f)
+					outcode |= (1 << p);
+			}
+
+			outsideAll &= outcode;
+			outsideAny |= outcode;
+		}
+
+		if (outsideAll) {
+
+			trianglesCulled++;
+			continue;
+		}
+
+		if (!outsideAny) {
+
+			addTriangle(view, v[0], v[1], v[2]);
+			continue;
+		}
+
+		// Sutherland-Hodgman clip against each plane the triangle crosses, then fan triangulate
+		float polygon[2][MaxClippedVertices][4];
+		int count = 3, src = 0;
+
+		for (int k = 0; k < 3; ++k)
+			copy(v[k], v[k] + 4, polygon[0][k]);
+
+		for (int p = 0; p < 5 && count >= 3; ++p) {
+
+			if (!(outsideAny & (1 << p)))
+				continue;
+
+			int dst = 1 - src, outCount = 0;
+
+			for (int k = 0; k < count; ++k) {
+
+				const float *a = polygon[src][k];
+				const float *b = polygon[src][(k + 1) % count];
+				float da = clipDistance(a, p);
+				float db = clipDistance(b, p);
+
+				if (da >= 0.0f && outCount < MaxClippedVertices)
+					copy(a, a + 4, polygon[dst][outCount++]);
+
+				if ((da >= 0.0f) != (db >= 0.0f) && outCount < MaxClippedVertices) {
+
+					float s = da / (da - db);
+
+					for (int c = 0; c < 4; ++c)
+						polygon[dst][outCount][c] = a[c] + s * (b[c] - a[c]);
+
+					outCount++;
+				}
+			}
+
+			count = outCount;
+			src = dst;
+		}
+
+		if (count < 3) {
+
+			trianglesCulled++;
+			continue;
+		}
+
+		for (int k = 1; k + 1 < count; ++k)
+			addTriangle(view, polygon[src][0], polygon[src][k], polygon[src][k + 1]);
+	}
+}
+
+// Project a clipped triangle to screen space and add it to the bins of the bands it covers.  Back-facing, degenerate and pixel-centre-free triangles are dropped.
+void OcclusionCuller::addTriangle(View &view, const float *v0, const float *v1, const float *v2) {
+
+	const float *v[3] = { v0, v1, v2 };
+	float x[3], y[3], z[3];
+
+	for (int k = 0; k < 3; ++k) {
+
+		if (v[k][3] <= 1e-6f) {
+
+			trianglesCulled++;
+			return;
+		}
+
+		float invW = 1.0f / v[k][3];
+
+		x[k] = (v[k][0] * invW * 0.5f + 0.5f) * width;
+		y[k] = (0.5f - v[k][1] * invW * 0.5f) * height;
+		z[k] = v[k][2] * invW;
+	}
+
+	// Front faces are clockwise on screen (positive area with y pointing down)
+	float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+
+	if (!(area > 0.0f)) {
+
+		trianglesCulled++;
+		return;
+	}
+
+	ScreenTriangle triangle;
+
+	// Pixels whose centres may lie inside the triangle
+	triangle.minX = max((int)ceilf(min(x[0], min(x[1], x[2])) - 0.5f), 0);
+	triangle.maxX = min((int)floorf(max(x[0], max(x[1], x[2])) - 0.5f), width - 1);
+	triangle.minY = max((int)ceilf(min(y[0], min(y[1], y[2])) - 0.5f), 0);
+	triangle.maxY = min((int)floorf(max(y[0], max(y[1], y[2])) - 0.5f), height - 1);
+
+	if (triangle.minX > triangle.maxX || triangle.minY > triangle.maxY) {
+
+		trianglesCulled++;
+		return;
+	}
+
+	// Edge k runs from vertex k to vertex k + 1 and is 0 on the opposite vertex's weight
+	for (int k = 0; k < 3; ++k) {
+
+		int a = k, b = (k + 1) % 3;
+
+		triangle.edgeA[k] = y[a] - y[b];
+		triangle.edgeB[k] = x[b] - x[a];
+		triangle.edgeC[k] = (y[b] - y[a]) * x[a] - (x[b] - x[a]) * y[a];
+	}
+
+	// Depth plane from the barycentric weights of vertex 1 (edge 2) and vertex 2 (edge 0)
+	float invArea = 1.0f / area;
+	float dz1 = (z[1] - z[0]) * invArea;
+	float dz2 = (z[2] - z[0]) * invArea;
+
+	triangle.depthA = triangle.edgeA[2] * dz1 + triangle.edgeA[0] * dz2;
+	triangle.depthB = triangle.edgeB[2] * dz1 + triangle.edgeB[0] * dz2;
+	triangle.depthC = z[0] + triangle.edgeC[2] * dz1 + triangle.edgeC[0] * dz2;
+
+	uint32_t index = (uint32_t)view.triangles.size();
+
+	view.triangles.push_back(triangle);
+
+	for (int band = triangle.minY / HiZBlockSize; band <= triangle.maxY / HiZBlockSize; ++band)
+		view.bins[band].push_back(index);
+
+	trianglesRasterized++;
+}
+
+// Rasterize the triangles binned to the band and reduce the band to its row of HiZ blocks.  Bands share no pixels so they can be rasterized concurrently.
+void OcclusionCuller::rasterizeBand(View &view, const int band) {
+
+	const int firstRow = band * HiZBlockSize;
+	const int lastRow = firstRow + HiZBlockSize - 1;
+
+	float *bandDepth = &view.depth[firstRow * width];
+
+	fill(bandDepth, bandDepth + HiZBlockSize * width, 1.0f);
+
+	const __m128 pixelOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);
+	const __m128 zero = _mm_setzero_ps();
+
+	const vector<uint32_t> &bin = view.bins[band];
+
+	for (size_t t = 0; t < bin.size(); ++t) {
+
+		const ScreenTriangle &triangle = view.triangles[bin[t]];
+
+		int rowStart = max(triangle.minY, firstRow);
+		int rowEnd = min(triangle.maxY, lastRow);
+		int columnStart = triangle.minX & ~3;
+
+		__m128 edgeA0 = _mm_set1_ps(triangle.edgeA[0]), edgeA1 = _mm_set1_ps(triangle.edgeA[1]), edgeA2 = _mm_set1_ps(triangle.edgeA[2]);
+		__m128 depthA = _mm_set1_ps(triangle.depthA);
+
+		// Edge and depth increments of a step of four pixels
+		__m128 edgeStep0 = _mm_set1_ps(triangle.edgeA[0] * 4.0f), edgeStep1 = _mm_set1_ps(triangle.edgeA[1] * 4.0f), edgeStep2 = _mm_set1_ps(triangle.edgeA[2] * 4.0f);
+		__m128 depthStep = _mm_set1_ps(triangle.depthA * 4.0f);
+
+		for (int row = rowStart; row <= rowEnd; ++row) {
+
+			float py = row + 0.5f;
+			__m128 px = _mm_add_ps(_mm_set1_ps((float)columnStart), pixelOffsets);
+
+			__m128 e0 = _mm_add_ps(_mm_mul_ps(edgeA0, px), _mm_set1_ps(triangle.edgeB[0] * py + triangle.edgeC[0]));
+			__m128 e1 = _mm_add_ps(_mm_mul_ps(edgeA1, px), _mm_set1_ps(triangle.edgeB[1] * py + triangle.edgeC[1]));
+			__m128 e2 = _mm_add_ps(_mm_mul_ps(edgeA2, px), _mm_set1_ps(triangle.edgeB[2] * py + triangle.edgeC[2]));
+			__m128 z = _mm_add_ps(_mm_mul_ps(depthA, px), _mm_set1_ps(triangle.depthB * py + triangle.depthC));
+
+			float *rowDepth = &view.depth[row * width];
+
+			for (int column = columnStart; column <= triangle.maxX; column += 4) {
+
+				__m128 inside = _mm_and_ps(_mm_and_ps(_mm_cmpge_ps(e0, zero), _mm_cmpge_ps(e1, zero)), _mm_cmpge_ps(e2, zero));
+
+				if (_mm_movemask_ps(inside)) {
+
+					__m128 depth = _mm_loadu_ps(rowDepth + column);
+					__m128 nearer = _mm_min_ps(depth, _mm_max_ps(z, zero));
+
+					_mm_storeu_ps(rowDepth + column, _mm_or_ps(_mm_and_ps(inside, nearer), _mm_andnot_ps(inside, depth)));
+				}
+
+				e0 = _mm_add_ps(e0, edgeStep0);
+				e1 = _mm_add_ps(e1, edgeStep1);
+				e2 = _mm_add_ps(e2, edgeStep2);
+				z = _mm_add_ps(z, depthStep);
+			}
+		}
+	}
+
+	// Maximum depth of each block in the band
+	for (int block = 0; block < blocksX; ++block) {
+
+		__m128 blockMax = zero;
+
+		for (int row = 0; row < HiZBlockSize; ++row) {
+
+			const float *p = bandDepth + row * width + block * HiZBlockSize;
+
+			blockMax = _mm_max_ps(blockMax, _mm_max_ps(_mm_loadu_ps(p), _mm_loadu_ps(p + 4)));
+		}
+
+		blockMax = _mm_max_ps(blockMax, _mm_shuffle_ps(blockMax, blockMax, _MM_SHUFFLE(1, 0, 3, 2)));
+		blockMax = _mm_max_ps(blockMax, _mm_shuffle_ps(blockMax, blockMax, _MM_SHUFFLE(2, 3, 0, 1)));
+
+		_mm_store_ss(&view.hiZ[band * blocksX + block], blockMax);
+	}
+}
+
+
+// Rasterize the occluders into the depth buffer of the given view and build its HiZ buffer.  viewProj is the row-major view-projection matrix of the view.  Bands are rasterized in parallel if a pool is given.
+void OcclusionCuller::render(const int viewIndex, const float *viewProj, WorkerPool *pool) {
+
+	if (viewIndex < 0 || viewIndex >= (int)views.size() || !viewProj)
+		return;
+
+	View &view = views[viewIndex];
+
+	copy(viewProj, viewProj + 16, view.viewProj);
+
+	transformOccluders(view, pool);
+	setupTriangles(view);
+
+	if (pool)
+		pool->parallelFor(blocksY, [this, &view](int band) { rasterizeBand(view, band); });
+	else {
+
+		for (int band = 0; band < blocksY; ++band)
+			rasterizeBand(view, band);
+	}
+
+	view.rendered = true;
+}
+
+
+// Return true if any pixel of the given pixel rectangle holds a depth greater than nearestDepth
+bool OcclusionCuller::testRect(const View &view, int minX, int minY, int maxX, int maxY, const float nearestDepth) const {
+
+	const __m128 objectDepth = _mm_set1_ps(nearestDepth);
+
+	int blockMinX = minX / HiZBlockSize, blockMaxX = maxX / HiZBlockSize;
+	int blockMinY = minY / HiZBlockSize, blockMaxY = maxY / HiZBlockSize;
+
+	for (int by = blockMinY; by <= blockMaxY; ++by) {
+
+		const float *hiZRow = &view.hiZ[by * blocksX];
+
+		for (int bx = blockMinX; bx <= blockMaxX; bx += 4) {
+
+			// Coarse test of four blocks at a time.  Lanes past the end of the rectangle are masked off.
+			int lanes = min(blockMaxX - bx + 1, 4);
+			int farther;
+
+			if (bx + 4 <= blocksX)
+				farther = _mm_movemask_ps(_mm_cmpgt_ps(_mm_loadu_ps(hiZRow + bx), objectDepth)) & ((1 << lanes) - 1);
+			else {
+
+				farther = 0;
+
+				for (int k = 0; k < lanes; ++k)
+					farther |= (hiZRow[bx + k] > nearestDepth) ? (1 << k) : 0;
+			}
+
+			// Refine each block with an occluder behind the object against the pixels of the rectangle it contains
+			for (int k = 0; farther && k < lanes; ++k) {
+
+				if (!(farther & (1 << k)))
+					continue;
+
+				int x0 = max((bx + k) * HiZBlockSize, minX), x1 = min((bx + k) * HiZBlockSize + HiZBlockSize - 1, maxX);
+				int y0 = max(by * HiZBlockSize, minY), y1 = min(by * HiZBlockSize + HiZBlockSize - 1, maxY);
+
+				for (int y = y0; y <= y1; ++y) {
+
+					const float *rowDepth = &view.depth[y * width];
+
+					for (int x = x0; x <= x1; ++x) {
+
+						if (rowDepth[x] > nearestDepth)
+							return true;
+					}
+				}
+			}
+		}
+	}
+
+	return false;
+}
+
+// Return false if the normalised device coordinate rectangle at the given (nearest) depth is hidden by the occluders in the given view
+bool OcclusionCuller::isRectVisible(const int viewIndex, const float minX, const float minY, const float maxX, const float maxY, const float nearestDepth) const {
+
+	if (viewIndex < 0 || viewIndex >= (int)views.size() || !views[viewIndex].rendered)
+		return true;
+
+	// Rectangles entirely off screen are left to frustum culling
+	if (maxX < -1.0f || minX > 1.0f || maxY < -1.0f || minY > 1.0f)
+		return true;
+
+	int pixelMinX = max((int)floorf((minX * 0.5f + 0.5f) * width), 0);
+	int pixelMaxX = min((int)floorf((maxX * 0.5f + 0.5f) * width), width - 1);
+	int pixelMinY = max((int)floorf((0.5f - maxY * 0.5f) * height), 0);
+	int pixelMaxY = min((int)floorf((0.5f - minY * 0.5f) * height), height - 1);
+
+	if (pixelMinX > pixelMaxX || pixelMinY > pixelMaxY)
+		return true;
+
+	return testRect(views[viewIndex], pixelMinX, pixelMinY, pixelMaxX, pixelMaxY, nearestDepth);
+}
+
+// Return false if the world space sphere is hidden by the occluders in the given view.  Views that have not been rendered report everything visible.
+bool OcclusionCuller::isSphereVisible(const int viewIndex, const float *centre, const float radius) const {
+
+	if (viewIndex < 0 || viewIndex >= (int)views.size() || !views[viewIndex].rendered)
+		return true;
+
+	const float *m = views[viewIndex].viewProj;
+
+	// Project the eight corners of the sphere's bounding box, four at a time
+	__m128 xs = _mm_setr_ps(centre[0] - radius, centre[0] + radius, centre[0] - radius, centre[0] + radius);
+	__m128 ys = _mm_setr_ps(centre[1] - radius, centre[1] - radius, centre[1] + radius, centre[1] + radius);
+
+	__m128 ndcMin = _mm_set1_ps(FLT_MAX);
+	__m128 ndcMax = _mm_set1_ps(-FLT_MAX);
+	__m128 nearest = _mm_set1_ps(FLT_MAX);
+	bool crossesNear = false;
+
+	for (int k = 0; k < 2; ++k) {
+
+		__m128 zs = _mm_set1_ps(centre[2] + ((k == 0) ? -radius : radius));
+
+		__m128 cx = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, _mm_set1_ps(m[0])), _mm_mul_ps(ys, _mm_set1_ps(m[4]))), _mm_add_ps(_mm_mul_ps(zs, _mm_set1_ps(m[8])), _mm_set1_ps(m[12])));
+		__m128 cy = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, _mm_set1_ps(m[1])), _mm_mul_ps(ys, _mm_set1_ps(m[5]))), _mm_add_ps(_mm_mul_ps(zs, _mm_set1_ps(m[9])), _mm_set1_ps(m[13])));
+		__m128 cz = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, _mm_set1_ps(m[2])), _mm_mul_ps(ys, _mm_set1_ps(m[6]))), _mm_add_ps(_mm_mul_ps(zs, _mm_set1_ps(m[10])), _mm_set1_ps(m[14])));
+		__m128 cw = _mm_add_ps(_mm_add_ps(_mm_mul_ps(xs, _mm_set1_ps(m[3])), _mm_mul_ps(ys, _mm_set1_ps(m[7]))), _mm_add_ps(_mm_mul_ps(zs, _mm_set1_ps(m[11])), _mm_set1_ps(m[15])));
+
+		// A corner in front of the near plane means the box may cover the whole view
+		if (_mm_movemask_ps(_mm_cmplt_ps(cz, _mm_set1_ps(0.0f))) || _mm_movemask_ps(_mm_cmple_ps(cw, _mm_set1_ps(1e-6f)))) {
+
+			crossesNear = true;
+			break;
+		}
+
+		__m128 invW = _mm_div_ps(_mm_set1_ps(1.0f), cw);
+		__m128 ndcX = _mm_mul_ps(cx, invW);
+		__m128 ndcY = _mm_mul_ps(cy, invW);
+
+		ndcMin = _mm_min_ps(ndcMin, _mm_unpacklo_ps(_mm_min_ps(ndcX, _mm_shuffle_ps(ndcX, ndcX, _MM_SHUFFLE(1, 0, 3, 2))), _mm_min_ps(ndcY, _mm_shuffle_ps(ndcY, ndcY, _MM_SHUFFLE(1, 0, 3, 2)))));
+		ndcMax = _mm_max_ps(ndcMax, _mm_unpacklo_ps(_mm_max_ps(ndcX, _mm_shuffle_ps(ndcX, ndcX, _MM_SHUFFLE(1, 0, 3, 2))), _mm_max_ps(ndcY, _mm_shuffle_ps(ndcY, ndcY, _MM_SHUFFLE(1, 0, 3, 2)))));
+		nearest = _mm_min_ps(nearest, _mm_mul_ps(cz, invW));
+	}
+
+	if (crossesNear)
+		return true;
+
+	// Lanes 0 and 2 of ndcMin / ndcMax hold x and lanes 1 and 3 hold y
+	float minima[4], maxima[4], depths[4];
+
+	_mm_storeu_ps(minima, ndcMin);
+	_mm_storeu_ps(maxima, ndcMax);
+	_mm_storeu_ps(depths, nearest);
+
+	float nearestDepth = min(min(depths[0], depths[1]), min(depths[2], depths[3]));
+
+	return isRectVisible(viewIndex, min(minima[0], minima[2]), min(minima[1], minima[3]), max(maxima[0], maxima[2]), max(maxima[1], maxima[3]), nearestDepth);
+}
+
+
+// Forget the depth of the given view (everything is reported visible until it is rendered again)
+void OcclusionCuller::invalidate(const int viewIndex) {
+
+	if (viewIndex >= 0 && viewIndex < (int)views.size())
+		views[viewIndex].rendered = false;
+}
+
+
+// Accessor methods
+
+int OcclusionCuller::getWidth() const {
+
+	return width;
+}
+
+int OcclusionCuller::getHeight() const {
+
+	return height;
+}
+
+int OcclusionCuller::getViewCount() const {
+
+	return (int)views.size();
+}
+
+const float* OcclusionCuller::getDepthBuffer(const int viewIndex) const {
+
+	return (viewIndex >= 0 && viewIndex < (int)views.size()) ? &views[viewIndex].depth[0] : nullptr;
+}
+
+uint32_t OcclusionCuller::getOccluderTriangleCount() const {
+
+	return (uint32_t)(occluderIndices.size() / 3);
+}
+
+uint64_t OcclusionCuller::getTrianglesRasterized() const {
+
+	return trianglesRasterized;
+}
+
+uint64_t OcclusionCuller::getTrianglesCulled() const {
+
+	return trianglesCulled;
+}
+
+void OcclusionCuller::resetStats() {
+
+	trianglesRasterized = 0;
+	trianglesCulled = 0;
+}
@@ -0,0 +1,119 @@
+//
+// OcclusionCuller.h
+//
+
+// Software occlusion culling.  Designated occluder meshes are rasterized on the CPU into a low resolution depth buffer per view and the bounds of other objects are tested against a hierarchical (HiZ) version of it - an object is occluded if every pixel its screen rectangle covers holds an occluder nearer than the object's nearest point.
+//
+// Occluder vertices are transformed to clip space four at a time with SSE, triangles are clipped (near plane and a guard band), binned into horizontal bands of HiZBlockSize rows and each band is rasterized and reduced to its row of HiZ blocks as an independent task on a WorkerPool.  Pixels are rasterized four at a time and the HiZ test compares four blocks at a time.
+//
+// The class does not depend on Direct3D - matrices are row-major float[16] using the row-vector convention of DirectXMath (XMFLOAT4X4 layout) and depth is z/w in [0, 1] as in Direct3D clip space.  Back-facing (counter-clockwise on screen) and near-plane-crossing geometry is handled conservatively: triangles are only ever dropped, never added, so culling errs on the side of drawing.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+class WorkerPool;
+
+
+class OcclusionCuller : public GUObject {
+
+public:
+
+	// Width and height in pixels of a HiZ block (and the height of a rasterizer band)
+	static const int			HiZBlockSize = 8;
+
+private:
+
+	// Triangle in screen space.  Edge and depth planes are evaluated at pixel centres as a*x + b*y + c.  Inside pixels have all three edge values >= 0.
+	struct ScreenTriangle {
+
+		float					edgeA[3];
+		float					edgeB[3];
+		float					edgeC[3];
+
+		float					depthA;
+		float					depthB;
+		float					depthC;
+
+		int						minX, maxX;
+		int						minY, maxY;
+	};
+
+	struct View {
+
+		std::vector<float>		depth;	// width * height, row-major, top row first
+		std::vector<float>		hiZ;	// maximum depth of each HiZBlockSize square block
+
+		float					viewProj[16];
+		bool					rendered;
+
+		// Clip space occluder vertices (structure-of-arrays, padded to a multiple of four)
+		std::vector<float>		clipX;
+		std::vector<float>		clipY;
+		std::vector<float>		clipZ;
+		std::vector<float>		clipW;
+
+		std::vector<ScreenTriangle>			triangles;
+		std::vector<std::vector<uint32_t> >	bins;	// triangles overlapping each band
+	};
+
+	int							width;
+	int							height;
+	int							blocksX;
+	int							blocksY;
+
+	std::vector<View>			views;
+
+	// World space occluder geometry shared by every view (structure-of-arrays, padded to a multiple of four)
+	std::vector<float>			occluderX;
+	std::vector<float>			occluderY;
+	std::vector<float>			occluderZ;
+	std::vector<uint32_t>		occluderIndices;
+	uint32_t					occluderVertexCount = 0;
+
+	// Triangles rasterized and dropped (clipped away, back-facing or covering no pixel centre) by every render() since the last resetStats()
+	uint64_t					trianglesRasterized = 0;
+	uint64_t					trianglesCulled = 0;
+
+	void transformOccluders(View &view, WorkerPool *pool);
+	void setupTriangles(View &view);
+	void addTriangle(View &view, const float *v0, const float *v1, const float *v2);
+	void rasterizeBand(View &view, const int band);
+
+	// Return true if any pixel of the given pixel rectangle holds a depth greater than nearestDepth
+	bool testRect(const View &view, int minX, int minY, int maxX, int maxY, const float nearestDepth) const;
+
+public:
+
+	// Create a culler for numViews views, each with a width x height depth buffer.  The dimensions are rounded up to a multiple of HiZBlockSize.
+	OcclusionCuller(const int numViews, const int _width, const int _height);
+
+	// Add an occluder mesh.  positions points to the first vertex position (3 floats), stride is the distance in bytes between vertex positions and world is a row-major matrix (nullptr for identity).  Occluders are static - the mesh is transformed to world space and copied.
+	void addOccluder(const float *positions, const size_t stride, const uint32_t vertexCount, const uint32_t *indices, const uint32_t indexCount, const float *world);
+	void clearOccluders();
+
+	// Rasterize the occluders into the depth buffer of the given view and build its HiZ buffer.  viewProj is the row-major view-projection matrix of the view.  Bands are rasterized in parallel if a pool is given.
+	void render(const int view, const float *viewProj, WorkerPool *pool = nullptr);
+
+	// Return false if the world space sphere is hidden by the occluders in the given view.  Views that have not been rendered report everything visible.
+	bool isSphereVisible(const int view, const float *centre, const float radius) const;
+
+	// Return false if the normalised device coordinate rectangle at the given (nearest) depth is hidden by the occluders in the given view
+	bool isRectVisible(const int view, const float minX, const float minY, const float maxX, const float maxY, const float nearestDepth) const;
+
+	// Forget the depth of the given view (everything is reported visible until it is rendered again)
+	void invalidate(const int view);
+
+	// Accessor methods
+	int getWidth() const;
+	int getHeight() const;
+	int getViewCount() const;
+	const float* getDepthBuffer(const int view) const;
+	uint32_t getOccluderTriangleCount() const;
+	uint64_t getTrianglesRasterized() const;
+	uint64_t getTrianglesCulled() const;
+	void resetStats();
+};
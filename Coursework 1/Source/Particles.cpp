@@ -171,13 +171,6 @@ void Particles::setTexture(ID3D11ShaderResourceView *tex_view)
 }
 Particles::~Particles() {
 
-	if (vertexBuffer)
-		vertexBuffer->Release();
-	if (indexBuffer)
-		indexBuffer->Release();
-	if (inputLayout)
-		inputLayout->Release();
-
 	if (textureResourceView)
 		textureResourceView->Release();
 
@@ -186,18 +179,18 @@ Particles::~Particles() {
 }
 
 
-void Particles::render(ID3D11DeviceContext *context) {
+UINT Particles::getTextures(ID3D11ShaderResourceView **views, ID3D11SamplerState **sampler) {
+
+	if (!textureResourceView || !linearSampler)
+		return 0;
 
-	// Validate object before rendering (see notes in constructor)
-	if (!context || !vertexBuffer || !effect)
-		return;
+	views[0] = textureResourceView;
+	*sampler = linearSampler;
 
-	effect->bindPipeline(context);
+	return 1;
+}
 
-	// set shaders for effect (no longer required - set by effect)
-	context->VSSetShader(effect->getVertexShader(), 0, 0);
-	context->PSSetShader(effect->getPixelShader(), 0, 0);
-	context->GSSetShader(effect->getGeometryShader(), 0, 0); //added
+void Particles::bindGeometry(DXContext *context) {
 
 	// Set vertex layout
 	context->IASetInputLayout(effect->getVSInputLayout());
@@ -212,17 +205,11 @@ void Particles::render(ID3D11DeviceContext *context) {
 
 	// Set primitive topology for IA
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
 
-	// Bind texture resource views and texture sampler objects to the PS stage of the pipeline
-	if (textureResourceView && linearSampler) {
-
-		context->PSSetShaderResources(0, 1, &textureResourceView);
-		context->PSSetSamplers(0, 1, &linearSampler);
-	}
+void Particles::draw(DXContext *context) {
 
 	// Draw particles object using index buffer
 	// indices for the particles.
 	context->DrawIndexed(N_P_IND, 0, 0);
-
 }
-
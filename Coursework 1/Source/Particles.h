@@ -1,6 +1,6 @@
 #pragma once
 #include "DXVertexParticle.h"
-#include <GUObject.h>
+#include <DXBaseModel.h>
 #define N_PART 100
 #define N_VERT N_PART*4
 #define N_P_IND N_PART*6
@@ -9,15 +9,15 @@
 class Texture;
 class Material;
 class Effect;
+class DXContext;
 
 
 
-class Particles : public GUObject {
+class Particles : public DXBaseModel {
 
 protected:
 
 	Material *material = nullptr;
-	Effect *effect = nullptr;
 
 
 	// Create Particle vertex buffer
@@ -26,9 +26,6 @@ protected:
 	// Create the indices
 	UINT indices[N_P_IND];
 
-	ID3D11Buffer					*vertexBuffer = nullptr;
-	ID3D11Buffer					*indexBuffer = nullptr;
-	ID3D11InputLayout				*inputLayout = nullptr;
 	// Augment particles with texture view
 	ID3D11ShaderResourceView			*textureResourceView = nullptr;
 	ID3D11SamplerState				*linearSampler = nullptr;
@@ -38,5 +35,7 @@ public:
 	Particles(ID3D11Device *device, Effect *_effect, ID3D11ShaderResourceView *tex_view, Material *_material);
 	~Particles();
 	void setTexture(ID3D11ShaderResourceView *tex_view);
-	void render(ID3D11DeviceContext *context);
+	UINT getTextures(ID3D11ShaderResourceView **views, ID3D11SamplerState **sampler);
+	void bindGeometry(DXContext *context);
+	void draw(DXContext *context);
 };
\ No newline at end of file
@@ -108,7 +108,7 @@ Quad::~Quad() {
 }
 
 
-void Quad::render(ID3D11DeviceContext *context) {
+void Quad::render(DXContext *context) {
 
 	// Validate object before rendering (see notes in constructor)
 	if (!context || !vertexBuffer || !inputLayout)
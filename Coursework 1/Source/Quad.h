@@ -3,6 +3,7 @@
 #include <GUObject.h>
 
 class DXBlob;
+class DXContext;
 
 
 class Quad : public GUObject {
@@ -15,5 +16,5 @@ public:
 	Quad(ID3D11Device *device,  ID3D11InputLayout	*_inputLayout);
 	~Quad();
 
-	void render(ID3D11DeviceContext *context);
+	void render(DXContext *context);
 };
\ No newline at end of file
@@ -0,0 +1,151 @@
+
+//
+// ReflectionProbeSet.cpp
+//
+
+#include <stdafx.h>
+#include <ReflectionProbeSet.h>
+#include <cmath>
+#include <fstream>
+
+using namespace std;
+
+
+// DDS header flags (see the DDS_HEADER documentation)
+static const uint32_t DDSMagic = 0x20534444; // "DDS "
+static const uint32_t DDSD_CAPS = 0x1;
+static const uint32_t DDSD_HEIGHT = 0x2;
+static const uint32_t DDSD_WIDTH = 0x4;
+static const uint32_t DDSD_PITCH = 0x8;
+static const uint32_t DDSD_PIXELFORMAT = 0x1000;
+static const uint32_t DDSD_MIPMAPCOUNT = 0x20000;
+static const uint32_t DDPF_ALPHAPIXELS = 0x1;
+static const uint32_t DDPF_RGB = 0x40;
+static const uint32_t DDSCAPS_COMPLEX = 0x8;
+static const uint32_t DDSCAPS_TEXTURE = 0x1000;
+static const uint32_t DDSCAPS_MIPMAP = 0x400000;
+static const uint32_t DDSCAPS2_CUBEMAP_ALLFACES = 0xFE00; // DDSCAPS2_CUBEMAP and the six face flags
+
+
+// Add a probe at the given world space position influencing points within radius of it.  Returns the index of the probe.
+int ReflectionProbeSet::addProbe(const float *position, const float radius) {
+
+	Probe probe = { { position[0], position[1], position[2] }, max(radius, 1e-3f) };
+
+	probes.push_back(probe);
+
+	return (int)probes.size() - 1;
+}
+
+// Choose the probes to blend at the given world space point.  The reflection is probeA blended with probeB by weightB.  If no probe influences the point the nearest probe (relative to its radius) is used alone.  Returns false if there are no probes.
+bool ReflectionProbeSet::blend(const float *point, int *probeA, int *probeB, float *weightB) const {
+
+	if (probes.empty())
+		return false;
+
+	// The two probes with the greatest influence.  Influence is 1 - distance / radius so a point outside every probe still finds its nearest probe (with negative influence).
+	int best[2] = { -1, -1 };
+	float influence[2] = { 0.0f, 0.0f };
+
+	for (size_t i = 0; i < probes.size(); i++) {
+
+		float dx = point[0] - probes[i].position[0];
+		float dy = point[1] - probes[i].position[1];
+		float dz = point[2] - probes[i].position[2];
+		float value = 1.0f - sqrtf(dx * dx + dy * dy + dz * dz) / probes[i].radius;
+
+		if (best[0] < 0 || value > influence[0]) {
+
+			best[1] = best[0];
+			influence[1] = influence[0];
+			best[0] = (int)i;
+			influence[0] = value;
+		}
+		else if (best[1] < 0 || value > influence[1]) {
+
+			best[1] = (int)i;
+			influence[1] = value;
+		}
+	}
+
+	*probeA = best[0];
+
+	if (best[1] < 0 || influence[1] <= 0.0f || influence[0] <= 0.0f) {
+
+		*probeB = best[0];
+		*weightB = 0.0f;
+	}
+	else {
+
+		*probeB = best[1];
+		*weightB = influence[1] / (influence[0] + influence[1]);
+	}
+
+	return true;
+}
+
+// Write a cube map of size x size faces and mipLevels levels to a DDS file.  texels holds 4 bytes (R, G, B, A) per texel in DDS order - every level of face +X, then every level of face -X and so on with each level half the size of the one before.
+bool ReflectionProbeSet::writeCubeDDS(const string &filename, const int size, const int mipLevels, const vector<uint8_t> &texels) {
+
+	if (size <= 0 || mipLevels <= 0)
+		return false;
+
+	size_t faceBytes = 0;
+
+	for (int level = 0; level < mipLevels; level++) {
+
+		size_t levelSize = (size_t)max(size >> level, 1);
+
+		faceBytes += levelSize * levelSize * 4;
+	}
+
+	if (texels.size() != faceBytes * 6)
+		return false;
+
+	// DDS_HEADER - the masks describe R8G8B8A8_UNORM
+	uint32_t header[31] = {};
+
+	header[0] = sizeof(header);
+	header[1] = DDSD_CAPS | DDSD_HEIGHT | DDSD_WIDTH | DDSD_PITCH | DDSD_PIXELFORMAT | ((mipLevels > 1) ? DDSD_MIPMAPCOUNT : 0);
+	header[2] = (uint32_t)size;
+	header[3] = (uint32_t)size;
+	header[4] = (uint32_t)size * 4;
+	header[6] = (uint32_t)mipLevels;
+	header[18] = 32;
+	header[19] = DDPF_RGB | DDPF_ALPHAPIXELS;
+	header[21] = 32;
+	header[22] = 0x000000FF;
+	header[23] = 0x0000FF00;
+	header[24] = 0x00FF0000;
+	header[25] = 0xFF000000;
+	header[26] = DDSCAPS_TEXTURE | DDSCAPS_COMPLEX | ((mipLevels > 1) ? DDSCAPS_MIPMAP : 0);
+	header[27] = DDSCAPS2_CUBEMAP_ALLFACES;
+
+	ofstream file(filename.c_str(), ios::binary);
+
+	if (!file)
+		return false;
+
+	file.write(reinterpret_cast<const char*>(&DDSMagic), sizeof(DDSMagic));
+	file.write(reinterpret_cast<const char*>(header), sizeof(header));
+	file.write(reinterpret_cast<const char*>(texels.data()), texels.size());
+
+	return file.good();
+}
+
+
+// Accessor methods
+int ReflectionProbeSet::getProbeCount() const {
+
+	return (int)probes.size();
+}
+
+const float* ReflectionProbeSet::getProbePosition(const int probe) const {
+
+	return probes[probe].position;
+}
+
+float ReflectionProbeSet::getProbeRadius(const int probe) const {
+
+	return probes[probe].radius;
+}
@@ -0,0 +1,42 @@
+//
+// ReflectionProbeSet.h
+//
+
+// Static reflection probes.  Each probe is a cube map of the static scene (the geometry and sky that never move) baked offline at a fixed position and stored as a DDS file.  At runtime a reflector blends the two probes with the most influence at its position - a probe's influence falls linearly from 1 at its centre to 0 at its radius so the reflection moves smoothly from one probe to the next.
+//
+// The class does not depend on Direct3D - probe cube maps are written as uncompressed 32 bit RGBA DDS cube maps (loadable with Texture) from texel data read back by the caller.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+
+class ReflectionProbeSet : public GUObject {
+
+	struct Probe {
+
+		float						position[3];
+		float						radius;
+	};
+
+	std::vector<Probe>				probes;
+
+public:
+
+	// Add a probe at the given world space position influencing points within radius of it.  Returns the index of the probe.
+	int addProbe(const float *position, const float radius);
+
+	// Choose the probes to blend at the given world space point.  The reflection is probeA blended with probeB by weightB.  If no probe influences the point the nearest probe (relative to its radius) is used alone.  Returns false if there are no probes.
+	bool blend(const float *point, int *probeA, int *probeB, float *weightB) const;
+
+	// Write a cube map of size x size faces and mipLevels levels to a DDS file.  texels holds 4 bytes (R, G, B, A) per texel in DDS order - every level of face +X, then every level of face -X and so on with each level half the size of the one before.
+	static bool writeCubeDDS(const std::string &filename, const int size, const int mipLevels, const std::vector<uint8_t> &texels);
+
+	// Accessor methods
+	int getProbeCount() const;
+	const float* getProbePosition(const int probe) const;
+	float getProbeRadius(const int probe) const;
+};
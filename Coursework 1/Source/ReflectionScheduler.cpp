@@ -0,0 +1,133 @@
+
+//
+// ReflectionScheduler.cpp
+//
+
+#include <stdafx.h>
+#include <ReflectionScheduler.h>
+
+using namespace std;
+
+
+ReflectionScheduler::ReflectionScheduler(const int _facesPerFrame) {
+
+	setFacesPerFrame(_facesPerFrame);
+
+	for (int i = 0; i < NumFaces; i++)
+		faceAge[i] = 0;
+}
+
+
+// Set the number of faces rendered per frame (clamped to [1, NumFaces])
+void ReflectionScheduler::setFacesPerFrame(const int faces) {
+
+	facesPerFrame = min(max(faces, 1), (int)NumFaces);
+}
+
+int ReflectionScheduler::getFacesPerFrame() const {
+
+	return facesPerFrame;
+}
+
+// Mark the given faces as holding out of date content
+void ReflectionScheduler::markDirty(const uint32_t faceMask) {
+
+	dirtyFaces |= (faceMask & AllFaces);
+}
+
+// Render every face on the next frame
+void ReflectionScheduler::requestFullRefresh() {
+
+	fullRefreshPending = true;
+}
+
+// Return the mask of faces to render this frame and record them as up to date.  Call once per frame.
+uint32_t ReflectionScheduler::schedule() {
+
+	uint32_t selected = 0;
+
+	if (fullRefreshPending) {
+
+		selected = AllFaces;
+		fullRefreshPending = false;
+		fullRefreshes++;
+	}
+	else {
+
+		// A dirty face is treated as older than it is by the number of frames a round-robin pass over every face takes, so it is rendered ahead of clean faces of similar age but not ahead of clean faces that have waited a full pass longer
+		const uint32_t dirtyPriority = (uint32_t)((NumFaces + facesPerFrame - 1) / facesPerFrame);
+
+		for (int n = 0; n < facesPerFrame; n++) {
+
+			int best = -1;
+			uint32_t bestScore = 0;
+
+			// Ties go to the lowest face index so clean faces are visited in order
+			for (int face = 0; face < NumFaces; face++) {
+
+				if (selected & (1 << face))
+					continue;
+
+				uint32_t score = faceAge[face] + ((dirtyFaces & (1 << face)) ? dirtyPriority : 0);
+
+				if (best < 0 || score > bestScore) {
+
+					best = face;
+					bestScore = score;
+				}
+			}
+
+			selected |= (1 << best);
+		}
+	}
+
+	for (int face = 0; face < NumFaces; face++) {
+
+		if (selected & (1 << face)) {
+
+			faceAge[face] = 0;
+			facesRendered++;
+		}
+		else if (faceAge[face] < UINT32_MAX)
+			faceAge[face]++;
+	}
+
+	dirtyFaces &= ~selected;
+	framesScheduled++;
+
+	return selected;
+}
+
+
+// Accessor methods
+uint32_t ReflectionScheduler::getDirtyFaces() const {
+
+	return dirtyFaces;
+}
+
+uint32_t ReflectionScheduler::getFaceAge(const int face) const {
+
+	return (face >= 0 && face < NumFaces) ? faceAge[face] : 0;
+}
+
+uint64_t ReflectionScheduler::getFramesScheduled() const {
+
+	return framesScheduled;
+}
+
+uint64_t ReflectionScheduler::getFacesRendered() const {
+
+	return facesRendered;
+}
+
+uint64_t ReflectionScheduler::getFullRefreshes() const {
+
+	return fullRefreshes;
+}
+
+void ReflectionScheduler::resetStats() {
+
+	framesScheduled = 0;
+	facesRendered = 0;
+	fullRefreshes = 0;
+}
@@ -0,0 +1,63 @@
+//
+// ReflectionScheduler.h
+//
+
+// Choose which faces of a dynamic cube map to re-render each frame.  At most facesPerFrame faces are rendered per frame so the cost of the reflection is a fixed budget rather than six scene passes.  Faces are chosen oldest first (round-robin when nothing changes) with faces marked dirty - faces whose content moved since they were last rendered - taking priority.  A dirty face gains a fixed number of frames of priority over a clean one so a face that keeps changing cannot starve the others.  A full refresh renders every face in the next frame regardless of the budget.
+//
+// The class does not depend on Direct3D - faces are identified by index (0 to NumFaces - 1) and sets of faces by bit mask.
+
+#pragma once
+
+#include <GUObject.h>
+#include <cstdint>
+
+
+class ReflectionScheduler : public GUObject {
+
+public:
+
+	static const int			NumFaces = 6;
+	static const uint32_t		AllFaces = (1 << NumFaces) - 1;
+
+private:
+
+	int							facesPerFrame;
+
+	// Faces with content that moved since they were last rendered
+	uint32_t					dirtyFaces = 0;
+
+	// Render every face on the next schedule() (set initially as the faces hold no content yet)
+	bool						fullRefreshPending = true;
+
+	// Frames since each face was last rendered
+	uint32_t					faceAge[NumFaces];
+
+	uint64_t					framesScheduled = 0;
+	uint64_t					facesRendered = 0;
+	uint64_t					fullRefreshes = 0;
+
+public:
+
+	ReflectionScheduler(const int _facesPerFrame = NumFaces);
+
+	// Set the number of faces rendered per frame (clamped to [1, NumFaces])
+	void setFacesPerFrame(const int faces);
+	int getFacesPerFrame() const;
+
+	// Mark the given faces as holding out of date content
+	void markDirty(const uint32_t faceMask);
+
+	// Render every face on the next frame
+	void requestFullRefresh();
+
+	// Return the mask of faces to render this frame and record them as up to date.  Call once per frame.
+	uint32_t schedule();
+
+	// Accessor methods
+	uint32_t getDirtyFaces() const;
+	uint32_t getFaceAge(const int face) const;
+	uint64_t getFramesScheduled() const;
+	uint64_t getFacesRendered() const;
+	uint64_t getFullRefreshes() const;
+	void resetStats();
+};
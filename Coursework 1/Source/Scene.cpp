@@ -17,6 +17,7 @@
 #include <DirectXTK\WICTextureLoader.h>
 #include <CGDClock.h>
 #include <Model.h>
+#include <StaticBatch.h>
 #include <LookAtCamera.h>
 #include <FirstPersonCamera.h>
 #include <Material.h>
@@ -24,6 +25,13 @@
 #include <Texture.h>
 #include <VertexStructures.h>
 #include <GPUParticles.h>
+#include <DXRecordingContext.h>
+#include <DXStateFilterContext.h>
+#include <WorkerPool.h>
+#include <CubeMapFilter.h>
+#include <TaskGraph.h>
+#include <iomanip>
+#include <cfloat>
 
 using namespace std;
 using namespace DirectX;
@@ -100,11 +108,18 @@ uint32_t DXLoadCSO(const char *filename, char **bytecode)
 //
 
 // Private constructor
-Scene::Scene(const LONG _width, const LONG _height, const wchar_t* wndClassName, const wchar_t* wndTitle, int nCmdShow, HINSTANCE hInstance, WNDPROC WndProc) {
+Scene::Scene(const LONG _width, const LONG _height, const wchar_t* wndClassName, const wchar_t* wndTitle, int nCmdShow, HINSTANCE hInstance, WNDPROC WndProc, DXBackendType backend) {
 
 	for (int i = 0; i < 6; i++)
 		renderTargetCameras[i] = nullptr;
 
+	for (int i = 0; i < NumViews; i++) {
+
+		renderQueues[i] = nullptr;
+		viewContexts[i] = nullptr;
+		viewCommandLists[i] = nullptr;
+	}
+
 	try
 	{
 		// 1. Register window class for main DirectX window
@@ -160,7 +175,7 @@ Scene::Scene(const LONG _width, const LONG _height, const wchar_t* wndClassName,
 
 
 		// 6. Create DirectX host environment (associated with main application wnd)
-		dx = DXSystem::CreateDirectXSystem(wndHandle);
+		dx = DXSystem::CreateDirectXSystem(wndHandle, backend);
 
 		if (!dx)
 			throw exception("Cannot create Direct3D device and context model");
@@ -178,6 +193,8 @@ Scene::Scene(const LONG _width, const LONG _height, const wchar_t* wndClassName,
 		if (!mainClock)
 			throw exception("Cannot create main clock / timer");
 
+		simulationClock = new FixedTimestep(SIMULATION_RATE);
+
 	}
 	catch (exception &e)
 	{
@@ -204,8 +221,11 @@ BOOL Scene::isMinimised() {
 // Public interface implementation
 //
 
+// Set by the -inittrace command line option (see setInitTraceFile())
+string Scene::initTraceFile;
+
 // Factory method to create the main Scene instance (singleton)
-Scene* Scene::CreateScene(const LONG _width, const LONG _height, const wchar_t* wndClassName, const wchar_t* wndTitle, int nCmdShow, HINSTANCE hInstance, WNDPROC WndProc) {
+Scene* Scene::CreateScene(const LONG _width, const LONG _height, const wchar_t* wndClassName, const wchar_t* wndTitle, int nCmdShow, HINSTANCE hInstance, WNDPROC WndProc, DXBackendType backend) {
 
 	static bool _scene_created = false;
 
@@ -213,7 +233,7 @@ Scene* Scene::CreateScene(const LONG _width, const LONG _height, const wchar_t*
 
 	if (!_scene_created) {
 
-		dxScene = new Scene(_width, _height, wndClassName, wndTitle, nCmdShow, hInstance, WndProc);
+		dxScene = new Scene(_width, _height, wndClassName, wndTitle, nCmdShow, hInstance, WndProc, backend);
 
 		if (dxScene)
 			_scene_created = true;
@@ -222,14 +242,20 @@ Scene* Scene::CreateScene(const LONG _width, const LONG _height, const wchar_t*
 	return dxScene;
 }
 
+// Write the trace of the load tasks of scenes created from now on to the given file in the Chrome trace event format (empty to only print the critical path)
+void Scene::setInitTraceFile(const string &filename) {
+
+	initTraceFile = filename;
+}
+
 // Destructor
 Scene::~Scene() {
 
 
 	//free local resources
 
-	if (cBufferExtSrc)
-		_aligned_free(cBufferExtSrc);
+	if (cBufferPerFrameSrc)
+		_aligned_free(cBufferPerFrameSrc);
 
 	if (mainCamera)
 		delete(mainCamera);
@@ -246,46 +272,138 @@ Scene::~Scene() {
 	if (perPixelLightingEffect)
 		delete(perPixelLightingEffect);
 
+	if (perPixelLightingInstancedEffect)
+		delete(perPixelLightingInstancedEffect);
+
+	if (refMapInstancedEffect)
+		delete(refMapInstancedEffect);
+
+	for (size_t i = 0; i < reflectionLODs.size(); i++) {
+
+		if (reflectionLODs[i].proxy)
+			reflectionLODs[i].proxy->release();
+	}
+
+	if (reflectionLightingEffect)
+		delete(reflectionLightingEffect);
+
+	if (reflectionLightingInstancedEffect)
+		delete(reflectionLightingInstancedEffect);
+
+	if (reflectionLightingLayeredEffect)
+		delete(reflectionLightingLayeredEffect);
+
+	if (reflectionLightingInstancedLayeredEffect)
+		delete(reflectionLightingInstancedLayeredEffect);
+
+	if (perPixelLightingLayeredEffect)
+		delete(perPixelLightingLayeredEffect);
+
+	if (perPixelLightingInstancedLayeredEffect)
+		delete(perPixelLightingInstancedLayeredEffect);
+
+	if (skyBoxLayeredEffect)
+		delete(skyBoxLayeredEffect);
+
+	if (reflectionProbeEffect)
+		delete(reflectionProbeEffect);
+
+	if (perPixelLightingParaboloidEffect)
+		delete(perPixelLightingParaboloidEffect);
+
+	if (perPixelLightingInstancedParaboloidEffect)
+		delete(perPixelLightingInstancedParaboloidEffect);
+
+	if (reflectionLightingParaboloidEffect)
+		delete(reflectionLightingParaboloidEffect);
+
+	if (reflectionLightingInstancedParaboloidEffect)
+		delete(reflectionLightingInstancedParaboloidEffect);
+
+	if (reflectionParaboloidEffect)
+		delete(reflectionParaboloidEffect);
+
+	for (size_t i = 0; i < probeTextures.size(); i++) {
+
+		if (probeTextures[i])
+			delete(probeTextures[i]);
+	}
+
+	if (reflectionProbes)
+		reflectionProbes->release();
+
+	if (crowdModel)
+		crowdModel->release();
+
+	if (reflectorModel)
+		reflectorModel->release();
+
+	for (int level = 0; level < CUBEMAP_LEVELS; level++) {
+
+		if (mDynamicCubeMapSRV[level])
+			mDynamicCubeMapSRV[level]->Release();
+
+		if (mDualParaboloidSRV[level])
+			mDualParaboloidSRV[level]->Release();
+
+		for (int i = 0; i < 6; i++) {
+
+			if (mDynamicCubeMapRTV[level][i])
+				mDynamicCubeMapRTV[level][i]->Release();
+		}
+
+		if (mDynamicCubeMapDSV[level])
+			mDynamicCubeMapDSV[level]->Release();
+
+		if (mDynamicCubeMapRTV_SinglePass[level])
+			mDynamicCubeMapRTV_SinglePass[level]->Release();
+
+		if (mDynamicCubeMapDSV_SinglePass[level])
+			mDynamicCubeMapDSV_SinglePass[level]->Release();
+	}
+
+	if (instanceBuffer)
+		instanceBuffer->release();
+
 	//Clean Up- release local interfaces
 
 	if (mainClock)
 		mainClock->release();
 
-	if (cBufferBridge)
-		cBufferBridge->Release();
+	if (simulationClock)
+		simulationClock->release();
 
-	if (cBufferTowerA)
-		cBufferTowerA->Release();
+	for (int i = 0; i < NumViews; i++) {
 
-	if (cBufferKnight)
-		cBufferKnight->Release();
+		if (renderQueues[i])
+			renderQueues[i]->release();
 
-	if(cBufferWalls)
-		cBufferWalls->Release();
+		if (viewCommandLists[i])
+			viewCommandLists[i]->release();
 
-	if (cBufferSkyBox)
-		cBufferSkyBox->Release();
+		if (viewContexts[i])
+			viewContexts[i]->release();
+	}
 
-	if (cBufferSphere)
-		cBufferSphere->Release();
+	Model::setImportPool(nullptr);
 
-	if (bridge)
-		bridge->release();
+	if (workerPool)
+		workerPool->release();
 
-	if (towerA)
-		towerA->release();
+	if (viewCuller)
+		viewCuller->release();
 
-	if (walls)
-		walls->release();
+	if (occlusionCuller)
+		occlusionCuller->release();
 
-	if (knight)
-		knight->release();
+	if (reflectionScheduler)
+		reflectionScheduler->release();
 
-	if (box)
-		box->release();
+	if (constantRing)
+		constantRing->release();
 
-	if (sphere)
-		sphere->release();
+	if (sceneGraph)
+		sceneGraph->release();
 
 	if (dx) {
 
@@ -320,20 +438,24 @@ HRESULT Scene::resizeResources() {
 		RECT clientRect;
 		GetClientRect(wndHandle, &clientRect);
 
-		renderScene();
+		// The main view projection has changed so the per-view constants must be written again before rendering
+		updateAndRenderScene();
 	}
 
 	return S_OK;
 }
 
-// Helper function to call updateScene followed by renderScene
+// Helper function to call updateFrame followed by renderScene
 HRESULT Scene::updateAndRenderScene() {
-	ID3D11DeviceContext *context = dx->getDeviceContext();
-	HRESULT hr = updateScene(context, mainCamera);
+
+	HRESULT hr = updateFrame();
 
 	if (SUCCEEDED(hr))
 		hr = renderScene();
 
+	// Fence the constants written for this frame so the ring does not overwrite them while the GPU may still be reading them
+	constantRing->endFrame(dx->getDeviceContext());
+
 	return hr;
 }
 
@@ -350,258 +472,982 @@ void Scene::stopClock() {
 void Scene::reportTimingData() {
 
 	cout << "Actual time elapsed = " << mainClock->actualTimeElapsed() << endl;
-	cout << "Game time elapsed = " << mainClock->gameTimeElapsed() << endl << endl;
+	cout << "Game time elapsed = " << mainClock->gameTimeElapsed() << endl;
+	cout << "Simulation steps = " << simulationClock->getStepCount() << " at " << simulationClock->getStepRate() << " per second (" << simulationClock->getTimeDropped() << " seconds dropped)" << endl << endl;
 	mainClock->reportTimingData();
 }
 
-//
-// Event handling methods
-//
-// Process mouse move with the left button held down
-void Scene::handleMouseLDrag(const POINT &disp) {
-	//LookAtCamera
-	//mainCamera->rotateElevation((float)-disp.y * 0.01f);
-	//mainCamera->rotateOnYAxis((float)-disp.x * 0.01f);
-
-	//FirstPersonCamera
-	mainCamera->elevate((float)-disp.y * 0.01f);
-	mainCamera->turn((float)-disp.x * 0.01f);
-}
+// Place numInstances copies of the knight on rings around the castle.  The crowd is drawn with hardware instancing and culled against each view every frame.  0 removes the crowd.
+void Scene::setCrowdSize(const int numInstances) {
 
-// Process mouse wheel movement
-void Scene::handleMouseWheel(const short zDelta) {
+	// Innermost ring radius, spacing between rings and between knights on a ring
+	const float crowdRadius = 30.0f;
+	const float crowdSpacing = 4.0f;
 
-	//LookAtCamera
-	/*if (zDelta < 0)
-		mainCamera->zoomCamera(1.2f);
-		else if (zDelta>0)
-		mainCamera->zoomCamera(0.9f);*/
+	// The crowd is reflected so every cube map face must be re-rendered
+	if (reflectionScheduler)
+		reflectionScheduler->requestFullRefresh();
 
-	//FirstPersonCamera
-	mainCamera->move(zDelta*0.01);
-}
+	instancedGroups.clear();
 
-// Process key down event.  keyCode indicates the key pressed while extKeyFlags indicates the extended key status at the time of the key down event (see http://msdn.microsoft.com/en-gb/library/windows/desktop/ms646280%28v=vs.85%29.aspx).
-void Scene::handleKeyDown(const WPARAM keyCode, const LPARAM extKeyFlags) {
-	
-	float x = 0, y = 0, z = 0;
+	if (instanceBuffer) {
 
-	//move reflective sphere (and render target cameras) back to origin
-	if (keyCode == VK_SPACE)
-	{
-		sphereTranslationMatrix = XMMatrixIdentity();
-	
-		for (int i = 0; i < 6; i++)
-			renderTargetCameras[i]->setPos(XMVectorSet(0, 0, 0, 0));
+		instanceBuffer->release();
+		instanceBuffer = nullptr;
+	}
 
+	if (numInstances <= 0 || !crowdModel)
 		return;
+
+	InstancedGroup crowd;
+
+	crowd.model = crowdModel;
+	crowd.effect = perPixelLightingInstancedEffect;
+	crowd.renderFlags = RenderInReflection | RenderInMainView;
+	crowd.reflectionEffect = reflectionLightingInstancedEffect;
+	crowd.reflectionMaxDistance = REFLECTION_CUTOFF_DISTANCE;
+
+	ZeroMemory(crowd.visibleRanges, sizeof(crowd.visibleRanges));
+	ZeroMemory(&crowd.layeredRange, sizeof(crowd.layeredRange));
+	crowd.firstCullIndex = 0;
+
+	XMFLOAT3 modelCentre;
+	float modelRadius;
+
+	crowdModel->getBoundingSphere(&modelCentre, &modelRadius);
+
+	const float scale = 0.05f;
+	int ring = 0, ringSlot = 0;
+
+	for (int i = 0; i < numInstances; i++) {
+
+		float ringRadius = crowdRadius + ring * crowdSpacing;
+		int ringCapacity = max((int)(XM_2PI * ringRadius / crowdSpacing), 1);
+		float angle = XM_2PI * ringSlot / ringCapacity;
+
+		// Turn each knight with its position on the ring so the crowd faces the same way relative to the centre
+		XMMATRIX world = XMMatrixRotationY(XM_PIDIV2 - angle) * XMMatrixScaling(scale, scale, scale) * XMMatrixTranslation(ringRadius * cosf(angle), -3.0f, ringRadius * sinf(angle));
+
+		DXInstanceData instance;
+
+		XMStoreFloat4x4(&instance.worldMatrix, world);
+		XMStoreFloat4x4(&instance.worldITMatrix, XMMatrixTranspose(XMMatrixInverse(nullptr, world)));
+
+		// Vary the tint across the crowd so individual instances can be told apart
+		instance.tint = XMFLOAT4(0.75f + 0.25f * sinf(i * 1.7f), 0.75f + 0.25f * sinf(i * 2.3f + 1.0f), 0.75f + 0.25f * sinf(i * 3.1f + 2.0f), 1.0f);
+
+		XMFLOAT3 centre;
+		XMStoreFloat3(&centre, XMVector3TransformCoord(XMLoadFloat3(&modelCentre), world));
+
+		crowd.instances.push_back(instance);
+		crowd.bounds.push_back(XMFLOAT4(centre.x, centre.y, centre.z, modelRadius * scale));
+
+		if (++ringSlot == ringCapacity) {
+
+			ring++;
+			ringSlot = 0;
+		}
 	}
-	//move reflective sphere up (+y)
-	else if (keyCode == 0x57) //0x57 = "W"
-		y += 0.3;
-	//move reflective sphere left (-x)
-	else if (keyCode == 0x41) //0x41 = "A"
-		x -= 0.3;
-	//move reflective sphere down (-y)
-	else if (keyCode == 0x53) //0x53 = "S"
-		y -= 0.3;
-	//move reflective sphere right (+x)
-	else if (keyCode == 0x44) //0x44 = "D"
-		x += 0.3;
-	//move reflective sphere forwards (+z)
-	else if (keyCode == 0x51) //0x51 = "Q"
-		z += 0.3;
-	//move reflective sphere backwards (-z)
-	else if (keyCode == 0x45) //0x45 = "E"
-		z -= 0.3;
 
-	//combine the new translation matrix with the current sphereTranslationMatrix
-	sphereTranslationMatrix *= XMMatrixTranslation(x, y, z);
+	instancedGroups.push_back(crowd);
 
-	//translate render target cameras along with the sphere so that the positions of reflected objects update correctly as the sphere moves
-	for (int i = 0; i < 6; i++)
-		renderTargetCameras[i]->setPos(renderTargetCameras[i]->getPos() + XMVectorSet(x, y, z, 0));
+	// Every instance may be visible in every view
+	instanceBuffer = new DXInstanceBuffer(dx->getDevice(), (UINT)numInstances * NumViews);
 }
 
-// Process key up event.  keyCode indicates the key released while extKeyFlags indicates the extended key status at the time of the key up event (see http://msdn.microsoft.com/en-us/library/windows/desktop/ms646281%28v=vs.85%29.aspx).
-void Scene::handleKeyUp(const WPARAM keyCode, const LPARAM extKeyFlags) {
+// Set the number of fixed simulation steps per second.  Rendering is not limited by the rate.
+void Scene::setSimulationRate(const double stepsPerSecond) {
 
-	// Add key up handler here...
+	simulationClock->setStepRate(stepsPerSecond);
 }
 
-//
-// Methods to handle initialisation, update and rendering of the scene
-//
+double Scene::getSimulationRate() {
 
+	return simulationClock->getStepRate();
+}
 
-//a second function has been added to 
-HRESULT Scene::rebuildViewport(Camera *camera){
-	// Binds the render target view and depth/stencil view to the pipeline.
-	// Sets up viewport for the main window (wndHandle) 
-	// Called at initialisation or in response to window resize
+// Set the minimum projected diameter in pixels of objects drawn into the cube map faces.  0 disables contribution culling.
+void Scene::setReflectionContributionThreshold(const float pixels) {
 
-	ID3D11DeviceContext *context = dx->getDeviceContext();
+	reflectionContributionThreshold = max(pixels, 0.0f);
 
-	if (!context)
-		return E_FAIL;
+	if (reflectionScheduler)
+		reflectionScheduler->requestFullRefresh();
+}
 
-	// Bind the render target view and depth/stencil view to the pipeline.
-	ID3D11RenderTargetView* renderTargetView = dx->getBackBufferRTV();
-	context->OMSetRenderTargets(1, &renderTargetView, dx->getDepthStencil());
-	// Setup viewport for the main window (wndHandle)
-	RECT clientRect;
-	GetClientRect(wndHandle, &clientRect);
+float Scene::getReflectionContributionThreshold() {
 
-	viewport.TopLeftX = 0;
-	viewport.TopLeftY = 0;
-	viewport.Width = static_cast<FLOAT>(clientRect.right - clientRect.left);
-	viewport.Height = static_cast<FLOAT>(clientRect.bottom - clientRect.top);
-	viewport.MinDepth = 0.0f;
-	viewport.MaxDepth = 1.0f;
-	//Set Viewport
-	context->RSSetViewports(1, &viewport);
+	return reflectionContributionThreshold;
+}
 
-	// Compute the projection matrix.
+// Enable or disable CPU occlusion culling of the main view and of the cube map faces
+void Scene::setOcclusionCulling(const bool mainView, const bool cubeFaces) {
 
-	camera->setProjMatrix(XMMatrixPerspectiveFovLH(0.25f*3.14, viewport.Width / viewport.Height, 1.0f, 1000.0f));
+	occlusionCulling = mainView;
+	cubeFaceOcclusionCulling = cubeFaces;
+}
 
-	return S_OK;
+bool Scene::getOcclusionCulling() {
+
+	return occlusionCulling;
 }
-HRESULT Scene::rebuildRenderTargetViewport(Camera *camera) {
-	// Binds the render target view and depth/stencil view to the pipeline.
-	// Sets up viewport for the main window (wndHandle) 
-	// Called at initialisation or in response to window resize
 
-	ID3D11DeviceContext *context = dx->getDeviceContext();
+bool Scene::getCubeFaceOcclusionCulling() {
 
-	if (!context)
-		return E_FAIL;
+	return cubeFaceOcclusionCulling;
+}
 
-	// Bind the render target view and depth/stencil view to the pipeline.
-	ID3D11RenderTargetView* renderTargetView = dx->getBackBufferRTV();
-	context->OMSetRenderTargets(1, &renderTargetView, dx->getDepthStencil());
-	// Setup viewport for the main window (wndHandle)
-	RECT clientRect;
-	GetClientRect(wndHandle, &clientRect);
+// Enable or disable recording the views on worker threads (see renderScene())
+void Scene::setParallelRecording(const bool enabled) {
 
-	renderTargetViewport.TopLeftX = 0;
-	renderTargetViewport.TopLeftY = 0;
-	renderTargetViewport.Width = static_cast<FLOAT>(CUBEMAP_SIZE);
-	renderTargetViewport.Height = static_cast<FLOAT>(CUBEMAP_SIZE);
-	renderTargetViewport.MinDepth = 0.0f;
-	renderTargetViewport.MaxDepth = 1.0f;
-	//Set Viewport
-	context->RSSetViewports(1, &renderTargetViewport);
+	parallelRecording = enabled;
+}
 
-	// Compute the projection matrix.
+bool Scene::getParallelRecording() {
 
-	//First parameter for projection matrix has been set to 0.5*PI (90 degrees).
-	//This widens the field of view of each camera so that each face of the cube map reflection fits seamlessly with adjacent faces
-	//It also removes the "blind spots" between cube map faces from the reflection
-	camera->setProjMatrix(XMMatrixPerspectiveFovLH(0.5f*3.14, renderTargetViewport.Width / renderTargetViewport.Height, 1.0f, 1000.0f));
+	return parallelRecording;
+}
 
-	return S_OK;
+// Set the number of cube map faces re-rendered per frame in six pass mode (see scheduleCubeFaces())
+void Scene::setCubeFacesPerFrame(const int faces) {
+
+	reflectionScheduler->setFacesPerFrame(faces);
 }
 
-HRESULT Scene::LoadShader(ID3D11Device *device, const char *filename, char **PSBytecode, ID3D11PixelShader **pixelShader){
+int Scene::getCubeFacesPerFrame() {
 
-	char *PSBytecodeLocal;
+	return reflectionScheduler->getFacesPerFrame();
+}
 
-	//Load the compiled shader byte code.
-	uint32_t shaderBytes = DXLoadCSO(filename, &PSBytecodeLocal);
+// Set the distance the cube map centre can move before every face is re-rendered in the same frame
+void Scene::setReflectionRefreshDistance(const float distance) {
 
-	PSBytecode = &PSBytecodeLocal;
-	cout << "Done: PShader memory bytes = " << shaderBytes << endl;
-	// Create shader object
-	HRESULT hr = device->CreatePixelShader(PSBytecodeLocal, shaderBytes, NULL, pixelShader);
+	reflectionRefreshDistance = max(distance, 0.0f);
+}
 
-	if (!SUCCEEDED(hr))
-		throw std::exception("Cannot create PixelShader interface");
-	return hr;
+float Scene::getReflectionRefreshDistance() {
+
+	return reflectionRefreshDistance;
 }
 
-uint32_t Scene::LoadShader(ID3D11Device *device, const char *filename, char **VSBytecode, ID3D11VertexShader **vertexShader){
+// Fix the size of each cube map face (rounded to the size of the nearest cube map level) or, if size is 0, choose it each frame from the projected size of the sphere (see updateCubeMapSize())
+void Scene::setCubeMapSize(const int size) {
 
-	char *VSBytecodeLocal;
+	adaptiveCubeMapSize = (size <= 0);
+	cubeMapShrinkFrames = 0;
 
-	//Load the compiled shader byte code.
-	uint32_t shaderBytes = DXLoadCSO(filename, &VSBytecodeLocal);
+	if (adaptiveCubeMapSize)
+		return;
 
-	cout << "Done: VShader memory bytes = " << shaderBytes << endl;
+	int level = 0;
 
-	*VSBytecode = VSBytecodeLocal;
-	cout << "Done: VShader writting = " << shaderBytes << endl;
-	HRESULT hr = device->CreateVertexShader(VSBytecodeLocal, shaderBytes, NULL, vertexShader);
-	cout << "Done: VShader return = " << hr << endl;
-	if (!SUCCEEDED(hr))
-		throw std::exception("Cannot create VertexShader interface");
-	return shaderBytes;
+	while (level + 1 < CUBEMAP_LEVELS && (CUBEMAP_MAX_SIZE >> (level + 1)) >= size)
+		level++;
+
+	setCubeMapLevel(level);
 }
 
-// Main resource setup for the application.  These are setup around a given Direct3D device.
-HRESULT Scene::initialiseSceneResources() {
-	//ID3D11DeviceContext *context = dx->getDeviceContext();
-	ID3D11Device *device = dx->getDevice();
-	if (!device)
-		return E_FAIL;
+int Scene::getCubeMapSize() {
 
-	//
-	// Setup main pipeline objects
-	//
+	return cubeMapSize;
+}
 
-	// Setup objects for fixed function pipeline stages
-	// Rasterizer Stage
-	// Bind the render target view and depth/stencil view to the pipeline
-	// and sets up viewport for the main window (wndHandle) 
+// Set how the given scene graph node is drawn into the cube map.  proxy (retained) replaces the node's model and effect replaces its effect when they are not nullptr, and the node is not drawn into the cube map when its bounds are further than maxDistance from the cube map centre.
+void Scene::setReflectionLOD(const SceneNode node, DXBaseModel *proxy, Effect *effect, const float maxDistance) {
 
-	// Create main camera
-	mainCamera = new FirstPersonCamera();
-	mainCamera->setPos(XMVectorSet(25, 2, -14.5, 1));
+	if (node < 0)
+		return;
 
-	rebuildViewport(mainCamera);
+	if ((size_t)node >= reflectionLODs.size()) {
 
-	//
-	//Setup of render target cameras
-	//
+		ReflectionLOD noLOD = { nullptr, nullptr, FLT_MAX };
+		reflectionLODs.resize(node + 1, noLOD);
+	}
 
-	//Vectors for render target camera initial position, up direction ("up" relative to camera), and direction each camera is facing towards
-	XMVECTOR pos = XMVectorSet(0, 0, 0, 1);
-	
-	XMVECTOR upDirections[6] = {
-		XMVectorSet(0, 1, 0, 0), //+x
-		XMVectorSet(0, 1, 0, 0), //-x
-		XMVectorSet(0, 0, -1, 0), //+y
-		XMVectorSet(0, 0, 1, 0), //-y
-		XMVectorSet(0, 1, 0, 0), //+z
-		XMVectorSet(0, 1, 0, 0), //-z
-	};
+	ReflectionLOD &lod = reflectionLODs[node];
 
-	//directions each camera will face
-	XMVECTOR faceDirections[6] = {
-		XMVectorSet(1, 0, 0, 1),  //+x
-		XMVectorSet(-1, 0, 0, 1), //-x
-		XMVectorSet(0, 1, 0, 1), //+y    
-		XMVectorSet(0, -1, 0, 1),  //-y
-		XMVectorSet(0, 0, 1, 1),  //+z
-		XMVectorSet(0, 0, -1, 1), //-z
-	};
+	if (proxy)
+		proxy->retain();
 
-	//Initialise each of the render target cameras at the origin, facing in the appropriate direction
-	for (int i = 0; i < 6; i++)
-		renderTargetCameras[i] = new FirstPersonCamera(pos, upDirections[i], faceDirections[i]);
+	if (lod.proxy)
+		lod.proxy->release();
 
-	ID3D11DeviceContext *context = dx->getDeviceContext();
-	if (!context)
-		return E_FAIL;
+	lod.proxy = proxy;
+	lod.effect = effect;
+	lod.maxDistance = maxDistance;
 
-	//Tutorial 04 task 1 create render target texture
+	if (reflectionScheduler)
+		reflectionScheduler->requestFullRefresh();
+}
 
-	D3D11_TEXTURE2D_DESC texDesc;
-	// fill out texture descrition
-	texDesc.Width = CUBEMAP_SIZE;
-	texDesc.Height = CUBEMAP_SIZE;
-	texDesc.MipLevels = 0;
-	texDesc.ArraySize = 6;
+// Enable or disable drawing the reflection LODs (proxies, effects and cutoff distances) of every node and instanced group
+void Scene::setReflectionLODEnabled(const bool enabled) {
+
+	reflectionLOD = enabled;
+
+	if (reflectionScheduler)
+		reflectionScheduler->requestFullRefresh();
+}
+
+bool Scene::getReflectionLODEnabled() {
+
+	return reflectionLOD;
+}
+
+// Select layered (single pass) or six pass rendering of the cube map (see renderScene())
+void Scene::setLayeredCubeMap(const bool enabled) {
+
+	layeredCubeMap = enabled;
+}
+
+// Write a GGX prefiltered copy of the given DDS cube map (see CubeMapFilter) with "_ggx" added to the file name.  Returns false if the cube map cannot be read (only uncompressed 32 bit cube maps are supported) or the copy cannot be written.
+bool Scene::prefilterCubeMap(const string &filename) {
+
+	int size;
+	vector<uint8_t> texels;
+
+	if (!CubeMapFilter::readCubeDDS(filename, &size, &texels)) {
+
+		cout << "Cannot read " << filename << " - only uncompressed 32 bit RGBA and BGRA cube maps can be prefiltered" << endl;
+		return false;
+	}
+
+	int mipLevels = min(PREFILTERED_MIP_LEVELS, CubeMapFilter::getMipLevelCount(size));
+	vector<uint8_t> filtered;
+
+	gu_time_index start = CGDClock::ActualTime();
+
+	CubeMapFilter::prefilterGGX(texels.data(), size, mipLevels, PREFILTER_SAMPLE_COUNT, workerPool, &filtered);
+
+	gu_seconds filterTime = CGDClock::ConvertTimeIntervalToSeconds(CGDClock::ActualTime() - start);
+
+	string outputFilename = filename.substr(0, filename.rfind('.')) + "_ggx.dds";
+
+	if (!ReflectionProbeSet::writeCubeDDS(outputFilename, size, mipLevels, filtered)) {
+
+		cout << "Cannot write " << outputFilename << endl;
+		return false;
+	}
+
+	cout << "Prefiltered " << filename << " (" << size << "x" << size << ", " << mipLevels << " levels) to " << outputFilename << " in " << filterTime << " seconds on " << workerPool->getConcurrency() << " threads" << endl;
+
+	return true;
+}
+
+// Sample the levels of the prefiltered probes by the roughness of the sphere's surface, or always sample the most detailed level
+void Scene::setRoughnessMips(const bool enabled) {
+
+	roughnessMips = enabled;
+}
+
+bool Scene::getRoughnessMips() {
+
+	return roughnessMips;
+}
+
+// Use the static reflection probes (if every probe has been baked) with the cube map holding only the dynamic objects, or render the whole scene into the cube map.  Every face holds the wrong content after a switch.
+void Scene::setReflectionProbesEnabled(const bool enabled) {
+
+	if (enabled == useReflectionProbes)
+		return;
+
+	useReflectionProbes = enabled;
+	probeFacesOccupied = ReflectionScheduler::AllFaces;
+	reflectionScheduler->requestFullRefresh();
+}
+
+bool Scene::getReflectionProbesEnabled() {
+
+	return useReflectionProbes;
+}
+
+bool Scene::getLayeredCubeMap() {
+
+	return layeredCubeMap;
+}
+
+// Reflect a dual paraboloid map in the sphere - the +z and -z cube map cameras render a hemisphere each every frame (see paraboloid_vs) in place of the six cube map faces, and the sphere composites them over the sky cube map.  Each hemisphere covers three times the solid angle of a cube map face at a lower and less even resolution so the mode suits reflectors where the reflection is hard to see.  The reflection probes are not used in dual paraboloid mode.
+void Scene::setDualParaboloid(const bool enabled) {
+
+	if (enabled == dualParaboloid)
+		return;
+
+	dualParaboloid = enabled;
+
+	// The +z and -z faces hold the hemispheres and the other faces are out of date
+	probeFacesOccupied = ReflectionScheduler::AllFaces;
+	reflectionScheduler->requestFullRefresh();
+}
+
+bool Scene::getDualParaboloid() {
+
+	return dualParaboloid;
+}
+
+// Run numFrames frames in each reflection mode (six pass and layered cube map, dual paraboloid) and report the CPU frame time, render queue draws and state binds and the API calls issued per frame of each.  Every mode renders the same scene from the current state so the figures are directly comparable.
+void Scene::compareCubeMapModes(const int numFrames) {
+
+	if (numFrames <= 0)
+		return;
+
+	bool wasLayered = layeredCubeMap;
+	bool wasDualParaboloid = dualParaboloid;
+	bool usedProbes = useReflectionProbes;
+	int facesPerFrame = reflectionScheduler->getFacesPerFrame();
+
+	// Every mode renders the whole scene into every face (or hemisphere) every frame so the comparison measures the full cost of each
+	reflectionScheduler->setFacesPerFrame(ReflectionScheduler::NumFaces);
+	setReflectionProbesEnabled(false);
+
+	cout << "Reflection mode comparison: " << numFrames << " frames per mode" << endl;
+
+	for (int mode = 0; mode < 3; mode++) {
+
+		setLayeredCubeMap(mode == 1);
+		setDualParaboloid(mode == 2);
+
+		dx->getStateFilterContext()->resetCounters();
+
+		for (int i = 0; i < NumViews; i++) {
+
+			renderQueues[i]->resetStats();
+			viewContexts[i]->resetCounters();
+		}
+
+		gu_time_index start = CGDClock::ActualTime();
+
+		for (int i = 0; i < numFrames; i++)
+			updateAndRenderScene();
+
+		gu_seconds totalTime = CGDClock::ConvertTimeIntervalToSeconds(CGDClock::ActualTime() - start);
+
+		uint64_t itemsDrawn = 0, stateBinds = 0;
+		uint64_t issued = dx->getStateFilterContext()->getTotalIssuedCount();
+
+		for (int i = 0; i < NumViews; i++) {
+
+			itemsDrawn += renderQueues[i]->getItemsDrawn();
+			stateBinds += renderQueues[i]->getStateBinds();
+
+			// In parallel mode the passes are recorded through the deferred context filters
+			if (parallelRecording)
+				issued += viewContexts[i]->getTotalIssuedCount();
+		}
+
+		cout << fixed << setprecision(4);
+		cout << ((dualParaboloid) ? "Dual paraboloid (2 passes)" : (layeredCubeMap) ? "Layered (1 cube map pass)" : "Six pass (6 cube map passes)") << ": mean CPU frame time (ms) = " << (totalTime * 1000.0) / numFrames;
+		cout.unsetf(ios::fixed);
+		cout << ", render queue draws per frame = " << (double)itemsDrawn / numFrames << ", state binds per frame = " << (double)stateBinds / numFrames << ", API calls issued per frame = " << (double)issued / numFrames << endl;
+	}
+
+	cout << endl;
+
+	setLayeredCubeMap(wasLayered);
+	setDualParaboloid(wasDualParaboloid);
+	setReflectionProbesEnabled(usedProbes);
+	reflectionScheduler->setFacesPerFrame(facesPerFrame);
+}
+
+// Render the static scene (RenderInProbe nodes) into the cube map at each probe position at the largest cube map size and write each probe to REFLECTION_PROBE_PATH as a GGX prefiltered DDS cube map (see CubeMapFilter).  The sphere is moved to each probe in turn so the cube map cameras follow it.  Not supported by the HEADLESS backend (the NULL device renders nothing).  Returns false if a probe could not be written.
+bool Scene::bakeReflectionProbes() {
+
+	if (dx->getBackend() == DXBackendType::HEADLESS) {
+
+		cout << "Reflection probes cannot be baked with the HEADLESS backend" << endl;
+		return false;
+	}
+
+	DXContext *context = dx->getDeviceContext();
+	ID3D11DeviceContext *d3dContext = dx->getD3DDeviceContext();
+	ID3D11Device *device = dx->getDevice();
+
+	// The cube map is read back through a staging copy
+	ID3D11Resource *cubeMapResource = nullptr;
+	mDynamicCubeMapSRV[0]->GetResource(&cubeMapResource);
+
+	D3D11_TEXTURE2D_DESC stagingDesc;
+	static_cast<ID3D11Texture2D*>(cubeMapResource)->GetDesc(&stagingDesc);
+
+	stagingDesc.Usage = D3D11_USAGE_STAGING;
+	stagingDesc.BindFlags = 0;
+	stagingDesc.CPUAccessFlags = D3D11_CPU_ACCESS_READ;
+	stagingDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+
+	ID3D11Texture2D *stagingTexture = nullptr;
+
+	if (FAILED(device->CreateTexture2D(&stagingDesc, 0, &stagingTexture))) {
+
+		cubeMapResource->Release();
+		cout << "Cannot create the reflection probe staging texture" << endl;
+		return false;
+	}
+
+	// Render the full models at the largest cube map level.  The instanced crowd is dynamic so is not drawn.
+	XMMATRIX anchorMatrix = sceneGraph->getLocalMatrix(sphereAnchorNode);
+	bool wasAdaptive = adaptiveCubeMapSize;
+	int size = cubeMapSize;
+	bool wasLayered = layeredCubeMap;
+	bool wasDualParaboloid = dualParaboloid;
+	bool usedReflectionLOD = reflectionLOD;
+
+	setCubeMapSize(CUBEMAP_MAX_SIZE);
+	setLayeredCubeMap(false);
+	setDualParaboloid(false);
+	reflectionLOD = false;
+	bakingReflectionProbes = true;
+
+	CreateDirectoryA(REFLECTION_PROBE_PATH, NULL);
+
+	const UINT faceBytes = CUBEMAP_MAX_SIZE * CUBEMAP_MAX_SIZE * 4;
+	vector<uint8_t> texels(faceBytes * 6);
+	bool baked = true;
+
+	for (int probe = 0; probe < reflectionProbes->getProbeCount(); probe++) {
+
+		const float *position = reflectionProbes->getProbePosition(probe);
+
+		sceneGraph->setLocalMatrix(sphereAnchorNode, XMMatrixTranslation(position[0], position[1], position[2]), true);
+		simulateStep(simulationClock->getSimulationTime());
+		updateFrame();
+
+		for (int face = 0; face < 6; face++)
+			recordView(context, face);
+
+		// Each probe is a frame of the constant ring - fence its constants so the probes do not accumulate into one allocation
+		constantRing->endFrame(context);
+
+		d3dContext->CopyResource(stagingTexture, cubeMapResource);
+
+		for (int face = 0; face < 6; face++) {
+
+			D3D11_MAPPED_SUBRESOURCE mapped;
+
+			if (FAILED(d3dContext->Map(stagingTexture, D3D11CalcSubresource(0, face, CUBEMAP_LEVELS), D3D11_MAP_READ, 0, &mapped))) {
+
+				baked = false;
+				continue;
+			}
+
+			for (int row = 0; row < CUBEMAP_MAX_SIZE; row++)
+				memcpy(&texels[face * faceBytes + row * CUBEMAP_MAX_SIZE * 4], static_cast<const uint8_t*>(mapped.pData) + row * mapped.RowPitch, CUBEMAP_MAX_SIZE * 4);
+
+			d3dContext->Unmap(stagingTexture, D3D11CalcSubresource(0, face, CUBEMAP_LEVELS));
+		}
+
+		// Rough surfaces sample the smaller levels of the GGX prefiltered mip chain
+		vector<uint8_t> filtered;
+
+		CubeMapFilter::prefilterGGX(texels.data(), CUBEMAP_MAX_SIZE, PREFILTERED_MIP_LEVELS, PREFILTER_SAMPLE_COUNT, workerPool, &filtered);
+
+		string filename = getProbeFilename(probe);
+
+		if (ReflectionProbeSet::writeCubeDDS(filename, CUBEMAP_MAX_SIZE, PREFILTERED_MIP_LEVELS, filtered))
+			cout << "Baked reflection probe " << filename << endl;
+		else {
+
+			cout << "Cannot write reflection probe " << filename << endl;
+			baked = false;
+		}
+	}
+
+	stagingTexture->Release();
+	cubeMapResource->Release();
+
+	bakingReflectionProbes = false;
+	reflectionLOD = usedReflectionLOD;
+	setLayeredCubeMap(wasLayered);
+	setDualParaboloid(wasDualParaboloid);
+	setCubeMapSize((wasAdaptive) ? 0 : size);
+
+	sceneGraph->setLocalMatrix(sphereAnchorNode, anchorMatrix, true);
+	simulateStep(simulationClock->getSimulationTime());
+	reflectionScheduler->requestFullRefresh();
+
+	return baked;
+}
+
+// Render one frame with serial and one with parallel view recording on the HEADLESS backend and check both produce the same sequence of render target, clear and draw commands.  Returns false if they differ or the backend is not HEADLESS.
+bool Scene::verifyParallelRecording() {
+
+	DXRecordingContext *recordingContext = dx->getRecordingContext();
+
+	if (!recordingContext) {
+
+		cout << "Parallel recording check requires the HEADLESS backend" << endl << endl;
+		return false;
+	}
+
+	// State calls differ between the two modes (each deferred context starts from the default state) so only compare the commands that determine the rendered output
+	auto outputCommands = [](const vector<DXCommand> &commands) {
+
+		vector<DXCommand> output;
+
+		for (size_t i = 0; i < commands.size(); ++i) {
+
+			DXCommandType type = commands[i].type;
+
+			if (type == DXCommandType::OMSetRenderTargets || type == DXCommandType::ClearRenderTargetView || type == DXCommandType::ClearDepthStencilView || type == DXCommandType::Draw || type == DXCommandType::DrawIndexed || type == DXCommandType::DrawIndexedInstanced)
+				output.push_back(commands[i]);
+		}
+
+		return output;
+	};
+
+	bool wasParallel = parallelRecording;
+
+	recordingContext->setRecordCommands(true);
+
+	// Both frames are rendered from the same update so they draw the scene in the same state
+	updateFrame();
+
+	setParallelRecording(false);
+	renderScene();
+	vector<DXCommand> serialCommands = outputCommands(recordingContext->getCommands());
+
+	setParallelRecording(true);
+	renderScene();
+	vector<DXCommand> parallelCommands = outputCommands(recordingContext->getCommands());
+
+	constantRing->endFrame(dx->getDeviceContext());
+	setParallelRecording(wasParallel);
+
+	size_t mismatch = 0;
+
+	while (mismatch < serialCommands.size() && mismatch < parallelCommands.size()) {
+
+		const DXCommand &a = serialCommands[mismatch];
+		const DXCommand &b = parallelCommands[mismatch];
+
+		if (a.type != b.type || a.slot != b.slot || a.count != b.count || a.offset != b.offset || a.instanceCount != b.instanceCount || a.startInstance != b.startInstance || a.object != b.object)
+			break;
+
+		mismatch++;
+	}
+
+	bool passed = (serialCommands.size() == parallelCommands.size() && mismatch == serialCommands.size());
+
+	cout << "Parallel recording check: " << serialCommands.size() << " serial and " << parallelCommands.size() << " parallel output commands - ";
+
+	if (passed)
+		cout << "PASSED" << endl << endl;
+	else
+		cout << "FAILED at command " << mismatch << endl << endl;
+
+	return passed;
+}
+
+// Run updateAndRenderScene for numFrames frames back-to-back and report the CPU frame cost and the issued / filtered API call counts of the state filter.  When the HEADLESS backend is in use the recorded API call counts are also reported.
+void Scene::runBenchmark(const int numFrames) {
+
+	DXRecordingContext *recordingContext = dx->getRecordingContext();
+
+	// Only counters are needed for the benchmark so do not retain the command stream of each frame
+	if (recordingContext) {
+
+		recordingContext->setRecordCommands(false);
+		recordingContext->resetCounters();
+	}
+
+	dx->getStateFilterContext()->resetCounters();
+
+	for (int i = 0; i < NumViews; i++) {
+
+		renderQueues[i]->resetStats();
+		viewContexts[i]->resetCounters();
+	}
+
+	reflectionScheduler->resetStats();
+	cubeMapResizes = 0;
+	probeFacesRendered = 0;
+
+	gu_seconds minFrameTime = DBL_MAX;
+	gu_seconds maxFrameTime = 0.0;
+
+	uint64_t benchmarkSteps = simulationClock->getStepCount();
+
+	gu_time_index benchmarkStart = CGDClock::ActualTime();
+
+	for (int i = 0; i < numFrames; i++) {
+
+		gu_time_index frameStart = CGDClock::ActualTime();
+
+		updateAndRenderScene();
+
+		gu_seconds frameTime = CGDClock::ConvertTimeIntervalToSeconds(CGDClock::ActualTime() - frameStart);
+
+		minFrameTime = min(minFrameTime, frameTime);
+		maxFrameTime = max(maxFrameTime, frameTime);
+	}
+
+	gu_seconds totalTime = CGDClock::ConvertTimeIntervalToSeconds(CGDClock::ActualTime() - benchmarkStart);
+
+	cout << "Benchmark: " << numFrames << " frames in " << totalTime << " seconds" << endl;
+
+	if (numFrames > 0) {
+
+		cout << fixed << setprecision(4);
+		cout << "Mean CPU frame time (ms) = " << (totalTime * 1000.0) / numFrames << endl;
+		cout << "Min CPU frame time (ms) = " << minFrameTime * 1000.0 << endl;
+		cout << "Max CPU frame time (ms) = " << maxFrameTime * 1000.0 << endl << endl;
+		cout.unsetf(ios::fixed);
+	}
+
+	cout << "Constant ring maps per frame = " << ((numFrames > 0) ? (double)constantRing->getMapCount() / numFrames : 0.0) << endl;
+	cout << "Constant ring fence stalls = " << constantRing->getStallCount() << endl;
+	cout << "Static constant uploads = " << constantRing->getStaticUploadCount() << endl;
+	cout << "Objects visible in last frame: main view = " << viewCuller->getVisibleCount(MainView) << ", cube faces =";
+
+	for (int i = 0; i < 6; i++)
+		cout << " " << viewCuller->getVisibleCount(i);
+
+	cout << " (of " << viewCuller->getSphereCount() << ", reflection contribution threshold " << reflectionContributionThreshold << " pixels)" << endl;
+	cout << "Objects occluded in last frame: main view = " << objectsOccluded[MainView] << ", cube faces =";
+
+	for (int i = 0; i < 6; i++)
+		cout << " " << objectsOccluded[i];
+
+	cout << " (" << occlusionCuller->getOccluderTriangleCount() << " occluder triangles, " << occlusionCuller->getWidth() << "x" << occlusionCuller->getHeight() << " depth buffer, " << ((occlusionCulling) ? "main view on" : "main view off") << ", " << ((cubeFaceOcclusionCulling) ? "cube faces on" : "cube faces off") << ")" << endl;
+	cout << "Static geometry draws per pass = " << staticBatchDraws << " (batched from " << staticSourceDraws << " sub-mesh draws)" << endl;
+	cout << "Reflection LOD = " << ((reflectionLOD) ? "on" : "off") << " (static geometry " << staticProxyTriangles << " proxy triangles per cube map face for " << staticBatchTriangles << " triangles, " << objectsBeyondReflectionCutoff << " objects beyond the cutoff distance in last frame)" << endl;
+	if (instanceBuffer)
+		cout << "Instances drawn in last frame = " << instanceBuffer->getInstanceCount() << " (" << instancedGroups.size() << " instanced groups)" << endl;
+
+	cout << "Simulation steps = " << simulationClock->getStepCount() - benchmarkSteps << " at " << simulationClock->getStepRate() << " per second" << endl;
+	cout << "Scene graph world transforms updated in last simulation step = " << sceneGraph->getNodesUpdated() << " of " << sceneGraph->getNodeCount() << endl;
+
+	if (numFrames > 0) {
+
+		uint64_t itemsDrawn = 0, effectBinds = 0, textureBinds = 0, geometryBinds = 0;
+
+		for (int i = 0; i < NumViews; i++) {
+
+			itemsDrawn += renderQueues[i]->getItemsDrawn();
+			effectBinds += renderQueues[i]->getEffectBinds();
+			textureBinds += renderQueues[i]->getTextureBinds();
+			geometryBinds += renderQueues[i]->getGeometryBinds();
+		}
+
+		cout << "Render queue draws per frame = " << (double)itemsDrawn / numFrames << endl;
+		cout << "Render queue state binds per frame = " << (double)(effectBinds + textureBinds + geometryBinds) / numFrames;
+		cout << " (effect " << (double)effectBinds / numFrames << ", texture " << (double)textureBinds / numFrames << ", geometry " << (double)geometryBinds / numFrames << ")" << endl;
+	}
+
+	cout << "Reflection rendering = " << ((dualParaboloid) ? "dual paraboloid (two passes)" : (layeredCubeMap) ? "layered cube map (single pass)" : "six pass cube map") << endl;
+	if (useReflectionProbes && reflectionProbesLoaded && !dualParaboloid)
+		cout << "Reflection probes = on (" << reflectionProbes->getProbeCount() << " probes, roughness mips " << ((roughnessMips) ? "on" : "off") << ", blending probes " << blendedProbeA << " and " << blendedProbeB << " in last frame, " << ((numFrames > 0) ? (double)probeFacesRendered / numFrames : 0.0) << " cube map faces of dynamic objects rendered per frame)" << endl;
+	else
+		cout << "Reflection probes = " << ((useReflectionProbes && !dualParaboloid) ? "not baked" : "off") << endl;
+
+	cout << "Cube map size = " << cubeMapSize << "x" << cubeMapSize << " in last frame (" << ((adaptiveCubeMapSize) ? "adaptive" : "fixed") << ", " << cubeMapResizes << " size changes)" << endl;
+
+	if (!layeredCubeMap && !dualParaboloid && numFrames > 0)
+		cout << "Cube map faces rendered per frame = " << (double)reflectionScheduler->getFacesRendered() / numFrames << " (budget " << reflectionScheduler->getFacesPerFrame() << " faces per frame, " << reflectionScheduler->getFullRefreshes() << " full refreshes)" << endl;
+
+	cout << "View recording = " << ((parallelRecording) ? "parallel" : "serial") << " (" << workerPool->getConcurrency() << " recording threads available)" << endl << endl;
+
+	// Calls reported as filtered were made by the scene but dropped before reaching the backend as they did not change the bound state.  In parallel mode the views are recorded through the deferred context filters.
+	dx->getStateFilterContext()->reportCallCounts();
+
+	if (parallelRecording) {
+
+		uint64_t issued = 0, filtered = 0;
+
+		for (int i = 0; i < NumViews; i++) {
+
+			issued += viewContexts[i]->getTotalIssuedCount();
+			filtered += viewContexts[i]->getTotalFilteredCount();
+		}
+
+		cout << "Deferred context calls per frame: issued = " << ((numFrames > 0) ? (double)issued / numFrames : 0.0) << ", filtered = " << ((numFrames > 0) ? (double)filtered / numFrames : 0.0) << endl << endl;
+	}
+
+	if (recordingContext)
+		recordingContext->reportCallCounts();
+}
+
+//
+// Event handling methods
+//
+// Process mouse move with the left button held down
+void Scene::handleMouseLDrag(const POINT &disp) {
+	//LookAtCamera
+	//mainCamera->rotateElevation((float)-disp.y * 0.01f);
+	//mainCamera->rotateOnYAxis((float)-disp.x * 0.01f);
+
+	//FirstPersonCamera
+	mainCamera->elevate((float)-disp.y * 0.01f);
+	mainCamera->turn((float)-disp.x * 0.01f);
+}
+
+// Process mouse wheel movement
+void Scene::handleMouseWheel(const short zDelta) {
+
+	//LookAtCamera
+	/*if (zDelta < 0)
+		mainCamera->zoomCamera(1.2f);
+		else if (zDelta>0)
+		mainCamera->zoomCamera(0.9f);*/
+
+	//FirstPersonCamera
+	mainCamera->move(zDelta*0.01);
+}
+
+// Process key down event.  keyCode indicates the key pressed while extKeyFlags indicates the extended key status at the time of the key down event (see http://msdn.microsoft.com/en-gb/library/windows/desktop/ms646280%28v=vs.85%29.aspx).
+void Scene::handleKeyDown(const WPARAM keyCode, const LPARAM extKeyFlags) {
+	
+	float x = 0, y = 0, z = 0;
+
+	//move reflective sphere (and render target cameras) back to origin.  Moves of the sphere are picked up by the reflection scheduler (see scheduleCubeFaces()).
+	if (keyCode == VK_SPACE)
+	{
+		sceneGraph->setLocalMatrix(sphereAnchorNode, XMMatrixIdentity(), true);
+
+		return;
+	}
+	//toggle recording the views on worker threads
+	else if (keyCode == 0x50) //0x50 = "P"
+	{
+		setParallelRecording(!parallelRecording);
+		cout << "Parallel view recording " << ((parallelRecording) ? "on" : "off") << endl;
+
+		return;
+	}
+	//toggle layered (single pass) cube map rendering
+	else if (keyCode == 0x4C) //0x4C = "L"
+	{
+		setLayeredCubeMap(!layeredCubeMap);
+		cout << "Layered cube map " << ((layeredCubeMap) ? "on" : "off") << endl;
+
+		return;
+	}
+	//toggle dual paraboloid reflection
+	else if (keyCode == 0x48) //0x48 = "H"
+	{
+		setDualParaboloid(!dualParaboloid);
+		cout << "Dual paraboloid reflection " << ((dualParaboloid) ? "on" : "off") << endl;
+
+		return;
+	}
+	//toggle the static reflection probes
+	else if (keyCode == 0x52) //0x52 = "R"
+	{
+		setReflectionProbesEnabled(!useReflectionProbes);
+		cout << "Reflection probes " << ((useReflectionProbes && reflectionProbesLoaded) ? "on" : (useReflectionProbes) ? "on (not baked)" : "off") << endl;
+
+		return;
+	}
+	//toggle occlusion culling of the main view
+	else if (keyCode == 0x4F) //0x4F = "O"
+	{
+		setOcclusionCulling(!occlusionCulling, cubeFaceOcclusionCulling);
+		cout << "Occlusion culling " << ((occlusionCulling) ? "on" : "off") << endl;
+
+		return;
+	}
+	//move reflective sphere up (+y)
+	else if (keyCode == 0x57) //0x57 = "W"
+		y += 0.3;
+	//move reflective sphere left (-x)
+	else if (keyCode == 0x41) //0x41 = "A"
+		x -= 0.3;
+	//move reflective sphere down (-y)
+	else if (keyCode == 0x53) //0x53 = "S"
+		y -= 0.3;
+	//move reflective sphere right (+x)
+	else if (keyCode == 0x44) //0x44 = "D"
+		x += 0.3;
+	//move reflective sphere forwards (+z)
+	else if (keyCode == 0x51) //0x51 = "Q"
+		z += 0.3;
+	//move reflective sphere backwards (-z)
+	else if (keyCode == 0x45) //0x45 = "E"
+		z -= 0.3;
+
+	//combine the new translation matrix with the current sphere translation.  The sphere, fire and second light are children of the anchor node so follow it on the next scene graph update.
+	if (x != 0 || y != 0 || z != 0)
+		sceneGraph->setLocalMatrix(sphereAnchorNode, sceneGraph->getLocalMatrix(sphereAnchorNode) * XMMatrixTranslation(x, y, z));
+}
+
+// Process key up event.  keyCode indicates the key released while extKeyFlags indicates the extended key status at the time of the key up event (see http://msdn.microsoft.com/en-us/library/windows/desktop/ms646281%28v=vs.85%29.aspx).
+void Scene::handleKeyUp(const WPARAM keyCode, const LPARAM extKeyFlags) {
+
+	// Add key up handler here...
+}
+
+//
+// Methods to handle initialisation, update and rendering of the scene
+//
+
+
+//a second function has been added to 
+HRESULT Scene::rebuildViewport(Camera *camera){
+	// Binds the render target view and depth/stencil view to the pipeline.
+	// Sets up viewport for the main window (wndHandle) 
+	// Called at initialisation or in response to window resize
+
+	DXContext *context = dx->getDeviceContext();
+
+	if (!context)
+		return E_FAIL;
+
+	// Bind the render target view and depth/stencil view to the pipeline.
+	ID3D11RenderTargetView* renderTargetView = dx->getBackBufferRTV();
+	context->OMSetRenderTargets(1, &renderTargetView, dx->getDepthStencil());
+	// Setup viewport for the main window (wndHandle)
+	RECT clientRect;
+	GetClientRect(wndHandle, &clientRect);
+
+	viewport.TopLeftX = 0;
+	viewport.TopLeftY = 0;
+	viewport.Width = static_cast<FLOAT>(clientRect.right - clientRect.left);
+	viewport.Height = static_cast<FLOAT>(clientRect.bottom - clientRect.top);
+	viewport.MinDepth = 0.0f;
+	viewport.MaxDepth = 1.0f;
+	//Set Viewport
+	context->RSSetViewports(1, &viewport);
+
+	// Compute the projection matrix.
+
+	camera->setProjMatrix(XMMatrixPerspectiveFovLH(0.25f*3.14, viewport.Width / viewport.Height, 1.0f, FAR_DEPTH));
+
+	return S_OK;
+}
+HRESULT Scene::rebuildRenderTargetViewport(Camera *camera) {
+	// Binds the render target view and depth/stencil view to the pipeline.
+	// Sets up viewport for the main window (wndHandle) 
+	// Called at initialisation or in response to window resize
+
+	DXContext *context = dx->getDeviceContext();
+
+	if (!context)
+		return E_FAIL;
+
+	// Bind the render target view and depth/stencil view to the pipeline.
+	ID3D11RenderTargetView* renderTargetView = dx->getBackBufferRTV();
+	context->OMSetRenderTargets(1, &renderTargetView, dx->getDepthStencil());
+	// Setup viewport for the main window (wndHandle)
+	RECT clientRect;
+	GetClientRect(wndHandle, &clientRect);
+
+	renderTargetViewport.TopLeftX = 0;
+	renderTargetViewport.TopLeftY = 0;
+	renderTargetViewport.Width = static_cast<FLOAT>(cubeMapSize);
+	renderTargetViewport.Height = static_cast<FLOAT>(cubeMapSize);
+	renderTargetViewport.MinDepth = 0.0f;
+	renderTargetViewport.MaxDepth = 1.0f;
+	//Set Viewport
+	context->RSSetViewports(1, &renderTargetViewport);
+
+	// Compute the projection matrix.
+
+	//First parameter for projection matrix has been set to 0.5*PI (90 degrees).
+	//This widens the field of view of each camera so that each face of the cube map reflection fits seamlessly with adjacent faces
+	//It also removes the "blind spots" between cube map faces from the reflection
+	camera->setProjMatrix(XMMatrixPerspectiveFovLH(0.5f*3.14, renderTargetViewport.Width / renderTargetViewport.Height, 1.0f, FAR_DEPTH));
+
+	return S_OK;
+}
+
+HRESULT Scene::LoadShader(ID3D11Device *device, const char *filename, char **PSBytecode, ID3D11PixelShader **pixelShader){
+
+	char *PSBytecodeLocal;
+
+	//Load the compiled shader byte code.
+	uint32_t shaderBytes = DXLoadCSO(filename, &PSBytecodeLocal);
+
+	PSBytecode = &PSBytecodeLocal;
+	cout << "Done: PShader memory bytes = " << shaderBytes << endl;
+	// Create shader object
+	HRESULT hr = device->CreatePixelShader(PSBytecodeLocal, shaderBytes, NULL, pixelShader);
+
+	if (!SUCCEEDED(hr))
+		throw std::exception("Cannot create PixelShader interface");
+	return hr;
+}
+
+uint32_t Scene::LoadShader(ID3D11Device *device, const char *filename, char **VSBytecode, ID3D11VertexShader **vertexShader){
+
+	char *VSBytecodeLocal;
+
+	//Load the compiled shader byte code.
+	uint32_t shaderBytes = DXLoadCSO(filename, &VSBytecodeLocal);
+
+	cout << "Done: VShader memory bytes = " << shaderBytes << endl;
+
+	*VSBytecode = VSBytecodeLocal;
+	cout << "Done: VShader writting = " << shaderBytes << endl;
+	HRESULT hr = device->CreateVertexShader(VSBytecodeLocal, shaderBytes, NULL, vertexShader);
+	cout << "Done: VShader return = " << hr << endl;
+	if (!SUCCEEDED(hr))
+		throw std::exception("Cannot create VertexShader interface");
+	return shaderBytes;
+}
+
+// Main resource setup for the application.  These are setup around a given Direct3D device.
+HRESULT Scene::initialiseSceneResources() {
+	//DXContext *context = dx->getDeviceContext();
+	ID3D11Device *device = dx->getDevice();
+	if (!device)
+		return E_FAIL;
+
+	//
+	// Setup main pipeline objects
+	//
+
+	// Setup objects for fixed function pipeline stages
+	// Rasterizer Stage
+	// Bind the render target view and depth/stencil view to the pipeline
+	// and sets up viewport for the main window (wndHandle) 
+
+	// Create main camera
+	mainCamera = new FirstPersonCamera();
+	mainCamera->setPos(XMVectorSet(25, 2, -14.5, 1));
+
+	rebuildViewport(mainCamera);
+
+	//
+	//Setup of render target cameras
+	//
+
+	//Vectors for render target camera initial position, up direction ("up" relative to camera), and direction each camera is facing towards
+	XMVECTOR pos = XMVectorSet(0, 0, 0, 1);
+	
+	XMVECTOR upDirections[6] = {
+		XMVectorSet(0, 1, 0, 0), //+x
+		XMVectorSet(0, 1, 0, 0), //-x
+		XMVectorSet(0, 0, -1, 0), //+y
+		XMVectorSet(0, 0, 1, 0), //-y
+		XMVectorSet(0, 1, 0, 0), //+z
+		XMVectorSet(0, 1, 0, 0), //-z
+	};
+
+	//directions each camera will face
+	XMVECTOR faceDirections[6] = {
+		XMVectorSet(1, 0, 0, 1),  //+x
+		XMVectorSet(-1, 0, 0, 1), //-x
+		XMVectorSet(0, 1, 0, 1), //+y    
+		XMVectorSet(0, -1, 0, 1),  //-y
+		XMVectorSet(0, 0, 1, 1),  //+z
+		XMVectorSet(0, 0, -1, 1), //-z
+	};
+
+	//Initialise each of the render target cameras at the origin, facing in the appropriate direction
+	for (int i = 0; i < 6; i++)
+		renderTargetCameras[i] = new FirstPersonCamera(pos, upDirections[i], faceDirections[i]);
+
+	DXContext *context = dx->getDeviceContext();
+	if (!context)
+		return E_FAIL;
+
+	//Tutorial 04 task 1 create render target texture
+
+	// The cube map is created once at its largest size.  Each mip level is a complete cube map half the size of the level above so changing the resolution (see updateCubeMapSize()) switches the level rendered and sampled rather than recreating the texture.
+	D3D11_TEXTURE2D_DESC texDesc;
+	// fill out texture descrition
+	texDesc.Width = CUBEMAP_MAX_SIZE;
+	texDesc.Height = CUBEMAP_MAX_SIZE;
+	texDesc.MipLevels = CUBEMAP_LEVELS;
+	texDesc.ArraySize = 6;
 	//texDesc.SampleDesc.Count = 8; // Multi-sample properties much match the above DXGI_SWAP_CHAIN_DESC structure
 	texDesc.SampleDesc.Count = 1;
 	texDesc.SampleDesc.Quality = 0;
@@ -609,516 +1455,1303 @@ HRESULT Scene::initialiseSceneResources() {
 	texDesc.Usage = D3D11_USAGE_DEFAULT;
 	texDesc.BindFlags = D3D11_BIND_RENDER_TARGET | D3D11_BIND_SHADER_RESOURCE;
 	texDesc.CPUAccessFlags = 0;
-	texDesc.MiscFlags = D3D11_RESOURCE_MISC_GENERATE_MIPS | D3D11_RESOURCE_MISC_TEXTURECUBE;
+	texDesc.MiscFlags = D3D11_RESOURCE_MISC_TEXTURECUBE;
+
+	//Create Texture
+	ID3D11Texture2D* renderTargetTexture = nullptr;
+	HRESULT hr = device->CreateTexture2D(&texDesc, 0, &renderTargetTexture);
+
+	//Create render target view
+	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc;
+	rtvDesc.Format = texDesc.Format;
+	rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY; //was "...TEXTURE2DMS"
+	rtvDesc.Texture2DArray.ArraySize = 1;
+
+	// Create the 6-face render target view
+	// Used by the layered cube map pass - the geometry shader selects the face of each triangle
+	D3D11_RENDER_TARGET_VIEW_DESC DescRT;
+	DescRT.Format = texDesc.Format;
+	DescRT.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
+	DescRT.Texture2DArray.FirstArraySlice = 0;
+	DescRT.Texture2DArray.ArraySize = 6;
+
+	//Create shader resource view - each view samples a single level
+	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
+	srvDesc.Format = texDesc.Format;
+	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
+	srvDesc.TextureCube.MipLevels = 1;
+
+	//Create the dual paraboloid shader resource view - the +z and -z faces of a single level
+	D3D11_SHADER_RESOURCE_VIEW_DESC paraboloidSRVDesc;
+	paraboloidSRVDesc.Format = texDesc.Format;
+	paraboloidSRVDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2DARRAY;
+	paraboloidSRVDesc.Texture2DArray.MipLevels = 1;
+	paraboloidSRVDesc.Texture2DArray.FirstArraySlice = 4;
+	paraboloidSRVDesc.Texture2DArray.ArraySize = 2;
+
+	for (int level = 0; level < CUBEMAP_LEVELS; level++)
+	{
+		rtvDesc.Texture2DArray.MipSlice = level;
+
+		for (int i = 0; i < 6; i++)
+		{
+			rtvDesc.Texture2DArray.FirstArraySlice = i;
+
+			hr = device->CreateRenderTargetView(renderTargetTexture, &rtvDesc, &mDynamicCubeMapRTV[level][i]);
+		}
+
+		DescRT.Texture2DArray.MipSlice = level;
+		hr = device->CreateRenderTargetView(renderTargetTexture, &DescRT, &mDynamicCubeMapRTV_SinglePass[level]);
+
+		srvDesc.TextureCube.MostDetailedMip = level;
+		hr = device->CreateShaderResourceView(renderTargetTexture, &srvDesc, &mDynamicCubeMapSRV[level]);
+
+		paraboloidSRVDesc.Texture2DArray.MostDetailedMip = level;
+		hr = device->CreateShaderResourceView(renderTargetTexture, &paraboloidSRVDesc, &mDualParaboloidSRV[level]);
+	}
+
+	// View saves reference.
+	renderTargetTexture->Release();
+
+	D3D11_TEXTURE2D_DESC depthTexDesc;
+	depthTexDesc.Width = CUBEMAP_MAX_SIZE;
+	depthTexDesc.Height = CUBEMAP_MAX_SIZE;
+	depthTexDesc.MipLevels = CUBEMAP_LEVELS;
+	depthTexDesc.ArraySize = 6;
+	depthTexDesc.SampleDesc.Count = 1;
+	depthTexDesc.SampleDesc.Quality = 0;
+	depthTexDesc.Format = DXGI_FORMAT_D32_FLOAT;
+	depthTexDesc.Usage = D3D11_USAGE_DEFAULT;
+	depthTexDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
+	depthTexDesc.CPUAccessFlags = 0;
+	depthTexDesc.MiscFlags = 0;
+
+	// One depth slice per cube map face so the layered pass can write every face at once and one level per cube map level
+	ID3D11Texture2D* depthTex = 0;
+	hr = device->CreateTexture2D(&depthTexDesc, 0, &depthTex);
+
+	// Create the depth stencil view of the first slice.  The six pass path renders the faces one after another so they share it.
+	D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
+	dsvDesc.Format = depthTexDesc.Format;
+	dsvDesc.Flags = 0;
+	dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+	dsvDesc.Texture2DArray.FirstArraySlice = 0;
+	dsvDesc.Texture2DArray.ArraySize = 1;
+
+	// Create the depth stencil view for the entire cube
+	// Used by the layered cube map pass
+	D3D11_DEPTH_STENCIL_VIEW_DESC DescDS;
+	DescDS.Format = depthTexDesc.Format;
+	DescDS.Flags = 0;
+	DescDS.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
+	DescDS.Texture2DArray.FirstArraySlice = 0;
+	DescDS.Texture2DArray.ArraySize = 6;
+
+	for (int level = 0; level < CUBEMAP_LEVELS; level++)
+	{
+		dsvDesc.Texture2DArray.MipSlice = level;
+		hr = device->CreateDepthStencilView(depthTex, &dsvDesc, &mDynamicCubeMapDSV[level]);
+
+		DescDS.Texture2DArray.MipSlice = level;
+		hr = device->CreateDepthStencilView(depthTex, &DescDS, &mDynamicCubeMapDSV_SinglePass[level]);
+	}
+
+	// Views save reference.
+	depthTex->Release();
+
+	//set up viewport
+	renderTargetViewport.TopLeftX = 0.0f;
+	renderTargetViewport.TopLeftY = 0.0f;
+	renderTargetViewport.Width = (float)cubeMapSize;
+	renderTargetViewport.Height = (float)cubeMapSize;
+	renderTargetViewport.MinDepth = 0.0f;
+	renderTargetViewport.MaxDepth = 1.0f;
+
+	// Setup CBuffers
+	cBufferPerFrameSrc = (CBufferPerFrame*)_aligned_malloc(sizeof(CBufferPerFrame), 16);
+
+	// Initialise CBuffers
+	ZeroMemory(cBufferPerFrameSrc, sizeof(CBufferPerFrame));
+
+	cBufferPerFrameSrc->lightVec = XMFLOAT4(250.0, -130.0, -145.0, 0.0); // Directional light
+	cBufferPerFrameSrc->lightAmbient = XMFLOAT4(0.3, 0.3, 0.3, 1.0);
+	cBufferPerFrameSrc->lightDiffuse = XMFLOAT4(0.8, 0.8, 0.8, 1.0);
+	cBufferPerFrameSrc->lightSpecular = XMFLOAT4(1.0, 1.0, 1.0, 1.0);
+
+	XMStoreFloat4(&cBufferPerFrameSrc->light2Vec, originalLight2Vec); // Positional light
+	cBufferPerFrameSrc->light2Ambient = XMFLOAT4(0.1, 0.1, 0.1, 1.0);
+	cBufferPerFrameSrc->light2Diffuse = XMFLOAT4(0.1, 0.1, 0.4, 1.0);
+	cBufferPerFrameSrc->light2Specular = XMFLOAT4(1.0, 1.0, 1.0, 1.0);
+
+	// All constants are sub-allocated from a single dynamic buffer and bound by offset.  Devices without Direct3D 11.1 constant buffer offsetting bind each range through a small discarded buffer instead.
+	constantRing = new DXConstantRing(device, CONSTANT_RING_SIZE, dx->supportsConstantBufferOffsetting());
+
+	// Each view has its own render queue and deferred context so all views can be recorded concurrently (see renderScene())
+	for (int i = 0; i < NumViews; i++) {
+
+		renderQueues[i] = new DXRenderQueue();
+		viewContexts[i] = dx->createDeferredContext();
+	}
+
+	// No more threads than views are needed - the rendering thread records views while it waits
+	workerPool = new WorkerPool(max(min((int)thread::hardware_concurrency(), (int)NumViews) - 1, 0));
+
+	// Models are parsed on the same pool
+	Model::setImportPool(workerPool);
+
+	viewCuller = new FrustumCuller();
+	occlusionCuller = new OcclusionCuller(NumViews, OCCLUSION_BUFFER_SIZE, OCCLUSION_BUFFER_SIZE);
+	reflectionScheduler = new ReflectionScheduler(CUBE_FACES_PER_FRAME);
+
+	ZeroMemory(objectsOccluded, sizeof(objectsOccluded));
+
+	// The per-view constants of every view are written at the start of the frame so the projection matrix of each render target camera must be set up front
+	for (int i = 0; i < 6; i++)
+		rebuildRenderTargetViewport(renderTargetCameras[i]);
+
+	rebuildViewport(mainCamera);
+
+	// Setup example objects
+
+	mattWhite.setSpecular(XMCOLOR(0, 0, 0, 0));
+	glossWhite.setSpecular(XMCOLOR(1, 1, 1, 1));
+
+	//
+	// Load the effects, textures and models as a task graph.  Shaders are read, textures decoded and models imported on the worker pool as soon as what they depend on has loaded - the device is free-threaded so each task creates its own resources.  The scene graph is assembled on this thread once its models have loaded so nodes are added in a fixed order.  Each model's import is also spread across the pool (see Model::setImportPool()) - the import waits only for its own tasks, helping to run them, so it can wait from inside a load task.
+	//
+
+	TaskGraph *loadGraph = new TaskGraph(workerPool);
+	const vector<TaskGraph::Task> noDependencies;
+
+	// Add a task creating an effect - gsPath is nullptr for effects without a geometry shader
+	auto addEffect = [&](Effect **effect, const char *vsPath, const char *psPath, const char *gsPath, const D3D11_INPUT_ELEMENT_DESC *vertexDesc, const UINT numVertexElements) -> TaskGraph::Task {
+
+		return loadGraph->addTask(string("Effect ") + vsPath + " " + psPath + ((gsPath) ? string(" ") + gsPath : string()), TaskGraph::Affinity::AnyThread, noDependencies, [=]() {
+
+			*effect = (gsPath) ? new Effect(device, vsPath, psPath, gsPath, vertexDesc, numVertexElements) : new Effect(device, vsPath, psPath, vertexDesc, numVertexElements);
+		});
+	};
+
+	// Add a task loading a texture.  WIC decodes images through COM so COM is initialised on the thread that runs the task.
+	auto addTexture = [&](Texture **texture, const wchar_t *filename) -> TaskGraph::Task {
+
+		wstring path(filename);
+
+		return loadGraph->addTask("Texture " + string(path.begin(), path.end()), TaskGraph::Affinity::AnyThread, noDependencies, [=]() {
+
+			HRESULT hr = CoInitializeEx(NULL, COINIT_MULTITHREADED);
+
+			*texture = new Texture(device, path);
+
+			if (SUCCEEDED(hr))
+				CoUninitialize();
+		});
+	};
+
+	// Add a task loading a model with a single texture once its effect and texture have loaded
+	auto addModel = [&](Model **model, const wchar_t *filename, Effect **effect, Texture **texture, Material *material, const bool keepMeshData, const vector<TaskGraph::Task> &dependencies) -> TaskGraph::Task {
+
+		wstring path(filename);
+
+		return loadGraph->addTask("Model " + string(path.begin(), path.end()), TaskGraph::Affinity::AnyThread, dependencies, [=]() {
+
+			*model = new Model(device, *effect, path, (*texture)->SRV, material, keepMeshData);
+		});
+	};
+
+	// Setup objects for the programmable (shader) stages of the pipeline
+
+	TaskGraph::Task perPixelLightingTask = addEffect(&perPixelLightingEffect, "Shaders\\cso\\per_pixel_lighting_vs.cso", "Shaders\\cso\\per_pixel_lighting_ps.cso", nullptr, compactVertexDesc, ARRAYSIZE(compactVertexDesc));
+	TaskGraph::Task skyBoxTask = addEffect(&skyBoxEffect, "Shaders\\cso\\sky_box_vs.cso", "Shaders\\cso\\sky_box_ps.cso", nullptr, compactVertexDesc, ARRAYSIZE(compactVertexDesc));
+	addEffect(&basicEffect, "Shaders\\cso\\basic_texture_vs.cso", "Shaders\\cso\\basic_texture_ps.cso", nullptr, basicVertexDesc, ARRAYSIZE(basicVertexDesc));
+	TaskGraph::Task fireTask = addEffect(&fireEffect, "Shaders\\cso\\fire_vs.cso", "Shaders\\cso\\fire_ps.cso", "Shaders\\cso\\fire_gs.cso", particleVertexDesc, ARRAYSIZE(particleVertexDesc));
+
+	//Used for standard implementation of reflection
+	TaskGraph::Task refMapTask = addEffect(&refMapEffect, "Shaders\\cso\\reflection_map_vs.cso", "Shaders\\cso\\reflection_map_ps.cso", nullptr, compactVertexDesc, ARRAYSIZE(compactVertexDesc));
+
+	//Instanced variants - same pixel shaders, world transforms and tint read from vertex stream 1
+	addEffect(&perPixelLightingInstancedEffect, "Shaders\\cso\\per_pixel_lighting_instanced_vs.cso", "Shaders\\cso\\per_pixel_lighting_ps.cso", nullptr, instancedCompactVertexDesc, ARRAYSIZE(instancedCompactVertexDesc));
+	addEffect(&refMapInstancedEffect, "Shaders\\cso\\reflection_map_instanced_vs.cso", "Shaders\\cso\\reflection_map_ps.cso", nullptr, instancedCompactVertexDesc, ARRAYSIZE(instancedCompactVertexDesc));
+
+	//Layered variants used to render the cube map in a single pass - the geometry shaders emit each triangle to the cube map faces it may be seen by.  The sky box vertex shader outputs the world space position for its geometry shader to project.
+	addEffect(&perPixelLightingLayeredEffect, "Shaders\\cso\\per_pixel_lighting_vs.cso", "Shaders\\cso\\per_pixel_lighting_ps.cso", "Shaders\\cso\\reflection_map_gs.cso", compactVertexDesc, ARRAYSIZE(compactVertexDesc));
+	addEffect(&perPixelLightingInstancedLayeredEffect, "Shaders\\cso\\per_pixel_lighting_instanced_vs.cso", "Shaders\\cso\\per_pixel_lighting_ps.cso", "Shaders\\cso\\reflection_map_gs.cso", instancedCompactVertexDesc, ARRAYSIZE(instancedCompactVertexDesc));
+	addEffect(&skyBoxLayeredEffect, "Shaders\\cso\\sky_box_layered_vs.cso", "Shaders\\cso\\sky_box_ps.cso", "Shaders\\cso\\sky_box_gs.cso", compactVertexDesc, ARRAYSIZE(compactVertexDesc));
+
+	//Simplified lighting for objects drawn into the cube map (see setReflectionLOD())
+	TaskGraph::Task reflectionLightingTask = addEffect(&reflectionLightingEffect, "Shaders\\cso\\per_pixel_lighting_vs.cso", "Shaders\\cso\\reflection_lighting_ps.cso", nullptr, compactVertexDesc, ARRAYSIZE(compactVertexDesc));
+	addEffect(&reflectionLightingInstancedEffect, "Shaders\\cso\\per_pixel_lighting_instanced_vs.cso", "Shaders\\cso\\reflection_lighting_ps.cso", nullptr, instancedCompactVertexDesc, ARRAYSIZE(instancedCompactVertexDesc));
+	addEffect(&reflectionLightingLayeredEffect, "Shaders\\cso\\per_pixel_lighting_vs.cso", "Shaders\\cso\\reflection_lighting_ps.cso", "Shaders\\cso\\reflection_map_gs.cso", compactVertexDesc, ARRAYSIZE(compactVertexDesc));
+	addEffect(&reflectionLightingInstancedLayeredEffect, "Shaders\\cso\\per_pixel_lighting_instanced_vs.cso", "Shaders\\cso\\reflection_lighting_ps.cso", "Shaders\\cso\\reflection_map_gs.cso", instancedCompactVertexDesc, ARRAYSIZE(instancedCompactVertexDesc));
+
+	addEffect(&reflectionProbeEffect, "Shaders\\cso\\reflection_map_vs.cso", "Shaders\\cso\\reflection_probe_ps.cso", nullptr, compactVertexDesc, ARRAYSIZE(compactVertexDesc));
+
+	//Dual paraboloid variants - the vertex shaders project onto the paraboloid of the view's hemisphere (see setDualParaboloid())
+	addEffect(&perPixelLightingParaboloidEffect, "Shaders\\cso\\paraboloid_vs.cso", "Shaders\\cso\\per_pixel_lighting_ps.cso", nullptr, compactVertexDesc, ARRAYSIZE(compactVertexDesc));
+	addEffect(&perPixelLightingInstancedParaboloidEffect, "Shaders\\cso\\paraboloid_instanced_vs.cso", "Shaders\\cso\\per_pixel_lighting_ps.cso", nullptr, instancedCompactVertexDesc, ARRAYSIZE(instancedCompactVertexDesc));
+	addEffect(&reflectionLightingParaboloidEffect, "Shaders\\cso\\paraboloid_vs.cso", "Shaders\\cso\\reflection_lighting_ps.cso", nullptr, compactVertexDesc, ARRAYSIZE(compactVertexDesc));
+	addEffect(&reflectionLightingInstancedParaboloidEffect, "Shaders\\cso\\paraboloid_instanced_vs.cso", "Shaders\\cso\\reflection_lighting_ps.cso", nullptr, instancedCompactVertexDesc, ARRAYSIZE(instancedCompactVertexDesc));
+
+	addEffect(&reflectionParaboloidEffect, "Shaders\\cso\\reflection_map_vs.cso", "Shaders\\cso\\reflection_paraboloid_ps.cso", nullptr, compactVertexDesc, ARRAYSIZE(compactVertexDesc));
+
+	TaskGraph::Task fireStatesTask = loadGraph->addTask("Fire effect states", TaskGraph::Affinity::AnyThread, { fireTask }, [&]() {
+
+		// get current blendState and blend description of particleEffect (alpha blending off by default)
+		ID3D11BlendState *partBS = fireEffect->getBlendState();
+		D3D11_BLEND_DESC partBD;
+		partBS->GetDesc(&partBD);
+
+		// Modify blend description - alpha blending on
+		partBD.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
+		partBD.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
+		partBD.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
+		partBD.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ZERO;
+		partBD.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
+		partBD.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
+
+		// Create new blendState
+		partBS->Release(); device->CreateBlendState(&partBD, &partBS);
+		fireEffect->setBlendState(partBS);
+
+		// get current depthStencil State and depthStencil description of particleEffect (depth read and write by default)
+		ID3D11DepthStencilState *partDSS = fireEffect->getDepthStencilState();
+		D3D11_DEPTH_STENCIL_DESC partDSD;
+		partDSS->GetDesc(&partDSD);
+
+		//Disable Depth Writing for particles
+		partDSD.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
+		// Create custom fire depth-stencil state object
+		partDSS->Release(); device->CreateDepthStencilState(&partDSD, &partDSS);
+		fireEffect->setDepthStencilState(partDSS);
+	});
+
+	addTexture(&brickTexture, L"Resources\\Textures\\brick_DIFFUSE.jpg");
+	TaskGraph::Task mossWallTask = addTexture(&mossWallTexture, L"Resources\\Textures\\Moss wall.jpg");
+	TaskGraph::Task knightTextureTask = addTexture(&knightTexture, L"Resources\\Textures\\knight_orig.jpg");
+	TaskGraph::Task envMapTask = addTexture(&envMapTexture, L"Resources\\Textures\\grassenvmap1024.dds");
+	TaskGraph::Task rustDiffTask = addTexture(&rustDiffTexture, L"Resources\\Textures\\rustDiff2.jpg");
+	TaskGraph::Task rustSpecTask = addTexture(&rustSpecTexture, L"Resources\\Textures\\rustSpec2.jpg");
+	TaskGraph::Task fireTextureTask = addTexture(&fireTexture, L"Resources\\Textures\\Fire.jpg");
+
+	Model *bridge = nullptr;
+	Model *towerA = nullptr;
+	Model *knight = nullptr;
+	Model *walls = nullptr;
+	Model *stand = nullptr;
+	Model *sphere = nullptr;
+
+	TaskGraph::Task bridgeTask = addModel(&bridge, L"Resources\\Models\\bridge.3ds", &perPixelLightingEffect, &mossWallTexture, &mattWhite, true, { perPixelLightingTask, mossWallTask });
+	TaskGraph::Task towerTask = addModel(&towerA, L"Resources\\Models\\tower.3ds", &perPixelLightingEffect, &mossWallTexture, &mattWhite, true, { perPixelLightingTask, mossWallTask });
+	TaskGraph::Task knightTask = addModel(&knight, L"Resources\\Models\\knight.3ds", &perPixelLightingEffect, &knightTexture, &mattWhite, false, { perPixelLightingTask, knightTextureTask });
+	TaskGraph::Task wallsTask = addModel(&walls, L"Resources\\Models\\Castle walls.3ds", &perPixelLightingEffect, &mossWallTexture, &mattWhite, true, { perPixelLightingTask, mossWallTask });
+	TaskGraph::Task standTask = addModel(&stand, L"Resources\\Models\\stand.3ds", &perPixelLightingEffect, &mossWallTexture, &mattWhite, true, { perPixelLightingTask, mossWallTask });
+
+	TaskGraph::Task sphereTask = loadGraph->addTask("Model Resources\\Models\\sphere.3ds", TaskGraph::Affinity::AnyThread, { refMapTask, rustDiffTask, rustSpecTask, envMapTask }, [&]() {
+
+		// Slots 3 and 4 are only sampled by reflectionProbeEffect (see updateReflectionProbes()) and slots 5 (the dual paraboloid map) and 6 (the sky) by reflectionParaboloidEffect
+		ID3D11ShaderResourceView *sphereTextureArray[] = { rustDiffTexture->SRV, mDynamicCubeMapSRV[cubeMapLevel], rustSpecTexture->SRV, mDynamicCubeMapSRV[cubeMapLevel], mDynamicCubeMapSRV[cubeMapLevel], mDualParaboloidSRV[cubeMapLevel], envMapTexture->SRV };
+
+		sphere = new Model(device, refMapEffect, wstring(L"Resources\\Models\\sphere.3ds"), sphereTextureArray, ARRAYSIZE(sphereTextureArray), &glossWhite);
+	});
+
+	// The bridge, tower, walls and stand never move so their world transforms are baked into merged vertex buffers at load time and drawn once per material per grid cell
+	StaticBatchBuilder staticBatcher(STATIC_BATCH_CELL_SIZE);
+	vector<StaticBatch*> staticBatches;
+	vector<StaticBatch*> staticProxies;
+
+	TaskGraph::Task staticBatchTask = loadGraph->addTask("Static batches", TaskGraph::Affinity::AnyThread, { bridgeTask, towerTask, wallsTask, standTask }, [&]() {
+
+		staticBatcher.add(bridge, XMMatrixScaling(0.05, 0.05, 0.05)*XMMatrixTranslation(0, -2.7, -15));
+		staticBatcher.add(towerA, XMMatrixScaling(2, 3, 2)*XMMatrixTranslation(0, -5, 15));
+		staticBatcher.add(walls, XMMatrixScaling(0.02, 0.02, 0.02)*XMMatrixTranslation(0, -3, -6));
+		staticBatcher.add(stand, XMMatrixScaling(0.05, 0.05, 0.05)*XMMatrixTranslation(0, -3, 0));
+
+		// Each batch is drawn into the cube map as a simplified proxy sharing its buffers
+		staticBatcher.build(device, &staticBatches, &staticProxies, REFLECTION_PROXY_CELL_SIZE);
+	});
+
+	//
+	// Setup scene graph
+	//
+
+	loadGraph->addTask("Scene graph", TaskGraph::Affinity::DeviceThread, { knightTask, sphereTask, staticBatchTask, skyBoxTask, envMapTask, fireStatesTask, fireTextureTask, reflectionLightingTask }, [&]() {
+
+		sceneGraph = new SceneGraph();
+
+		const uint32_t renderInAllViews = RenderInReflection | RenderInMainView;
+
+		// Static nodes are also baked into the reflection probes
+		const uint32_t renderStatic = renderInAllViews | RenderInProbe;
+
+		// The anchor carries the user-defined translation of the reflective sphere
+		sphereAnchorNode = sceneGraph->addNode("sphereAnchor", SceneGraph::NullNode, XMMatrixIdentity());
+
+		// The tower and walls are large enough to hide much of the scene so are also the occluders of the occlusion culler
+		addOccluder(towerA, XMMatrixScaling(2, 3, 2)*XMMatrixTranslation(0, -5, 15));
+
+		SceneNode knightNode = sceneGraph->addNode("knight", SceneGraph::NullNode, XMMatrixRotationY(1.5) * XMMatrixScaling(0.05, 0.05, 0.05)*XMMatrixTranslation(0, -3, 20), knight, renderInAllViews);
+		sceneGraph->setSpin(knightNode, XMVectorSet(0, 1, 0, 0), 0.1f);
+		setReflectionLOD(knightNode, nullptr, reflectionLightingEffect, REFLECTION_CUTOFF_DISTANCE);
+
+		// The knight is also the model of the instanced crowd
+		crowdModel = knight;
+		crowdModel->retain();
+
+		Box *box = new Box(device, skyBoxEffect, envMapTexture->SRV);
+		sceneGraph->addNode("skyBox", SceneGraph::NullNode, XMMatrixScaling(100.0, 100, 100)*XMMatrixTranslation(0, 0, 0), box, renderStatic);
+		box->release();
+
+		addOccluder(walls, XMMatrixScaling(0.02, 0.02, 0.02)*XMMatrixTranslation(0, -3, -6));
+
+		for (size_t i = 0; i < staticBatches.size(); ++i) {
+
+			SceneNode batchNode = sceneGraph->addNode("staticBatch", SceneGraph::NullNode, XMMatrixIdentity(), staticBatches[i], renderStatic);
+			setReflectionLOD(batchNode, staticProxies[i], reflectionLightingEffect, FLT_MAX);
+			staticBatches[i]->release();
+			staticProxies[i]->release();
+		}
+
+		reflectorNode = sceneGraph->addNode("sphere", sphereAnchorNode, XMMatrixScaling(1.0, 1, 1), sphere, RenderInMainView);
+		sceneGraph->setSpin(reflectorNode, XMVectorSet(1, 0, 0, 0), 1.0f);
+
+		// The sphere's material is pointed at the cube map level chosen each frame
+		XMFLOAT3 sphereCentre;
+
+		reflectorModel = sphere;
+		reflectorModel->retain();
+		reflectorModel->getBoundingSphere(&sphereCentre, &reflectorRadius);
+
+		// The fire orbits the sphere.  It is not currently drawn so has no pass flags.
+		GPUParticles *fire = new GPUParticles(device, fireEffect, fireTexture->SRV, &mattWhite);
+		fireNode = sceneGraph->addNode("fire", sphereAnchorNode, XMMatrixScaling(1, 1, 1) * XMMatrixTranslation(-2.5, 1.0, 2.0), fire, ObjectConstantsGS);
+		sceneGraph->setSpin(fireNode, XMVectorSet(0, 1, 0, 0), 0.5f);
+		fire->release();
+
+		// The second light follows the fire
+		light2Node = sceneGraph->addNode("light2", sphereAnchorNode, XMMatrixIdentity());
+		sceneGraph->setSpin(light2Node, XMVectorSet(0, 1, 0, 0), 0.5f);
+	});
+
+	try
+	{
+		loadGraph->run();
+	}
+	catch (exception&)
+	{
+		loadGraph->release();
+		throw;
+	}
+
+	// The startup trace shows where the load time went - the critical path is the chain of tasks that bounded it
+	cout << "Scene resources loaded - ";
+	loadGraph->printTrace(cout);
+
+	if (!initTraceFile.empty()) {
+
+		if (loadGraph->writeTrace(initTraceFile))
+			cout << "Wrote startup trace to " << initTraceFile << endl;
+		else
+			cout << "Cannot write " << initTraceFile << endl;
+	}
+
+	loadGraph->release();
+
+	// The scene holds its own references to the models it uses
+	bridge->release();
+	towerA->release();
+	knight->release();
+	walls->release();
+	stand->release();
+	sphere->release();
+
+	layeredEffects[perPixelLightingEffect] = perPixelLightingLayeredEffect;
+	layeredEffects[perPixelLightingInstancedEffect] = perPixelLightingInstancedLayeredEffect;
+	layeredEffects[skyBoxEffect] = skyBoxLayeredEffect;
+	layeredEffects[reflectionLightingEffect] = reflectionLightingLayeredEffect;
+	layeredEffects[reflectionLightingInstancedEffect] = reflectionLightingInstancedLayeredEffect;
+
+	paraboloidEffects[perPixelLightingEffect] = perPixelLightingParaboloidEffect;
+	paraboloidEffects[perPixelLightingInstancedEffect] = perPixelLightingInstancedParaboloidEffect;
+	paraboloidEffects[reflectionLightingEffect] = reflectionLightingParaboloidEffect;
+	paraboloidEffects[reflectionLightingInstancedEffect] = reflectionLightingInstancedParaboloidEffect;
+
+	staticSourceDraws = staticBatcher.getSourceDrawCount();
+	staticBatchDraws = staticBatcher.getBatchDrawCount();
+	staticBatchTriangles = staticBatcher.getBatchTriangleCount();
+	staticProxyTriangles = staticBatcher.getProxyTriangleCount();
+
+	objectConstants.resize(sceneGraph->getNodeCount());
+	staticObjectConstants.resize(sceneGraph->getNodeCount());
+	staticObjectBounds.resize(sceneGraph->getNodeCount());
+	staticObjectValid.resize(sceneGraph->getNodeCount(), 0);
+
+	for (int i = 0; i < sceneGraph->getNodeCount(); i++) {
+
+		SceneNode node = sceneGraph->getNodeInOrder(i);
+
+		if (sceneGraph->getRenderable(node))
+			staticObjectConstants[node] = constantRing->allocateStatic(sizeof(CBufferPerObject));
+	}
+	objectViewMasks.resize(sceneGraph->getNodeCount(), 0);
+
+	ReflectionLOD noLOD = { nullptr, nullptr, FLT_MAX };
+	reflectionLODs.resize(sceneGraph->getNodeCount(), noLOD);
+
+	// Reflection probes cover the area the sphere is moved around in - the stand at the centre, the bridge and the tower
+	static const float probePositions[][3] = { { 0.0f, 0.0f, 0.0f }, { 0.0f, 0.0f, -12.0f }, { 0.0f, 0.0f, 12.0f }, { -10.0f, 0.0f, 0.0f }, { 10.0f, 0.0f, 0.0f } };
+
+	reflectionProbes = new ReflectionProbeSet();
+
+	for (int i = 0; i < (int)ARRAYSIZE(probePositions); i++)
+		reflectionProbes->addProbe(probePositions[i], REFLECTION_PROBE_RADIUS);
+
+	if (!loadReflectionProbes())
+		cout << "Reflection probes have not been baked (run with -bakeprobes) - the whole scene is rendered into the cube map" << endl;
+
+	// Resolve the initial world transforms - the first simulation step interpolates from this state
+	simulateStep(0.0);
+
+	return S_OK;
+}
+
+// Update scene state (perform animations etc) for the given simulation time.  Called at the fixed simulation rate so the cost of the simulation does not grow with the frame rate.
+void Scene::simulateStep(const gu_seconds time) {
+
+	// Resolve world transforms - only animated nodes and nodes whose transform (or parent transform) changed are recomputed
+	sceneGraph->update(time);
+}
+
+// Tick the main clock, run the simulation steps that are due and update the per-frame and per-object cbuffers.  The world and world inverse-transpose matrices of each object do not depend on the camera so are computed and uploaded once per frame rather than once per view.
+HRESULT Scene::updateFrame() {
+
+	mainClock->tick();
+
+	simulationClock->advance(mainClock->gameTimeDelta());
+
+	while (simulationClock->step())
+		simulateStep(simulationClock->getSimulationTime());
+
+	// Render between the last two simulation steps
+	frameTime = simulationClock->getRenderTime();
+
+	float interpolation = simulationClock->getInterpolationFactor();
+
+	// Translate the render target cameras along with the sphere so that the positions of reflected objects update correctly as the sphere moves
+	XMMATRIX anchorWorld, anchorWorldIT;
+
+	sceneGraph->getInterpolatedWorldMatrices(sphereAnchorNode, interpolation, &anchorWorld, &anchorWorldIT);
+
+	for (int i = 0; i < 6; i++)
+		renderTargetCameras[i]->setPos(anchorWorld.r[3]);
+
+	// The cube map size must be chosen before the per-view constants are written and the views are culled
+	updateCubeMapSize();
+	updateReflectionProbes();
+
+	DXContext *context = dx->getDeviceContext();
+
+	viewCuller->clear();
+
+	// Write every constant block used by the frame into the ring.  The ring is mapped once on the first allocation and unmapped once all blocks have been written.  The world space bounds of each node are added to the view culler in node order.  Nodes at rest reuse the static block and bounds written when they came to rest.
+	for (int i = 0; i < sceneGraph->getNodeCount(); i++) {
+
+		SceneNode node = sceneGraph->getNodeInOrder(i);
+		DXBaseModel *model = sceneGraph->getRenderable(node);
+
+		if (!model)
+			continue;
+
+		bool atRest = !sceneGraph->hasChanged(node);
+
+		if (atRest && staticObjectValid[node]) {
+
+			const XMFLOAT4 &bounds = staticObjectBounds[node];
+
+			objectConstants[node] = staticObjectConstants[node];
+
+			if (bounds.w >= 0.0f)
+				viewCuller->addSphere(XMFLOAT3(bounds.x, bounds.y, bounds.z), bounds.w);
+			else
+				viewCuller->addUnbounded();
+
+			continue;
+		}
+
+		CBufferPerObject *perObject;
+
+		if (atRest) {
+
+			objectConstants[node] = staticObjectConstants[node];
+			perObject = static_cast<CBufferPerObject*>(constantRing->writeStatic(staticObjectConstants[node]));
+		}
+		else
+			perObject = static_cast<CBufferPerObject*>(constantRing->allocate(context, sizeof(CBufferPerObject), &objectConstants[node]));
+
+		staticObjectValid[node] = atRest;
+
+		XMMATRIX world, worldIT;
+
+		sceneGraph->getInterpolatedWorldMatrices(node, interpolation, &world, &worldIT);
+
+		perObject->worldMatrix = world;
+		perObject->worldITMatrix = worldIT;
+		model->getMaterialColours(&perObject->matDiffuse, &perObject->matSpecular);
+
+		XMFLOAT3 centre;
+		float radius;
+
+		if (model->getBoundingSphere(&centre, &radius)) {
+
+			// The radius is scaled by the largest axis scale of the world transform
+			float scale = max(max(XMVectorGetX(XMVector3LengthSq(world.r[0])), XMVectorGetX(XMVector3LengthSq(world.r[1]))), XMVectorGetX(XMVector3LengthSq(world.r[2])));
+
+			XMStoreFloat3(&centre, XMVector3TransformCoord(XMLoadFloat3(&centre), world));
+			radius *= sqrtf(scale);
+
+			viewCuller->addSphere(centre, radius);
+			staticObjectBounds[node] = XMFLOAT4(centre.x, centre.y, centre.z, radius);
+		}
+		else {
+
+			viewCuller->addUnbounded();
+			staticObjectBounds[node] = XMFLOAT4(0.0f, 0.0f, 0.0f, -1.0f);
+		}
+	}
+
+	constantRing->flushStatic();
+
+	// Update per-frame constants (the render target cameras move with the sphere)
+	for (int i = 0; i < 6; i++)
+		cBufferPerFrameSrc->cubeFaceViewProjMatrices[i] = renderTargetCameras[i]->getViewMatrix() * renderTargetCameras[i]->getProjMatrix();
+
+	XMStoreFloat3(&cubeMapCentre, renderTargetCameras[0]->getPos());
+
+	XMMATRIX light2World, light2WorldIT;
+
+	sceneGraph->getInterpolatedWorldMatrices(light2Node, interpolation, &light2World, &light2WorldIT);
+
+	XMVECTOR newLight2Vec = XMVector3Transform(originalLight2Vec, light2World);
+	XMStoreFloat4(&cBufferPerFrameSrc->light2Vec, newLight2Vec);
+
+	cBufferPerFrameSrc->Timer = (FLOAT)frameTime;
+
+	perFrameConstants = constantRing->upload(context, cBufferPerFrameSrc, sizeof(CBufferPerFrame));
+
+	// Per-view state - the view-projection matrix is combined with each object's world matrix in the vertex shader.  The paraboloid vertex shaders project the view space position themselves so the hemispheres of the dual paraboloid map only have a view matrix.
+	for (int i = 0; i < NumViews; i++) {
+
+		FirstPersonCamera *camera = (i == MainView) ? mainCamera : renderTargetCameras[i];
+		CBufferPerView *perView = static_cast<CBufferPerView*>(constantRing->allocate(context, sizeof(CBufferPerView), &perViewConstants[i]));
+
+		XMMATRIX viewMatrix = camera->getViewMatrix();
+
+		XMStoreFloat4x4(&viewMatrices[i], viewMatrix);
+
+		perView->viewProjMatrix = (isParaboloidView(i)) ? viewMatrix : viewMatrix*camera->getProjMatrix();
+		XMStoreFloat4(&perView->eyePos, camera->getPos());
+	}
+
+	// The instanced vertex shaders take their transforms from the instance stream and only read the material colours from the per-object constants
+	for (size_t g = 0; g < instancedGroups.size(); g++) {
+
+		CBufferPerObject *perObject = static_cast<CBufferPerObject*>(constantRing->allocate(context, sizeof(CBufferPerObject), &instancedGroups[g].objectConstants));
+
+		perObject->worldMatrix = XMMatrixIdentity();
+		perObject->worldITMatrix = XMMatrixIdentity();
+		instancedGroups[g].model->getMaterialColours(&perObject->matDiffuse, &perObject->matSpecular);
+	}
+
+	constantRing->unmap(context);
+
+	cullViews();
+	updateInstances(context);
+
+	return S_OK;
+}
+
+HRESULT Scene::updateScene(DXContext *context, const int view) {
+
+	// Bind the per-frame and per-view constants to all stages.  Only the per-object constants change between draws.
+	DXConstantRange sharedConstants[2] = { perFrameConstants, perViewConstants[view] };
+
+	constantRing->bind(context, ConstantStageVS | ConstantStageGS | ConstantStagePS, CBufferSlotPerFrame, 2, sharedConstants);
+
+	return S_OK;
+}
+
+// Bind the per-object constants of the given scene graph node and render it
+void Scene::renderNode(DXContext *context, const SceneNode node) {
+
+	DXBaseModel *model = sceneGraph->getRenderable(node);
+
+	if (!model)
+		return;
+
+	uint32_t stage = (sceneGraph->getRenderFlags(node) & ObjectConstantsGS) ? ConstantStageGS : ConstantStageVS;
+
+	constantRing->bind(context, stage, CBufferSlotPerObject, 1, &objectConstants[node]);
+
+	model->render(context);
+}
+
+// Record the commands that render the given view (cube map face index, LayeredCubeMapView or MainView).  Only scene state written by updateFrame() is read so views can be recorded concurrently, each on its own context.
+void Scene::recordView(DXContext *context, const int view) {
+
+	// Cube map faces are cleared to red and the main view to blue.  While the reflection probes are in use the faces only hold the dynamic objects so are cleared to transparent - the sphere sees the probes where the alpha is 0.  The hemispheres of the dual paraboloid map are cleared to transparent as the sky is not drawn into them.
+	static const FLOAT faceClearColour[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+	static const FLOAT dynamicClearColour[4] = { 0.0f, 0.0f, 0.0f, 0.0f };
+	static const FLOAT mainClearColour[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
+
+	bool mainView = (view == MainView);
+	bool layered = (view == LayeredCubeMapView);
+
+	// The probe bake draws only the static nodes and the dynamic pass draws everything else.  Static nodes do not hide dynamic objects behind them in the dynamic pass.
+	bool dynamicPass = !mainView && !bakingReflectionProbes && useReflectionProbes && reflectionProbesLoaded && !dualParaboloid;
+	uint32_t pass = (mainView) ? RenderInMainView : (bakingReflectionProbes) ? RenderInProbe : RenderInReflection;
+
+	// The cube map faces share one depth/stencil buffer as they are the same size.  The layered pass renders every face at once so uses all six slices of it.  Both are rendered at the current cube map level.
+	ID3D11RenderTargetView *renderTarget = (mainView) ? dx->getBackBufferRTV() : (layered) ? mDynamicCubeMapRTV_SinglePass[cubeMapLevel] : mDynamicCubeMapRTV[cubeMapLevel][view];
+	ID3D11DepthStencilView *depthStencil = (mainView) ? dx->getDepthStencil() : (layered) ? mDynamicCubeMapDSV_SinglePass[cubeMapLevel] : mDynamicCubeMapDSV[cubeMapLevel];
+
+	// The layered pass binds the view constants of face 0 - its eye position is the cube map centre and the geometry shaders project with the per-frame face matrices
+	context->RSSetViewports(1, (mainView) ? &viewport : &renderTargetViewport);
+	updateScene(context, (layered) ? 0 : view);
+
+	context->ClearRenderTargetView(renderTarget, (mainView) ? mainClearColour : (dynamicPass || isParaboloidView(view)) ? dynamicClearColour : faceClearColour);
+	context->ClearDepthStencilView(depthStencil, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	context->OMSetRenderTargets(1, &renderTarget, depthStencil);
+
+	renderObjects(context, pass, view, (layered) ? (1 << MainView) - 1 : 1 << view, (dynamicPass) ? RenderInProbe : 0);
+
+	if (!bakingReflectionProbes)
+		renderInstancedGroups(context, pass, view);
+
+	// The geometry shader must not remain bound for the following views
+	if (layered)
+		context->GSSetShader(NULL, 0, 0);
+
+	//fire must be rendered after sphere, otherwise sphere covers it when fire passes in front of the sphere
+	//fireEffect->bindPipeline(context);
+	//renderNode(context, fireNode);
+	//context->GSSetShader(NULL, 0, 0);
+}
+
+// Render scene.  The cube map is rendered first (six passes, one layered pass in layered mode or the two hemispheres in dual paraboloid mode), then the main view which samples the cube map.  In parallel mode each pass is recorded on a worker thread into its own deferred context and the command lists are executed in order on the immediate context.
+HRESULT Scene::renderScene() {
+
+	DXContext *context = dx->getDeviceContext();
+
+	// Validate window and D3D context
+	if (isMinimised() || !context)
+		return E_FAIL;
+
+	// The layered pass is recorded on the context and command list of face 0
+	int passes[NumViews];
+	int numPasses = 0;
+
+	if (layeredCubeMap && !dualParaboloid) {
+
+		// While the reflection probes are in use the layered pass is skipped when no face shows a dynamic object
+		if (cubeFacesScheduled)
+			passes[numPasses++] = LayeredCubeMapView;
+	}
+	else {
+
+		// Only the faces chosen by the reflection scheduler (or the two hemispheres of the dual paraboloid map) are rendered - the others keep their content from an earlier frame
+		for (int i = 0; i < 6; i++) {
+
+			if (cubeFacesScheduled & (1 << i))
+				passes[numPasses++] = i;
+		}
+	}
+
+	passes[numPasses++] = MainView;
+
+	if (parallelRecording) {
+
+		workerPool->parallelFor(numPasses, [this, &passes](int pass) {
+
+			int slot = (passes[pass] == LayeredCubeMapView) ? 0 : passes[pass];
+
+			recordView(viewContexts[slot], passes[pass]);
+
+			if (FAILED(viewContexts[slot]->FinishCommandList(FALSE, &viewCommandLists[slot])))
+				throw exception("Cannot finish view command list");
+		});
 
-	//Create Texture
-	ID3D11Texture2D* renderTargetTexture = nullptr;
-	HRESULT hr = device->CreateTexture2D(&texDesc, 0, &renderTargetTexture);
+		for (int i = 0; i < numPasses; i++) {
 
-	//Create render target view
-	D3D11_RENDER_TARGET_VIEW_DESC rtvDesc;
-	rtvDesc.Format = texDesc.Format;
-	rtvDesc.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY; //was "...TEXTURE2DMS"
-	rtvDesc.Texture2DArray.MipSlice = 0;
-	rtvDesc.Texture2DArray.ArraySize = 1;
+			int slot = (passes[i] == LayeredCubeMapView) ? 0 : passes[i];
 
-	for (int i = 0; i < 6; i++)
-	{
-		rtvDesc.Texture2DArray.FirstArraySlice = i;
+			context->ExecuteCommandList(viewCommandLists[slot], FALSE);
 
-		hr = device->CreateRenderTargetView(renderTargetTexture, &rtvDesc, &mDynamicCubeMapRTV[i]);
+			viewCommandLists[slot]->release();
+			viewCommandLists[slot] = nullptr;
+		}
 	}
- 
-	// Create the 6-face render target view
-	// Used to create RTV for attempted geometry shader optimisation of cube map creation
-	D3D11_RENDER_TARGET_VIEW_DESC DescRT;
-	DescRT.Format = texDesc.Format;
-	DescRT.ViewDimension = D3D11_RTV_DIMENSION_TEXTURE2DARRAY;
-	DescRT.Texture2DArray.FirstArraySlice = 0;
-	DescRT.Texture2DArray.ArraySize = 6;
-	DescRT.Texture2DArray.MipSlice = 0;
+	else {
 
-	hr = device->CreateRenderTargetView(renderTargetTexture, &DescRT, &mDynamicCubeMapRTV_SinglePass);
-	//
+		for (int i = 0; i < numPasses; i++)
+			recordView(context, passes[i]);
+	}
 
-	//Create shader resource view
-	D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc;
-	srvDesc.Format = texDesc.Format;
-	srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURECUBE;
-	srvDesc.TextureCube.MostDetailedMip = 0;
-	srvDesc.TextureCube.MipLevels = -1;
+	// Present current frame to the screen
+	HRESULT hr = dx->presentBackBuffer();
 
-	hr = device->CreateShaderResourceView(renderTargetTexture, &srvDesc, &mDynamicCubeMapSRV);
+	return S_OK;
+}
 
-	// View saves reference.
-	renderTargetTexture->Release();
+//calls to render objects have been moved from renderScene() to this function, to make the renderScene() code more readable
+//objects are drawn through the render queue - opaque objects are grouped by effect, texture and mesh (front-to-back within each group) and blended objects are drawn last, back-to-front
+//only nodes visible in one of the views in viewMask (see cullViews()) are submitted
+//the layered cube map view draws each node once with the layered variant of its effect - nodes whose effect has no layered variant are not drawn into the cube map in layered mode
+//the hemispheres of the dual paraboloid map draw each node with the paraboloid variant of its effect in the same way
+HRESULT Scene::renderObjects(DXContext *context, const uint32_t pass, const int view, const uint32_t viewMask, const uint32_t excludeFlags)
+{
+	bool layered = (view == LayeredCubeMapView);
+	bool paraboloid = isParaboloidView(view);
+	DXRenderQueue *renderQueue = renderQueues[(layered) ? 0 : view];
+	XMMATRIX viewMatrix = XMLoadFloat4x4(&viewMatrices[(layered) ? 0 : view]);
+	XMVECTOR centre = XMLoadFloat3(&cubeMapCentre);
 
-	D3D11_TEXTURE2D_DESC depthTexDesc;
-	depthTexDesc.Width = CUBEMAP_SIZE;
-	depthTexDesc.Height = CUBEMAP_SIZE;
-	depthTexDesc.MipLevels = 1;
-	depthTexDesc.ArraySize = 1;
-	depthTexDesc.SampleDesc.Count = 1;
-	depthTexDesc.SampleDesc.Quality = 0;
-	depthTexDesc.Format = DXGI_FORMAT_D32_FLOAT;
-	depthTexDesc.Usage = D3D11_USAGE_DEFAULT;
-	depthTexDesc.BindFlags = D3D11_BIND_DEPTH_STENCIL;
-	depthTexDesc.CPUAccessFlags = 0;
-	depthTexDesc.MiscFlags = 0;
+	renderQueue->begin(FAR_DEPTH);
 
-	ID3D11Texture2D* depthTex = 0;
-	hr = device->CreateTexture2D(&depthTexDesc, 0, &depthTex);
-	// Create the depth stencil view for the entire buffer.
-	
-	D3D11_DEPTH_STENCIL_VIEW_DESC dsvDesc;
-	dsvDesc.Format = depthTexDesc.Format;
-	dsvDesc.Flags = 0;
-	dsvDesc.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2D;
-	dsvDesc.Texture2D.MipSlice = 0;
-	hr = device->CreateDepthStencilView(depthTex, &dsvDesc, &mDynamicCubeMapDSV);
+	for (int i = 0; i < sceneGraph->getNodeCount(); i++) {
 
-	// Create the depth stencil view for the entire cube
-	// Used to create DSV for attempted geometry shader optimisation of cube map creation
-	D3D11_DEPTH_STENCIL_VIEW_DESC DescDS;
-	DescDS.Format = depthTexDesc.Format;
-	DescDS.Flags = 0;
-	DescDS.ViewDimension = D3D11_DSV_DIMENSION_TEXTURE2DARRAY;
-	DescDS.Texture2DArray.FirstArraySlice = 0;
-	DescDS.Texture2DArray.ArraySize = 1;
-	DescDS.Texture2DArray.MipSlice = 0;
+		SceneNode node = sceneGraph->getNodeInOrder(i);
+		uint32_t renderFlags = sceneGraph->getRenderFlags(node);
 
-	hr = device->CreateDepthStencilView(depthTex, &DescDS, &mDynamicCubeMapDSV_SinglePass);
-	//
+		if (!(renderFlags & pass) || (renderFlags & excludeFlags) || !sceneGraph->getRenderable(node) || !(objectViewMasks[node] & viewMask))
+			continue;
 
-	//set up viewport
-	renderTargetViewport.TopLeftX = 0.0f;
-	renderTargetViewport.TopLeftY = 0.0f;
-	renderTargetViewport.Width = (float)CUBEMAP_SIZE;
-	renderTargetViewport.Height = (float)CUBEMAP_SIZE;
-	renderTargetViewport.MinDepth = 0.0f;
-	renderTargetViewport.MaxDepth = 1.0f;
+		DXDrawItem item;
 
-	// Setup objects for the programmable (shader) stages of the pipeline
+		item.model = sceneGraph->getRenderable(node);
+		item.effect = nullptr;
+		item.objectConstants = objectConstants[node];
+		item.geometryShaderConstants = (renderFlags & ObjectConstantsGS) != 0;
 
-	perPixelLightingEffect = new Effect(device, "Shaders\\cso\\per_pixel_lighting_vs.cso", "Shaders\\cso\\per_pixel_lighting_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
-	skyBoxEffect = new Effect(device, "Shaders\\cso\\sky_box_vs.cso", "Shaders\\cso\\sky_box_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
-	basicEffect = new Effect(device, "Shaders\\cso\\basic_texture_vs.cso", "Shaders\\cso\\basic_texture_ps.cso", basicVertexDesc, ARRAYSIZE(basicVertexDesc));
-	fireEffect = new Effect(device, "Shaders\\cso\\fire_vs.cso", "Shaders\\cso\\fire_ps.cso", "Shaders\\cso\\fire_gs.cso", particleVertexDesc, ARRAYSIZE(particleVertexDesc));
+		// The sphere reflects the dual paraboloid map in dual paraboloid mode and the probes while they are in use
+		if (node == reflectorNode && dualParaboloid)
+			item.effect = reflectionParaboloidEffect;
+		else if (node == reflectorNode && useReflectionProbes && reflectionProbesLoaded)
+			item.effect = reflectionProbeEffect;
 
-	//Used for standard implementation of reflection
-	refMapEffect = new Effect(device, "Shaders\\cso\\reflection_map_vs.cso", "Shaders\\cso\\reflection_map_ps.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
-
-	//Used for attempted optimisation of reflection cube map creation using geometry shader.
-	//Not currently used.
-	//refMapEffect = new Effect(device, "Shaders\\cso\\reflection_map_vs.cso", "Shaders\\cso\\reflection_map_ps.cso", "Shaders\\cso\\reflection_map_gs.cso", extVertexDesc, ARRAYSIZE(extVertexDesc));
-
-	// get current blendState and blend description of particleEffect (alpha blending off by default)
-	ID3D11BlendState *partBS = fireEffect->getBlendState();
-	D3D11_BLEND_DESC partBD;
-	partBS->GetDesc(&partBD);
-
-	// Modify blend description - alpha blending on
-	partBD.RenderTarget[0].SrcBlend = D3D11_BLEND_SRC_ALPHA;
-	partBD.RenderTarget[0].DestBlend = D3D11_BLEND_INV_SRC_ALPHA;
-	partBD.RenderTarget[0].BlendOp = D3D11_BLEND_OP_ADD;
-	partBD.RenderTarget[0].SrcBlendAlpha = D3D11_BLEND_ZERO;
-	partBD.RenderTarget[0].DestBlendAlpha = D3D11_BLEND_ZERO;
-	partBD.RenderTarget[0].BlendOpAlpha = D3D11_BLEND_OP_ADD;
-
-	// Create new blendState
-	partBS->Release(); device->CreateBlendState(&partBD, &partBS);
-	fireEffect->setBlendState(partBS);
-
-	// get current depthStencil State and depthStencil description of particleEffect (depth read and write by default)
-	ID3D11DepthStencilState *partDSS = fireEffect->getDepthStencilState();
-	D3D11_DEPTH_STENCIL_DESC partDSD;
-	partDSS->GetDesc(&partDSD);
-
-	//Disable Depth Writing for particles
-	partDSD.DepthWriteMask = D3D11_DEPTH_WRITE_MASK_ZERO;
-	// Create custom fire depth-stencil state object
-	partDSS->Release(); device->CreateDepthStencilState(&partDSD, &partDSS);
-	fireEffect->setDepthStencilState(partDSS);
-
-	// Setup CBuffer
-	cBufferExtSrc = (CBufferExt*)_aligned_malloc(sizeof(CBufferExt), 16);
-	// Initialise CBuffer
-	cBufferExtSrc->worldMatrix = XMMatrixIdentity();
-	cBufferExtSrc->worldITMatrix = XMMatrixIdentity();
-	cBufferExtSrc->WVPMatrix = mainCamera->getViewMatrix()*mainCamera->getProjMatrix();
-
-	//Used in geometry shader cube map optimisation to set camera view matrices in reflection_map shader cbuffers
-	for (int i = 0; i < 6; i++)
-		cBufferExtSrc->cameraViewMatrices[i] = renderTargetCameras[i]->getViewMatrix();
-
-	cBufferExtSrc->lightVec = XMFLOAT4(250.0, -130.0, -145.0, 0.0); // Directional light
-	cBufferExtSrc->lightAmbient = XMFLOAT4(0.3, 0.3, 0.3, 1.0);
-	cBufferExtSrc->lightDiffuse = XMFLOAT4(0.8, 0.8, 0.8, 1.0);
-	cBufferExtSrc->lightSpecular = XMFLOAT4(1.0, 1.0, 1.0, 1.0);
-
-	XMStoreFloat4(&cBufferExtSrc->light2Vec, originalLight2Vec); // Positional light
-	cBufferExtSrc->light2Ambient = XMFLOAT4(0.1, 0.1, 0.1, 1.0);
-	cBufferExtSrc->light2Diffuse = XMFLOAT4(0.1, 0.1, 0.4, 1.0);
-	cBufferExtSrc->light2Specular = XMFLOAT4(1.0, 1.0, 1.0, 1.0);
-
-	XMStoreFloat4(&cBufferExtSrc->eyePos, mainCamera->getPos());
-
-	D3D11_BUFFER_DESC cbufferDesc;
-	D3D11_SUBRESOURCE_DATA cbufferInitData;
-	ZeroMemory(&cbufferDesc, sizeof(D3D11_BUFFER_DESC));
-	ZeroMemory(&cbufferInitData, sizeof(D3D11_SUBRESOURCE_DATA));
-	cbufferDesc.ByteWidth = sizeof(CBufferExt);
-	cbufferDesc.Usage = D3D11_USAGE_DYNAMIC;
-	cbufferDesc.CPUAccessFlags = D3D11_CPU_ACCESS_WRITE;
-	cbufferDesc.BindFlags = D3D11_BIND_CONSTANT_BUFFER;
-	cbufferInitData.pSysMem = cBufferExtSrc;
-
-	//Create cBuffers
-	hr = device->CreateBuffer(&cbufferDesc, &cbufferInitData, &cBufferBridge);
-	hr = device->CreateBuffer(&cbufferDesc, &cbufferInitData, &cBufferTowerA);
-	hr = device->CreateBuffer(&cbufferDesc, &cbufferInitData, &cBufferKnight);
-	hr = device->CreateBuffer(&cbufferDesc, &cbufferInitData, &cBufferSkyBox);
-	hr = device->CreateBuffer(&cbufferDesc, &cbufferInitData, &cBufferSphere);
-	hr = device->CreateBuffer(&cbufferDesc, &cbufferInitData, &cBufferStand);
-	hr = device->CreateBuffer(&cbufferDesc, &cbufferInitData, &cBufferWalls);
-	hr = device->CreateBuffer(&cbufferDesc, &cbufferInitData, &cBufferFire);
+		// The cube map faces draw the node's reflection proxy with its reflection effect
+		if (view != MainView && reflectionLOD) {
 
-	// Setup example objects
+			const ReflectionLOD &lod = reflectionLODs[node];
 
-	mattWhite.setSpecular(XMCOLOR(0, 0, 0, 0));
-	glossWhite.setSpecular(XMCOLOR(1, 1, 1, 1));
+			if (lod.proxy)
+				item.model = lod.proxy;
 
-	brickTexture = new Texture(device, L"Resources\\Textures\\brick_DIFFUSE.jpg");
-	mossWallTexture = new Texture(device, L"Resources\\Textures\\Moss wall.jpg");
-	knightTexture = new Texture(device, L"Resources\\Textures\\knight_orig.jpg");
-	envMapTexture = new Texture(device, L"Resources\\Textures\\grassenvmap1024.dds");
-	rustDiffTexture = new Texture(device, L"Resources\\Textures\\rustDiff2.jpg");
-	rustSpecTexture = new Texture(device, L"Resources\\Textures\\rustSpec2.jpg");
-	fireTexture = new Texture(device, L"Resources\\Textures\\Fire.jpg");
-
-	ID3D11ShaderResourceView *sphereTextureArray[] = { rustDiffTexture->SRV, mDynamicCubeMapSRV, rustSpecTexture->SRV };
-
-	//load bridge
-	bridge = new Model(device, perPixelLightingEffect, wstring(L"Resources\\Models\\bridge.3ds"), mossWallTexture->SRV, &mattWhite);
-	towerA = new Model(device, perPixelLightingEffect, wstring(L"Resources\\Models\\tower.3ds"), mossWallTexture->SRV, &mattWhite);
-	knight = new Model(device, perPixelLightingEffect, wstring(L"Resources\\Models\\knight.3ds"), knightTexture->SRV, &mattWhite);
-	sphere = new Model(device, refMapEffect, wstring(L"Resources\\Models\\sphere.3ds"), sphereTextureArray, 3, &glossWhite);
-	stand = new Model(device, perPixelLightingEffect, wstring(L"Resources\\Models\\stand.3ds"), mossWallTexture->SRV, &mattWhite);
-	box = new Box(device, skyBoxEffect, envMapTexture->SRV);
-	walls = new Model(device, perPixelLightingEffect, wstring(L"Resources\\Models\\Castle walls.3ds"), mossWallTexture->SRV, &mattWhite);
-	fire = new GPUParticles(device, fireEffect, fireTexture->SRV, &mattWhite);
+			item.effect = lod.effect;
+		}
 
-	return S_OK;
-}
+		if (layered) {
 
-// Update scene state (perform animations etc)
-HRESULT Scene::updateScene(ID3D11DeviceContext *context, FirstPersonCamera* camera) {
+			map<Effect*, Effect*>::const_iterator layeredEffect = layeredEffects.find((item.effect) ? item.effect : item.model->getEffect());
 
+			if (layeredEffect == layeredEffects.end())
+				continue;
 
-	mainClock->tick();
-	gu_seconds tDelta = mainClock->gameTimeElapsed();
-
-	cBufferExtSrc->Timer = (FLOAT)tDelta;
-	XMStoreFloat4(&cBufferExtSrc->eyePos, camera->getPos());
-
-	// Update bridge cBuffer
-	// Scale and translate bridge world matrix
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(0.05, 0.05, 0.05)*XMMatrixTranslation(0, -2.7, -15);
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferBridge);
-
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(2, 3, 2)*XMMatrixTranslation(0, -5, 15);
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferTowerA);
-
-	cBufferExtSrc->worldMatrix = XMMatrixRotationY(1.5) * XMMatrixScaling(0.05, 0.05, 0.05)*XMMatrixTranslation(0, -3, 20) * XMMatrixRotationY(tDelta * 0.1);
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferKnight);
-
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(100.0, 100, 100)*XMMatrixTranslation(0, 0, 0);
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferSkyBox);
-
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(1.0, 1, 1) * XMMatrixRotationX(tDelta) * sphereTranslationMatrix;
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferSphere);
-
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(0.05, 0.05, 0.05)*XMMatrixTranslation(0, -3, 0);
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferStand);
-
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(0.02, 0.02, 0.02)*XMMatrixTranslation(0, -3, -6);
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix*camera->getViewMatrix()*camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferWalls);
-
-	cBufferExtSrc->Timer = cBufferExtSrc->Timer * 3;// speed up particles
-	// Scale and translate fire world matrix
-	cBufferExtSrc->worldMatrix = XMMatrixScaling(1, 1, 1) * XMMatrixTranslation(-2.5, 1.0, 2.0) * XMMatrixRotationY(tDelta * 0.5) * sphereTranslationMatrix;
-	cBufferExtSrc->worldITMatrix = XMMatrixTranspose(XMMatrixInverse(nullptr, cBufferExtSrc->worldMatrix));
-	cBufferExtSrc->WVPMatrix = cBufferExtSrc->worldMatrix * camera->getViewMatrix() * camera->getProjMatrix();
-	mapCbuffer(cBufferExtSrc, cBufferFire);
-
-	XMVECTOR newLight2Vec = XMVector3Transform(originalLight2Vec, XMMatrixRotationY(tDelta * 0.5) * sphereTranslationMatrix);
-	XMStoreFloat4(&cBufferExtSrc->light2Vec, newLight2Vec);
+			item.effect = layeredEffect->second;
+
+			// Sort depth is the distance of the node's origin from the cube map centre (the layered pass has no single view direction)
+			renderQueue->submit(item, XMVectorGetX(XMVector3Length(sceneGraph->getWorldMatrix(node).r[3] - centre)));
+			continue;
+		}
+
+		if (paraboloid) {
+
+			map<Effect*, Effect*>::const_iterator paraboloidEffect = paraboloidEffects.find((item.effect) ? item.effect : item.model->getEffect());
+
+			if (paraboloidEffect == paraboloidEffects.end())
+				continue;
+
+			item.effect = paraboloidEffect->second;
+		}
+
+		// Sort depth is the view space depth of the node's origin
+		XMVECTOR viewPos = XMVector3TransformCoord(sceneGraph->getWorldMatrix(node).r[3], viewMatrix);
+
+		renderQueue->submit(item, XMVectorGetZ(viewPos));
+	}
+
+	renderQueue->sort();
+	renderQueue->execute(context, constantRing, CBufferSlotPerObject);
 
 	return S_OK;
 }
 
-// Helper function to copy cbuffer data from cpu to gpu
-HRESULT Scene::mapCbuffer(void *cBufferExtSrcL, ID3D11Buffer *cBufferExtL)
-{
-	ID3D11DeviceContext *context = dx->getDeviceContext();
-	// Map cBuffer
-	D3D11_MAPPED_SUBRESOURCE res;
-	HRESULT hr = context->Map(cBufferExtL, 0, D3D11_MAP_WRITE_DISCARD, 0, &res);
+// Add the mesh of a model (loaded with keepMeshData) placed with the given world transform to the occlusion culler
+void Scene::addOccluder(Model *model, FXMMATRIX world) {
+
+	const vector<DXVertexExt> &vertices = model->getMeshVertices();
+	const vector<uint32_t> &indices = model->getMeshIndices();
+
+	if (vertices.empty() || indices.empty())
+		return;
+
+	XMFLOAT4X4 worldMatrix;
+
+	XMStoreFloat4x4(&worldMatrix, world);
+
+	// Sub-mesh indices are relative to the sub-mesh's first vertex
+	uint32_t indexOffset = 0;
 
-	if (SUCCEEDED(hr)) {
-		memcpy(res.pData, cBufferExtSrcL, sizeof(CBufferExt));
-		context->Unmap(cBufferExtL, 0);
+	for (uint32_t mesh = 0; mesh < model->getMeshCount(); mesh++) {
+
+		uint32_t baseVertex = model->getMeshBaseVertex(mesh);
+		uint32_t vertexCount = ((mesh + 1 < model->getMeshCount()) ? model->getMeshBaseVertex(mesh + 1) : (uint32_t)vertices.size()) - baseVertex;
+
+		occlusionCuller->addOccluder(&vertices[baseVertex].pos.x, sizeof(DXVertexExt), vertexCount, &indices[indexOffset], model->getMeshIndexCount(mesh), &worldMatrix._11);
+
+		indexOffset += model->getMeshIndexCount(mesh);
 	}
-	return hr;
 }
 
-// Render scene
-HRESULT Scene::renderScene() {
+// Cull the bounds of the renderable nodes (added by updateFrame()) and of every crowd instance against all views in a single pass.  The cube map faces also reject objects smaller than reflectionContributionThreshold pixels.  Objects hidden behind the occluders are then removed from the occlusion culled views.
+void Scene::cullViews() {
 
-	ID3D11DeviceContext *context = dx->getDeviceContext();
+	for (size_t g = 0; g < instancedGroups.size(); g++) {
 
-	// Validate window and D3D context
-	if (isMinimised() || !context)
-		return E_FAIL;
+		InstancedGroup &group = instancedGroups[g];
 
-	// Clear the screen
-	static const FLOAT clearColor[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+		group.firstCullIndex = viewCuller->getSphereCount();
 
-	// Save current render targets
-	ID3D11RenderTargetView* renderTargets[1];
-	ID3D11RenderTargetView* defaultRenderTargetView;
-	ID3D11DepthStencilView* defaultDepthStencilView;
-	context->OMGetRenderTargets(1, &defaultRenderTargetView, &defaultDepthStencilView);
+		for (size_t k = 0; k < group.bounds.size(); k++)
+			viewCuller->addSphere(XMFLOAT3(group.bounds[k].x, group.bounds[k].y, group.bounds[k].z), group.bounds[k].w);
+	}
 
-	for (int i = 0; i < 6; i++)
-	{
-		//rebuild the viewport and update the positions of scene objects from the perspective of the current render target camera
-		rebuildRenderTargetViewport(renderTargetCameras[i]);
-		updateScene(context, renderTargetCameras[i]);
+	XMFLOAT4X4 viewProjMatrices[NumViews];
 
-		// Clear new render target and original depth stencil
-		context->ClearRenderTargetView(mDynamicCubeMapRTV[i], clearColor);
-		context->ClearDepthStencilView(mDynamicCubeMapDSV, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	// The hemispheres of the dual paraboloid map are culled against a perspective frustum of almost 180 degrees.  Its viewport height is chosen so the pixel scale used by contribution culling matches the centre of the paraboloid image (a quarter of its size per radian).
+	XMMATRIX paraboloidProj = XMMatrixPerspectiveFovLH(PARABOLOID_CULL_FOV, 1.0f, 1.0f, FAR_DEPTH);
+	float paraboloidCullHeight = 0.5f * renderTargetViewport.Height / XMVectorGetY(paraboloidProj.r[1]);
 
-		// Set new render targets - we are using the default depth/stencil as it is the same size
-		renderTargets[0] = mDynamicCubeMapRTV[i];
-		context->OMSetRenderTargets(1, renderTargets, mDynamicCubeMapDSV);
+	for (int i = 0; i < NumViews; i++) {
 
-		renderObjects(context);
+		FirstPersonCamera *camera = (i == MainView) ? mainCamera : renderTargetCameras[i];
+		const D3D11_VIEWPORT &viewViewport = (i == MainView) ? viewport : renderTargetViewport;
+		bool paraboloid = isParaboloidView(i);
 
-		//if (fire) {
-		//	fireEffect->bindPipeline(context);
+		XMMATRIX viewProj = XMLoadFloat4x4(&viewMatrices[i]) * ((paraboloid) ? paraboloidProj : camera->getProjMatrix());
 
-		//	// Apply the particles cBuffer.
-		//	context->VSSetConstantBuffers(0, 1, &cBufferFire);
-		//	context->GSSetConstantBuffers(0, 1, &cBufferFire);
-		//	context->PSSetConstantBuffers(0, 1, &cBufferFire);
-		//	// Render
-		//	fire->render(context);
+		XMStoreFloat4x4(&viewProjMatrices[i], viewProj);
 
-		//	context->GSSetShader(NULL, 0, 0);
-		//}
+		viewCuller->setView(i, viewProj, camera->getPos(), (paraboloid) ? paraboloidCullHeight : viewViewport.Height);
+		viewCuller->setContributionThreshold(i, (i == MainView) ? 0.0f : reflectionContributionThreshold);
 	}
 
-	// Restore default render targets
-	renderTargets[0] = renderTargetRTV;
-	context->OMSetRenderTargets(1, &defaultRenderTargetView, defaultDepthStencilView);
+	viewCuller->cull();
 
-	rebuildViewport(mainCamera);
-	updateScene(context, mainCamera);
+	// Objects beyond their reflection cutoff distance are removed from every cube map face before the faces are scheduled so they do not mark faces dirty
+	objectsBeyondReflectionCutoff = 0;
+
+	if (reflectionLOD) {
+
+		uint32_t cullIndex = 0;
+
+		for (int i = 0; i < sceneGraph->getNodeCount(); i++) {
 
-	// Clear new render target and original depth stencil
-	float clearColor2[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
-	context->ClearRenderTargetView(defaultRenderTargetView, clearColor2);
-	context->ClearDepthStencilView(defaultDepthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+			SceneNode node = sceneGraph->getNodeInOrder(i);
 
-	renderObjects(context);
+			if (sceneGraph->getRenderable(node))
+				applyReflectionCutoff(cullIndex++, reflectionLODs[node].maxDistance);
+		}
+
+		for (size_t g = 0; g < instancedGroups.size(); g++) {
 
-	if (sphere) {
-		// Apply the sphere cBuffer.
-		context->VSSetConstantBuffers(0, 1, &cBufferSphere);
-		context->PSSetConstantBuffers(0, 1, &cBufferSphere);
-		// Render
-		sphere->render(context);
+			for (size_t k = 0; k < instancedGroups[g].instances.size(); k++)
+				applyReflectionCutoff(instancedGroups[g].firstCullIndex + (uint32_t)k, instancedGroups[g].reflectionMaxDistance);
+		}
 	}
 
-	//fire must be rendered after sphere, otherwise sphere covers it when fire passes in front of the sphere
-	//if (fire) {
-	//	fireEffect->bindPipeline(context);
+	scheduleCubeFaces();
+	scheduleProbeFaces();
 
-	//	// Apply the particles cBuffer.
-	//	context->VSSetConstantBuffers(0, 1, &cBufferFire);
-	//	context->GSSetConstantBuffers(0, 1, &cBufferFire);
-	//	context->PSSetConstantBuffers(0, 1, &cBufferFire);
-	//	// Render
-	//	fire->render(context);
+	// Rasterize the occluders for each occlusion culled view and clear the view's bit of every object hidden behind them.  Only objects that survived frustum culling are tested.
+	for (int i = 0; i < NumViews; i++) {
 
-	//	context->GSSetShader(NULL, 0, 0);
-	//}
+		objectsOccluded[i] = 0;
 
-	// Present current frame to the screen
-	HRESULT hr = dx->presentBackBuffer();
+		// Faces not rendered this frame need no occlusion culling
+		if (i != MainView && !(cubeFacesScheduled & (1 << i)))
+			continue;
 
-	return S_OK;
+		// The occlusion buffer is a perspective projection so cannot cull the hemispheres of the dual paraboloid map
+		if (!((i == MainView) ? occlusionCulling : cubeFaceOcclusionCulling) || isParaboloidView(i)) {
+
+			occlusionCuller->invalidate(i);
+			continue;
+		}
+
+		occlusionCuller->render(i, &viewProjMatrices[i]._11, workerPool);
+
+		for (uint32_t k = 0; k < viewCuller->getSphereCount(); k++) {
+
+			uint8_t mask = viewCuller->getMask(k);
+			XMFLOAT3 centre;
+			float radius;
+
+			if (!(mask & (1 << i)) || !viewCuller->getSphere(k, &centre, &radius))
+				continue;
+
+			if (!occlusionCuller->isSphereVisible(i, &centre.x, radius)) {
+
+				viewCuller->setMask(k, mask & ~(1 << i));
+				objectsOccluded[i]++;
+			}
+		}
+	}
+
+	// Masks of the nodes are in node order (see updateFrame())
+	uint32_t cullIndex = 0;
+
+	for (int i = 0; i < sceneGraph->getNodeCount(); i++) {
+
+		SceneNode node = sceneGraph->getNodeInOrder(i);
+
+		if (sceneGraph->getRenderable(node))
+			objectViewMasks[node] = viewCuller->getMask(cullIndex++);
+	}
 }
 
-// Render scene using geometry shader optimisation of the cube map creation (cube map is created in single pass).
-// Not working, but does compile and render the sphere.
-HRESULT Scene::renderSceneWithCubeMapGS() {
+// Clear the cube map face bits of the given view culler sphere if it lies further than maxDistance from the cube map centre
+void Scene::applyReflectionCutoff(const uint32_t cullIndex, const float maxDistance) {
 
-	ID3D11DeviceContext *context = dx->getDeviceContext();
+	uint8_t mask = viewCuller->getMask(cullIndex);
+	XMFLOAT3 centre;
+	float radius;
 
-	// Validate window and D3D context
-	if (isMinimised() || !context)
-		return E_FAIL;
+	if (maxDistance >= FLT_MAX || !(mask & ReflectionScheduler::AllFaces) || !viewCuller->getSphere(cullIndex, &centre, &radius))
+		return;
+
+	if (XMVectorGetX(XMVector3Length(XMLoadFloat3(&centre) - XMLoadFloat3(&cubeMapCentre))) - radius > maxDistance) {
+
+		viewCuller->setMask(cullIndex, (uint8_t)(mask & ~ReflectionScheduler::AllFaces));
+		objectsBeyondReflectionCutoff++;
+	}
+}
 
-	// Clear the screen
-	static const FLOAT clearColor[4] = { 1.0f, 0.0f, 0.0f, 1.0f };
+// Choose the cube map level from the size of the sphere in the main view.  The smallest level with faces at least CUBEMAP_TEXELS_PER_PIXEL times the projected diameter of the sphere is wanted.  A larger level is switched to at once.  A smaller level is only switched to once the wanted size has been below CUBEMAP_SHRINK_MARGIN of the next smaller size for CUBEMAP_SHRINK_FRAMES consecutive frames.
+void Scene::updateCubeMapSize() {
 
-	// Save current render targets
-	ID3D11RenderTargetView* renderTargets[1];
-	ID3D11RenderTargetView* defaultRenderTargetView;
-	ID3D11DepthStencilView* defaultDepthStencilView;
-	context->OMGetRenderTargets(1, &defaultRenderTargetView, &defaultDepthStencilView);
+	if (!adaptiveCubeMapSize || !reflectorModel)
+		return;
 
-	//
-	//Render to cube map render target in single pass
-	//
-	rebuildViewport(mainCamera);
-	updateScene(context, mainCamera);
+	// The render target cameras are at the centre of the sphere
+	float distance = XMVectorGetX(XMVector3Length(renderTargetCameras[0]->getPos() - mainCamera->getPos()));
 
-	// Clear new render target and original depth stencil
-	float clearColor2[4] = { 0.0f, 0.0f, 1.0f, 1.0f };
-	context->ClearRenderTargetView(mDynamicCubeMapRTV_SinglePass, clearColor2);
-	context->ClearDepthStencilView(mDynamicCubeMapDSV_SinglePass, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+	// Projected diameter in pixels of a sphere of radius r at distance d - the sphere fills the view when the camera is inside it
+	float wantedSize = (float)CUBEMAP_MAX_SIZE;
 
-	ID3D11RenderTargetView* aRTViews[1] = { mDynamicCubeMapRTV_SinglePass };
-	context->OMSetRenderTargets(sizeof(aRTViews) / sizeof(aRTViews[0]), aRTViews, mDynamicCubeMapDSV_SinglePass);
+	if (distance > reflectorRadius) {
 
-	renderObjects(context);
+		float projScaleY = XMVectorGetY(mainCamera->getProjMatrix().r[1]);
 
-	//fire must be rendered after sphere, otherwise sphere covers it when fire passes in front of the sphere
-	if (fire) {
-		fireEffect->bindPipeline(context);
+		wantedSize = CUBEMAP_TEXELS_PER_PIXEL * reflectorRadius / sqrtf(distance * distance - reflectorRadius * reflectorRadius) * projScaleY * viewport.Height;
+	}
 
-		// Apply the particles cBuffer.
-		context->VSSetConstantBuffers(0, 1, &cBufferFire);
-		context->GSSetConstantBuffers(0, 1, &cBufferFire);
-		context->PSSetConstantBuffers(0, 1, &cBufferFire);
-		// Render
-		fire->render(context);
+	int wantedLevel = 0;
 
-		context->GSSetShader(NULL, 0, 0);
+	while (wantedLevel + 1 < CUBEMAP_LEVELS && (float)(CUBEMAP_MAX_SIZE >> (wantedLevel + 1)) >= wantedSize)
+		wantedLevel++;
+
+	if (wantedLevel < cubeMapLevel) {
+
+		cubeMapShrinkFrames = 0;
+		setCubeMapLevel(wantedLevel);
 	}
+	else if (wantedLevel > cubeMapLevel && wantedSize <= CUBEMAP_SHRINK_MARGIN * (float)(cubeMapSize >> 1)) {
 
-	//
-	//Render scene to default render target
-	//
-	renderTargets[0] = renderTargetRTV;
-	context->OMSetRenderTargets(1, &defaultRenderTargetView, defaultDepthStencilView);
+		if (++cubeMapShrinkFrames >= CUBEMAP_SHRINK_FRAMES) {
 
-	rebuildViewport(mainCamera);
-	updateScene(context, mainCamera);
+			cubeMapShrinkFrames = 0;
+			setCubeMapLevel(cubeMapLevel + 1);
+		}
+	}
+	else
+		cubeMapShrinkFrames = 0;
+}
+
+// Render and sample the given cube map level from this frame.  The faces of the new level hold old content (or none) so all of them are re-rendered.
+void Scene::setCubeMapLevel(const int level) {
+
+	int newLevel = min(max(level, 0), CUBEMAP_LEVELS - 1);
+
+	if (newLevel == cubeMapLevel)
+		return;
+
+	cubeMapLevel = newLevel;
+	cubeMapSize = CUBEMAP_MAX_SIZE >> cubeMapLevel;
+	cubeMapResizes++;
+
+	for (int i = 0; i < 6; i++)
+		rebuildRenderTargetViewport(renderTargetCameras[i]);
+
+	// The sphere's material is pointed at the new level by updateReflectionProbes()
+	reflectionScheduler->requestFullRefresh();
+}
+
+// Return true if the given view is a hemisphere of the dual paraboloid map in the current frame - the +z or -z cube map face in dual paraboloid mode
+bool Scene::isParaboloidView(const int view) const {
+
+	return dualParaboloid && view >= 0 && view < MainView && (PARABOLOID_FACES & (1 << view)) != 0;
+}
+
+// Load the baked cube map of every probe.  Returns false (and the probes are not used) if any probe has not been baked.
+bool Scene::loadReflectionProbes() {
+
+	ID3D11Device *device = dx->getDevice();
+
+	reflectionProbesLoaded = true;
+	probeTextures.resize(reflectionProbes->getProbeCount(), nullptr);
+
+	for (int probe = 0; probe < reflectionProbes->getProbeCount(); probe++) {
+
+		string filename = getProbeFilename(probe);
 
-	context->ClearRenderTargetView(defaultRenderTargetView, clearColor2);
-	context->ClearDepthStencilView(defaultDepthStencilView, D3D11_CLEAR_DEPTH | D3D11_CLEAR_STENCIL, 1.0f, 0);
+		if (GetFileAttributesA(filename.c_str()) == INVALID_FILE_ATTRIBUTES) {
 
-	renderObjects(context);
+			reflectionProbesLoaded = false;
+			continue;
+		}
+
+		probeTextures[probe] = new Texture(device, wstring(filename.begin(), filename.end()));
 
-	if (sphere) {
-		// Apply the sphere cBuffer.
-		context->VSSetConstantBuffers(0, 1, &cBufferSphere);
-		context->PSSetConstantBuffers(0, 1, &cBufferSphere);
-		// Render
-		sphere->render(context);
+		if (!probeTextures[probe]->SRV) {
+
+			delete(probeTextures[probe]);
+			probeTextures[probe] = nullptr;
+			reflectionProbesLoaded = false;
+		}
 	}
 
-	//fire must be rendered after sphere, otherwise sphere covers it when fire passes in front of the sphere
-	if (fire) {
-		fireEffect->bindPipeline(context);
+	return reflectionProbesLoaded;
+}
 
-		// Apply the particles cBuffer.
-		context->VSSetConstantBuffers(0, 1, &cBufferFire);
-		context->GSSetConstantBuffers(0, 1, &cBufferFire);
-		context->PSSetConstantBuffers(0, 1, &cBufferFire);
-		// Render
-		fire->render(context);
+// Path of the DDS file of the given probe
+string Scene::getProbeFilename(const int probe) {
 
-		context->GSSetShader(NULL, 0, 0);
+	return string(REFLECTION_PROBE_PATH) + "probe" + to_string(probe) + ".dds";
+}
+
+// Choose the probes blended by the sphere from the position of the cube map cameras and point the sphere's material at them and at the current cube map level (and the dual paraboloid map of that level).  Without the probes the sphere's material only samples the cube map.
+void Scene::updateReflectionProbes() {
+
+	if (!reflectorModel)
+		return;
+
+	ID3D11ShaderResourceView *cubeMap = mDynamicCubeMapSRV[cubeMapLevel];
+	float weightB = 0.0f;
+
+	if (useReflectionProbes && reflectionProbesLoaded && !dualParaboloid) {
+
+		XMFLOAT3 centre;
+
+		XMStoreFloat3(&centre, renderTargetCameras[0]->getPos());
+		reflectionProbes->blend(&centre.x, &blendedProbeA, &blendedProbeB, &weightB);
+
+		reflectorModel->setTexture(1, probeTextures[blendedProbeA]->SRV);
+		reflectorModel->setTexture(3, probeTextures[blendedProbeB]->SRV);
 	}
+	else {
 
-	// Present current frame to the screen
-	HRESULT hr = dx->presentBackBuffer();
+		reflectorModel->setTexture(1, cubeMap);
+		reflectorModel->setTexture(3, cubeMap);
+	}
 
-	return S_OK;
+	reflectorModel->setTexture(4, cubeMap);
+	reflectorModel->setTexture(5, mDualParaboloidSRV[cubeMapLevel]);
+	cBufferPerFrameSrc->probeBlend = XMFLOAT4(weightB, (roughnessMips) ? (float)(PREFILTERED_MIP_LEVELS - 1) : 0.0f, 0.0f, 0.0f);
 }
 
-//calls to render objects have been moved from renderScene() to this function, to make the renderScene() code more readable
-HRESULT Scene::renderObjects(ID3D11DeviceContext* context)
-{
-	if (bridge) {
+// Choose the cube map faces rendered this frame.  Faces that show (or showed in the last frame) a reflected node that moved in the last simulation step are marked dirty, as is every face when the cube map centre moves.  Every face is re-rendered at once when the centre has moved more than reflectionRefreshDistance since the last full refresh.  Lighting changes do not mark faces dirty - they are picked up by the round-robin refresh.  The layered pass always renders every face and the dual paraboloid map always renders both hemispheres.
+void Scene::scheduleCubeFaces() {
 
-		// Setup pipeline for effect
-		// Apply the bridge cBuffer.
-		context->VSSetConstantBuffers(0, 1, &cBufferBridge);
-		context->PSSetConstantBuffers(0, 1, &cBufferBridge);
-		// Render
-		bridge->render(context);
+	if (dualParaboloid) {
+
+		cubeFacesScheduled = PARABOLOID_FACES;
+		return;
 	}
 
-	if (towerA)
-	{
-		context->VSSetConstantBuffers(0, 1, &cBufferTowerA);
-		context->PSSetConstantBuffers(0, 1, &cBufferTowerA);
+	if (layeredCubeMap) {
 
-		towerA->render(context);
+		cubeFacesScheduled = ReflectionScheduler::AllFaces;
+		return;
 	}
 
-	if (knight)
-	{
-		context->VSSetConstantBuffers(0, 1, &cBufferKnight);
-		context->PSSetConstantBuffers(0, 1, &cBufferKnight);
+	XMVECTOR centreMove = XMLoadFloat3(&cubeMapCentre) - XMLoadFloat3(&cubeMapRefreshCentre);
+
+	if (XMVectorGetX(XMVector3Length(centreMove)) > reflectionRefreshDistance)
+		reflectionScheduler->requestFullRefresh();
 
-		knight->render(context);
+	if (sceneGraph->hasChanged(sphereAnchorNode))
+		reflectionScheduler->markDirty(ReflectionScheduler::AllFaces);
+	else {
+
+		// Masks are in node order (see updateFrame()).  objectViewMasks still holds the masks of the last frame.
+		uint32_t movedFaces = 0;
+		uint32_t cullIndex = 0;
+
+		for (int i = 0; i < sceneGraph->getNodeCount(); i++) {
+
+			SceneNode node = sceneGraph->getNodeInOrder(i);
+
+			if (!sceneGraph->getRenderable(node))
+				continue;
+
+			uint8_t mask = viewCuller->getMask(cullIndex++);
+
+			if ((sceneGraph->getRenderFlags(node) & RenderInReflection) && sceneGraph->hasChanged(node))
+				movedFaces |= mask | objectViewMasks[node];
+		}
+
+		reflectionScheduler->markDirty(movedFaces);
 	}
 
-	if (box) {
-		// Apply the box cBuffer.
-		context->VSSetConstantBuffers(0, 1, &cBufferSkyBox);
-		context->PSSetConstantBuffers(0, 1, &cBufferSkyBox);
-		// Render
-		box->render(context);
+	cubeFacesScheduled = reflectionScheduler->schedule();
+
+	if (cubeFacesScheduled == ReflectionScheduler::AllFaces)
+		cubeMapRefreshCentre = cubeMapCentre;
+}
+
+// Remove the cube map faces without dynamic objects from the faces chosen by scheduleCubeFaces() while the reflection probes are in use.  A face that showed dynamic objects (or the whole scene) and no longer does is rendered once more to clear it.  Faces left empty are up to date however long ago they were scheduled.
+void Scene::scheduleProbeFaces() {
+
+	if (!useReflectionProbes || !reflectionProbesLoaded || dualParaboloid) {
+
+		probeFacesOccupied = ReflectionScheduler::AllFaces;
+		return;
 	}
 
-	if (walls)
-	{
-		context->VSSetConstantBuffers(0, 1, &cBufferWalls);
-		context->PSSetConstantBuffers(0, 1, &cBufferWalls);
+	// Masks are in node order (see updateFrame())
+	uint32_t dynamicFaces = 0;
+	uint32_t cullIndex = 0;
+
+	for (int i = 0; i < sceneGraph->getNodeCount(); i++) {
 
-		walls->render(context);
+		SceneNode node = sceneGraph->getNodeInOrder(i);
+
+		if (!sceneGraph->getRenderable(node))
+			continue;
+
+		uint32_t renderFlags = sceneGraph->getRenderFlags(node);
+		uint8_t mask = viewCuller->getMask(cullIndex++);
+
+		if ((renderFlags & RenderInReflection) && !(renderFlags & RenderInProbe))
+			dynamicFaces |= mask;
 	}
 
-	if (stand)
-	{
-		context->VSSetConstantBuffers(0, 1, &cBufferStand);
-		context->PSSetConstantBuffers(0, 1, &cBufferStand);
+	for (size_t g = 0; g < instancedGroups.size(); g++) {
 
-		stand->render(context);
+		if (!(instancedGroups[g].renderFlags & RenderInReflection))
+			continue;
+
+		for (size_t k = 0; k < instancedGroups[g].instances.size(); k++)
+			dynamicFaces |= viewCuller->getMask(instancedGroups[g].firstCullIndex + (uint32_t)k);
 	}
 
-	return S_OK;
-}
\ No newline at end of file
+	dynamicFaces &= ReflectionScheduler::AllFaces;
+
+	uint32_t clearedFaces = probeFacesOccupied & ~dynamicFaces;
+
+	// The layered pass renders every face so runs if any face needs rendering
+	if (layeredCubeMap)
+		cubeFacesScheduled = (dynamicFaces | clearedFaces) ? ReflectionScheduler::AllFaces : 0;
+	else
+		cubeFacesScheduled = (cubeFacesScheduled & dynamicFaces) | clearedFaces;
+
+	probeFacesOccupied = (probeFacesOccupied & ~cubeFacesScheduled) | (cubeFacesScheduled & dynamicFaces);
+
+	for (int face = 0; face < ReflectionScheduler::NumFaces; face++) {
+
+		if (cubeFacesScheduled & (1 << face))
+			probeFacesRendered++;
+	}
+}
+
+// Write the instances of every instanced group visible in each view (see cullViews()) to a contiguous range of the instance buffer per (group, view) pair.  The buffer is mapped once per frame.
+void Scene::updateInstances(DXContext *context) {
+
+	if (!instanceBuffer || instancedGroups.empty())
+		return;
+
+	instanceBuffer->begin(context);
+
+	for (size_t g = 0; g < instancedGroups.size(); g++) {
+
+		InstancedGroup &group = instancedGroups[g];
+
+		// In layered mode the instances visible in any cube map face are written once (to layeredRange) in place of the six per-face ranges.  Dual paraboloid mode overrides layered mode.
+		bool layeredMode = layeredCubeMap && !dualParaboloid;
+
+		for (int i = 0; i <= NumViews; i++) {
+
+			bool layered = (i == LayeredCubeMapView);
+			DXInstanceRange &range = (layered) ? group.layeredRange : group.visibleRanges[i];
+			uint32_t viewMask = (layered) ? (1 << MainView) - 1 : 1 << i;
+
+			range.firstInstance = 0;
+			range.numInstances = 0;
+
+			if (!(group.renderFlags & ((i == MainView) ? RenderInMainView : RenderInReflection)) || (i < MainView && (layeredMode || !(cubeFacesScheduled & (1 << i)))) || (layered && !layeredMode))
+				continue;
+
+			visibleInstances.clear();
+
+			for (size_t k = 0; k < group.instances.size(); k++) {
+
+				if (viewCuller->getMask(group.firstCullIndex + (uint32_t)k) & viewMask)
+					visibleInstances.push_back((int)k);
+			}
+
+			if (visibleInstances.empty())
+				continue;
+
+			DXInstanceData *instanceData = instanceBuffer->allocate((UINT)visibleInstances.size(), &range);
+
+			for (UINT k = 0; k < range.numInstances; k++)
+				instanceData[k] = group.instances[visibleInstances[k]];
+		}
+	}
+
+	instanceBuffer->end(context);
+}
+
+// Draw the instances of each instanced group visible in the given view.  Each group costs one draw call per sub-mesh regardless of the number of instances.  The layered cube map view draws the instances visible in any face with the layered variant of the group's effect and the hemispheres of the dual paraboloid map draw with the paraboloid variant.
+void Scene::renderInstancedGroups(DXContext *context, const uint32_t pass, const int view) {
+
+	bool layered = (view == LayeredCubeMapView);
+	bool paraboloid = isParaboloidView(view);
+	for (size_t g = 0; g < instancedGroups.size(); g++) {
+
+		InstancedGroup &group = instancedGroups[g];
+		const DXInstanceRange &range = (layered) ? group.layeredRange : group.visibleRanges[view];
+		Effect *effect = (view != MainView && reflectionLOD && group.reflectionEffect) ? group.reflectionEffect : group.effect;
+
+		if (!(group.renderFlags & pass) || range.numInstances == 0)
+			continue;
+
+		constantRing->bind(context, ConstantStageVS, CBufferSlotPerObject, 1, &group.objectConstants);
+
+		if (layered) {
+
+			map<Effect*, Effect*>::const_iterator layeredEffect = layeredEffects.find(effect);
+
+			if (layeredEffect != layeredEffects.end())
+				group.model->renderInstanced(context, layeredEffect->second, instanceBuffer->getBuffer(), range);
+		}
+		else if (paraboloid) {
+
+			map<Effect*, Effect*>::const_iterator paraboloidEffect = paraboloidEffects.find(effect);
+
+			if (paraboloidEffect != paraboloidEffects.end())
+				group.model->renderInstanced(context, paraboloidEffect->second, instanceBuffer->getBuffer(), range);
+		}
+		else
+			group.model->renderInstanced(context, effect, instanceBuffer->getBuffer(), range);
+	}
+}
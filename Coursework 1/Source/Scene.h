@@ -6,15 +6,30 @@
 
 #include <GUObject.h>
 #include <Windows.h>
+#include <DXSystem.h>
 #include <Box.h>
 #include <Triangle.h>
 #include <Particles.h>
 #include <Quad.h>
 
 #include <CBufferStructures.h>
+#include <DXConstantRing.h>
+#include <DXRenderQueue.h>
+#include <DXInstanceBuffer.h>
+#include <WorkerPool.h>
+#include <FrustumCuller.h>
+#include <OcclusionCuller.h>
+#include <ReflectionScheduler.h>
+#include <ReflectionProbeSet.h>
+#include <FixedTimestep.h>
+#include <SceneGraph.h>
 #include <Material.h>
+#include <map>
 
 class DXSystem;
+class DXContext;
+class DXCommandList;
+class DXStateFilterContext;
 class CGDClock;
 class Model;
 class Camera;
@@ -25,8 +40,6 @@ class Effect;
 
 
 
-
-
 class Scene : public GUObject {
 
 	HINSTANCE								hInst = NULL;
@@ -52,18 +65,37 @@ class Scene : public GUObject {
 	Effect									*basicEffect;
 	Effect									*refMapEffect;
 	Effect									*fireEffect;
+
+	//instanced variants of perPixelLightingEffect and refMapEffect - world transforms are read from the per-instance vertex stream rather than the per-object cbuffer
+	Effect									*perPixelLightingInstancedEffect = nullptr;
+	Effect									*refMapInstancedEffect = nullptr;
+
+	//layered variants of the effects drawn into the cube map - the same vertex and pixel shaders with a geometry shader that emits each triangle to every cube map face it may be seen by (see recordView()).  Keyed on the effect they replace.
+	Effect									*perPixelLightingLayeredEffect = nullptr;
+	Effect									*perPixelLightingInstancedLayeredEffect = nullptr;
+	Effect									*skyBoxLayeredEffect = nullptr;
+	std::map<Effect*, Effect*>				layeredEffects;
+
+	//simplified lighting (no specular term) used to draw objects into the cube map (see ReflectionLOD) and its instanced and layered variants
+	Effect									*reflectionLightingEffect = nullptr;
+	Effect									*reflectionLightingInstancedEffect = nullptr;
+	Effect									*reflectionLightingLayeredEffect = nullptr;
+	Effect									*reflectionLightingInstancedLayeredEffect = nullptr;
+
+	//reflection of the blended reflection probes with the dynamic objects composited over them - replaces refMapEffect for the sphere while the probes are in use
+	Effect									*reflectionProbeEffect = nullptr;
+
+	//dual paraboloid variants of the effects drawn into the reflection - the same pixel shaders with a vertex shader that projects onto the paraboloid of the view's hemisphere (see setDualParaboloid()).  Keyed on the effect they replace.  The sky box has no variant - the sphere samples the sky cube map where the paraboloids are empty.
+	Effect									*perPixelLightingParaboloidEffect = nullptr;
+	Effect									*perPixelLightingInstancedParaboloidEffect = nullptr;
+	Effect									*reflectionLightingParaboloidEffect = nullptr;
+	Effect									*reflectionLightingInstancedParaboloidEffect = nullptr;
+	std::map<Effect*, Effect*>				paraboloidEffects;
+
+	//reflection of the dual paraboloid map composited over the sky cube map - replaces refMapEffect for the sphere in dual paraboloid mode
+	Effect									*reflectionParaboloidEffect = nullptr;
 	
-	ID3D11Buffer							*cBufferSkyBox = nullptr;
-	ID3D11Buffer							*cBufferBridge = nullptr;
-	ID3D11Buffer							*cBufferTowerA = nullptr;
-	ID3D11Buffer							*cBufferKnight = nullptr;
-	ID3D11Buffer							*cBufferTree = nullptr;
-	ID3D11Buffer							*cBufferSphere = nullptr;
-	ID3D11Buffer							*cBufferStand = nullptr;
-	ID3D11Buffer							*cBufferWalls = nullptr;
-	ID3D11Buffer							*cBufferFire = nullptr;
-
-	CBufferExt								*cBufferExtSrc = nullptr;
+	CBufferPerFrame							*cBufferPerFrameSrc = nullptr;
 
 	Texture									*brickTexture = nullptr;
 	Texture									*mossWallTexture = nullptr;
@@ -73,50 +105,232 @@ class Scene : public GUObject {
 	Texture									*knightTexture = nullptr;
 	Texture									*fireTexture = nullptr;
 
-	// Tutorial 04
-	ID3D11ShaderResourceView*				mDynamicCubeMapSRV;
+	//the size of each face of the cube map texture at its most detailed level and the number of levels (each half the size of the one before).  The cube map is rendered into and sampled from the level chosen by updateCubeMapSize().
+	static const int						CUBEMAP_MAX_SIZE = 512;
+	static const int						CUBEMAP_LEVELS = 5;
+
+	// Tutorial 04 - one set of views per cube map level
+	ID3D11ShaderResourceView*				mDynamicCubeMapSRV[CUBEMAP_LEVELS];
 	ID3D11RenderTargetView*					renderTargetRTV;
-	ID3D11RenderTargetView*					mDynamicCubeMapRTV[6];
-	ID3D11DepthStencilView*					mDynamicCubeMapDSV;
+	ID3D11RenderTargetView*					mDynamicCubeMapRTV[CUBEMAP_LEVELS][6];
+	ID3D11DepthStencilView*					mDynamicCubeMapDSV[CUBEMAP_LEVELS];
 
-	//used for the (attempted) efficient creation of cube map using the geometry shader in a single pass
-	ID3D11RenderTargetView*					mDynamicCubeMapRTV_SinglePass;
-	ID3D11DepthStencilView*					mDynamicCubeMapDSV_SinglePass;
+	//render target and depth views of all six cube map faces used by the layered (single pass) cube map mode
+	ID3D11RenderTargetView*					mDynamicCubeMapRTV_SinglePass[CUBEMAP_LEVELS];
+	ID3D11DepthStencilView*					mDynamicCubeMapDSV_SinglePass[CUBEMAP_LEVELS];
+
+	//the +z and -z faces of each cube map level viewed as a 2 slice array - the two hemispheres of the dual paraboloid map are rendered into these faces
+	ID3D11ShaderResourceView*				mDualParaboloidSRV[CUBEMAP_LEVELS];
+
+	//render the cube map in one layered pass (each object submitted once) rather than one pass per face (each object submitted once per face it is visible in)
+	bool									layeredCubeMap = false;
+
+	//the sphere reflects a dual paraboloid map - two hemispheres rendered every frame by the +z and -z cube map cameras in place of the six cube map faces (and the reflection probes).  Overrides the layered cube map mode.
+	bool									dualParaboloid = false;
+	static const uint32_t					PARABOLOID_FACES = (1 << 4) | (1 << 5); //cube map faces (views) the hemispheres are rendered into
+	const float								PARABOLOID_CULL_FOV = 3.1f; //field of view of the perspective frustum each hemisphere is culled against - just under a hemisphere
 	
-	//Models
-	Model									*bridge = nullptr;
-	Model									*towerA = nullptr;
-	Model									*knight = nullptr;
-	Box										*box = nullptr;
-	Model									*sphere = nullptr;
-	Model									*stand = nullptr;
+	//Models - every renderable object is owned by a node of the scene graph
+	SceneGraph								*sceneGraph = nullptr;
 	Quad									*triangle = nullptr;
-	Model									*walls = nullptr;
-	Particles								*fire = nullptr;
+
+	//nodes referred to directly by the scene.  The reflective sphere, the fire and the second light are children of sphereAnchorNode, whose local transform is the user-defined translation of the sphere (see handleKeyDown()).
+	SceneNode								sphereAnchorNode = SceneGraph::NullNode;
+	SceneNode								fireNode = SceneGraph::NullNode;
+	SceneNode								light2Node = SceneGraph::NullNode;
+
+	//render flags stored with each scene graph node
+	enum SceneRenderFlags : uint32_t {
+
+		RenderInReflection = 0x01,		// drawn into each face of the dynamic cube map
+		RenderInMainView = 0x02,		// drawn into the main view
+		ObjectConstantsGS = 0x04,		// per-object constants are read by the geometry shader rather than the vertex shader
+		RenderInProbe = 0x08			// static - baked into the reflection probes so not drawn into the cube map while the probes are in use
+	};
+
 	// Main FPS clock
 	CGDClock								*mainClock = nullptr;
 
+	// Fixed-step simulation clock driven by the main clock's game time.  The scene graph is updated once per step and rendered interpolated between the last two steps so animation does not depend on the frame rate.
+	FixedTimestep							*simulationClock = nullptr;
+
+	//default number of simulation steps per second
+	const double							SIMULATION_RATE = 60.0;
+
 	//Main scene camera
 	FirstPersonCamera						*mainCamera = nullptr;
 
 	//Cameras used for rendering to 6 render targets for the dynamic reflection
 	FirstPersonCamera						*renderTargetCameras[6]; 
 
-	//the size of each face of the cube map texture - a low resolution such as 256 x 256 saves processing
-	const int								CUBEMAP_SIZE = 256;
+	//level of the cube map currently rendered and sampled and the size of its faces.  The size follows the projected size of the sphere in the main view - it grows as soon as the sphere needs more detail but only shrinks once the sphere has been well below the next smaller size for CUBEMAP_SHRINK_FRAMES frames so it does not switch back and forth at a boundary.
+	int										cubeMapLevel = 1;
+	int										cubeMapSize = CUBEMAP_MAX_SIZE >> 1;
+	bool									adaptiveCubeMapSize = true;
+	int										cubeMapShrinkFrames = 0; //consecutive frames the sphere has needed a smaller cube map
+	uint32_t								cubeMapResizes = 0;
+	const float								CUBEMAP_TEXELS_PER_PIXEL = 1.0f; //cube map face size per pixel of the sphere's projected diameter
+	const float								CUBEMAP_SHRINK_MARGIN = 0.75f; //the cube map shrinks once the size needed is below this fraction of the next smaller size
+	const int								CUBEMAP_SHRINK_FRAMES = 30;
+
+	//the reflective sphere - its material samples the current cube map level (or the reflection probes and the current cube map level, see updateReflectionProbes())
+	Model									*reflectorModel = nullptr;
+	SceneNode								reflectorNode = SceneGraph::NullNode;
+	float									reflectorRadius = 1.0f;
+
+	//static reflection probes - cube maps of the RenderInProbe nodes baked offline (see bakeReflectionProbes()) and loaded from REFLECTION_PROBE_PATH.  While the probes are in use the sphere blends the two nearest probes and the cube map only holds the dynamic objects, so faces without dynamic objects are not rendered.
+	ReflectionProbeSet						*reflectionProbes = nullptr;
+	std::vector<Texture*>					probeTextures; //indexed by probe, nullptr if the probe has not been baked
+	bool									reflectionProbesLoaded = false; //every probe was loaded
+	bool									useReflectionProbes = true;
+	bool									bakingReflectionProbes = false; //recordView() draws the RenderInProbe nodes into the cube map faces
+	uint32_t								probeFacesOccupied = 0; //cube map faces holding dynamic objects (or the whole scene) that must be cleared once they show no dynamic objects
+	int										blendedProbeA = 0; //probes blended by the sphere in the current frame
+	int										blendedProbeB = 0;
+	uint64_t								probeFacesRendered = 0; //cube map faces rendered while the probes are in use since the last benchmark started
+	const float								REFLECTION_PROBE_RADIUS = 12.0f;
+
+	//the probes are baked with a GGX prefiltered mip chain - level l holds roughness l / (PREFILTERED_MIP_LEVELS - 1).  With roughnessMips the sphere samples the level matching the roughness of its surface.
+	const int								PREFILTERED_MIP_LEVELS = 6;
+	const int								PREFILTER_SAMPLE_COUNT = 64; //GGX samples per texel
+	bool									roughnessMips = false;
+	const char								*REFLECTION_PROBE_PATH = "Resources\\Probes\\";
+
+	//far clip plane distance of every camera - also the view depth mapped to the largest depth in the render queue sort key
+	const float								FAR_DEPTH = 1000.0f;
+
+	//size of the xz grid cells the static castle geometry is batched by - one draw per material per cell (see StaticBatch)
+	const float								STATIC_BATCH_CELL_SIZE = 20.0f;
+
+	//draw calls per pass of the static geometry before and after batching (reported by the benchmark)
+	uint32_t								staticSourceDraws = 0;
+	uint32_t								staticBatchDraws = 0;
+
+	//size of the grid the vertices of the static geometry are clustered on to make the proxies drawn into the cube map - about two cube map pixels at the distance of the castle walls from the sphere
+	const float								REFLECTION_PROXY_CELL_SIZE = 0.25f;
+
+	//distance from the cube map centre beyond which the knights are not drawn into the cube map
+	const float								REFLECTION_CUTOFF_DISTANCE = 60.0f;
+
+	//triangles of the static geometry drawn per pass in the main view and in the cube map faces (reported by the benchmark)
+	uint32_t								staticBatchTriangles = 0;
+	uint32_t								staticProxyTriangles = 0;
 
-	//used for applying a user-defined translation to the reflective sphere in updateScene()
-	DirectX::XMMATRIX						sphereTranslationMatrix = XMMatrixIdentity();
-	
 	//initial position of the second light in the scene (coming from the fire)
 	DirectX::XMVECTOR						originalLight2Vec = DirectX::XMVectorSet(-2.5, 0.0, 2.0, 1.0);
 
+	//simulation time the current frame is rendered at - between the last two simulation steps (see updateFrame())
+	gu_seconds								frameTime = 0.0;
+
+	//views rendered each frame - the 6 cube map faces (indexed as renderTargetCameras) followed by the main camera
+	enum SceneView {
+
+		MainView = 6,
+
+		NumViews,
+
+		//all six cube map faces rendered in a single layered pass - recorded on the context and render queue of face 0 (see recordView())
+		LayeredCubeMapView = NumViews
+	};
+
+	//upload ring holding all per-frame, per-view and per-object constants.  Every block is written by updateFrame() in a single map of the ring and bound by range using the offsets below.
+	DXConstantRing							*constantRing = nullptr;
+	DXConstantRange							perFrameConstants;
+	DXConstantRange							perViewConstants[NumViews];
+	std::vector<DXConstantRange>			objectConstants; //indexed by scene graph node
+
+	//nodes at rest (not moved by the last simulation step) are bound to a static block of the ring instead.  Their constants and world space bounds are written once when they come to rest and reused every frame until they move again.
+	std::vector<DXConstantRange>			staticObjectConstants; //indexed by scene graph node
+	std::vector<DirectX::XMFLOAT4>			staticObjectBounds; //world space bounding sphere, w < 0 if the node is unbounded
+	std::vector<uint8_t>					staticObjectValid; //1 if the static block and bounds of the node are current
+
+	//the world space bounds of every renderable node and crowd instance are culled against all views in a single pass each frame (see cullViews()).  Bit v of a node's mask is set if it is visible in view v.
+	FrustumCuller							*viewCuller = nullptr;
+	std::vector<uint8_t>					objectViewMasks; //indexed by scene graph node
+
+	//how a node is drawn into the cube map - a cheaper stand-in model, a cheaper effect and the distance from the cube map centre beyond which it is not drawn.  The proxy is drawn with the node's world transform so must be in the same model space.
+	struct ReflectionLOD {
+
+		DXBaseModel							*proxy; //retained, nullptr to draw the node's own model
+		Effect								*effect; //nullptr to use the model's effect
+		float								maxDistance; //FLT_MAX for no cutoff
+	};
+
+	std::vector<ReflectionLOD>				reflectionLODs; //indexed by scene graph node
+	bool									reflectionLOD = true;
+	uint32_t								objectsBeyondReflectionCutoff = 0; //objects removed from the cube map faces by their cutoff distance in the last frame
+
+	//minimum projected diameter in pixels of objects drawn into the cube map faces - smaller objects contribute little to the low resolution reflection and are skipped.  0 disables contribution culling.
+	float									reflectionContributionThreshold = 2.0f;
+
+	//CPU occlusion culling - the castle walls and tower are rasterized into a low resolution depth buffer for the main view (and optionally each cube map face) and objects hidden behind them are removed from the view's mask (see cullViews())
+	OcclusionCuller							*occlusionCuller = nullptr;
+	bool									occlusionCulling = true;
+	bool									cubeFaceOcclusionCulling = false;
+	uint32_t								objectsOccluded[NumViews]; //objects removed by occlusion culling from each view in the last frame
+
+	//width and height in pixels of the occlusion depth buffer of each view
+	const int								OCCLUSION_BUFFER_SIZE = 256;
+
+	//chooses the cube map faces re-rendered each frame - a budget of faces per frame with faces showing moved objects first (see scheduleCubeFaces()).  Faces not rendered keep their content from an earlier frame.
+	ReflectionScheduler						*reflectionScheduler = nullptr;
+	uint32_t								cubeFacesScheduled = ReflectionScheduler::AllFaces; //faces rendered in the current frame
+	const int								CUBE_FACES_PER_FRAME = 2;
+
+	//distance the cube map centre can move before every face is re-rendered at once rather than within the face budget
+	float									reflectionRefreshDistance = 1.0f;
+	DirectX::XMFLOAT3						cubeMapRefreshCentre = DirectX::XMFLOAT3(0.0f, 0.0f, 0.0f); //cube map centre at the last full refresh
+
+	//size of the constant ring in bytes - large enough for several frames of constants to be in flight
+	static const UINT						CONSTANT_RING_SIZE = 64 * 1024;
+
+	//queue the scene graph nodes of each view are submitted to - sorted by state and depth before drawing so state is only bound when it changes.  One queue per view so views can be recorded concurrently.
+	DXRenderQueue							*renderQueues[NumViews];
+
+	//view matrix of each view for the current frame (written by updateFrame())
+	DirectX::XMFLOAT4X4						viewMatrices[NumViews];
+
+	//position of the cube map cameras for the current frame - the layered cube map pass sorts by distance from it
+	DirectX::XMFLOAT3						cubeMapCentre;
+
+	//copies of one model drawn with one instanced draw per sub-mesh in each view.  The instances visible in each view are written to instanceBuffer by updateFrame().
+	struct InstancedGroup {
+
+		Model								*model;
+		Effect								*effect; //an instanced effect (see perPixelLightingInstancedEffect)
+		uint32_t							renderFlags; //passes the group is drawn in (see SceneRenderFlags)
+		std::vector<DXInstanceData>			instances;
+		std::vector<DirectX::XMFLOAT4>		bounds; //world space bounding sphere of each instance (centre in xyz, radius in w)
+		DXInstanceRange						visibleRanges[NumViews];
+		DXInstanceRange						layeredRange; //instances visible in any cube map face (layered cube map mode only)
+		Effect								*reflectionEffect; //instanced effect used in the cube map faces (nullptr to use effect)
+		float								reflectionMaxDistance; //distance from the cube map centre beyond which instances are not drawn into the cube map
+		uint32_t							firstCullIndex; //index of the first instance's bounds in viewCuller
+		DXConstantRange						objectConstants; //the model's material colours for the instanced vertex shaders (written by updateFrame())
+	};
+
+	std::vector<InstancedGroup>				instancedGroups;
+	DXInstanceBuffer						*instanceBuffer = nullptr;
+	std::vector<int>						visibleInstances; //scratch list of the instances of a group that pass the culling test of a view
+
+	//knight model used for the instanced crowd (see setCrowdSize())
+	Model									*crowdModel = nullptr;
+
+	//parallel view recording - when enabled each view is recorded by a worker thread on its own deferred context and the resulting command lists are executed in view order on the immediate context
+	bool									parallelRecording = false;
+	WorkerPool								*workerPool = nullptr;
+	DXStateFilterContext					*viewContexts[NumViews];
+	DXCommandList							*viewCommandLists[NumViews];
+
+	//file the Chrome trace of the scene's load tasks is written to by initialiseSceneResources() (see setInitTraceFile())
+	static std::string						initTraceFile;
+
 	//
 	// Private interface
 	//
 
 	// Private constructor
-	Scene(const LONG _width, const LONG _height, const wchar_t* wndClassName, const wchar_t* wndTitle, int nCmdShow, HINSTANCE hInstance, WNDPROC WndProc);
+	Scene(const LONG _width, const LONG _height, const wchar_t* wndClassName, const wchar_t* wndTitle, int nCmdShow, HINSTANCE hInstance, WNDPROC WndProc, DXBackendType backend);
 
 	// Return TRUE if the window is in a minimised state, FALSE otherwise
 	BOOL isMinimised();
@@ -128,7 +342,10 @@ public:
 	// Public interface
 	//
 	// Factory method to create the main Scene instance (singleton)
-	static Scene* CreateScene(const LONG _width, const LONG _height, const wchar_t* wndClassName, const wchar_t* wndTitle, int nCmdShow, HINSTANCE hInstance, WNDPROC WndProc);
+	static Scene* CreateScene(const LONG _width, const LONG _height, const wchar_t* wndClassName, const wchar_t* wndTitle, int nCmdShow, HINSTANCE hInstance, WNDPROC WndProc, DXBackendType backend = DXBackendType::D3D11);
+
+	// Write the trace of the load tasks of scenes created from now on to the given file in the Chrome trace event format (empty to only print the critical path)
+	static void setInitTraceFile(const std::string &filename);
 
 	// Destructor
 	~Scene();
@@ -139,14 +356,79 @@ public:
 	// Resize swap chain buffers and update pipeline viewport configurations in response to a window resize event
 	HRESULT resizeResources();
 
-	// Helper function to call updateScene followed by renderScene
+	// Helper function to call updateFrame followed by renderScene
 	HRESULT updateAndRenderScene();
-	HRESULT mapCbuffer(void *cBufferExtSrcL, ID3D11Buffer *cBufferExtL);
 	// Clock handling methods
 	void startClock();
 	void stopClock();
 	void reportTimingData();
 
+	// Place numInstances copies of the knight on rings around the castle.  The crowd is drawn with hardware instancing and culled against each view every frame.  0 removes the crowd.
+	void setCrowdSize(const int numInstances);
+
+	// Set the number of fixed simulation steps per second.  Rendering is not limited by the rate.
+	void setSimulationRate(const double stepsPerSecond);
+	double getSimulationRate();
+
+	// Set the minimum projected diameter in pixels of objects drawn into the cube map faces.  0 disables contribution culling.
+	void setReflectionContributionThreshold(const float pixels);
+	float getReflectionContributionThreshold();
+
+	// Set the number of cube map faces re-rendered per frame (1 to 6) and the distance the sphere can move before every face is re-rendered
+	void setCubeFacesPerFrame(const int faces);
+	int getCubeFacesPerFrame();
+	void setReflectionRefreshDistance(const float distance);
+	float getReflectionRefreshDistance();
+
+	// Fix the size of each cube map face (rounded to a size of one of the cube map levels) or, if size is 0, choose it each frame from the projected size of the sphere
+	void setCubeMapSize(const int size);
+	int getCubeMapSize();
+
+	// Set how the given scene graph node is drawn into the cube map (see ReflectionLOD) and enable or disable the reflection LODs of every node
+	void setReflectionLOD(const SceneNode node, DXBaseModel *proxy, Effect *effect, const float maxDistance);
+	void setReflectionLODEnabled(const bool enabled);
+	bool getReflectionLODEnabled();
+
+	// Select layered (single pass) or six pass rendering of the cube map
+	void setLayeredCubeMap(const bool enabled);
+	bool getLayeredCubeMap();
+
+	// Use the static reflection probes (if every probe has been baked) with the cube map holding only the dynamic objects, or render the whole scene into the cube map
+	void setReflectionProbesEnabled(const bool enabled);
+	bool getReflectionProbesEnabled();
+
+	// Render the static scene (RenderInProbe nodes) into the cube map at each probe position at the largest cube map size and write each probe to REFLECTION_PROBE_PATH as a GGX prefiltered DDS cube map.  Not supported by the HEADLESS backend (the NULL device renders nothing).  Returns false if a probe could not be written.
+	bool bakeReflectionProbes();
+
+	// Write a GGX prefiltered copy of the given DDS cube map with "_ggx" added to the file name.  Only uncompressed 32 bit cube maps are supported.
+	bool prefilterCubeMap(const std::string &filename);
+
+	// Sample the levels of the prefiltered reflection probes by the roughness of the sphere's surface
+	void setRoughnessMips(const bool enabled);
+	bool getRoughnessMips();
+
+	// Reflect a dual paraboloid map (two passes) rather than the cube map (six passes, or the reflection probes) in the sphere
+	void setDualParaboloid(const bool enabled);
+	bool getDualParaboloid();
+
+	// Run numFrames frames with six pass, layered and dual paraboloid reflection rendering and report the CPU frame time, draws and API calls of each mode.  The current mode is restored afterwards.
+	void compareCubeMapModes(const int numFrames);
+
+	// Enable or disable CPU occlusion culling of the main view and of the cube map faces
+	void setOcclusionCulling(const bool mainView, const bool cubeFaces);
+	bool getOcclusionCulling();
+	bool getCubeFaceOcclusionCulling();
+
+	// Enable or disable recording the views on worker threads (see renderScene())
+	void setParallelRecording(const bool enabled);
+	bool getParallelRecording();
+
+	// Render one frame with serial and one with parallel view recording on the HEADLESS backend and check both produce the same sequence of render target, clear and draw commands.  Returns false if they differ or the backend is not HEADLESS.
+	bool verifyParallelRecording();
+
+	// Run updateAndRenderScene for numFrames frames back-to-back and report the CPU frame cost and the issued / filtered API call counts of the state filter.  When the HEADLESS backend is in use the recorded API call counts are also reported.
+	void runBenchmark(const int numFrames);
+
 
 	//
 	// Event handling methods
@@ -180,12 +462,28 @@ public:
 	HRESULT LoadShader(ID3D11Device *device, const char *filename, char **PSBytecode, ID3D11PixelShader **pixelShader);
 	uint32_t LoadShader(ID3D11Device *device, const char *filename, char **VSBytecode, ID3D11VertexShader **vertexShader);
 	HRESULT initialiseSceneResources();
-	HRESULT updateScene(ID3D11DeviceContext *context, FirstPersonCamera* camera); //updates cbuffers using the view and projection matrices of the specified camera
+	void simulateStep(const gu_seconds time); //advances the simulation (scene graph animation) to the given time - called once per fixed step
+	HRESULT updateFrame(); //ticks the main clock, runs the simulation steps that are due and writes the per-frame, per-view and per-object constants for the frame into the constant ring
+	HRESULT updateScene(DXContext *context, const int view); //binds the per-frame constants and the per-view constants of the specified view (cube face index or MainView)
+	void renderNode(DXContext *context, const SceneNode node); //binds the per-object constants of the specified scene graph node and renders it
+	void recordView(DXContext *context, const int view); //records the commands that render the specified view (cube face index, LayeredCubeMapView or MainView) - only reads scene state so views can be recorded concurrently
 	HRESULT renderScene();
-	HRESULT renderSceneWithCubeMapGS();
-	HRESULT renderObjects(ID3D11DeviceContext* context);
-
-	void DrawScene(ID3D11DeviceContext *context);
+	HRESULT renderObjects(DXContext *context, const uint32_t pass, const int view, const uint32_t viewMask, const uint32_t excludeFlags = 0); //submits every scene graph node with the given render flag (and none of excludeFlags) that is visible in a view of viewMask to the render queue and draws the queue sorted by state and depth in the specified view (LayeredCubeMapView draws with the layered effects)
+	void addOccluder(Model *model, DirectX::FXMMATRIX world); //adds the mesh of a model (loaded with keepMeshData) placed with the given world transform to the occlusion culler
+	void applyReflectionCutoff(const uint32_t cullIndex, const float maxDistance); //removes the view culler sphere from the cube map faces if it is further than maxDistance from the cube map centre
+	void updateCubeMapSize(); //chooses the cube map level from the projected size of the sphere in the main view
+	void setCubeMapLevel(const int level); //renders and samples the given cube map level from the next frame
+	bool isParaboloidView(const int view) const; //the view is a hemisphere of the dual paraboloid map this frame
+	bool loadReflectionProbes(); //loads the baked cube map of every probe - returns false if any probe has not been baked
+	std::string getProbeFilename(const int probe); //path of the DDS file of the given probe
+	void updateReflectionProbes(); //chooses the probes blended by the sphere and points the sphere's material at them and at the current cube map level
+	void scheduleCubeFaces(); //marks the cube map faces showing moved nodes dirty and chooses the faces rendered this frame
+	void scheduleProbeFaces(); //removes the faces without dynamic objects from the faces rendered this frame while the reflection probes are in use
+	void cullViews(); //culls the bounds added to viewCuller by updateFrame() and the crowd instances against every view (frustum, contribution and occlusion culling) and stores the view mask of each node
+	void updateInstances(DXContext *context); //writes the instances of every instanced group visible in each view to the instance buffer
+	void renderInstancedGroups(DXContext *context, const uint32_t pass, const int view); //draws the visible instances of every instanced group with the given render flag in the specified view
+
+	void DrawScene(DXContext *context);
 
 
 
@@ -0,0 +1,295 @@
+
+//
+// SceneGraph.cpp
+//
+
+#include <stdafx.h>
+#include <SceneGraph.h>
+#include <DXBaseModel.h>
+#include <algorithm>
+
+using namespace std;
+using namespace DirectX;
+
+
+// Reorder v so that element i of the result is element order[i] of the original
+template <typename T>
+static void permute(vector<T> &v, const vector<int> &order) {
+
+	vector<T> result;
+
+	result.reserve(v.size());
+
+	for (size_t i = 0; i < order.size(); ++i)
+		result.push_back(v[order[i]]);
+
+	v.swap(result);
+}
+
+
+SceneGraph::SceneGraph() {
+}
+
+SceneGraph::~SceneGraph() {
+
+	for (size_t i = 0; i < renderable.size(); ++i) {
+
+		if (renderable[i])
+			renderable[i]->release();
+	}
+}
+
+
+// Stable sort all node storage by depth in the hierarchy
+void SceneGraph::sortBreadthFirst() {
+
+	int numNodes = (int)name.size();
+
+	vector<int> order(numNodes);
+
+	for (int i = 0; i < numNodes; ++i)
+		order[i] = i;
+
+	stable_sort(order.begin(), order.end(), [this](const int a, const int b) { return depth[a] < depth[b]; });
+
+	vector<int> newSlot(numNodes);
+
+	for (int i = 0; i < numNodes; ++i)
+		newSlot[order[i]] = i;
+
+	permute(name, order);
+	permute(parentSlot, order);
+	permute(depth, order);
+	permute(flags, order);
+	permute(localMatrix, order);
+	permute(spinAxis, order);
+	permute(spinRate, order);
+	permute(worldMatrix, order);
+	permute(worldITMatrix, order);
+	permute(previousWorldMatrix, order);
+	permute(renderable, order);
+	permute(renderFlags, order);
+	permute(slotNode, order);
+
+	for (int i = 0; i < numNodes; ++i) {
+
+		if (parentSlot[i] != NullNode)
+			parentSlot[i] = newSlot[parentSlot[i]];
+
+		nodeSlot[slotNode[i]] = i;
+	}
+
+	breadthFirst = true;
+}
+
+
+// Add a node with the given local transform (relative to parent).  The graph retains model if one is given.  nodeRenderFlags are not interpreted by the graph and can be used by the caller to select the passes a node is rendered in.
+SceneNode SceneGraph::addNode(const string &nodeName, const SceneNode parent, FXMMATRIX local, DXBaseModel *model, const uint32_t nodeRenderFlags) {
+
+	if (parent != NullNode && (parent < 0 || parent >= (SceneNode)nodeSlot.size()))
+		throw exception("SceneGraph: Invalid parent node");
+
+	SceneNode node = (SceneNode)nodeSlot.size();
+	int slot = (int)name.size();
+	int parentIndex = (parent != NullNode) ? nodeSlot[parent] : NullNode;
+	int nodeDepth = (parent != NullNode) ? depth[parentIndex] + 1 : 0;
+
+	// Nodes are appended so the storage remains breadth-first provided the depth never decreases
+	if (slot > 0 && nodeDepth < depth[slot - 1])
+		breadthFirst = false;
+
+	XMFLOAT4X4 identity;
+	XMStoreFloat4x4(&identity, XMMatrixIdentity());
+
+	XMFLOAT4X4 localTransform;
+	XMStoreFloat4x4(&localTransform, local);
+
+	name.push_back(nodeName);
+	parentSlot.push_back(parentIndex);
+	depth.push_back(nodeDepth);
+	flags.push_back(NodeDirty | NodeSnap);
+	localMatrix.push_back(localTransform);
+	spinAxis.push_back(XMFLOAT3(0.0f, 1.0f, 0.0f));
+	spinRate.push_back(0.0f);
+	worldMatrix.push_back(identity);
+	worldITMatrix.push_back(identity);
+	previousWorldMatrix.push_back(identity);
+	renderable.push_back(model);
+	renderFlags.push_back(nodeRenderFlags);
+
+	nodeSlot.push_back(slot);
+	slotNode.push_back(node);
+
+	if (model)
+		model->retain();
+
+	return node;
+}
+
+// Set the local transform of the node.  The node and all of its descendants are updated on the next call to update.  If snap is true the move is not interpolated (for example when the node is teleported).
+void SceneGraph::setLocalMatrix(const SceneNode node, FXMMATRIX local, const bool snap) {
+
+	int slot = nodeSlot[node];
+
+	XMStoreFloat4x4(&localMatrix[slot], local);
+	flags[slot] |= NodeDirty;
+
+	if (snap)
+		flags[slot] |= NodeSnap;
+}
+
+XMMATRIX SceneGraph::getLocalMatrix(const SceneNode node) {
+
+	return XMLoadFloat4x4(&localMatrix[nodeSlot[node]]);
+}
+
+// Animate the node by rotating it about the given (local) axis at angularVelocity radians per second.  The rotation is applied after the node's local transform.
+void SceneGraph::setSpin(const SceneNode node, FXMVECTOR axis, const float angularVelocity) {
+
+	int slot = nodeSlot[node];
+
+	XMStoreFloat3(&spinAxis[slot], XMVector3Normalize(axis));
+	spinRate[slot] = angularVelocity;
+
+	if (angularVelocity != 0.0f)
+		flags[slot] |= NodeAnimated;
+	else
+		flags[slot] &= ~NodeAnimated;
+
+	flags[slot] |= NodeDirty;
+}
+
+// Recompute the world transforms of all dirty and animated nodes (and their descendants) for the given time
+void SceneGraph::update(const gu_seconds time) {
+
+	if (!breadthFirst)
+		sortBreadthFirst();
+
+	int numNodes = (int)name.size();
+
+	nodesUpdated = 0;
+
+	for (int i = 0; i < numNodes; ++i) {
+
+		int parent = parentSlot[i];
+		bool parentChanged = (parent != NullNode) && (flags[parent] & NodeChanged);
+
+		if (!parentChanged && !(flags[i] & (NodeDirty | NodeAnimated))) {
+
+			// A node that moved in the previous update is now at rest so there is nothing to interpolate
+			if (flags[i] & NodeChanged)
+				previousWorldMatrix[i] = worldMatrix[i];
+
+			flags[i] &= ~(NodeChanged | NodeSnapped);
+			continue;
+		}
+
+		bool snap = (flags[i] & NodeSnap) || (parent != NullNode && (flags[parent] & NodeSnapped));
+
+		XMMATRIX world = XMLoadFloat4x4(&localMatrix[i]);
+
+		if (flags[i] & NodeAnimated)
+			world = world * XMMatrixRotationNormal(XMLoadFloat3(&spinAxis[i]), (float)(spinRate[i] * time));
+
+		if (parent != NullNode)
+			world = world * XMLoadFloat4x4(&worldMatrix[parent]);
+
+		if (snap)
+			XMStoreFloat4x4(&previousWorldMatrix[i], world);
+		else
+			previousWorldMatrix[i] = worldMatrix[i];
+
+		XMStoreFloat4x4(&worldMatrix[i], world);
+		XMStoreFloat4x4(&worldITMatrix[i], XMMatrixTranspose(XMMatrixInverse(nullptr, world)));
+
+		flags[i] = (uint8_t)((flags[i] & ~(NodeDirty | NodeSnap | NodeSnapped)) | NodeChanged | ((snap) ? NodeSnapped : 0));
+		nodesUpdated++;
+	}
+}
+
+
+// Traversal - index 0 to getNodeCount()-1 visits the nodes in breadth-first order
+
+int SceneGraph::getNodeCount() {
+
+	return (int)slotNode.size();
+}
+
+SceneNode SceneGraph::getNodeInOrder(const int index) {
+
+	if (!breadthFirst)
+		sortBreadthFirst();
+
+	return slotNode[index];
+}
+
+SceneNode SceneGraph::findNode(const string &nodeName) {
+
+	for (size_t i = 0; i < name.size(); ++i) {
+
+		if (name[i] == nodeName)
+			return slotNode[i];
+	}
+
+	return NullNode;
+}
+
+
+// Accessor methods
+
+const string& SceneGraph::getName(const SceneNode node) {
+
+	return name[nodeSlot[node]];
+}
+
+XMMATRIX SceneGraph::getWorldMatrix(const SceneNode node) {
+
+	return XMLoadFloat4x4(&worldMatrix[nodeSlot[node]]);
+}
+
+XMMATRIX SceneGraph::getWorldITMatrix(const SceneNode node) {
+
+	return XMLoadFloat4x4(&worldITMatrix[nodeSlot[node]]);
+}
+
+bool SceneGraph::hasChanged(const SceneNode node) {
+
+	return (flags[nodeSlot[node]] & NodeChanged) != 0;
+}
+
+// Return the world and world inverse-transpose transforms of the node interpolated between its world transform before the last update (t = 0) and after it (t = 1).  Scale, rotation and translation are interpolated separately so the transforms are assumed to contain no shear.
+void SceneGraph::getInterpolatedWorldMatrices(const SceneNode node, const float t, XMMATRIX *world, XMMATRIX *worldIT) {
+
+	int slot = nodeSlot[node];
+
+	*world = XMLoadFloat4x4(&worldMatrix[slot]);
+	*worldIT = XMLoadFloat4x4(&worldITMatrix[slot]);
+
+	// Nodes that did not move (or were snapped) in the last update have no previous transform to interpolate from
+	if ((flags[slot] & (NodeChanged | NodeSnapped)) != NodeChanged || t >= 1.0f)
+		return;
+
+	XMVECTOR scale0, rotation0, translation0;
+	XMVECTOR scale1, rotation1, translation1;
+
+	if (!XMMatrixDecompose(&scale0, &rotation0, &translation0, XMLoadFloat4x4(&previousWorldMatrix[slot])) || !XMMatrixDecompose(&scale1, &rotation1, &translation1, *world))
+		return;
+
+	*world = XMMatrixAffineTransformation(XMVectorLerp(scale0, scale1, t), XMVectorZero(), XMQuaternionSlerp(rotation0, rotation1, t), XMVectorLerp(translation0, translation1, t));
+	*worldIT = XMMatrixTranspose(XMMatrixInverse(nullptr, *world));
+}
+
+DXBaseModel* SceneGraph::getRenderable(const SceneNode node) {
+
+	return renderable[nodeSlot[node]];
+}
+
+uint32_t SceneGraph::getRenderFlags(const SceneNode node) {
+
+	return renderFlags[nodeSlot[node]];
+}
+
+int SceneGraph::getNodesUpdated() {
+
+	return nodesUpdated;
+}
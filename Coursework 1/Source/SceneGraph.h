@@ -0,0 +1,101 @@
+
+//
+// SceneGraph.h
+//
+
+// Hierarchy of scene nodes with parent / child transforms.  Node data is stored as structure-of-arrays in breadth-first (level) order so every parent precedes its children and all world transforms are resolved in a single forward pass.  Each node's world transform is only recomputed when its local transform is dirty, when it is animated or when its parent's world transform changed in the same update, so static nodes cost nothing after the first update.
+//
+// The world transform before the last update is kept for every node so a renderer running at a different rate to the updates can interpolate between the two (see getInterpolatedWorldMatrices).
+
+#pragma once
+
+#include <DirectXMath.h>
+#include <GUObject.h>
+#include <CGDClock.h>
+#include <string>
+#include <vector>
+
+class DXBaseModel;
+
+
+// Stable handle to a node.  Handles are returned by addNode and remain valid when the graph reorders its storage.
+typedef int SceneNode;
+
+
+class SceneGraph : public GUObject {
+
+	enum NodeFlags : uint8_t {
+
+		NodeDirty = 0x01,		// Local transform changed since the last update
+		NodeAnimated = 0x02,	// Local transform is a function of time so is recomputed every update
+		NodeChanged = 0x04,		// World transform was recomputed by the last update
+		NodeSnap = 0x08,		// The next update moves the node without interpolating from its current world transform (set by addNode and setLocalMatrix)
+		NodeSnapped = 0x10		// The last update snapped the node - its descendants are snapped with it
+	};
+
+	// Per-node data indexed by storage slot
+	std::vector<std::string>				name;
+	std::vector<int>						parentSlot;
+	std::vector<int>						depth;
+	std::vector<uint8_t>					flags;
+	std::vector<DirectX::XMFLOAT4X4>		localMatrix;
+	std::vector<DirectX::XMFLOAT3>			spinAxis;
+	std::vector<float>						spinRate;
+	std::vector<DirectX::XMFLOAT4X4>		worldMatrix;
+	std::vector<DirectX::XMFLOAT4X4>		worldITMatrix;
+	std::vector<DirectX::XMFLOAT4X4>		previousWorldMatrix;
+	std::vector<DXBaseModel*>				renderable;
+	std::vector<uint32_t>					renderFlags;
+
+	// Mapping between node handles and storage slots
+	std::vector<int>						nodeSlot;
+	std::vector<SceneNode>					slotNode;
+
+	// False when a node has been added out of breadth-first order - the storage is sorted before the next update
+	bool									breadthFirst = true;
+
+	// Number of world transforms recomputed by the last update
+	int										nodesUpdated = 0;
+
+	// Stable sort all node storage by depth in the hierarchy
+	void sortBreadthFirst();
+
+public:
+
+	// Handle used for the parent of root nodes and returned by findNode when no node matches
+	static const SceneNode					NullNode = -1;
+
+	SceneGraph();
+	~SceneGraph();
+
+	// Add a node with the given local transform (relative to parent).  The graph retains model if one is given.  nodeRenderFlags are not interpreted by the graph and can be used by the caller to select the passes a node is rendered in.
+	SceneNode addNode(const std::string &nodeName, const SceneNode parent, DirectX::FXMMATRIX local, DXBaseModel *model = nullptr, const uint32_t nodeRenderFlags = 0);
+
+	// Set the local transform of the node.  The node and all of its descendants are updated on the next call to update.  If snap is true the move is not interpolated (for example when the node is teleported).
+	void setLocalMatrix(const SceneNode node, DirectX::FXMMATRIX local, const bool snap = false);
+	DirectX::XMMATRIX getLocalMatrix(const SceneNode node);
+
+	// Animate the node by rotating it about the given (local) axis at angularVelocity radians per second.  The rotation is applied after the node's local transform.
+	void setSpin(const SceneNode node, DirectX::FXMVECTOR axis, const float angularVelocity);
+
+	// Recompute the world transforms of all dirty and animated nodes (and their descendants) for the given time
+	void update(const gu_seconds time);
+
+	// Traversal - index 0 to getNodeCount()-1 visits the nodes in breadth-first order
+	int getNodeCount();
+	SceneNode getNodeInOrder(const int index);
+	SceneNode findNode(const std::string &nodeName);
+
+	// Accessor methods
+	const std::string& getName(const SceneNode node);
+	DirectX::XMMATRIX getWorldMatrix(const SceneNode node);
+	DirectX::XMMATRIX getWorldITMatrix(const SceneNode node);
+	bool hasChanged(const SceneNode node);
+
+	// Return the world and world inverse-transpose transforms of the node interpolated between its world transform before the last update (t = 0) and after it (t = 1).  Scale, rotation and translation are interpolated separately so the transforms are assumed to contain no shear.
+	void getInterpolatedWorldMatrices(const SceneNode node, const float t, DirectX::XMMATRIX *world, DirectX::XMMATRIX *worldIT);
+
+	DXBaseModel* getRenderable(const SceneNode node);
+	uint32_t getRenderFlags(const SceneNode node);
+	int getNodesUpdated();
+};
@@ -0,0 +1,461 @@
+
+//
+// StaticBatch.cpp
+//
+
+#include <stdafx.h>
+#include <StaticBatch.h>
+#include <Model.h>
+#include <Effect.h>
+#include <DXVertexExt.h>
+#include <DXVertexCompact.h>
+#include <MeshSimplifier.h>
+#include <MeshOptimizer.h>
+#include <map>
+#include <cstring>
+
+using namespace std;
+using namespace DirectX;
+
+
+//
+// StaticBatch
+//
+
+// The batch retains the buffers, textures and sampler.  The index buffer holds indices of _indexFormat.
+StaticBatch::StaticBatch(Effect *_effect, ID3D11Buffer *_vertexBuffer, ID3D11Buffer *_indexBuffer, DXGI_FORMAT _indexFormat, UINT _numTextures, ID3D11ShaderResourceView *const *_textures, ID3D11SamplerState *_sampler, const XMFLOAT4 &_matDiffuse, const XMFLOAT4 &_matSpecular, UINT _startIndex, UINT _indexCount, const XMFLOAT3 &centre, const float radius) {
+
+	effect = _effect;
+	vertexBuffer = _vertexBuffer;
+	indexBuffer = _indexBuffer;
+	indexFormat = _indexFormat;
+	inputLayout = effect->getVSInputLayout();
+
+	vertexBuffer->AddRef();
+	indexBuffer->AddRef();
+
+	if (inputLayout)
+		inputLayout->AddRef();
+
+	numTextures = min(_numTextures, MaxTextures);
+
+	for (UINT i = 0; i < numTextures; ++i) {
+
+		textures[i] = _textures[i];
+		textures[i]->AddRef();
+	}
+
+	sampler = _sampler;
+
+	if (sampler)
+		sampler->AddRef();
+
+	matDiffuse = _matDiffuse;
+	matSpecular = _matSpecular;
+	startIndex = _startIndex;
+	indexCount = _indexCount;
+	boundsCentre = centre;
+	boundsRadius = radius;
+}
+
+StaticBatch::~StaticBatch() {
+
+	for (UINT i = 0; i < numTextures; ++i)
+		textures[i]->Release();
+
+	if (sampler)
+		sampler->Release();
+}
+
+
+UINT StaticBatch::getTextures(ID3D11ShaderResourceView **views, ID3D11SamplerState **_sampler) {
+
+	if (numTextures == 0 || !sampler)
+		return 0;
+
+	for (UINT i = 0; i < numTextures; ++i)
+		views[i] = textures[i];
+
+	*_sampler = sampler;
+
+	return numTextures;
+}
+
+void StaticBatch::bindGeometry(DXContext *context) {
+
+	context->IASetInputLayout(inputLayout);
+
+	ID3D11Buffer* vertexBuffers[] = { vertexBuffer };
+	UINT vertexStrides[] = { sizeof(DXVertexCompact) };
+	UINT vertexOffsets[] = { 0 };
+
+	context->IASetVertexBuffers(0, 1, vertexBuffers, vertexStrides, vertexOffsets);
+	context->IASetIndexBuffer(indexBuffer, indexFormat, 0);
+
+	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
+}
+
+void StaticBatch::draw(DXContext *context) {
+
+	context->DrawIndexed(indexCount, startIndex, 0);
+}
+
+
+// Accessor methods
+
+bool StaticBatch::getBoundingSphere(XMFLOAT3 *centre, float *radius) {
+
+	*centre = boundsCentre;
+	*radius = boundsRadius;
+
+	return true;
+}
+
+void StaticBatch::getMaterialColours(XMFLOAT4 *diffuse, XMFLOAT4 *specular) {
+
+	*diffuse = matDiffuse;
+	*specular = matSpecular;
+}
+
+UINT StaticBatch::getIndexCount() {
+
+	return indexCount;
+}
+
+
+//
+// StaticBatchBuilder
+//
+
+// Effect, textures, sampler and material colours shared by every triangle of a batch.  Models created with identical sampler descriptions share one sampler object (Direct3D returns the existing state object) so pointers can be compared.
+struct BatchMaterial {
+
+	Effect								*effect;
+	UINT								numTextures;
+	ID3D11ShaderResourceView			*textures[DXBaseModel::MaxTextures];
+	ID3D11SamplerState					*sampler;
+	XMFLOAT4							matDiffuse;
+	XMFLOAT4							matSpecular;
+
+	bool operator<(const BatchMaterial &rhs) const {
+
+		if (effect != rhs.effect)
+			return effect < rhs.effect;
+
+		if (numTextures != rhs.numTextures)
+			return numTextures < rhs.numTextures;
+
+		if (sampler != rhs.sampler)
+			return sampler < rhs.sampler;
+
+		for (UINT i = 0; i < numTextures; ++i) {
+
+			if (textures[i] != rhs.textures[i])
+				return textures[i] < rhs.textures[i];
+		}
+
+		// Colours are compared bitwise - the keys are zeroed before they are filled in
+		int colours = memcmp(&matDiffuse, &rhs.matDiffuse, sizeof(XMFLOAT4));
+
+		if (colours == 0)
+			colours = memcmp(&matSpecular, &rhs.matSpecular, sizeof(XMFLOAT4));
+
+		return colours < 0;
+	}
+};
+
+// Triangles of one (material, cell) group and the bounds of their vertices
+struct BatchCell {
+
+	vector<uint32_t>					indices;
+	XMFLOAT3							boundsMin;
+	XMFLOAT3							boundsMax;
+};
+
+// Merged geometry of one material.  Cells are keyed on their (x, z) grid coordinates.
+struct BatchGeometry {
+
+	vector<DXVertexExt>					vertices;
+	map<pair<int, int>, BatchCell>		cells;
+};
+
+
+StaticBatchBuilder::StaticBatchBuilder(const float _cellSize) {
+
+	cellSize = max(_cellSize, 1e-3f);
+}
+
+StaticBatchBuilder::~StaticBatchBuilder() {
+
+	for (size_t i = 0; i < sources.size(); ++i)
+		sources[i].model->release();
+}
+
+
+// Add a model placed with the given world transform.  The model must have been loaded with keepMeshData (see Model) and is retained until the builder is destroyed.
+void StaticBatchBuilder::add(Model *model, FXMMATRIX world) {
+
+	if (!model || !model->getEffect() || model->getMeshVertices().empty())
+		throw exception("StaticBatchBuilder: Model has no mesh data (load with keepMeshData)");
+
+	Source source;
+
+	source.model = model;
+	XMStoreFloat4x4(&source.worldMatrix, world);
+
+	model->retain();
+	sources.push_back(source);
+}
+
+// Merge the added models and append one batch per (material, cell) to batches.  If proxies is given a simplified copy of each batch (see MeshSimplifier) is appended to it in the same order - the proxy of a batch shares its vertex and index buffers and clusters vertices on a grid of proxyCellSize.  The caller owns the returned batches.
+void StaticBatchBuilder::build(ID3D11Device *device, vector<StaticBatch*> *batches, vector<StaticBatch*> *proxies, const float proxyCellSize) {
+
+	map<BatchMaterial, BatchGeometry> geometry;
+
+	sourceDraws = 0;
+	batchDraws = 0;
+	batchTriangles = 0;
+	proxyTriangles = 0;
+
+	for (size_t s = 0; s < sources.size(); ++s) {
+
+		Model *model = sources[s].model;
+
+		BatchMaterial material;
+
+		ZeroMemory(&material, sizeof(BatchMaterial));
+		material.effect = model->getEffect();
+		material.numTextures = model->getTextures(material.textures, &material.sampler);
+
+		if (material.numTextures == 0)
+			material.sampler = nullptr;
+
+		model->getMaterialColours(&material.matDiffuse, &material.matSpecular);
+
+		BatchGeometry &batch = geometry[material];
+
+		// Bake the world transform into the vertices.  Normals are transformed by the inverse-transpose and renormalised.
+		XMMATRIX world = XMLoadFloat4x4(&sources[s].worldMatrix);
+		XMMATRIX worldIT = XMMatrixTranspose(XMMatrixInverse(nullptr, world));
+
+		// A mirroring transform reverses the winding of every triangle
+		bool flipWinding = XMVectorGetX(XMMatrixDeterminant(world)) < 0.0f;
+
+		const vector<DXVertexExt> &vertices = model->getMeshVertices();
+		const vector<uint32_t> &indices = model->getMeshIndices();
+
+		uint32_t vertexBase = (uint32_t)batch.vertices.size();
+
+		for (size_t v = 0; v < vertices.size(); ++v) {
+
+			DXVertexExt vertex = vertices[v];
+
+			XMStoreFloat3(&vertex.pos, XMVector3TransformCoord(XMLoadFloat3(&vertex.pos), world));
+			XMStoreFloat3(&vertex.normal, XMVector3Normalize(XMVector3TransformNormal(XMLoadFloat3(&vertex.normal), worldIT)));
+
+			batch.vertices.push_back(vertex);
+		}
+
+		// Assign each triangle to the cell containing its centroid
+		uint32_t indexOffset = 0;
+
+		for (uint32_t mesh = 0; mesh < model->getMeshCount(); ++mesh) {
+
+			uint32_t meshBase = vertexBase + model->getMeshBaseVertex(mesh);
+			uint32_t meshIndexCount = model->getMeshIndexCount(mesh);
+
+			for (uint32_t i = 0; i + 2 < meshIndexCount; i += 3) {
+
+				uint32_t tri[3] = { meshBase + indices[indexOffset + i], meshBase + indices[indexOffset + i + 1], meshBase + indices[indexOffset + i + 2] };
+
+				if (flipWinding)
+					swap(tri[0], tri[2]);
+
+				XMVECTOR p0 = XMLoadFloat3(&batch.vertices[tri[0]].pos);
+				XMVECTOR p1 = XMLoadFloat3(&batch.vertices[tri[1]].pos);
+				XMVECTOR p2 = XMLoadFloat3(&batch.vertices[tri[2]].pos);
+				XMVECTOR centroid = (p0 + p1 + p2) / 3.0f;
+
+				pair<int, int> cellKey((int)floorf(XMVectorGetX(centroid) / cellSize), (int)floorf(XMVectorGetZ(centroid) / cellSize));
+
+				map<pair<int, int>, BatchCell>::iterator cellIter = batch.cells.find(cellKey);
+
+				if (cellIter == batch.cells.end()) {
+
+					cellIter = batch.cells.insert(make_pair(cellKey, BatchCell())).first;
+					XMStoreFloat3(&cellIter->second.boundsMin, p0);
+					XMStoreFloat3(&cellIter->second.boundsMax, p0);
+				}
+
+				BatchCell &cell = cellIter->second;
+
+				XMStoreFloat3(&cell.boundsMin, XMVectorMin(XMLoadFloat3(&cell.boundsMin), XMVectorMin(p0, XMVectorMin(p1, p2))));
+				XMStoreFloat3(&cell.boundsMax, XMVectorMax(XMLoadFloat3(&cell.boundsMax), XMVectorMax(p0, XMVectorMax(p1, p2))));
+
+				cell.indices.insert(cell.indices.end(), tri, tri + 3);
+			}
+
+			indexOffset += meshIndexCount;
+			sourceDraws++;
+		}
+	}
+
+	materialCount = (uint32_t)geometry.size();
+
+	// Create one vertex / index buffer pair per material with the indices of each cell stored contiguously
+	for (map<BatchMaterial, BatchGeometry>::iterator g = geometry.begin(); g != geometry.end(); ++g) {
+
+		const BatchMaterial &material = g->first;
+		BatchGeometry &batch = g->second;
+
+		if (batch.vertices.empty() || batch.cells.empty())
+			continue;
+
+		// Each cell takes a subset of the triangles of several models, so its triangles are reordered again for the vertex cache and overdraw (see MeshOptimizer)
+		for (map<pair<int, int>, BatchCell>::iterator c = batch.cells.begin(); c != batch.cells.end(); ++c)
+			MeshOptimizer::optimizeTriangles(c->second.indices.data(), (uint32_t)c->second.indices.size(), &batch.vertices[0].pos.x, sizeof(DXVertexExt), (uint32_t)batch.vertices.size());
+
+		vector<uint32_t> indices;
+
+		for (map<pair<int, int>, BatchCell>::iterator c = batch.cells.begin(); c != batch.cells.end(); ++c)
+			indices.insert(indices.end(), c->second.indices.begin(), c->second.indices.end());
+
+		// Store the vertices in the order the cells first use them.  The cell indices are remapped too as the proxies are built from them.
+		vector<uint32_t> vertexRemap;
+
+		MeshOptimizer::optimizeVertexFetch(indices.data(), (uint32_t)indices.size(), (uint32_t)batch.vertices.size(), &vertexRemap);
+
+		vector<DXVertexExt> sourceVertices(batch.vertices);
+
+		for (size_t v = 0; v < sourceVertices.size(); ++v)
+			batch.vertices[vertexRemap[v]] = sourceVertices[v];
+
+		for (map<pair<int, int>, BatchCell>::iterator c = batch.cells.begin(); c != batch.cells.end(); ++c)
+			for (size_t i = 0; i < c->second.indices.size(); ++i)
+				c->second.indices[i] = vertexRemap[c->second.indices[i]];
+
+		batchTriangles += (uint32_t)indices.size() / 3;
+
+		// The proxy indices of each cell follow the full indices of every cell.  Vertices are clustered over the whole material so neighbouring cells agree on their shared vertices.
+		vector<UINT> proxyIndexCounts;
+		UINT proxyStartIndex = (UINT)indices.size();
+
+		if (proxies) {
+
+			vector<uint32_t> remap;
+
+			MeshSimplifier::clusterVertices(&batch.vertices[0].pos.x, &batch.vertices[0].normal.x, sizeof(DXVertexExt), (uint32_t)batch.vertices.size(), proxyCellSize, &remap);
+
+			for (map<pair<int, int>, BatchCell>::iterator c = batch.cells.begin(); c != batch.cells.end(); ++c) {
+
+				uint32_t triangles = MeshSimplifier::remapTriangles(c->second.indices.data(), (uint32_t)c->second.indices.size(), remap, &indices);
+
+				proxyIndexCounts.push_back(triangles * 3);
+				proxyTriangles += triangles;
+			}
+		}
+
+		// Pack the vertices and, if the material has few enough vertices, the full and proxy indices for upload (see DXVertexCompact)
+		vector<DXVertexCompact> packedVertices;
+		vector<uint16_t> packedIndices;
+
+		DXVertexCompact::packVertices(batch.vertices.data(), (uint32_t)batch.vertices.size(), &packedVertices);
+		DXGI_FORMAT indexFormat = DXVertexCompact::packIndices(indices.data(), (uint32_t)indices.size(), &packedIndices);
+
+		D3D11_BUFFER_DESC bufferDesc;
+		D3D11_SUBRESOURCE_DATA bufferData;
+
+		ZeroMemory(&bufferDesc, sizeof(D3D11_BUFFER_DESC));
+		ZeroMemory(&bufferData, sizeof(D3D11_SUBRESOURCE_DATA));
+
+		bufferDesc.Usage = D3D11_USAGE_IMMUTABLE;
+		bufferDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
+		bufferDesc.ByteWidth = (UINT)(packedVertices.size() * sizeof(DXVertexCompact));
+		bufferData.pSysMem = packedVertices.data();
+
+		ID3D11Buffer *vertexBuffer = nullptr;
+		ID3D11Buffer *indexBuffer = nullptr;
+
+		HRESULT hr = device->CreateBuffer(&bufferDesc, &bufferData, &vertexBuffer);
+
+		if (!SUCCEEDED(hr))
+			throw exception("StaticBatchBuilder: Cannot create vertex buffer");
+
+		bufferDesc.BindFlags = D3D11_BIND_INDEX_BUFFER;
+		bufferDesc.ByteWidth = (UINT)(indices.size() * DXVertexCompact::indexStride(indexFormat));
+		bufferData.pSysMem = (indexFormat == DXGI_FORMAT_R16_UINT) ? (const void*)packedIndices.data() : (const void*)indices.data();
+
+		hr = device->CreateBuffer(&bufferDesc, &bufferData, &indexBuffer);
+
+		if (!SUCCEEDED(hr)) {
+
+			vertexBuffer->Release();
+			throw exception("StaticBatchBuilder: Cannot create index buffer");
+		}
+
+		UINT startIndex = 0;
+		size_t cellIndex = 0;
+
+		for (map<pair<int, int>, BatchCell>::iterator c = batch.cells.begin(); c != batch.cells.end(); ++c) {
+
+			const BatchCell &cell = c->second;
+
+			XMVECTOR boundsMin = XMLoadFloat3(&cell.boundsMin);
+			XMVECTOR boundsMax = XMLoadFloat3(&cell.boundsMax);
+
+			XMFLOAT3 centre;
+			XMStoreFloat3(&centre, (boundsMin + boundsMax) * 0.5f);
+
+			float radius = XMVectorGetX(XMVector3Length(boundsMax - boundsMin)) * 0.5f;
+
+			batches->push_back(new StaticBatch(material.effect, vertexBuffer, indexBuffer, indexFormat, material.numTextures, material.textures, material.sampler, material.matDiffuse, material.matSpecular, startIndex, (UINT)cell.indices.size(), centre, radius));
+
+			startIndex += (UINT)cell.indices.size();
+			batchDraws++;
+
+			// The proxy keeps the bounds of the full batch as it covers the same area
+			if (proxies) {
+
+				UINT proxyIndexCount = proxyIndexCounts[cellIndex];
+
+				proxies->push_back(new StaticBatch(material.effect, vertexBuffer, indexBuffer, indexFormat, material.numTextures, material.textures, material.sampler, material.matDiffuse, material.matSpecular, proxyStartIndex, proxyIndexCount, centre, radius));
+
+				proxyStartIndex += proxyIndexCount;
+			}
+
+			cellIndex++;
+		}
+
+		// The batches hold the only references to the buffers
+		vertexBuffer->Release();
+		indexBuffer->Release();
+	}
+}
+
+
+// Accessor methods
+
+uint32_t StaticBatchBuilder::getSourceDrawCount() {
+
+	return sourceDraws;
+}
+
+uint32_t StaticBatchBuilder::getBatchDrawCount() {
+
+	return batchDraws;
+}
+
+uint32_t StaticBatchBuilder::getMaterialCount() {
+
+	return materialCount;
+}
+
+uint32_t StaticBatchBuilder::getBatchTriangleCount() {
+
+	return batchTriangles;
+}
+
+uint32_t StaticBatchBuilder::getProxyTriangleCount() {
+
+	return proxyTriangles;
+}
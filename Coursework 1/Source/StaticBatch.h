@@ -0,0 +1,90 @@
+//
+// StaticBatch.h
+//
+
+// Load-time batching of static geometry.  StaticBatchBuilder merges the meshes of Model instances that never move into shared vertex and index buffers with their world transforms baked into the vertices.  Triangles are grouped by material (effect, textures, sampler and material colours) and by the cell of a uniform grid in the xz plane containing their centroid.  Each (material, cell) group becomes one StaticBatch drawn with a single DrawIndexed, so the draw count of the static set depends on the materials and cells it covers rather than on the number of pieces it was modelled in.  The triangles of each cell and the vertices of each material are reordered for the vertex cache (see MeshOptimizer).  Every StaticBatch of a material shares the same buffers so the render queue binds its geometry once for all of its cells.  The buffers hold DXVertexCompact vertices and 16 bit indices when the material has at most 65536 vertices.
+
+#pragma once
+
+#include <DXBaseModel.h>
+#include <DirectXMath.h>
+#include <vector>
+
+class Model;
+
+
+class StaticBatch : public DXBaseModel {
+
+	UINT								numTextures = 0;
+	ID3D11ShaderResourceView			*textures[MaxTextures];
+	ID3D11SamplerState					*sampler = nullptr;
+
+	// Range of the shared index buffer drawn by this batch.  Indices are absolute (base vertex 0).
+	UINT								startIndex = 0;
+	UINT								indexCount = 0;
+
+	// Colours of the material the batch was built from (see getMaterialColours)
+	DirectX::XMFLOAT4					matDiffuse;
+	DirectX::XMFLOAT4					matSpecular;
+
+	// World space bounding sphere of the batch's triangles
+	DirectX::XMFLOAT3					boundsCentre;
+	float								boundsRadius = 0.0f;
+
+public:
+
+	// The batch retains the buffers, textures and sampler.  The index buffer holds indices of _indexFormat.
+	StaticBatch(Effect *_effect, ID3D11Buffer *_vertexBuffer, ID3D11Buffer *_indexBuffer, DXGI_FORMAT _indexFormat, UINT _numTextures, ID3D11ShaderResourceView *const *_textures, ID3D11SamplerState *_sampler, const DirectX::XMFLOAT4 &_matDiffuse, const DirectX::XMFLOAT4 &_matSpecular, UINT _startIndex, UINT _indexCount, const DirectX::XMFLOAT3 &centre, const float radius);
+	~StaticBatch();
+
+	UINT getTextures(ID3D11ShaderResourceView **views, ID3D11SamplerState **_sampler);
+	void bindGeometry(DXContext *context);
+	void draw(DXContext *context);
+
+	// Return the world space bounding sphere of the batch (batches are placed with an identity world transform so model and world space coincide)
+	bool getBoundingSphere(DirectX::XMFLOAT3 *centre, float *radius);
+	void getMaterialColours(DirectX::XMFLOAT4 *diffuse, DirectX::XMFLOAT4 *specular);
+	UINT getIndexCount();
+};
+
+
+class StaticBatchBuilder {
+
+	struct Source {
+
+		Model							*model;
+		DirectX::XMFLOAT4X4				worldMatrix;
+	};
+
+	std::vector<Source>					sources;
+
+	// Size of a grid cell in world units
+	float								cellSize;
+
+	// Statistics of the last build
+	uint32_t							sourceDraws = 0;
+	uint32_t							batchDraws = 0;
+	uint32_t							materialCount = 0;
+	uint32_t							batchTriangles = 0;
+	uint32_t							proxyTriangles = 0;
+
+public:
+
+	StaticBatchBuilder(const float _cellSize);
+	~StaticBatchBuilder();
+
+	// Add a model placed with the given world transform.  The model must have been loaded with keepMeshData (see Model) and is retained until the builder is destroyed.
+	void add(Model *model, DirectX::FXMMATRIX world);
+
+	// Merge the added models and append one batch per (material, cell) to batches.  If proxies is given a simplified copy of each batch (see MeshSimplifier) is appended to it in the same order - the proxy of a batch shares its vertex and index buffers and clusters vertices on a grid of proxyCellSize.  The caller owns the returned batches.
+	void build(ID3D11Device *device, std::vector<StaticBatch*> *batches, std::vector<StaticBatch*> *proxies = nullptr, const float proxyCellSize = 0.0f);
+
+	// Draw calls the added models issue per pass (one per sub-mesh) and draw calls of the batches built from them
+	uint32_t getSourceDrawCount();
+	uint32_t getBatchDrawCount();
+	uint32_t getMaterialCount();
+
+	// Triangles of the batches and of their proxies (0 if no proxies were built)
+	uint32_t getBatchTriangleCount();
+	uint32_t getProxyTriangleCount();
+};
@@ -0,0 +1,328 @@
+
+//
+// TaskGraph.cpp
+//
+
+#include <stdafx.h>
+#include <TaskGraph.h>
+#include <WorkerPool.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+
+using namespace std;
+
+
+// Tasks that may run on any thread are submitted to _pool, which is retained.  If _pool is null or has no worker threads every task runs on the device thread.
+TaskGraph::TaskGraph(WorkerPool *_pool) {
+
+	pool = _pool;
+
+	if (pool)
+		pool->retain();
+}
+
+TaskGraph::~TaskGraph() {
+
+	if (pool)
+		pool->release();
+}
+
+
+// Add a task that runs body once the given tasks have completed.  The dependencies must already have been added.
+TaskGraph::Task TaskGraph::addTask(const string &name, const Affinity affinity, const vector<Task> &dependencies, function<void()> body) {
+
+	Task task = (Task)tasks.size();
+
+	TaskInfo info;
+
+	info.name = name;
+	info.body = move(body);
+	info.affinity = affinity;
+	info.dependencies = dependencies;
+	info.unresolved = 0;
+	info.trace.start = info.trace.end = 0.0;
+	info.trace.thread = -1;
+
+	tasks.push_back(info);
+
+	for (size_t i = 0; i < dependencies.size(); ++i)
+		tasks[dependencies[i]].dependents.push_back(task);
+
+	return task;
+}
+
+// Run every task and wait for them to complete.  The calling thread is the device thread.  Rethrows the first exception thrown by a task.
+void TaskGraph::run() {
+
+	unique_lock<std::mutex> lock(mutex);
+
+	traceThreads.assign(1, this_thread::get_id());
+
+	deviceQueue.clear();
+	remaining = (int)tasks.size();
+	running = 0;
+	taskException = nullptr;
+
+	runStart = CGDClock::ActualTime();
+
+	for (size_t i = 0; i < tasks.size(); ++i) {
+
+		tasks[i].unresolved = (int)tasks[i].dependencies.size();
+		tasks[i].trace.start = tasks[i].trace.end = 0.0;
+		tasks[i].trace.thread = -1;
+	}
+
+	for (size_t i = 0; i < tasks.size(); ++i)
+		if (tasks[i].unresolved == 0)
+			enqueue((Task)i);
+
+	// Execute device thread tasks as they become ready until every task has completed or a task failed and the running tasks have finished
+	while (true) {
+
+		stateChanged.wait(lock, [this]() { return !deviceQueue.empty() || remaining == 0 || (taskException && running == 0); });
+
+		if (remaining == 0 || (taskException && running == 0))
+			break;
+
+		Task task = deviceQueue.front();
+		deviceQueue.pop_front();
+
+		lock.unlock();
+		execute(task, false);
+		lock.lock();
+	}
+
+	runTime = CGDClock::ConvertTimeIntervalToSeconds(CGDClock::ActualTime() - runStart);
+
+	exception_ptr thrown = taskException;
+
+	taskException = nullptr;
+	lock.unlock();
+
+	// The pool's bookkeeping for the submitted tasks completes after the tasks themselves
+	if (pool)
+		pool->wait();
+
+	if (thrown)
+		rethrow_exception(thrown);
+}
+
+// Queue a task whose dependencies have all completed.  Must be called with the mutex held.
+void TaskGraph::enqueue(const Task task) {
+
+	if (tasks[task].affinity == Affinity::AnyThread && pool && pool->getConcurrency() > 1) {
+
+		running++;
+		pool->submit([this, task]() { execute(task, true); });
+	}
+	else
+		deviceQueue.push_back(task);
+}
+
+// Run a task and queue the dependents it was the last dependency of.  pooled is true if the task was submitted to the pool.
+void TaskGraph::execute(const Task task, const bool pooled) {
+
+	TaskInfo &info = tasks[task];
+
+	{
+		lock_guard<std::mutex> lock(mutex);
+
+		info.trace.thread = traceThread();
+		info.trace.start = CGDClock::ConvertTimeIntervalToSeconds(CGDClock::ActualTime() - runStart);
+	}
+
+	exception_ptr thrown;
+
+	try {
+
+		info.body();
+	}
+	catch (...) {
+
+		thrown = current_exception();
+	}
+
+	{
+		lock_guard<std::mutex> lock(mutex);
+
+		info.trace.end = CGDClock::ConvertTimeIntervalToSeconds(CGDClock::ActualTime() - runStart);
+
+		if (thrown && !taskException) {
+
+			taskException = thrown;
+			deviceQueue.clear();
+		}
+
+		if (!taskException) {
+
+			for (size_t i = 0; i < info.dependents.size(); ++i)
+				if (--tasks[info.dependents[i]].unresolved == 0)
+					enqueue(info.dependents[i]);
+		}
+
+		remaining--;
+
+		if (pooled)
+			running--;
+	}
+
+	stateChanged.notify_all();
+}
+
+// Return the trace number of the calling thread.  Must be called with the mutex held.
+int TaskGraph::traceThread() {
+
+	thread::id id = this_thread::get_id();
+
+	for (size_t i = 0; i < traceThreads.size(); ++i)
+		if (traceThreads[i] == id)
+			return (int)i;
+
+	traceThreads.push_back(id);
+
+	return (int)traceThreads.size() - 1;
+}
+
+
+// Trace of the last run
+gu_seconds TaskGraph::getRunTime() const {
+
+	return runTime;
+}
+
+const TaskGraph::TaskTrace& TaskGraph::getTaskTrace(const Task task) const {
+
+	return tasks[task].trace;
+}
+
+const string& TaskGraph::getTaskName(const Task task) const {
+
+	return tasks[task].name;
+}
+
+int TaskGraph::getTaskCount() const {
+
+	return (int)tasks.size();
+}
+
+// Return the critical path of the last run in execution order
+vector<TaskGraph::Task> TaskGraph::getCriticalPath() const {
+
+	vector<Task> path;
+
+	if (tasks.empty())
+		return path;
+
+	Task task = 0;
+
+	for (Task i = 1; i < (Task)tasks.size(); ++i)
+		if (tasks[i].trace.end > tasks[task].trace.end)
+			task = i;
+
+	while (true) {
+
+		path.push_back(task);
+
+		const vector<Task> &dependencies = tasks[task].dependencies;
+
+		if (dependencies.empty())
+			break;
+
+		task = dependencies[0];
+
+		for (size_t i = 1; i < dependencies.size(); ++i)
+			if (tasks[dependencies[i]].trace.end > tasks[task].trace.end)
+				task = dependencies[i];
+	}
+
+	reverse(path.begin(), path.end());
+
+	return path;
+}
+
+// Return the task that took longest in the last run
+TaskGraph::Task TaskGraph::getLongestTask() const {
+
+	Task longest = 0;
+
+	for (Task i = 1; i < (Task)tasks.size(); ++i)
+		if (tasks[i].trace.end - tasks[i].trace.start > tasks[longest].trace.end - tasks[longest].trace.start)
+			longest = i;
+
+	return longest;
+}
+
+// Print the run time, the longest task and the critical path with the time spent waiting between its tasks
+void TaskGraph::printTrace(ostream &out) const {
+
+	if (tasks.empty())
+		return;
+
+	vector<Task> path = getCriticalPath();
+	gu_seconds busy = 0.0;
+
+	for (size_t i = 0; i < path.size(); ++i)
+		busy += tasks[path[i]].trace.end - tasks[path[i]].trace.start;
+
+	const TaskInfo &longest = tasks[getLongestTask()];
+	streamsize precision = out.precision();
+
+	out << fixed << setprecision(2);
+	out << tasks.size() << " tasks completed in " << runTime * 1000.0 << "ms on " << traceThreads.size() << " threads" << endl;
+	out << "Longest task = " << longest.name << " (" << (longest.trace.end - longest.trace.start) * 1000.0 << "ms)" << endl;
+	out << "Critical path = " << busy * 1000.0 << "ms running, " << (tasks[path.back()].trace.end - busy) * 1000.0 << "ms waiting" << endl;
+
+	for (size_t i = 0; i < path.size(); ++i) {
+
+		const TaskTrace &trace = tasks[path[i]].trace;
+
+		out << "  " << setw(9) << trace.start * 1000.0 << " - " << setw(9) << trace.end * 1000.0 << "ms  thread " << trace.thread << "  " << tasks[path[i]].name << endl;
+	}
+
+	out.unsetf(ios::floatfield);
+	out.precision(precision);
+}
+
+// Write the trace of the last run as Chrome trace events.  Tasks on the critical path are coloured.  Returns false if the file cannot be written.
+bool TaskGraph::writeTrace(const string &filename) const {
+
+	ofstream out(filename.c_str());
+
+	if (!out)
+		return false;
+
+	vector<Task> path = getCriticalPath();
+
+	out << "{\"traceEvents\":[" << endl;
+
+	for (size_t i = 0; i < traceThreads.size(); ++i)
+		out << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << i << ",\"args\":{\"name\":\"" << ((i == 0) ? "Device thread" : "Worker") << "\"}}," << endl;
+
+	for (size_t i = 0; i < tasks.size(); ++i) {
+
+		const TaskTrace &trace = tasks[i].trace;
+
+		// Names are written as they are apart from characters JSON requires escaped
+		string name;
+
+		for (size_t c = 0; c < tasks[i].name.length(); ++c) {
+
+			if (tasks[i].name[c] == '"' || tasks[i].name[c] == '\\')
+				name += '\\';
+
+			name += tasks[i].name[c];
+		}
+
+		out << "{\"name\":\"" << name << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << trace.thread << ",\"ts\":" << (int64_t)(trace.start * 1000000.0) << ",\"dur\":" << (int64_t)((trace.end - trace.start) * 1000000.0);
+
+		if (find(path.begin(), path.end(), (Task)i) != path.end())
+			out << ",\"cname\":\"terrible\"";
+
+		out << "}" << ((i + 1 < tasks.size()) ? "," : "") << endl;
+	}
+
+	out << "]}" << endl;
+
+	return out.good();
+}
@@ -0,0 +1,123 @@
+//
+// TaskGraph.h
+//
+
+// Run a set of tasks with dependencies between them.  A task is queued as soon as every task it depends on has completed - tasks that may run on any thread are submitted to a WorkerPool and tasks that must run on the thread calling run() (the device thread) are executed by that thread between waits, so independent work overlaps and device thread work is done as soon as its inputs are ready.  An exception thrown by a task stops any further tasks being queued and is rethrown from run() once the tasks already running have finished.
+//
+// Each run is traced - the start and end time and thread of every task are recorded.  The critical path is the chain of tasks ending with the last task to finish, following at each step the dependency that finished last.  Its length bounds the run time however many threads are available.  The trace can be printed or written in the Chrome trace event format (chrome://tracing).
+//
+// The class does not depend on Direct3D.
+
+#pragma once
+
+#include <GUObject.h>
+#include <CGDClock.h>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+class WorkerPool;
+
+
+class TaskGraph : public GUObject {
+
+public:
+
+	typedef int								Task;
+
+	enum class Affinity : uint8_t { AnyThread = 0, DeviceThread };
+
+	// Timing of a task in the last run (seconds from the start of the run).  thread is 0 for the device thread and numbered from 1 for the other threads in the order they first ran a task.
+	struct TaskTrace {
+
+		gu_seconds							start;
+		gu_seconds							end;
+		int									thread;
+	};
+
+private:
+
+	struct TaskInfo {
+
+		std::string							name;
+		std::function<void()>				body;
+		Affinity							affinity;
+		std::vector<Task>					dependencies;
+		std::vector<Task>					dependents;
+
+		// Dependencies not yet completed in the current run
+		int									unresolved;
+
+		TaskTrace							trace;
+	};
+
+	std::vector<TaskInfo>					tasks;
+
+	WorkerPool								*pool = nullptr;
+
+	std::mutex								mutex;
+	std::condition_variable					stateChanged;
+
+	// Ready tasks waiting for the device thread
+	std::deque<Task>						deviceQueue;
+
+	// Tasks not yet completed in the current run
+	int										remaining = 0;
+
+	// Tasks submitted to the pool that have not yet completed
+	int										running = 0;
+
+	// First exception thrown by a task in the current run
+	std::exception_ptr						taskException;
+
+	gu_time_index							runStart = 0;
+	gu_seconds								runTime = 0.0;
+
+	// Threads that ran tasks in the last run - the device thread first
+	std::vector<std::thread::id>			traceThreads;
+
+	// Queue a task whose dependencies have all completed.  Must be called with the mutex held.
+	void enqueue(const Task task);
+
+	// Run a task and queue the dependents it was the last dependency of.  pooled is true if the task was submitted to the pool.
+	void execute(const Task task, const bool pooled);
+
+	// Return the trace number of the calling thread.  Must be called with the mutex held.
+	int traceThread();
+
+public:
+
+	// Tasks that may run on any thread are submitted to _pool, which is retained.  If _pool is null or has no worker threads every task runs on the device thread.
+	TaskGraph(WorkerPool *_pool);
+	~TaskGraph();
+
+	// Add a task that runs body once the given tasks have completed.  The dependencies must already have been added.
+	Task addTask(const std::string &name, const Affinity affinity, const std::vector<Task> &dependencies, std::function<void()> body);
+
+	// Run every task and wait for them to complete.  The calling thread is the device thread.  Rethrows the first exception thrown by a task.
+	void run();
+
+	// Trace of the last run
+	gu_seconds getRunTime() const;
+	const TaskTrace& getTaskTrace(const Task task) const;
+	const std::string& getTaskName(const Task task) const;
+	int getTaskCount() const;
+
+	// Return the critical path of the last run in execution order
+	std::vector<Task> getCriticalPath() const;
+
+	// Return the task that took longest in the last run
+	Task getLongestTask() const;
+
+	// Print the run time, the longest task and the critical path with the time spent waiting between its tasks
+	void printTrace(std::ostream &out) const;
+
+	// Write the trace of the last run as Chrome trace events.  Tasks on the critical path are coloured.  Returns false if the file cannot be written.
+	bool writeTrace(const std::string &filename) const;
+};
@@ -1,6 +1,7 @@
 #include "stdafx.h"
 #include "Terrain.h"
 #include "Effect.h"
+#include "DXVertexCompact.h"
 using namespace std;
 using namespace DirectX;
 using namespace DirectX::PackedVector;
@@ -80,10 +81,14 @@ Terrain::Terrain(UINT widthl, UINT heightl, ID3D11DeviceContext *context, ID3D11
 		ZeroMemory(&vertexDesc, sizeof(D3D11_BUFFER_DESC));
 		ZeroMemory(&vertexData, sizeof(D3D11_SUBRESOURCE_DATA));
 
+		vector<DXVertexCompact> packedVertices;
+
+		DXVertexCompact::packVertices(vertices, width*height, &packedVertices);
+
 		vertexDesc.Usage = D3D11_USAGE_IMMUTABLE;
-		vertexDesc.ByteWidth = sizeof(DXVertexExt)* width*height;
+		vertexDesc.ByteWidth = sizeof(DXVertexCompact)* width*height;
 		vertexDesc.BindFlags = D3D11_BIND_VERTEX_BUFFER;
-		vertexData.pSysMem = vertices;
+		vertexData.pSysMem = packedVertices.data();
 
 		HRESULT hr = device->CreateBuffer(&vertexDesc, &vertexData, &vertexBuffer);
 	}
@@ -138,7 +143,7 @@ Terrain::~Terrain()
 }
 
 
-void Terrain::render(ID3D11DeviceContext *context) {
+void Terrain::render(DXContext *context) {
 
 	//effect->bindPipeline(context);
 
@@ -156,11 +161,11 @@ void Terrain::render(ID3D11DeviceContext *context) {
 
 	// Set DXModel vertex and index buffers for IA
 	ID3D11Buffer* vertexBuffers[] = { vertexBuffer };
-	UINT vertexStrides[] = { sizeof(DXVertexExt) };
+	UINT vertexStrides[] = { sizeof(DXVertexCompact) };
 	UINT vertexOffsets[] = { 0 };
 
 	context->IASetVertexBuffers(0, 1, vertexBuffers, vertexStrides, vertexOffsets);
-	context->IASetIndexBuffer(indexBuffer, DXGI_FORMAT_R32_UINT, 0);
+	context->IASetIndexBuffer(indexBuffer, indexFormat, 0);
 
 	// Set primitive topology for IA
 	context->IASetPrimitiveTopology(D3D11_PRIMITIVE_TOPOLOGY_TRIANGLELIST);
@@ -12,7 +12,7 @@ public:
 		ID3D11ShaderResourceView *tex_view, Material *_material, ID3D11Texture2D *tex_height, ID3D11Texture2D *tex_normal);
 
 	float CalculateYValue(float x, float z);
-	void Terrain::render(ID3D11DeviceContext *context);
+	void Terrain::render(DXContext *context);
 	~Terrain();
 };
 
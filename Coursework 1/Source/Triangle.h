@@ -3,6 +3,7 @@
 #include <GUObject.h>
 
 class DXBlob;
+class DXContext;
 
 
 class Triangle : public GUObject {
@@ -15,5 +16,5 @@ public:
 	Triangle(ID3D11Device *device, ID3D11InputLayout *_inputLayout);
 	~Triangle();
 
-	void render(ID3D11DeviceContext *context);
+	void render(DXContext *context);
 };
\ No newline at end of file
@@ -83,7 +83,7 @@ Triangle::~Triangle() {
 }
 
 
-void Triangle::render(ID3D11DeviceContext *context) {
+void Triangle::render(DXContext *context) {
 
 	// Validate object before rendering (see notes in constructor)
 	if (!context || !vertexBuffer || !inputLayout)
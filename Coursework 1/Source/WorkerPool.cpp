@@ -0,0 +1,203 @@
+//
+// WorkerPool.cpp
+//
+
+#include <stdafx.h>
+#include <WorkerPool.h>
+#include <algorithm>
+
+using namespace std;
+
+
+// Create the pool with the given number of worker threads.  A negative count creates one thread per hardware thread less one (the thread calling wait() makes up the difference).
+WorkerPool::WorkerPool(int numThreads) {
+
+	if (numThreads < 0)
+		numThreads = max((int)thread::hardware_concurrency() - 1, 0);
+
+	for (int i = 0; i < numThreads; ++i)
+		threads.push_back(thread(&WorkerPool::workerMain, this));
+}
+
+WorkerPool::~WorkerPool() {
+
+	{
+		lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+
+	taskAvailable.notify_all();
+
+	for (size_t i = 0; i < threads.size(); ++i)
+		threads[i].join();
+}
+
+
+void WorkerPool::workerMain() {
+
+	while (true) {
+
+		QueuedTask task;
+
+		{
+			unique_lock<std::mutex> lock(mutex);
+
+			taskAvailable.wait(lock, [this]() { return stopping || !tasks.empty(); });
+
+			if (tasks.empty())
+				return;
+
+			task = move(tasks.front());
+			tasks.pop_front();
+		}
+
+		runTask(task);
+	}
+}
+
+// Run the given task and record its completion.  Must be called without the mutex held.
+void WorkerPool::runTask(QueuedTask &task) {
+
+	exception_ptr thrown;
+
+	try {
+
+		task.task();
+	}
+	catch (...) {
+
+		thrown = current_exception();
+	}
+
+	bool allComplete;
+
+	{
+		lock_guard<std::mutex> lock(mutex);
+
+		exception_ptr &firstException = (task.group) ? task.group->taskException : taskException;
+
+		if (thrown && !firstException)
+			firstException = thrown;
+
+		allComplete = (--pending == 0);
+
+		// The group may be destroyed by its waiter as soon as the mutex is released
+		if (task.group && --task.group->pending == 0)
+			allComplete = true;
+	}
+
+	if (allComplete)
+		tasksComplete.notify_all();
+}
+
+
+// Queue a task for execution
+void WorkerPool::submit(function<void()> task) {
+
+	{
+		lock_guard<std::mutex> lock(mutex);
+
+		QueuedTask queued = { move(task), nullptr };
+
+		tasks.push_back(move(queued));
+		pending++;
+	}
+
+	taskAvailable.notify_one();
+}
+
+// Queue a task for execution as part of the given group
+void WorkerPool::submit(TaskGroup &group, function<void()> task) {
+
+	{
+		lock_guard<std::mutex> lock(mutex);
+
+		QueuedTask queued = { move(task), &group };
+
+		tasks.push_back(move(queued));
+		pending++;
+		group.pending++;
+	}
+
+	taskAvailable.notify_one();
+}
+
+// Block until every submitted task has completed.  Rethrows the first exception thrown by a task.
+void WorkerPool::wait() {
+
+	unique_lock<std::mutex> lock(mutex);
+
+	while (pending > 0) {
+
+		if (!tasks.empty()) {
+
+			// Execute queued work on this thread rather than sleeping
+			QueuedTask task = move(tasks.front());
+			tasks.pop_front();
+
+			lock.unlock();
+			runTask(task);
+			lock.lock();
+		}
+		else
+			tasksComplete.wait(lock);
+	}
+
+	if (taskException) {
+
+		exception_ptr thrown = taskException;
+
+		taskException = nullptr;
+		rethrow_exception(thrown);
+	}
+}
+
+// Block until every task of the group has completed, executing the group's queued tasks on the calling thread meanwhile.  Rethrows the first exception thrown by a task of the group.  Can be called from a task running on the pool.
+void WorkerPool::wait(TaskGroup &group) {
+
+	unique_lock<std::mutex> lock(mutex);
+
+	while (group.pending > 0) {
+
+		// Only the group's own tasks are executed here - any other task could be one that waits on work this thread is waiting for
+		deque<QueuedTask>::iterator queued = find_if(tasks.begin(), tasks.end(), [&group](const QueuedTask &task) { return task.group == &group; });
+
+		if (queued != tasks.end()) {
+
+			QueuedTask task = move(*queued);
+			tasks.erase(queued);
+
+			lock.unlock();
+			runTask(task);
+			lock.lock();
+		}
+		else
+			tasksComplete.wait(lock);
+	}
+
+	if (group.taskException) {
+
+		exception_ptr thrown = group.taskException;
+
+		group.taskException = nullptr;
+		rethrow_exception(thrown);
+	}
+}
+
+// Call body(i) for i in [0, count) across the pool and wait for all calls to complete.  The calls are submitted as a TaskGroup so parallelFor can be called from a task running on the pool.
+void WorkerPool::parallelFor(const int count, const function<void(int)> &body) {
+
+	TaskGroup group;
+
+	for (int i = 0; i < count; ++i)
+		submit(group, [&body, i]() { body(i); });
+
+	wait(group);
+}
+
+
+// Return the number of threads that execute tasks (the worker threads plus the thread calling wait())
+int WorkerPool::getConcurrency() {
+
+	return (int)threads.size() + 1;
+}
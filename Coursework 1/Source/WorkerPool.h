@@ -0,0 +1,87 @@
+//
+// WorkerPool.h
+//
+
+// Model a fixed pool of worker threads that execute submitted tasks.  Threads are created once and sleep while the task queue is empty.  wait() blocks until every submitted task has completed - the calling thread executes queued tasks while it waits so a pool can be created with no worker threads and a thread is never idle while work remains.  An exception thrown by a task is captured and rethrown from wait().
+//
+// Tasks can also be submitted to a TaskGroup and waited for on their own.  The waiting thread only executes tasks of its group, so a task running on the pool can spread work across the same pool (see parallelFor) - waiting for the whole pool would include the waiting task itself and never return.
+
+#pragma once
+
+#include <GUObject.h>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+class WorkerPool : public GUObject {
+
+public:
+
+	// Tasks waited for together by wait(TaskGroup&).  A group must outlive its tasks.
+	struct TaskGroup {
+
+		// Number of the group's tasks submitted but not yet completed
+		int									pending = 0;
+
+		// First exception thrown by a task of the group since the last wait
+		std::exception_ptr					taskException;
+	};
+
+private:
+
+	struct QueuedTask {
+
+		std::function<void()>				task;
+		TaskGroup							*group; // nullptr for tasks submitted without a group
+	};
+
+	std::vector<std::thread>				threads;
+
+	std::mutex								mutex;
+	std::condition_variable					taskAvailable;
+	std::condition_variable					tasksComplete;
+
+	std::deque<QueuedTask>					tasks;
+
+	// Number of tasks submitted but not yet completed (queued or running)
+	int										pending = 0;
+
+	bool									stopping = false;
+
+	// First exception thrown by a task without a group since the last wait()
+	std::exception_ptr						taskException;
+
+	void workerMain();
+
+	// Run the given task and record its completion.  Must be called without the mutex held.
+	void runTask(QueuedTask &task);
+
+public:
+
+	// Create the pool with the given number of worker threads.  A negative count creates one thread per hardware thread less one (the thread calling wait() makes up the difference).
+	WorkerPool(int numThreads = -1);
+	~WorkerPool();
+
+	// Queue a task for execution
+	void submit(std::function<void()> task);
+
+	// Queue a task for execution as part of the given group
+	void submit(TaskGroup &group, std::function<void()> task);
+
+	// Block until every submitted task has completed.  Rethrows the first exception thrown by a task without a group.
+	void wait();
+
+	// Block until every task of the group has completed, executing the group's queued tasks on the calling thread meanwhile.  Rethrows the first exception thrown by a task of the group.  Can be called from a task running on the pool.
+	void wait(TaskGroup &group);
+
+	// Call body(i) for i in [0, count) across the pool and wait for all calls to complete.  The calls are submitted as a TaskGroup so parallelFor can be called from a task running on the pool.
+	void parallelFor(const int count, const std::function<void(int)> &body);
+
+	// Return the number of threads that execute tasks (the worker threads plus the thread calling wait())
+	int getConcurrency();
+};
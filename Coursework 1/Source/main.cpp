@@ -8,6 +8,7 @@
 #include <exception>
 #include <CGDConsole.h>
 #include <Scene.h>
+#include <Model.h>
 
 using namespace std;
 
@@ -21,6 +22,80 @@ int APIENTRY _tWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPTSTR lpCm
 	CGDConsole		*debugConsole = nullptr;
 	Scene	*mainScene = nullptr;
 
+	// Command line options: -headless runs the scene on the recording backend in a hidden window, -frames N runs N frames back-to-back then exits, -parallel records the views on worker threads, -verify checks serial and parallel recording produce the same output (HEADLESS only), -simrate N sets the number of fixed simulation steps per second, -crowd N adds N instanced knights, -mincontrib N sets the minimum projected size in pixels of objects drawn into the cube map faces, -noocclusion disables CPU occlusion culling of the main view, -faceocclusion enables it for the cube map faces, -layered renders the cube map in a single layered pass, -paraboloid reflects a dual paraboloid map in the sphere (two passes) rather than the cube map, -cubecompare N runs N frames with each reflection mode and compares them, -cubefaces N sets the number of cube map faces re-rendered per frame, -noreflectionlod draws the full models and lighting into the cube map, -cubesize N fixes the size of the cube map faces (otherwise it follows the size of the sphere on screen), -bakeprobes bakes the static reflection probes to DDS files then exits, -noprobes renders the whole scene into the cube map rather than using the baked probes, -roughmips samples the prefiltered levels of the probes by surface roughness, -prefilter FILE writes a GGX prefiltered copy of a DDS cube map then exits, -cookmodels imports every model and writes its cooked mesh (loaded in place of the model on later runs) then exits, -inittrace FILE writes a Chrome trace of the scene's load tasks
+	DXBackendType	backend = DXBackendType::D3D11;
+	int				benchmarkFrames = 0;
+	bool			parallelRecording = (lpCmdLine && _tcsstr(lpCmdLine, TEXT("-parallel")));
+	bool			verifyRecording = (lpCmdLine && _tcsstr(lpCmdLine, TEXT("-verify")));
+	bool			mainOcclusion = !(lpCmdLine && _tcsstr(lpCmdLine, TEXT("-noocclusion")));
+	bool			faceOcclusion = (lpCmdLine && _tcsstr(lpCmdLine, TEXT("-faceocclusion")));
+	bool			layeredCubeMap = (lpCmdLine && _tcsstr(lpCmdLine, TEXT("-layered")));
+	bool			dualParaboloid = (lpCmdLine && _tcsstr(lpCmdLine, TEXT("-paraboloid")));
+	bool			reflectionLOD = !(lpCmdLine && _tcsstr(lpCmdLine, TEXT("-noreflectionlod")));
+	bool			bakeProbes = (lpCmdLine && _tcsstr(lpCmdLine, TEXT("-bakeprobes")));
+	bool			reflectionProbes = !(lpCmdLine && _tcsstr(lpCmdLine, TEXT("-noprobes")));
+	bool			roughnessMips = (lpCmdLine && _tcsstr(lpCmdLine, TEXT("-roughmips")));
+	bool			cookModels = (lpCmdLine && _tcsstr(lpCmdLine, TEXT("-cookmodels")));
+
+	if (lpCmdLine && _tcsstr(lpCmdLine, TEXT("-headless"))) {
+
+		backend = DXBackendType::HEADLESS;
+		benchmarkFrames = 1000;
+		nCmdShow = SW_HIDE;
+	}
+
+	LPTSTR framesArg = (lpCmdLine) ? _tcsstr(lpCmdLine, TEXT("-frames")) : nullptr;
+
+	if (framesArg)
+		benchmarkFrames = _ttoi(framesArg + _tcslen(TEXT("-frames")));
+
+	LPTSTR simRateArg = (lpCmdLine) ? _tcsstr(lpCmdLine, TEXT("-simrate")) : nullptr;
+	int simulationRate = (simRateArg) ? _ttoi(simRateArg + _tcslen(TEXT("-simrate"))) : 0;
+
+	LPTSTR crowdArg = (lpCmdLine) ? _tcsstr(lpCmdLine, TEXT("-crowd")) : nullptr;
+	int crowdSize = (crowdArg) ? _ttoi(crowdArg + _tcslen(TEXT("-crowd"))) : 0;
+
+	LPTSTR minContribArg = (lpCmdLine) ? _tcsstr(lpCmdLine, TEXT("-mincontrib")) : nullptr;
+	double minContribution = (minContribArg) ? _tstof(minContribArg + _tcslen(TEXT("-mincontrib"))) : -1.0;
+
+	LPTSTR cubeCompareArg = (lpCmdLine) ? _tcsstr(lpCmdLine, TEXT("-cubecompare")) : nullptr;
+	int cubeCompareFrames = (cubeCompareArg) ? _ttoi(cubeCompareArg + _tcslen(TEXT("-cubecompare"))) : 0;
+
+	LPTSTR cubeFacesArg = (lpCmdLine) ? _tcsstr(lpCmdLine, TEXT("-cubefaces")) : nullptr;
+	int cubeFacesPerFrame = (cubeFacesArg) ? _ttoi(cubeFacesArg + _tcslen(TEXT("-cubefaces"))) : 0;
+
+	LPTSTR cubeSizeArg = (lpCmdLine) ? _tcsstr(lpCmdLine, TEXT("-cubesize")) : nullptr;
+	int cubeMapSize = (cubeSizeArg) ? _ttoi(cubeSizeArg + _tcslen(TEXT("-cubesize"))) : 0;
+
+	// The file name runs to the next space
+	LPTSTR prefilterArg = (lpCmdLine) ? _tcsstr(lpCmdLine, TEXT("-prefilter")) : nullptr;
+	string prefilterFile;
+
+	if (prefilterArg) {
+
+		for (LPTSTR c = prefilterArg + _tcslen(TEXT("-prefilter")); *c; c++) {
+
+			if (*c != TEXT(' '))
+				prefilterFile += (char)*c;
+			else if (!prefilterFile.empty())
+				break;
+		}
+	}
+
+	LPTSTR initTraceArg = (lpCmdLine) ? _tcsstr(lpCmdLine, TEXT("-inittrace")) : nullptr;
+	string initTraceFile;
+
+	if (initTraceArg) {
+
+		for (LPTSTR c = initTraceArg + _tcslen(TEXT("-inittrace")); *c; c++) {
+
+			if (*c != TEXT(' '))
+				initTraceFile += (char)*c;
+			else if (!initTraceFile.empty())
+				break;
+		}
+	}
+
 #pragma region 1. Initialise application
 
 	// 1.1 Tell Windows to terminate app if heap becomes corrupted
@@ -43,11 +118,18 @@ int APIENTRY _tWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPTSTR lpCm
 
 		cout << "Hello DirectX 11...\n\n";
 		
-		// 1.4 Create main application scene object (singleton)
-		mainScene = Scene::CreateScene(600, 600, L"DirectX 11", L"DirectX 11", nCmdShow, hInstance, WndProc);
+		// 1.4 Create main application scene object (singleton).  The models are cooked as the scene loads them.
+		Model::setCookModels(cookModels);
+		Scene::setInitTraceFile(initTraceFile);
+
+		gu_time_index loadStart = CGDClock::ActualTime();
+
+		mainScene = Scene::CreateScene(600, 600, L"DirectX 11", L"DirectX 11", nCmdShow, hInstance, WndProc, backend);
 
 		if (!mainScene)
 			throw exception("Cannot create main application scene");
+
+		cout << "Scene created in " << CGDClock::ConvertTimeIntervalToSeconds(CGDClock::ActualTime() - loadStart) << " seconds" << endl;
 	}
 	catch(exception& e)
 	{
@@ -68,7 +150,49 @@ int APIENTRY _tWinMain(HINSTANCE hInstance, HINSTANCE hPrevInstance, LPTSTR lpCm
 
 #pragma region 2. Main message loop
 
-	while (1) {
+	mainScene->setParallelRecording(parallelRecording);
+	mainScene->setOcclusionCulling(mainOcclusion, faceOcclusion);
+	mainScene->setLayeredCubeMap(layeredCubeMap);
+	mainScene->setDualParaboloid(dualParaboloid);
+	mainScene->setReflectionLODEnabled(reflectionLOD);
+	mainScene->setReflectionProbesEnabled(reflectionProbes);
+	mainScene->setRoughnessMips(roughnessMips);
+
+	if (cubeFacesPerFrame > 0)
+		mainScene->setCubeFacesPerFrame(cubeFacesPerFrame);
+
+	if (cubeMapSize > 0)
+		mainScene->setCubeMapSize(cubeMapSize);
+
+	if (simulationRate > 0)
+		mainScene->setSimulationRate(simulationRate);
+
+	if (crowdSize > 0)
+		mainScene->setCrowdSize(crowdSize);
+
+	if (minContribution >= 0.0)
+		mainScene->setReflectionContributionThreshold((float)minContribution);
+
+	if (verifyRecording)
+		mainScene->verifyParallelRecording();
+
+	if (cubeCompareFrames > 0)
+		mainScene->compareCubeMapModes(cubeCompareFrames);
+
+	// Probe baking, prefiltering and model cooking are offline steps - the probes and cooked meshes are loaded the next time the scene starts
+	bool offline = bakeProbes || !prefilterFile.empty() || cookModels;
+
+	if (!prefilterFile.empty())
+		mainScene->prefilterCubeMap(prefilterFile);
+
+	if (bakeProbes)
+		mainScene->bakeReflectionProbes();
+
+	// Benchmark mode - render the requested number of frames without waiting on window messages
+	if (benchmarkFrames > 0 && !offline)
+		mainScene->runBenchmark(benchmarkFrames);
+
+	while (benchmarkFrames == 0 && !offline) {
 
 		MSG msg;
 
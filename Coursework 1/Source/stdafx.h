@@ -50,5 +50,6 @@
 #include <DirectXTK\DDSTextureLoader.h>
 #include <DirectXTK\WICTextureLoader.h>
 #include <DXSystem.h>
+#include <DXContext.h>
 #include <DXVertexBasic.h>
 #include <DXVertexExt.h>
@@ -0,0 +1,117 @@
+
+//
+// CubeMapFilterTest.cpp
+//
+
+// Prefilter small generated cube maps with CubeMapFilter and check that a uniform environment stays uniform at every level, that filtering on a WorkerPool gives the same result as filtering on the calling thread and that the samples of each face are read from the right faces.
+
+#include <stdafx.h>
+#include <CubeMapFilter.h>
+#include <WorkerPool.h>
+#include <Test.h>
+
+using namespace std;
+
+
+static const int Size = 32;
+static const int SampleCount = 30; // not a multiple of four so the padding samples are exercised
+
+
+// Colour of each face of the faces test - each face is dominated by one channel
+static const uint8_t FaceColours[6][4] = { { 255, 0, 0, 255 }, { 128, 0, 0, 255 }, { 0, 255, 0, 255 }, { 0, 128, 0, 255 }, { 0, 0, 255, 255 }, { 0, 0, 128, 255 } };
+
+
+static void fillFaces(vector<uint8_t> &texels) {
+
+	texels.resize((size_t)6 * Size * Size * 4);
+
+	for (int face = 0; face < 6; face++)
+		for (int i = 0; i < Size * Size; i++)
+			memcpy(&texels[((size_t)face * Size * Size + i) * 4], FaceColours[face], 4);
+}
+
+static void testUniform() {
+
+	vector<uint8_t> texels((size_t)6 * Size * Size * 4), filtered;
+
+	for (size_t i = 0; i < texels.size(); i += 4) {
+
+		texels[i] = 40;
+		texels[i + 1] = 120;
+		texels[i + 2] = 200;
+		texels[i + 3] = 255;
+	}
+
+	int levels = CubeMapFilter::getMipLevelCount(Size);
+
+	CHECK(levels == 6);
+
+	CubeMapFilter::prefilterGGX(texels.data(), Size, levels, SampleCount, nullptr, &filtered);
+
+	size_t faceBytes = 0;
+
+	for (int l = 0; l < levels; l++)
+		faceBytes += (size_t)(Size >> l) * (Size >> l) * 4;
+
+	CHECK(filtered.size() == faceBytes * 6);
+
+	int maxError = 0;
+
+	for (size_t i = 0; i < filtered.size(); i++)
+		maxError = max(maxError, abs((int)filtered[i] - (int)texels[i % 4]));
+
+	CHECK(maxError <= 1);
+}
+
+static void testPoolMatchesSerial() {
+
+	vector<uint8_t> texels((size_t)6 * Size * Size * 4), serial, pooled;
+
+	srand(3);
+
+	for (size_t i = 0; i < texels.size(); i++)
+		texels[i] = (uint8_t)(rand() % 256);
+
+	WorkerPool *pool = new WorkerPool(3);
+
+	CubeMapFilter::prefilterGGX(texels.data(), Size, 6, SampleCount, nullptr, &serial);
+	CubeMapFilter::prefilterGGX(texels.data(), Size, 6, SampleCount, pool, &pooled);
+
+	CHECK(serial == pooled);
+
+	// The most detailed level is a copy of the source
+	CHECK(memcmp(serial.data(), texels.data(), (size_t)Size * Size * 4) == 0);
+
+	pool->release();
+}
+
+static void testFaces() {
+
+	vector<uint8_t> texels, filtered;
+
+	fillFaces(texels);
+
+	// Level 1 has roughness 0.2 - the centre of each face only sees its own face
+	CubeMapFilter::prefilterGGX(texels.data(), Size, 6, SampleCount, nullptr, &filtered);
+
+	size_t faceBytes = filtered.size() / 6;
+	int centre = (Size / 4) * (Size / 2) + Size / 4;
+
+	for (int face = 0; face < 6; face++) {
+
+		const uint8_t *texel = &filtered[face * faceBytes + (size_t)Size * Size * 4 + centre * 4];
+
+		for (int c = 0; c < 3; c++)
+			CHECK_NEAR(texel[c], FaceColours[face][c], 16);
+	}
+}
+
+
+int main() {
+
+	testUniform();
+	testPoolMatchesSerial();
+	testFaces();
+
+	return TEST_RESULT("CubeMapFilterTest");
+}
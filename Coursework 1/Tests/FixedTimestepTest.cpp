@@ -0,0 +1,154 @@
+
+//
+// FixedTimestepTest.cpp
+//
+
+// Drive FixedTimestep with a virtual clock - a fixed sequence of frame times - and check the steps run by each advance, the maxStepsPerFrame limit and the interpolated render time.
+
+#include <stdafx.h>
+#include <FixedTimestep.h>
+#include <Test.h>
+
+using namespace std;
+
+
+static const double StepLength = 1.0 / 60.0;
+static const double Tolerance = 1e-9;
+
+
+// Advance by elapsed and run every step that is due.  Returns the number of steps run.
+static int runFrame(FixedTimestep &clock, const gu_seconds elapsed) {
+
+	clock.advance(elapsed);
+
+	int steps = 0;
+
+	while (clock.step())
+		steps++;
+
+	return steps;
+}
+
+
+static void testStepsPerAdvance() {
+
+	FixedTimestep clock(60.0, 8);
+
+	// A frame shorter than a step runs no steps.  There is no previous state before the first step so the render time is the start time.
+	CHECK(runFrame(clock, 1.0 / 144.0) == 0);
+	CHECK_NEAR(clock.getInterpolationFactor(), 60.0 / 144.0, 1e-6);
+	CHECK_NEAR(clock.getSimulationTime(), 0.0, Tolerance);
+	CHECK_NEAR(clock.getRenderTime(), 0.0, Tolerance);
+
+	// Completing the step runs it and leaves 2/144 - 1/60 of a second
+	CHECK(runFrame(clock, 1.0 / 144.0) == 0);
+	CHECK(runFrame(clock, 1.0 / 144.0) == 1);
+	CHECK_NEAR(clock.getSimulationTime(), StepLength, Tolerance);
+	CHECK_NEAR(clock.getInterpolationFactor(), (3.0 / 144.0 - StepLength) / StepLength, 1e-6);
+	CHECK_NEAR(clock.getRenderTime(), 3.0 / 144.0 - StepLength, Tolerance);
+
+	// Two and a half steps in one frame
+	clock.reset();
+
+	CHECK(runFrame(clock, 2.5 * StepLength) == 2);
+	CHECK(clock.step() == false);
+	CHECK(clock.getStepCount() == 2);
+	CHECK_NEAR(clock.getSimulationTime(), 2.0 * StepLength, Tolerance);
+	CHECK_NEAR(clock.getInterpolationFactor(), 0.5, 1e-6);
+	CHECK_NEAR(clock.getRenderTime(), 1.5 * StepLength, Tolerance);
+
+	// Negative frame times are ignored
+	CHECK(runFrame(clock, -1.0) == 0);
+	CHECK_NEAR(clock.getInterpolationFactor(), 0.5, 1e-6);
+}
+
+static void testRoundingDoesNotDelaySteps() {
+
+	FixedTimestep clock(60.0, 8);
+
+	// One second at 144 fps and at 60 fps runs exactly 60 steps despite the rounding of each frame time
+	for (int i = 0; i < 144; i++)
+		runFrame(clock, 1.0 / 144.0);
+
+	CHECK(clock.getStepCount() == 60);
+	CHECK_NEAR(clock.getSimulationTime(), 1.0, 1e-6);
+
+	clock.reset();
+
+	for (int i = 0; i < 60; i++)
+		CHECK(runFrame(clock, StepLength) == 1);
+
+	CHECK(clock.getStepCount() == 60);
+	CHECK_NEAR(clock.getTimeDropped(), 0.0, Tolerance);
+}
+
+static void testMaxStepsPerFrame() {
+
+	FixedTimestep clock(60.0, 4);
+
+	// Half a second (30 steps) is capped at 4 steps and the rest of the whole steps are dropped.  The partial step is kept for interpolation.
+	CHECK(runFrame(clock, 0.5 + 0.25 * StepLength) == 4);
+	CHECK(clock.getStepCount() == 4);
+	CHECK_NEAR(clock.getSimulationTime(), 4.0 * StepLength, Tolerance);
+	CHECK_NEAR(clock.getTimeDropped(), 26.0 * StepLength, Tolerance);
+	CHECK_NEAR(clock.getInterpolationFactor(), 0.25, 1e-6);
+	CHECK_NEAR(clock.getRenderTime(), 3.25 * StepLength, Tolerance);
+
+	// The next normal frame is not affected by the dropped time
+	CHECK(runFrame(clock, 0.75 * StepLength) == 1);
+	CHECK_NEAR(clock.getTimeDropped(), 26.0 * StepLength, Tolerance);
+
+	// The limit is at least one step
+	clock.setMaxStepsPerFrame(0);
+	CHECK(clock.getMaxStepsPerFrame() == 1);
+	CHECK(runFrame(clock, 3.0 * StepLength) == 1);
+	CHECK_NEAR(clock.getTimeDropped(), 28.0 * StepLength, Tolerance);
+
+	// A stall of a day (over five million steps) runs one step and drops the rest, keeping the partial step
+	clock.reset();
+	CHECK(runFrame(clock, 86400.0 + 0.5 * StepLength) == 1);
+	CHECK_NEAR(clock.getTimeDropped(), 86400.0 - StepLength, 1e-6);
+	CHECK_NEAR(clock.getInterpolationFactor(), 0.5, 1e-4);
+}
+
+static void testResetAndRate() {
+
+	FixedTimestep clock(60.0, 8);
+
+	clock.reset(10.0);
+
+	CHECK_NEAR(clock.getSimulationTime(), 10.0, Tolerance);
+	CHECK_NEAR(clock.getRenderTime(), 10.0, Tolerance);
+
+	// Changing the rate keeps the accumulated time
+	runFrame(clock, 0.01);
+	clock.setStepRate(100.0);
+
+	CHECK_NEAR(clock.getStepLength(), 0.01, Tolerance);
+	CHECK(runFrame(clock, 0.0) == 1);
+	CHECK_NEAR(clock.getSimulationTime(), 10.01, Tolerance);
+
+	bool threw = false;
+
+	try {
+
+		clock.setStepRate(0.0);
+	}
+	catch (const runtime_error &) {
+
+		threw = true;
+	}
+
+	CHECK(threw);
+}
+
+
+int main() {
+
+	testStepsPerAdvance();
+	testRoundingDoesNotDelaySteps();
+	testMaxStepsPerFrame();
+	testResetAndRate();
+
+	return TEST_RESULT("FixedTimestepTest");
+}
@@ -0,0 +1,207 @@
+//
+// MeshOptimizerTest.cpp
+//
+
+// Reorder generated grid meshes with MeshOptimizer and check that the triangles and their winding are kept by each pass, that the cache miss ratio never gets worse than the source order and that the vertex fetch remap is a permutation matching the rewritten indices.
+
+#include <stdafx.h>
+#include <MeshOptimizer.h>
+#include <Test.h>
+
+using namespace std;
+
+
+static const uint32_t GridSize = 40; // vertices along each side
+
+
+// Build a GridSize x GridSize vertex grid in the xz plane with two triangles per cell, row by row
+static void buildGrid(vector<float> &positions, vector<uint32_t> &indices) {
+
+	positions.clear();
+	indices.clear();
+
+	for (uint32_t z = 0; z < GridSize; z++) {
+
+		for (uint32_t x = 0; x < GridSize; x++) {
+
+			positions.push_back((float)x);
+			positions.push_back(0.0f);
+			positions.push_back((float)z);
+		}
+	}
+
+	for (uint32_t z = 0; z + 1 < GridSize; z++) {
+
+		for (uint32_t x = 0; x + 1 < GridSize; x++) {
+
+			uint32_t v = z * GridSize + x;
+			uint32_t cell[6] = { v, v + GridSize, v + 1, v + 1, v + GridSize, v + GridSize + 1 };
+
+			indices.insert(indices.end(), cell, cell + 6);
+		}
+	}
+}
+
+// Shuffle the triangles of indices (not the vertices within them)
+static void shuffleTriangles(vector<uint32_t> &indices) {
+
+	srand(11);
+
+	for (size_t t = indices.size() / 3 - 1; t > 0; t--) {
+
+		size_t other = (size_t)rand() % (t + 1);
+
+		for (int c = 0; c < 3; c++)
+			swap(indices[t * 3 + c], indices[other * 3 + c]);
+	}
+}
+
+// Return the triangles of indices rotated to start at their smallest index (which keeps the winding) and sorted, so two index buffers drawing the same triangles compare equal
+static vector<uint64_t> triangleSet(const vector<uint32_t> &indices) {
+
+	vector<uint64_t> triangles;
+
+	for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+
+		const uint32_t *t = &indices[i];
+		int first = (t[1] < t[0] && t[1] < t[2]) ? 1 : (t[2] < t[0] && t[2] < t[1]) ? 2 : 0;
+
+		triangles.push_back(((uint64_t)t[first] << 42) | ((uint64_t)t[(first + 1) % 3] << 21) | (uint64_t)t[(first + 2) % 3]);
+	}
+
+	sort(triangles.begin(), triangles.end());
+
+	return triangles;
+}
+
+static double acmr(const vector<uint32_t> &indices, const uint32_t vertexCount) {
+
+	MeshOptimizer::CacheStats stats = MeshOptimizer::analyzeVertexCache(indices.data(), (uint32_t)indices.size(), vertexCount);
+
+	return (double)stats.transformed / stats.triangles;
+}
+
+static void testTrianglesKept() {
+
+	vector<float> positions;
+	vector<uint32_t> indices;
+
+	buildGrid(positions, indices);
+	shuffleTriangles(indices);
+
+	uint32_t vertexCount = GridSize * GridSize;
+	vector<uint64_t> source = triangleSet(indices);
+
+	// Each pass on its own...
+	vector<uint32_t> optimized = indices;
+	vector<uint32_t> clusters;
+
+	MeshOptimizer::optimizeVertexCache(optimized.data(), (uint32_t)optimized.size(), vertexCount, &clusters);
+
+	CHECK(triangleSet(optimized) == source);
+	CHECK(!clusters.empty() && clusters[0] == 0);
+
+	MeshOptimizer::optimizeOverdraw(optimized.data(), (uint32_t)optimized.size(), positions.data(), 3 * sizeof(float), vertexCount, clusters);
+
+	CHECK(triangleSet(optimized) == source);
+
+	// ...and together
+	optimized = indices;
+	MeshOptimizer::optimizeTriangles(optimized.data(), (uint32_t)optimized.size(), positions.data(), 3 * sizeof(float), vertexCount);
+
+	CHECK(triangleSet(optimized) == source);
+}
+
+static void testCacheNeverWorse() {
+
+	vector<float> positions;
+	vector<uint32_t> indices;
+
+	buildGrid(positions, indices);
+
+	uint32_t vertexCount = GridSize * GridSize;
+
+	// The row order of a grid is already reasonable and a shuffled order is poor - neither may get worse
+	for (int shuffled = 0; shuffled < 2; shuffled++) {
+
+		if (shuffled)
+			shuffleTriangles(indices);
+
+		vector<uint32_t> optimized = indices;
+		MeshOptimizer::CacheStats before, after;
+
+		MeshOptimizer::optimizeTriangles(optimized.data(), (uint32_t)optimized.size(), positions.data(), 3 * sizeof(float), vertexCount, &before, &after);
+
+		CHECK(before.triangles == indices.size() / 3 && after.triangles == before.triangles);
+		CHECK(before.vertices == vertexCount && after.vertices == vertexCount);
+		CHECK(after.transformed <= before.transformed);
+		CHECK_NEAR(acmr(indices, vertexCount), (double)before.transformed / before.triangles, 1e-9);
+		CHECK_NEAR(acmr(optimized, vertexCount), (double)after.transformed / after.triangles, 1e-9);
+
+		// Tipsify brings a shuffled grid close to the row order (about 1 vertex per triangle for a 16 entry cache)
+		if (shuffled)
+			CHECK(acmr(optimized, vertexCount) < 1.0);
+	}
+}
+
+static void testVertexFetchRemap() {
+
+	vector<float> positions;
+	vector<uint32_t> indices;
+
+	buildGrid(positions, indices);
+	shuffleTriangles(indices);
+
+	// Two vertices no triangle uses
+	uint32_t vertexCount = GridSize * GridSize + 2;
+	vector<uint32_t> source = indices, remap;
+
+	MeshOptimizer::optimizeVertexFetch(indices.data(), (uint32_t)indices.size(), vertexCount, &remap);
+
+	CHECK(remap.size() == vertexCount);
+
+	// remap is a permutation of 0 .. vertexCount - 1
+	vector<bool> used(vertexCount, false);
+	bool permutation = (remap.size() == vertexCount);
+
+	for (size_t v = 0; v < remap.size() && permutation; v++) {
+
+		permutation = remap[v] < vertexCount && !used[remap[v]];
+
+		if (permutation)
+			used[remap[v]] = true;
+	}
+
+	CHECK(permutation);
+
+	if (!permutation)
+		return;
+
+	// The indices are rewritten through remap and first use each vertex in order
+	bool rewritten = true;
+	uint32_t nextVertex = 0;
+
+	for (size_t i = 0; i < indices.size(); i++) {
+
+		rewritten = rewritten && indices[i] == remap[source[i]] && indices[i] <= nextVertex;
+
+		if (indices[i] == nextVertex)
+			nextVertex++;
+	}
+
+	CHECK(rewritten);
+	CHECK(nextVertex == GridSize * GridSize);
+
+	// Unused vertices follow the used ones in their original order
+	CHECK(remap[GridSize * GridSize] == GridSize * GridSize && remap[GridSize * GridSize + 1] == GridSize * GridSize + 1);
+}
+
+
+int main() {
+
+	testTrianglesKept();
+	testCacheNeverWorse();
+	testVertexFetchRemap();
+
+	return TEST_RESULT("MeshOptimizerTest");
+}
@@ -0,0 +1,167 @@
+//
+// MeshSimplifierTest.cpp
+//
+
+// Simplify generated meshes with MeshSimplifier and check that a finely tessellated quad collapses to fewer triangles facing the same way, that degenerate and duplicate triangles are dropped and that the two sides of a thin wall are not merged into one cluster.
+
+#include <stdafx.h>
+#include <MeshSimplifier.h>
+#include <Test.h>
+
+using namespace std;
+
+
+// Position and normal of a vertex as laid out in the vertex buffer
+struct Vertex {
+
+	float								position[3];
+	float								normal[3];
+};
+
+
+// Add a quad of (cells + 1) x (cells + 1) vertices spanning size in x and y at depth z, facing +z (or -z if flipped), to vertices and indices
+static void addQuad(vector<Vertex> &vertices, vector<uint32_t> &indices, const int cells, const float size, const float z, const bool flipped) {
+
+	uint32_t first = (uint32_t)vertices.size();
+	float step = size / cells;
+
+	for (int y = 0; y <= cells; y++) {
+
+		for (int x = 0; x <= cells; x++) {
+
+			Vertex v = { { x * step, y * step, z }, { 0.0f, 0.0f, flipped ? -1.0f : 1.0f } };
+
+			vertices.push_back(v);
+		}
+	}
+
+	for (int y = 0; y < cells; y++) {
+
+		for (int x = 0; x < cells; x++) {
+
+			uint32_t v = first + y * (cells + 1) + x;
+			uint32_t row = cells + 1;
+
+			// Counter-clockwise seen from +z
+			uint32_t cell[6] = { v, v + 1, v + row, v + 1, v + row + 1, v + row };
+
+			if (flipped) {
+
+				swap(cell[1], cell[2]);
+				swap(cell[4], cell[5]);
+			}
+
+			indices.insert(indices.end(), cell, cell + 6);
+		}
+	}
+}
+
+// Return the z component of the geometric normal of triangle t of indices
+static float faceNormalZ(const vector<Vertex> &vertices, const vector<uint32_t> &indices, const size_t t) {
+
+	const float *a = vertices[indices[t * 3]].position;
+	const float *b = vertices[indices[t * 3 + 1]].position;
+	const float *c = vertices[indices[t * 3 + 2]].position;
+
+	return (b[0] - a[0]) * (c[1] - a[1]) - (b[1] - a[1]) * (c[0] - a[0]);
+}
+
+static void testQuadCollapses() {
+
+	vector<Vertex> vertices;
+	vector<uint32_t> indices, simplified;
+	vector<uint32_t> remap;
+
+	addQuad(vertices, indices, 32, 8.0f, 0.0f, false);
+
+	MeshSimplifier::clusterVertices(vertices[0].position, vertices[0].normal, sizeof(Vertex), (uint32_t)vertices.size(), 1.0f, &remap);
+
+	CHECK(remap.size() == vertices.size());
+
+	// Every vertex maps to a representative in the same cell that maps to itself
+	for (size_t v = 0; v < remap.size(); v++) {
+
+		const float *p = vertices[v].position;
+		const float *r = vertices[remap[v]].position;
+
+		CHECK(remap[remap[v]] == remap[v]);
+		CHECK(floorf(p[0]) == floorf(r[0]) && floorf(p[1]) == floorf(r[1]));
+	}
+
+	uint32_t triangles = MeshSimplifier::remapTriangles(indices.data(), (uint32_t)indices.size(), remap, &simplified);
+
+	CHECK(triangles == simplified.size() / 3);
+	CHECK(triangles > 0 && triangles < indices.size() / 3 / 8);
+
+	// The simplified triangles still face +z
+	for (size_t t = 0; t < triangles; t++)
+		CHECK(faceNormalZ(vertices, simplified, t) > 0.0f);
+}
+
+static void testDegenerateAndDuplicates() {
+
+	vector<uint32_t> remap = { 0, 1, 2, 3, 1 };
+
+	// A triangle, the same triangle rotated, one remapped onto an edge, the reversed triangle and a repeated vertex
+	uint32_t indices[] = { 0, 1, 2, 1, 2, 0, 0, 1, 4, 2, 1, 0, 3, 3, 2, 1, 3, 2 };
+	vector<uint32_t> simplified;
+
+	uint32_t triangles = MeshSimplifier::remapTriangles(indices, sizeof(indices) / sizeof(indices[0]), remap, &simplified);
+
+	// The first triangle, the reversed one (it faces the other way) and the last are kept
+	uint32_t expected[] = { 0, 1, 2, 2, 1, 0, 1, 3, 2 };
+
+	CHECK(triangles == 3);
+	CHECK(simplified == vector<uint32_t>(expected, expected + 9));
+
+	// Triangles are appended
+	triangles = MeshSimplifier::remapTriangles(indices, 3, remap, &simplified);
+
+	CHECK(triangles == 1 && simplified.size() == 12);
+}
+
+static void testWallSidesKept() {
+
+	vector<Vertex> vertices;
+	vector<uint32_t> indices, simplified;
+	vector<uint32_t> remap;
+
+	// The back and front of a wall 0.1 thick - every cell holds vertices of both sides
+	addQuad(vertices, indices, 8, 2.0f, 0.0f, true);
+
+	uint32_t backCount = (uint32_t)vertices.size();
+
+	addQuad(vertices, indices, 8, 2.0f, 0.1f, false);
+
+	MeshSimplifier::clusterVertices(vertices[0].position, vertices[0].normal, sizeof(Vertex), (uint32_t)vertices.size(), 0.5f, &remap);
+
+	bool sidesKept = true;
+
+	for (uint32_t v = 0; v < vertices.size(); v++)
+		sidesKept = sidesKept && ((v < backCount) == (remap[v] < backCount));
+
+	CHECK(sidesKept);
+
+	uint32_t triangles = MeshSimplifier::remapTriangles(indices.data(), (uint32_t)indices.size(), remap, &simplified);
+
+	CHECK(triangles > 0 && triangles < indices.size() / 3);
+
+	// Each triangle stays on one side, facing out from the wall
+	for (size_t t = 0; t < triangles; t++) {
+
+		bool back = simplified[t * 3] < backCount;
+
+		CHECK(back == (simplified[t * 3 + 1] < backCount) && back == (simplified[t * 3 + 2] < backCount));
+		CHECK((faceNormalZ(vertices, simplified, t) < 0.0f) == back);
+	}
+}
+
+
+int main() {
+
+	testQuadCollapses();
+	testDegenerateAndDuplicates();
+	testWallSidesKept();
+
+	return TEST_RESULT("MeshSimplifierTest");
+}
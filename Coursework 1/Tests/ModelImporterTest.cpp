@@ -0,0 +1,306 @@
+
+//
+// ModelImporterTest.cpp
+//
+
+// Import the obj and 3ds models in Resources/Models and check that importing on a WorkerPool gives byte for byte the same result as importing on the calling thread, that every index is in range of its sub-mesh and that the triangle winding agrees with the normals stored in Bridge.obj.  3ds smoothing groups are checked on a small generated file.
+
+#include <stdafx.h>
+#include <ModelImporter.h>
+#include <WorkerPool.h>
+#include <Test.h>
+
+using namespace std;
+
+
+static const char *ModelDirectory = "../Resources/Models/";
+
+static const char *Models[] = {
+
+	"Bridge.obj", "Shark.obj", "logs.obj",
+	"bridge.3DS", "castle.3DS", "Castle walls.3DS", "earth.3DS", "knight.3DS", "Rudd Fish.3ds", "sphere.3ds", "sphere2.3ds", "stand.3DS", "tower.3ds", "tree.3DS"
+};
+
+
+// Unnormalised normal of triangle t of the given sub-mesh
+static void faceNormal(const ModelImporter *importer, const ModelImporter::Mesh &mesh, const uint32_t firstIndex, float *n) {
+
+	const vector<ModelImporter::Vertex> &vertices = importer->getVertices();
+	const vector<uint32_t> &indices = importer->getIndices();
+
+	const float *p0 = vertices[mesh.baseVertex + indices[firstIndex]].pos;
+	const float *p1 = vertices[mesh.baseVertex + indices[firstIndex + 1]].pos;
+	const float *p2 = vertices[mesh.baseVertex + indices[firstIndex + 2]].pos;
+
+	float e1[3] = { p1[0] - p0[0], p1[1] - p0[1], p1[2] - p0[2] };
+	float e2[3] = { p2[0] - p0[0], p2[1] - p0[1], p2[2] - p0[2] };
+
+	n[0] = e1[1] * e2[2] - e1[2] * e2[1];
+	n[1] = e1[2] * e2[0] - e1[0] * e2[2];
+	n[2] = e1[0] * e2[1] - e1[1] * e2[0];
+}
+
+static float dot(const float *a, const float *b) {
+
+	return a[0] * b[0] + a[1] * b[1] + a[2] * b[2];
+}
+
+static float length(const float *a) {
+
+	return sqrtf(dot(a, a));
+}
+
+
+static void testSerialMatchesPool(WorkerPool *pool) {
+
+	for (size_t m = 0; m < sizeof(Models) / sizeof(Models[0]); m++) {
+
+		string filename = string(ModelDirectory) + Models[m];
+
+		ModelImporter *serial = new ModelImporter();
+		ModelImporter *pooled = new ModelImporter(pool);
+
+		bool serialImported = serial->import(filename);
+		bool pooledImported = pooled->import(filename);
+
+		if (!serialImported)
+			cout << Models[m] << ": " << serial->getError() << endl;
+
+		CHECK(serialImported && pooledImported);
+
+		const vector<ModelImporter::Vertex> &vertices = serial->getVertices();
+		const vector<uint32_t> &indices = serial->getIndices();
+		const vector<ModelImporter::Mesh> &meshes = serial->getMeshes();
+
+		CHECK(!meshes.empty() && !indices.empty());
+		CHECK(vertices.size() == pooled->getVertices().size());
+		CHECK(indices == pooled->getIndices());
+		CHECK(meshes.size() == pooled->getMeshes().size());
+		CHECK(vertices.size() == pooled->getVertices().size() && memcmp(vertices.data(), pooled->getVertices().data(), vertices.size() * sizeof(ModelImporter::Vertex)) == 0);
+
+		// Indices are relative to the base vertex of their sub-mesh and must stay within the sub-mesh
+		size_t firstIndex = 0;
+		size_t outOfRange = 0;
+
+		for (size_t s = 0; s < meshes.size(); s++) {
+
+			uint32_t endVertex = (s + 1 < meshes.size()) ? meshes[s + 1].baseVertex : (uint32_t)vertices.size();
+
+			CHECK(meshes[s].indexCount % 3 == 0);
+
+			for (uint32_t i = 0; i < meshes[s].indexCount; i++) {
+
+				if (meshes[s].baseVertex + indices[firstIndex + i] >= endVertex)
+					outOfRange++;
+			}
+
+			firstIndex += meshes[s].indexCount;
+		}
+
+		CHECK(firstIndex == indices.size());
+		CHECK(outOfRange == 0);
+
+		serial->release();
+		pooled->release();
+	}
+}
+
+static void testWindingMatchesNormals() {
+
+	// Bridge.obj stores its normals so they are converted rather than computed.  Front faces must wind the same way as the normals of their corners.
+	ModelImporter *importer = new ModelImporter();
+
+	CHECK(importer->import(string(ModelDirectory) + "Bridge.obj"));
+
+	const vector<ModelImporter::Vertex> &vertices = importer->getVertices();
+	const vector<uint32_t> &indices = importer->getIndices();
+	size_t firstIndex = 0, agree = 0, disagree = 0;
+
+	for (size_t s = 0; s < importer->getMeshes().size(); s++) {
+
+		const ModelImporter::Mesh &mesh = importer->getMeshes()[s];
+
+		for (uint32_t t = 0; t < mesh.indexCount; t += 3) {
+
+			float n[3], cornerNormals[3] = { 0.0f, 0.0f, 0.0f };
+
+			faceNormal(importer, mesh, (uint32_t)firstIndex + t, n);
+
+			for (int k = 0; k < 3; k++) {
+
+				const float *normal = vertices[mesh.baseVertex + indices[firstIndex + t + k]].normal;
+
+				cornerNormals[0] += normal[0];
+				cornerNormals[1] += normal[1];
+				cornerNormals[2] += normal[2];
+			}
+
+			float d = dot(n, cornerNormals);
+
+			if (d > 0.0f)
+				agree++;
+			else if (d < 0.0f)
+				disagree++;
+		}
+
+		firstIndex += mesh.indexCount;
+	}
+
+	CHECK(agree > 0);
+	CHECK(disagree * 100 < agree);
+
+	importer->release();
+}
+
+
+// Append a 3ds chunk holding the given body to file
+static void appendChunk(vector<uint8_t> &file, const uint16_t id, const vector<uint8_t> &body) {
+
+	uint32_t length = (uint32_t)body.size() + 6;
+
+	file.insert(file.end(), reinterpret_cast<const uint8_t*>(&id), reinterpret_cast<const uint8_t*>(&id) + 2);
+	file.insert(file.end(), reinterpret_cast<const uint8_t*>(&length), reinterpret_cast<const uint8_t*>(&length) + 4);
+	file.insert(file.end(), body.begin(), body.end());
+}
+
+template <class T> static void append(vector<uint8_t> &data, const T &value) {
+
+	data.insert(data.end(), reinterpret_cast<const uint8_t*>(&value), reinterpret_cast<const uint8_t*>(&value) + sizeof(T));
+}
+
+// Write a 3ds file holding two triangles folded at right angles along a shared edge, with the given smoothing group masks (or no smoothing chunk if groups is nullptr) and import it
+static ModelImporter* importFold(const uint32_t *groups) {
+
+	// z-up 3ds positions - face 0 lies in the plane z = 0 and face 1 in the plane x = 0, sharing the edge from vertex 0 to vertex 2
+	const float positions[4][3] = { { 0.0f, 0.0f, 0.0f }, { 1.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }, { 0.0f, 0.0f, 1.0f } };
+	const uint16_t faces[2][4] = { { 0, 1, 2, 0 }, { 0, 2, 3, 0 } };
+
+	vector<uint8_t> vertexBody, faceBody, smoothingBody, triMeshBody, objectBody, editorBody, file;
+
+	append(vertexBody, (uint16_t)4);
+	for (int v = 0; v < 4; v++)
+		for (int k = 0; k < 3; k++)
+			append(vertexBody, positions[v][k]);
+
+	append(faceBody, (uint16_t)2);
+	for (int f = 0; f < 2; f++)
+		for (int k = 0; k < 4; k++)
+			append(faceBody, faces[f][k]);
+
+	if (groups) {
+
+		append(smoothingBody, groups[0]);
+		append(smoothingBody, groups[1]);
+		appendChunk(faceBody, 0x4150, smoothingBody);
+	}
+
+	appendChunk(triMeshBody, 0x4110, vertexBody);
+	appendChunk(triMeshBody, 0x4120, faceBody);
+
+	const char name[] = "fold";
+
+	objectBody.insert(objectBody.end(), name, name + sizeof(name));
+	appendChunk(objectBody, 0x4100, triMeshBody);
+	appendChunk(editorBody, 0x4000, objectBody);
+	appendChunk(file, 0x3D3D, editorBody);
+
+	vector<uint8_t> mainBody(file);
+
+	file.clear();
+	appendChunk(file, 0x4D4D, mainBody);
+
+	const char *filename = "Build/SmoothingGroups.3ds";
+
+	ofstream out(filename, ios::binary);
+
+	out.write(reinterpret_cast<const char*>(file.data()), file.size());
+	out.close();
+
+	ModelImporter *importer = new ModelImporter();
+
+	CHECK(importer->import(filename));
+	CHECK(importer->getIndices().size() == 6);
+
+	return importer;
+}
+
+// Cosine of the angle between the normal at each corner of the fold and the face normal of the corner's face.  The triangles are reversed on import so the corners on the shared edge are 0 and 2 of face 0 and 4 and 5 of face 1.
+static void foldCornerAngles(const ModelImporter *importer, float *cosines) {
+
+	const ModelImporter::Mesh &mesh = importer->getMeshes()[0];
+
+	for (int f = 0; f < 2; f++) {
+
+		float n[3];
+
+		faceNormal(importer, mesh, f * 3, n);
+
+		for (int k = 0; k < 3; k++) {
+
+			const float *normal = importer->getVertices()[mesh.baseVertex + importer->getIndices()[f * 3 + k]].normal;
+
+			cosines[f * 3 + k] = dot(n, normal) / (length(n) * length(normal));
+		}
+	}
+}
+
+static void testSmoothingGroups() {
+
+	const float cos45 = sqrtf(0.5f);
+	float cosines[6];
+
+	// Without smoothing groups, and with overlapping groups, the shared edge is smoothed - the corners on it are 45 degrees from both faces
+	const uint32_t sameGroup[2] = { 1, 1 };
+	const uint32_t overlappingGroups[2] = { 1, 3 };
+	const uint32_t *smoothed[3] = { nullptr, sameGroup, overlappingGroups };
+
+	for (int s = 0; s < 3; s++) {
+
+		ModelImporter *importer = importFold(smoothed[s]);
+
+		foldCornerAngles(importer, cosines);
+
+		CHECK(importer->getVertices().size() == 4);
+		CHECK_NEAR(cosines[0], cos45, 1e-5);
+		CHECK_NEAR(cosines[2], cos45, 1e-5);
+		CHECK_NEAR(cosines[4], cos45, 1e-5);
+		CHECK_NEAR(cosines[5], cos45, 1e-5);
+		CHECK_NEAR(cosines[1], 1.0, 1e-5);
+		CHECK_NEAR(cosines[3], 1.0, 1e-5);
+
+		importer->release();
+	}
+
+	// Faces in different groups, or in no group, are not smoothed together.  The vertices of the shared edge are split so every corner has its face normal.
+	const uint32_t separateGroups[2] = { 1, 2 };
+	const uint32_t noGroup[2] = { 0, 0 };
+	const uint32_t *flat[2] = { separateGroups, noGroup };
+
+	for (int s = 0; s < 2; s++) {
+
+		ModelImporter *importer = importFold(flat[s]);
+
+		foldCornerAngles(importer, cosines);
+
+		CHECK(importer->getVertices().size() == 6);
+
+		for (int c = 0; c < 6; c++)
+			CHECK_NEAR(cosines[c], 1.0, 1e-5);
+
+		importer->release();
+	}
+}
+
+
+int main() {
+
+	WorkerPool *pool = new WorkerPool(4);
+
+	testSerialMatchesPool(pool);
+	testWindingMatchesNormals();
+	testSmoothingGroups();
+
+	pool->release();
+
+	return TEST_RESULT("ModelImporterTest");
+}
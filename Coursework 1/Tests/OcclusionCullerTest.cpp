@@ -0,0 +1,263 @@
+
+//
+// OcclusionCullerTest.cpp
+//
+
+// Rasterize simple occluders with OcclusionCuller and check sphere visibility behind and around a wall, that reversed (back-facing) winding is not rasterized and that the SSE rasterizer matches a scalar reference rasterizer, and that rendering 40000 triangles on a WorkerPool gives the same depth buffer as rendering them serially.
+
+#include <stdafx.h>
+#include <OcclusionCuller.h>
+#include <WorkerPool.h>
+#include <Test.h>
+
+using namespace std;
+
+
+// Row-major left-handed perspective projection (as XMMatrixPerspectiveFovLH) with the camera at the origin looking down +z
+static void perspective(float *m, const float fovY, const float aspect, const float nearZ, const float farZ) {
+
+	float yScale = 1.0f / tanf(fovY * 0.5f);
+
+	for (int i = 0; i < 16; i++)
+		m[i] = 0.0f;
+
+	m[0] = yScale / aspect;
+	m[5] = yScale;
+	m[10] = farZ / (farZ - nearZ);
+	m[11] = 1.0f;
+	m[14] = -nearZ * farZ / (farZ - nearZ);
+}
+
+// Scalar reference - rasterize each front-facing triangle at pixel centres and keep the nearest depth.  Triangles must lie in front of the near plane.
+static void rasterizeReference(const float *viewProj, const int size, const vector<float> &positions, const vector<uint32_t> &indices, vector<float> &depth) {
+
+	depth.assign(size * size, 1.0f);
+
+	for (size_t t = 0; t < indices.size(); t += 3) {
+
+		float x[3], y[3], z[3];
+
+		for (int k = 0; k < 3; k++) {
+
+			const float *p = &positions[3 * indices[t + k]];
+			float w = p[2];
+
+			x[k] = (p[0] * viewProj[0] / w * 0.5f + 0.5f) * size;
+			y[k] = (0.5f - p[1] * viewProj[5] / w * 0.5f) * size;
+			z[k] = (p[2] * viewProj[10] + viewProj[14]) / w;
+		}
+
+		float area = (x[1] - x[0]) * (y[2] - y[0]) - (x[2] - x[0]) * (y[1] - y[0]);
+
+		if (!(area > 0.0f))
+			continue;
+
+		for (int py = 0; py < size; py++) {
+
+			for (int px = 0; px < size; px++) {
+
+				float sx = px + 0.5f, sy = py + 0.5f;
+				float w0 = (x[2] - x[1]) * (sy - y[1]) - (y[2] - y[1]) * (sx - x[1]);
+				float w1 = (x[0] - x[2]) * (sy - y[2]) - (y[0] - y[2]) * (sx - x[2]);
+				float w2 = (x[1] - x[0]) * (sy - y[0]) - (y[1] - y[0]) * (sx - x[0]);
+
+				if (w0 >= 0.0f && w1 >= 0.0f && w2 >= 0.0f)
+					depth[py * size + px] = min(depth[py * size + px], (w0 * z[0] + w1 * z[1] + w2 * z[2]) / area);
+			}
+		}
+	}
+}
+
+
+// 10 x 10 wall at z = 10, clockwise on screen (front-facing)
+static const float WallPositions[] = { -5.0f, -5.0f, 10.0f, -5.0f, 5.0f, 10.0f, 5.0f, 5.0f, 10.0f, 5.0f, -5.0f, 10.0f };
+static const uint32_t WallIndices[] = { 0, 1, 2, 0, 2, 3 };
+static const uint32_t WallIndicesReversed[] = { 0, 2, 1, 0, 3, 2 };
+
+
+static void testWall(const float *viewProj, WorkerPool *pool) {
+
+	OcclusionCuller *culler = new OcclusionCuller(1, 256, 256);
+
+	culler->addOccluder(WallPositions, 3 * sizeof(float), 4, WallIndices, 6, nullptr);
+
+	// Nothing is occluded before the view is rendered
+	float behind[] = { 0.0f, 0.0f, 20.0f };
+
+	CHECK(culler->isSphereVisible(0, behind, 1.0f));
+
+	culler->render(0, viewProj, pool);
+
+	CHECK(culler->getOccluderTriangleCount() == 2);
+	CHECK(culler->getTrianglesRasterized() == 2);
+
+	// The wall covers the centre of the view at depth far / (far - near) * (1 - near / 10)
+	const float *depth = culler->getDepthBuffer(0);
+
+	CHECK_NEAR(depth[128 * 256 + 128], (1000.0 / 999.0) * (1.0 - 1.0 / 10.0), 1e-4);
+	CHECK(depth[0] == 1.0f);
+
+	float inFront[] = { 0.0f, 0.0f, 5.0f };
+	float overEdge[] = { 10.0f, 0.0f, 20.0f };
+	float beside[] = { 30.0f, 0.0f, 20.0f };
+	float edgeBehind[] = { 4.0f, 0.0f, 20.0f };
+	float aroundCamera[] = { 0.0f, 0.0f, -3.0f };
+
+	CHECK(!culler->isSphereVisible(0, behind, 1.0f));
+	CHECK(culler->isSphereVisible(0, inFront, 1.0f));
+	CHECK(culler->isSphereVisible(0, overEdge, 1.0f));
+	CHECK(!culler->isSphereVisible(0, edgeBehind, 1.0f));
+	CHECK(culler->isSphereVisible(0, beside, 1.0f));
+	CHECK(culler->isSphereVisible(0, aroundCamera, 4.0f));
+
+	// A sphere that reaches in front of the wall is visible
+	CHECK(culler->isSphereVisible(0, behind, 11.0f));
+
+	culler->invalidate(0);
+
+	CHECK(culler->isSphereVisible(0, behind, 1.0f));
+
+	culler->release();
+}
+
+static void testReversedWinding(const float *viewProj) {
+
+	OcclusionCuller *culler = new OcclusionCuller(1, 64, 64);
+
+	culler->addOccluder(WallPositions, 3 * sizeof(float), 4, WallIndicesReversed, 6, nullptr);
+	culler->render(0, viewProj);
+
+	float behind[] = { 0.0f, 0.0f, 20.0f };
+
+	CHECK(culler->getTrianglesRasterized() == 0);
+	CHECK(culler->getTrianglesCulled() == 2);
+	CHECK(culler->isSphereVisible(0, behind, 1.0f));
+
+	culler->release();
+}
+
+static void testFloorCrossingNearPlane(const float *viewProj, WorkerPool *pool) {
+
+	// Floor below the camera that extends behind it - the near plane clips it
+	OcclusionCuller *culler = new OcclusionCuller(1, 128, 128);
+	float floor[] = { -100.0f, -2.0f, -50.0f, -100.0f, -2.0f, 100.0f, 100.0f, -2.0f, 100.0f, 100.0f, -2.0f, -50.0f };
+
+	culler->addOccluder(floor, 3 * sizeof(float), 4, WallIndices, 6, nullptr);
+	culler->render(0, viewProj, pool);
+
+	float below[] = { 0.0f, -10.0f, 30.0f };
+	float above[] = { 0.0f, 3.0f, 30.0f };
+
+	CHECK(culler->getTrianglesRasterized() > 0);
+	CHECK(!culler->isSphereVisible(0, below, 1.0f));
+	CHECK(culler->isSphereVisible(0, above, 1.0f));
+
+	culler->release();
+}
+
+static void testMatchesReference(const float *viewProj, WorkerPool *pool) {
+
+	const int size = 128;
+
+	vector<float> positions;
+	vector<uint32_t> indices;
+
+	srand(1);
+
+	for (uint32_t t = 0; t < 300; t++) {
+
+		float x = (rand() % 200 - 100) / 10.0f, y = (rand() % 200 - 100) / 10.0f, z = 5.0f + rand() % 50;
+
+		for (int k = 0; k < 3; k++) {
+
+			positions.push_back(x + (rand() % 100 - 50) / 10.0f);
+			positions.push_back(y + (rand() % 100 - 50) / 10.0f);
+			positions.push_back(z + (rand() % 100) / 20.0f);
+			indices.push_back(3 * t + k);
+		}
+	}
+
+	OcclusionCuller *culler = new OcclusionCuller(1, size, size);
+
+	culler->addOccluder(positions.data(), 3 * sizeof(float), (uint32_t)positions.size() / 3, indices.data(), (uint32_t)indices.size(), nullptr);
+	culler->render(0, viewProj, pool);
+
+	vector<float> reference;
+
+	rasterizeReference(viewProj, size, positions, indices, reference);
+
+	const float *depth = culler->getDepthBuffer(0);
+	int mismatches = 0;
+
+	for (int i = 0; i < size * size; i++) {
+
+		if (fabs(reference[i] - depth[i]) > 1e-3)
+			mismatches++;
+	}
+
+	CHECK(mismatches == 0);
+
+	culler->release();
+}
+
+static void testPoolMatchesSerial(const float *viewProj, WorkerPool *pool) {
+
+	vector<float> positions;
+	vector<uint32_t> indices;
+
+	srand(2);
+
+	// 20000 small triangles, each added with both windings
+	for (uint32_t t = 0; t < 20000; t++) {
+
+		float x = (rand() % 400 - 200) / 10.0f, y = (rand() % 400 - 200) / 10.0f, z = 5.0f + rand() % 100;
+
+		for (int k = 0; k < 3; k++) {
+
+			positions.push_back(x + (rand() % 40 - 20) / 10.0f);
+			positions.push_back(y + (rand() % 40 - 20) / 10.0f);
+			positions.push_back(z);
+		}
+
+		uint32_t triangle[] = { 3 * t, 3 * t + 2, 3 * t + 1, 3 * t, 3 * t + 1, 3 * t + 2 };
+
+		indices.insert(indices.end(), triangle, triangle + 6);
+	}
+
+	OcclusionCuller *culler = new OcclusionCuller(1, 256, 256);
+
+	culler->addOccluder(positions.data(), 3 * sizeof(float), (uint32_t)positions.size() / 3, indices.data(), (uint32_t)indices.size(), nullptr);
+
+	culler->render(0, viewProj, nullptr);
+
+	vector<float> serial(culler->getDepthBuffer(0), culler->getDepthBuffer(0) + 256 * 256);
+
+	culler->render(0, viewProj, pool);
+
+	CHECK(culler->getTrianglesRasterized() > 0);
+	CHECK(memcmp(serial.data(), culler->getDepthBuffer(0), serial.size() * sizeof(float)) == 0);
+
+	culler->release();
+}
+
+
+int main() {
+
+	float viewProj[16];
+
+	perspective(viewProj, 3.14159265f / 2.0f, 1.0f, 1.0f, 1000.0f);
+
+	WorkerPool *pool = new WorkerPool(3);
+
+	testWall(viewProj, nullptr);
+	testWall(viewProj, pool);
+	testReversedWinding(viewProj);
+	testFloorCrossingNearPlane(viewProj, pool);
+	testMatchesReference(viewProj, nullptr);
+	testMatchesReference(viewProj, pool);
+	testPoolMatchesSerial(viewProj, pool);
+
+	pool->release();
+
+	return TEST_RESULT("OcclusionCullerTest");
+}
@@ -0,0 +1,57 @@
+//
+// stdafx.h
+//
+
+// Stand-in for the pre-compiled header used when the platform independent sources are built with g++ for the tests.  Only the standard library and the core types are included - no Windows or Direct3D headers.
+//
+// The sources throw exception("message") which relies on the MSVC std::exception constructor taking a message.  exception is mapped to a runtime_error that provides one, so every standard header a source may use is included before the mapping.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+
+// Core types
+#include <GUObject.h>
+#include <CGDClock.h>
+
+
+namespace gu_portable {
+
+	class exception : public std::runtime_error {
+
+	public:
+
+		explicit exception(const char *message) : std::runtime_error(message) {}
+	};
+}
+
+#define exception gu_portable::exception
+
+using std::max;
+using std::min;
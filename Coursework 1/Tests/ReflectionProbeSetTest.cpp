@@ -0,0 +1,112 @@
+//
+// ReflectionProbeSetTest.cpp
+//
+
+// Write a prefiltered cube map with ReflectionProbeSet::writeCubeDDS and read it back with CubeMapFilter::readCubeDDS, and check that the blend between two probes moves smoothly from one to the other with weights that sum to 1.
+
+#include <stdafx.h>
+#include <ReflectionProbeSet.h>
+#include <CubeMapFilter.h>
+#include <Test.h>
+
+using namespace std;
+
+
+static const int Size = 16;
+static const char *ProbeFilename = "Build/ReflectionProbeSetTest.dds";
+
+
+static void testDDSRoundTrip() {
+
+	vector<uint8_t> texels((size_t)6 * Size * Size * 4), filtered, readTexels;
+
+	srand(7);
+
+	for (size_t i = 0; i < texels.size(); i++)
+		texels[i] = (uint8_t)(rand() % 256);
+
+	int levels = CubeMapFilter::getMipLevelCount(Size);
+
+	CubeMapFilter::prefilterGGX(texels.data(), Size, levels, 16, nullptr, &filtered);
+
+	CHECK(ReflectionProbeSet::writeCubeDDS(ProbeFilename, Size, levels, filtered));
+
+	int size = 0;
+
+	CHECK(CubeMapFilter::readCubeDDS(ProbeFilename, &size, &readTexels));
+	CHECK(size == Size);
+	CHECK(readTexels.size() == texels.size());
+
+	// readCubeDDS returns the most detailed level of each face, which the prefilter copies from the source
+	if (readTexels.size() == texels.size())
+		CHECK(readTexels == texels);
+
+	// The texel data must match the size and level count
+	filtered.pop_back();
+	CHECK(!ReflectionProbeSet::writeCubeDDS(ProbeFilename, Size, levels, filtered));
+
+	remove(ProbeFilename);
+}
+
+static void testBlend() {
+
+	ReflectionProbeSet *probes = new ReflectionProbeSet();
+
+	int probeA, probeB;
+	float weightB;
+	float origin[3] = { 0.0f, 0.0f, 0.0f };
+
+	CHECK(!probes->blend(origin, &probeA, &probeB, &weightB));
+
+	float positions[2][3] = { { 0.0f, 0.0f, 0.0f }, { 10.0f, 0.0f, 0.0f } };
+
+	CHECK(probes->addProbe(positions[0], 8.0f) == 0);
+	CHECK(probes->addProbe(positions[1], 8.0f) == 1);
+
+	// Walk from the first probe to the second - the weight of the second probe rises from 0 to 1
+	float previousWeight = -1.0f;
+
+	for (int step = 0; step <= 20; step++) {
+
+		float point[3] = { step * 0.5f, 1.0f, 0.0f };
+
+		CHECK(probes->blend(point, &probeA, &probeB, &weightB));
+		CHECK(weightB >= 0.0f && weightB <= 1.0f);
+
+		float weights[2] = { 0.0f, 0.0f };
+
+		weights[probeA] += 1.0f - weightB;
+		weights[probeB] += weightB;
+
+		CHECK_NEAR(weights[0] + weights[1], 1.0f, 1e-5);
+		CHECK(weights[1] >= previousWeight - 1e-5f);
+
+		previousWeight = weights[1];
+	}
+
+	float midpoint[3] = { 5.0f, 0.0f, 0.0f };
+
+	probes->blend(midpoint, &probeA, &probeB, &weightB);
+	CHECK(probeA != probeB);
+	CHECK_NEAR(weightB, 0.5f, 1e-5);
+
+	// A point at a probe centre, or outside every probe, uses the nearest probe alone
+	probes->blend(positions[1], &probeA, &probeB, &weightB);
+	CHECK(probeA == 1 && probeB == 1 && weightB == 0.0f);
+
+	float outside[3] = { -20.0f, 0.0f, 0.0f };
+
+	probes->blend(outside, &probeA, &probeB, &weightB);
+	CHECK(probeA == 0 && probeB == 0 && weightB == 0.0f);
+
+	probes->release();
+}
+
+
+int main() {
+
+	testDDSRoundTrip();
+	testBlend();
+
+	return TEST_RESULT("ReflectionProbeSetTest");
+}
@@ -0,0 +1,155 @@
+//
+// ReflectionSchedulerTest.cpp
+//
+
+// Run ReflectionScheduler for every face budget and check that the faces are rendered round-robin within ceil(6 / facesPerFrame) frames when nothing changes, that dirty faces are rendered ahead of clean ones without starving them and that a full refresh renders every face in the next frame.
+
+#include <stdafx.h>
+#include <ReflectionScheduler.h>
+#include <Test.h>
+
+using namespace std;
+
+
+static const int NumFaces = ReflectionScheduler::NumFaces;
+
+
+static int faceCount(const uint32_t mask) {
+
+	int count = 0;
+
+	for (int face = 0; face < NumFaces; face++)
+		count += (mask >> face) & 1;
+
+	return count;
+}
+
+// Frames for a round-robin pass over every face
+static int passFrames(const int facesPerFrame) {
+
+	return (NumFaces + facesPerFrame - 1) / facesPerFrame;
+}
+
+// Schedule frames frames, marking dirtyMask (or random faces if dirtyMask is negative) dirty before each, and return the most frames any face went between renders
+static int longestWait(ReflectionScheduler *scheduler, const int frames, const int dirtyMask) {
+
+	int lastRendered[NumFaces] = {};
+	int longest = 0;
+
+	for (int frame = 1; frame <= frames; frame++) {
+
+		if (dirtyMask != 0)
+			scheduler->markDirty((dirtyMask > 0) ? (uint32_t)dirtyMask : (uint32_t)(rand() & rand() & ReflectionScheduler::AllFaces));
+
+		uint32_t faces = scheduler->schedule();
+
+		CHECK(faceCount(faces) == scheduler->getFacesPerFrame());
+
+		for (int face = 0; face < NumFaces; face++) {
+
+			if (faces & (1 << face)) {
+
+				longest = max(longest, frame - lastRendered[face]);
+				lastRendered[face] = frame;
+			}
+		}
+	}
+
+	// Faces never rendered have waited since the start
+	for (int face = 0; face < NumFaces; face++)
+		longest = max(longest, frames + 1 - lastRendered[face]);
+
+	return longest;
+}
+
+static void testRoundRobin() {
+
+	for (int facesPerFrame = 1; facesPerFrame <= NumFaces; facesPerFrame++) {
+
+		ReflectionScheduler *scheduler = new ReflectionScheduler(facesPerFrame);
+
+		// The faces hold nothing until the first frame renders them all
+		CHECK(scheduler->schedule() == ReflectionScheduler::AllFaces);
+
+		CHECK(longestWait(scheduler, 60, 0) <= passFrames(facesPerFrame));
+		CHECK(scheduler->getFacesRendered() == (uint64_t)NumFaces + 60 * facesPerFrame);
+
+		scheduler->release();
+	}
+}
+
+static void testDirtyFirst() {
+
+	for (int facesPerFrame = 1; facesPerFrame < NumFaces; facesPerFrame++) {
+
+		ReflectionScheduler *scheduler = new ReflectionScheduler(facesPerFrame);
+
+		scheduler->schedule();
+		scheduler->schedule();
+
+		// Face 5 was rendered most recently (or with the faces just before it) so would be last in a round-robin pass
+		scheduler->markDirty(1 << 5);
+		CHECK(scheduler->getDirtyFaces() == (1 << 5));
+
+		uint32_t faces = scheduler->schedule();
+
+		CHECK((faces & (1 << 5)) != 0);
+		CHECK(scheduler->getDirtyFaces() == 0);
+		CHECK(scheduler->getFaceAge(5) == 0);
+
+		scheduler->release();
+	}
+}
+
+static void testNoStarvation() {
+
+	srand(5);
+
+	for (int facesPerFrame = 1; facesPerFrame <= NumFaces; facesPerFrame++) {
+
+		// A dirty face is worth one pass of waiting, so a face waits at most two passes however often the others change
+		int limit = 2 * passFrames(facesPerFrame);
+
+		ReflectionScheduler *scheduler = new ReflectionScheduler(facesPerFrame);
+
+		scheduler->schedule();
+		CHECK(longestWait(scheduler, 200, 1) <= limit);
+
+		scheduler->requestFullRefresh();
+		scheduler->schedule();
+		CHECK(longestWait(scheduler, 200, -1) <= limit);
+
+		scheduler->release();
+	}
+}
+
+static void testFullRefresh() {
+
+	ReflectionScheduler *scheduler = new ReflectionScheduler(1);
+
+	scheduler->schedule();
+	scheduler->schedule();
+
+	scheduler->requestFullRefresh();
+	CHECK(scheduler->schedule() == ReflectionScheduler::AllFaces);
+
+	for (int face = 0; face < NumFaces; face++)
+		CHECK(scheduler->getFaceAge(face) == 0);
+
+	CHECK(faceCount(scheduler->schedule()) == 1);
+	CHECK(scheduler->getFullRefreshes() == 2);
+	CHECK(scheduler->getFramesScheduled() == 4);
+
+	scheduler->release();
+}
+
+
+int main() {
+
+	testRoundRobin();
+	testDirtyFirst();
+	testNoStarvation();
+	testFullRefresh();
+
+	return TEST_RESULT("ReflectionSchedulerTest");
+}
@@ -0,0 +1,33 @@
+//
+// Test.h
+//
+
+// Minimal checks shared by the test programs.  A failed check reports its expression and location and the program returns the number of failures from main (via TEST_RESULT) so make stops on the first failing test.
+
+#pragma once
+
+#include <cmath>
+#include <iostream>
+
+
+static int testFailures = 0;
+
+#define CHECK(expression) \
+	do { \
+		if (!(expression)) { \
+			std::cout << __FILE__ << "(" << __LINE__ << "): check failed: " << #expression << std::endl; \
+			testFailures++; \
+		} \
+	} while (0)
+
+#define CHECK_NEAR(value, expected, tolerance) \
+	do { \
+		double checkValue = (double)(value), checkExpected = (double)(expected); \
+		if (!(std::fabs(checkValue - checkExpected) <= (tolerance))) { \
+			std::cout << __FILE__ << "(" << __LINE__ << "): " << #value << " = " << checkValue << ", expected " << checkExpected << std::endl; \
+			testFailures++; \
+		} \
+	} while (0)
+
+#define TEST_RESULT(name) \
+	((testFailures == 0) ? (std::cout << name << ": passed" << std::endl, 0) : (std::cout << name << ": " << testFailures << " check(s) failed" << std::endl, 1))
@@ -0,0 +1,93 @@
+
+//
+// WorkerPoolTest.cpp
+//
+
+// Check that WorkerPool runs every task, that a task running on the pool can spread work across the same pool with parallelFor and that exceptions are rethrown from the wait of the task's group.
+
+#include <stdafx.h>
+#include <WorkerPool.h>
+#include <Test.h>
+
+using namespace std;
+
+
+static void testParallelFor(WorkerPool *pool) {
+
+	vector<int> counts(1000, 0);
+
+	pool->parallelFor((int)counts.size(), [&counts](int i) { counts[i]++; });
+
+	CHECK(count(counts.begin(), counts.end(), 1) == (int)counts.size());
+}
+
+static void testNestedParallelFor(WorkerPool *pool) {
+
+	// Each outer task waits on inner work submitted to the pool it is running on
+	const int outer = 8, inner = 64;
+	vector<atomic<int> > counts(outer);
+
+	for (int i = 0; i < outer; i++)
+		counts[i] = 0;
+
+	for (int i = 0; i < outer; i++)
+		pool->submit([pool, &counts, i]() { pool->parallelFor(inner, [&counts, i](int) { counts[i]++; }); });
+
+	pool->wait();
+
+	for (int i = 0; i < outer; i++)
+		CHECK(counts[i] == inner);
+}
+
+static void testExceptions(WorkerPool *pool) {
+
+	bool threw = false;
+
+	try {
+
+		pool->parallelFor(16, [](int i) {
+
+			if (i == 5)
+				throw runtime_error("task failed");
+		});
+	}
+	catch (const runtime_error &) {
+
+		threw = true;
+	}
+
+	CHECK(threw);
+
+	// The exception belonged to the group so the pool is left clean
+	threw = false;
+
+	try {
+
+		pool->submit([]() {});
+		pool->wait();
+	}
+	catch (const runtime_error &) {
+
+		threw = true;
+	}
+
+	CHECK(!threw);
+}
+
+
+int main() {
+
+	// No worker threads (everything runs on the waiting thread) and a pool with workers
+	for (int threads = 0; threads <= 3; threads += 3) {
+
+		WorkerPool *pool = new WorkerPool(threads);
+
+		testParallelFor(pool);
+		testNestedParallelFor(pool);
+		testExceptions(pool);
+
+		pool->release();
+	}
+
+	return TEST_RESULT("WorkerPoolTest");
+}